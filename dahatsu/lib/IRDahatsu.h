@@ -1,7 +1,18 @@
+#pragma once
+
+#include "esphome.h"
+#include <IRsend.h>
 #include <ir_Tcl.h>
 #include <IRutils.h>
 
+#include "../../shared_libs/EnumNames.h"
+#include "../../shared_libs/HeapDiagnostics.h"
+#include "../../shared_libs/LatencyHistogram.h"
+#include "../../shared_libs/IRReceiverHub.h"
+#include "../../shared_libs/IRTransmitter.h"
+
 namespace ir_climate {
+namespace dahatsu {
 
 static const char *TAG = "ir.dahatsu";
 
@@ -28,6 +39,108 @@ enum AC_MODE : uint8_t {
   MODE_AUTO = 8,
 };
 
+static constexpr EnumName MODE_NAMES[] PROGMEM = {
+    {"off", AC_MODE::MODE_OFF},
+    {"auto", AC_MODE::MODE_AUTO},
+    {"cool", AC_MODE::MODE_COOL},
+    {"heat", AC_MODE::MODE_HEAT},
+    {"fan_only", AC_MODE::MODE_FAN},
+    {"dry", AC_MODE::MODE_DRY},
+    {"undefined", AC_MODE::MODE_UNDEFINED}};
+static_assert(enum_keys_unique(MODE_NAMES), "MODE_NAMES: first letter and length must be unique");
+static constexpr EnumIndex MODE_INDEX PROGMEM = enum_index(MODE_NAMES);
+static_assert(MODE_INDEX.seed != 0, "MODE_NAMES: no perfect hash seed");
+
+static constexpr EnumName FAN_MODE_NAMES[] PROGMEM = {
+    {"auto", FAN_MODE::FAN_AUTO},
+    {"low", FAN_MODE::FAN_LOW},
+    {"medium", FAN_MODE::FAN_MEDIUM},
+    {"high", FAN_MODE::FAN_HIGH},
+    {"undefined", FAN_MODE::FAN_UNDEFINED}};
+static_assert(enum_keys_unique(FAN_MODE_NAMES), "FAN_MODE_NAMES: first letter and length must be unique");
+static constexpr EnumIndex FAN_MODE_INDEX PROGMEM = enum_index(FAN_MODE_NAMES);
+static_assert(FAN_MODE_INDEX.seed != 0, "FAN_MODE_NAMES: no perfect hash seed");
+
+static constexpr EnumName SWING_MODE_NAMES[] PROGMEM = {
+    {"off", SWING_MODE::SWING_OFF},
+    {"horizontal", SWING_MODE::SWING_HORIZONTAL}};
+static_assert(enum_keys_unique(SWING_MODE_NAMES), "SWING_MODE_NAMES: first letter and length must be unique");
+static constexpr EnumIndex SWING_MODE_INDEX PROGMEM = enum_index(SWING_MODE_NAMES);
+static_assert(SWING_MODE_INDEX.seed != 0, "SWING_MODE_NAMES: no perfect hash seed");
+
+//Возможности режима, биты маски features
+enum CAPABILITY : uint8_t {
+  CAP_LIGHT = 1 << 0,
+  CAP_TURBO = 1 << 1,
+  CAP_HEALTH = 1 << 2,
+  CAP_ECO = 1 << 3,
+  CAP_SET_TEMP = 1 << 4,
+};
+
+static constexpr uint16_t fan_bit(const FAN_MODE fan_mode) { return 1 << fan_mode; }
+
+static constexpr uint16_t FAN_MASK_ALL = fan_bit(FAN_AUTO) | fan_bit(FAN_LOW) | fan_bit(FAN_MEDIUM) | fan_bit(FAN_HIGH);
+
+//Таблица возможностей по режимам, по ней работают set_mode и проверки set_*.
+//fan_modes - маска допустимых режимов обдува (fan_bit), default_fan - обдув, если текущий недопустим
+struct ModeCapabilities {
+  AC_MODE mode;
+  uint8_t features;
+  uint16_t fan_modes;
+  FAN_MODE default_fan;
+};
+
+static constexpr ModeCapabilities MODE_CAPABILITIES[] = {
+    {AC_MODE::MODE_HEAT, CAP_HEALTH | CAP_LIGHT | CAP_TURBO | CAP_ECO | CAP_SET_TEMP, FAN_MASK_ALL, FAN_MODE::FAN_MEDIUM},
+    {AC_MODE::MODE_DRY, CAP_HEALTH | CAP_LIGHT | CAP_TURBO, fan_bit(FAN_AUTO), FAN_MODE::FAN_AUTO},
+    {AC_MODE::MODE_COOL, CAP_HEALTH | CAP_LIGHT | CAP_TURBO | CAP_ECO | CAP_SET_TEMP, FAN_MASK_ALL, FAN_MODE::FAN_MEDIUM},
+    {AC_MODE::MODE_FAN, CAP_HEALTH | CAP_LIGHT | CAP_TURBO, FAN_MASK_ALL & ~fan_bit(FAN_AUTO), FAN_MODE::FAN_MEDIUM},
+    {AC_MODE::MODE_AUTO, CAP_HEALTH | CAP_LIGHT, FAN_MASK_ALL, FAN_MODE::FAN_MEDIUM}};
+
+//Таблица поведения режимов из README. Заполняется по README, а не по MODE_CAPABILITIES:
+//ограничения режимов сверяются с ней при компиляции, поведение команд - перебором состояний
+//драйвера на хосте (host/tools/dahatsu_verifier.cpp), он же сверяет таблицу с текстом README.
+//fan_modes - маска fan_bit, turbo_temp 0 - турбо температуру не меняет
+struct ModeRule {
+  AC_MODE mode;
+  uint8_t fan_modes;
+  bool set_temp;
+  bool health;
+  bool light;
+  bool turbo;
+  bool eco;
+  FAN_MODE turbo_fan;
+  uint8_t turbo_temp;
+};
+
+static constexpr ModeRule MODE_RULES[] = {
+    {AC_MODE::MODE_AUTO, FAN_MASK_ALL, false, true, true, false, false, FAN_MODE::FAN_UNDEFINED, 0},
+    {AC_MODE::MODE_FAN, FAN_MASK_ALL & ~fan_bit(FAN_AUTO), false, true, true, true, false, FAN_MODE::FAN_HIGH, 0},
+    {AC_MODE::MODE_COOL, FAN_MASK_ALL, true, true, true, true, true, FAN_MODE::FAN_HIGH, 16},
+    {AC_MODE::MODE_HEAT, FAN_MASK_ALL, true, true, true, true, true, FAN_MODE::FAN_HIGH, 31},
+    {AC_MODE::MODE_DRY, fan_bit(FAN_AUTO), false, true, true, true, false, FAN_MODE::FAN_LOW, 0}};
+
+static constexpr size_t MODE_COUNT = sizeof(MODE_CAPABILITIES) / sizeof(MODE_CAPABILITIES[0]);
+
+static constexpr bool rule_matches(const ModeRule& rule, const ModeCapabilities& capabilities) {
+  return rule.fan_modes == capabilities.fan_modes && rule.set_temp == ((capabilities.features & CAP_SET_TEMP) != 0) &&
+         rule.health == ((capabilities.features & CAP_HEALTH) != 0) &&
+         rule.light == ((capabilities.features & CAP_LIGHT) != 0) &&
+         rule.turbo == ((capabilities.features & CAP_TURBO) != 0) && rule.eco == ((capabilities.features & CAP_ECO) != 0);
+}
+
+static constexpr bool rule_matches_mode(const ModeRule& rule, const size_t i = 0) {
+  return i < MODE_COUNT &&
+         (MODE_CAPABILITIES[i].mode == rule.mode ? rule_matches(rule, MODE_CAPABILITIES[i]) : rule_matches_mode(rule, i + 1));
+}
+
+static constexpr bool rules_match_capabilities(const size_t i = 0) {
+  return i >= sizeof(MODE_RULES) / sizeof(MODE_RULES[0]) || (rule_matches_mode(MODE_RULES[i]) && rules_match_capabilities(i + 1));
+}
+
+static_assert(sizeof(MODE_RULES) / sizeof(MODE_RULES[0]) == MODE_COUNT, "MODE_RULES: every mode needs a README rule");
+static_assert(rules_match_capabilities(), "MODE_CAPABILITIES: fan modes or features differ from MODE_RULES (README)");
+
 class State {
  public:
   float temp;
@@ -44,16 +157,27 @@ class State {
 class IRDahatsu {
  private:
   IRTcl112Ac* ac_;
-  IRrecv* ir_receiver_{nullptr};
-  decode_results* decode_results_;
+  IRTransmitter* ir_transmitter_;
+  IRReceiverHub* receiver_hub_{nullptr};
   CallbackManager<void()> state_callback_{};
+  CallbackManager<void()> send_callback_{};
+
+  //кадр, ожидающий отправки из loop(), очередь на один кадр
+  uint8_t tx_frame_[kTcl112AcStateLength];
+  bool tx_pending_{false};
+  //кадр в эфире, прерывание timer1 еще не закончило его отправку
+  bool transmitting_{false};
+  uint32_t tx_hash_{0};
   State* state_{nullptr};
 
-  bool health_enabled_{true};
-  bool light_enabled_{true};
-  bool turbo_enabled_{true};
-  bool eco_enabled_{true};
-  bool set_temp_enabled_{true};
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+  //буфер для to_string, строка живет до следующего вызова
+  mutable char string_buffer_[192];
+#endif
+
+  //маски текущего режима из MODE_CAPABILITIES, до первого set_mode - все разрешено
+  uint8_t features_{CAP_HEALTH | CAP_LIGHT | CAP_TURBO | CAP_ECO | CAP_SET_TEMP};
+  uint16_t fan_modes_{FAN_MASK_ALL};
 
  public:
   const float temp_min = 16;
@@ -84,31 +208,51 @@ class IRDahatsu {
       swing_mode_to_str(SWING_MODE::SWING_OFF),
       swing_mode_to_str(SWING_MODE::SWING_HORIZONTAL)};
 
-  IRDahatsu(uint16_t receiver_pin, uint16_t transmitter_pin) {
+  IRDahatsu(uint16_t receiver_pin, uint16_t transmitter_pin)
+      : IRDahatsu(new IRReceiverHub(receiver_pin, 300, 20, 40), transmitter_pin) {}
+
+  //приемник общий для нескольких кондиционеров на одном узле, передатчик у каждого свой
+  IRDahatsu(IRReceiverHub* receiver_hub, uint16_t transmitter_pin) {
     ac_ = new IRTcl112Ac(transmitter_pin);
-    ir_receiver_ = new IRrecv(receiver_pin, 300, 20, true);
-    ir_receiver_->setTolerance(40);
+    ir_transmitter_ = new IRTransmitter(transmitter_pin);
+    receiver_hub_ = receiver_hub;
+    receiver_hub_->add_on_frame_callback([this](const decode_results* results) { this->on_frame_(results); });
     ac_->setPower(false);
 
     //инициализация констрейнтов
     set_mode(get_mode());
-    decode_results_ = new decode_results();
   }
 
   void setup() const {
-    ir_receiver_->enableIRIn();
+    receiver_hub_->setup();
     ac_->begin();
+    ir_transmitter_->begin();
   }
 
   void add_on_state_callback(std::function<void()>&& callback) { this->state_callback_.add(std::move(callback)); }
 
-  void send() const {
-    ir_receiver_->disableIRIn();
-    ac_->send();
+  //вызывается после того, как кадр ушел в эфир
+  void add_on_send_callback(std::function<void()>&& callback) { this->send_callback_.add(std::move(callback)); }
+
+  //ставит текущее состояние в очередь, сам кадр отправляется из loop()
+  void send() {
+    //неотправленный кадр заменяется новым, состояние в нем полное
+    if(this->tx_pending_) {
+      ESP_LOGD(TAG, "[send]: предыдущий кадр еще не отправлен, заменяем");
+    }
+
+    memcpy(this->tx_frame_, this->ac_->getRaw(), kTcl112AcStateLength);
+    this->tx_pending_ = true;
     ESP_LOGD(TAG, "[send]: %s", this->to_string());
-    ir_receiver_->enableIRIn();
   }
 
+  bool is_send_pending() const { return this->tx_pending_ || this->transmitting_; }
+
+  IRReceiverHub* get_receiver_hub() const { return this->receiver_hub_; }
+
+  //сколько повторных кадров с пульта не было применено
+  uint32_t get_duplicate_frames() const { return this->receiver_hub_->get_duplicate_frames(); }
+
   State* get_prev_state() const { return this->state_; }
 
   bool set_temp(const float temp) {
@@ -120,7 +264,7 @@ class IRDahatsu {
 
     this->ac_->setTemp(temp);
 
-    if(this->set_temp_enabled_ == false)
+    if(set_temp_allowed() == false)
       return false;
 
     return true;
@@ -128,36 +272,33 @@ class IRDahatsu {
 
   float get_temp() const { return this->ac_->getTemp(); }
 
-  bool set_temp_allowed() const { return this->set_temp_enabled_; }
+  bool set_temp_allowed() const { return (this->features_ & CAP_SET_TEMP) != 0; }
 
   void set_mode(const AC_MODE mode) {
 
     switch (mode) {
       case AC_MODE::MODE_HEAT:
         this->ac_->setMode(1);
-        set_constraints(true, true, true, true, true, FAN_MODE::FAN_MEDIUM);
         break;
       case AC_MODE::MODE_DRY:
         set_turbo(false);
         this->ac_->setMode(2);
-        set_constraints(true, true, true, false, false, FAN_MODE::FAN_AUTO);
         break;
       case AC_MODE::MODE_COOL:
         set_turbo(false);
         this->ac_->setMode(3);
-        set_constraints(true, true, true, true, true, FAN_MODE::FAN_MEDIUM);
         break;
       case AC_MODE::MODE_FAN:
         this->ac_->setMode(7);
-        set_constraints(true, true, true, false, false, FAN_MODE::FAN_MEDIUM);
         break;
       case AC_MODE::MODE_AUTO:
         this->ac_->setMode(8);
-        set_constraints(true, true, false, false, false, FAN_MODE::FAN_MEDIUM);
         break;
       default:
-        break;
+        return;
     }
+
+    set_constraints(mode);
   }
 
   AC_MODE get_mode() const {
@@ -192,22 +333,13 @@ class IRDahatsu {
       this->ac_->setPower(true);
   }
 
-  void set_hvac_mode(const std::string& mode) {
-    if (str_equals_case_insensitive(mode, "OFF")) {
-      this->set_hvac_mode(AC_MODE::MODE_OFF);
-    } else if (str_equals_case_insensitive(mode, "AUTO")) {
-      this->set_hvac_mode(AC_MODE::MODE_AUTO);
-    } else if (str_equals_case_insensitive(mode, "COOL")) {
-      this->set_hvac_mode(AC_MODE::MODE_COOL);
-    } else if (str_equals_case_insensitive(mode, "HEAT")) {
-      this->set_hvac_mode(AC_MODE::MODE_HEAT);
-    } else if (str_equals_case_insensitive(mode, "FAN_ONLY")) {
-      this->set_hvac_mode(AC_MODE::MODE_FAN);
-    } else if (str_equals_case_insensitive(mode, "DRY")) {
-      this->set_hvac_mode(AC_MODE::MODE_DRY);
-    } else {
-      ESP_LOGW(TAG, "[set_hvac_mode]: Unrecognized mode %s", mode.c_str());
-    }
+  void set_hvac_mode(const std::string& mode_str) {
+    auto mode = parse_mode(mode_str);
+
+    if (mode == AC_MODE::MODE_UNDEFINED)
+      ESP_LOGW(TAG, "[set_hvac_mode]: Unrecognized mode %s", mode_str.c_str());
+    else
+      set_hvac_mode(mode);
   }
 
   AC_MODE get_hvac_mode() const {
@@ -221,25 +353,10 @@ class IRDahatsu {
 
   const char* get_hvac_mode_str() const { return mode_to_str(this->get_hvac_mode()); }
 
-  bool is_fan_mode_supported(const FAN_MODE fan_mode) const {
-    const auto mode = this->ac_->getMode();
-
-    // для режима FAN доступны все режимы  кроме auto
-    if (mode == AC_MODE::MODE_FAN) {
-      if (fan_mode == FAN_MODE::FAN_AUTO) return false;
+  bool is_fan_mode_supported(const FAN_MODE fan_mode) const { return (this->fan_modes_ & fan_bit(fan_mode)) != 0; }
 
-      return true;
-    }
-
-    //Для режима осушения доступен только один режим обдува: auto
-    if (mode == AC_MODE::MODE_DRY) {
-      if (fan_mode == FAN_MODE::FAN_AUTO) return true;
-
-      return false;
-    }
-
-    return true;
-  }
+  //маска fan_bit допустимых режимов обдува в текущем режиме
+  uint16_t get_fan_modes_mask() const { return this->fan_modes_; }
 
   bool set_fan(FAN_MODE fan_mode) {
 
@@ -333,7 +450,7 @@ class IRDahatsu {
   }
 
   bool set_light(const bool on) const {
-    if (this->light_enabled_ == false) return false;
+    if (light_allowed() == false) return false;
 
     this->ac_->setLight(on);
 
@@ -341,11 +458,10 @@ class IRDahatsu {
   }
 
   bool set_light(const std::string& on) const {
-    if (str_equals_case_insensitive(on, "OFF") || str_equals_case_insensitive(on, "FALSE"))
-      return set_light(false);
+    auto value = parse_on_off(on);
 
-    if (str_equals_case_insensitive(on, "ON") || str_equals_case_insensitive(on, "TRUE"))
-      return set_light(true);
+    if (value != ENUM_UNDEFINED)
+      return set_light(value == 1);
 
     ESP_LOGW(TAG, "[set_light]: Unrecognized light mode %s", on.c_str());
     return false;
@@ -353,20 +469,19 @@ class IRDahatsu {
 
   bool get_light() const { return this->ac_->getLight(); }
 
-  bool light_allowed() const { return this->light_enabled_; }
+  bool light_allowed() const { return (this->features_ & CAP_LIGHT) != 0; }
 
   bool set_turbo(const bool on) {
-    if (this->turbo_enabled_ == false) return false;
+    if (turbo_allowed() == false) return false;
 
     return set_turbo_(on);
   }
 
   bool set_turbo(const std::string& on) {
-    if (str_equals_case_insensitive(on, "OFF") || str_equals_case_insensitive(on, "FALSE"))
-      return set_turbo(false);
+    auto value = parse_on_off(on);
 
-    if (str_equals_case_insensitive(on, "ON") || str_equals_case_insensitive(on, "TRUE"))
-      return set_turbo(true);
+    if (value != ENUM_UNDEFINED)
+      return set_turbo(value == 1);
 
     ESP_LOGW(TAG, "[set_turbo]: Unrecognized turbo mode %s", on.c_str());
     return false;
@@ -374,10 +489,10 @@ class IRDahatsu {
 
   bool get_turbo() const { return this->ac_->getTurbo(); }
 
-  bool turbo_allowed() const { return this->turbo_enabled_; }
+  bool turbo_allowed() const { return (this->features_ & CAP_TURBO) != 0; }
 
   bool set_health(const bool on) const {
-    if (this->health_enabled_ == false) return false;
+    if (health_allowed() == false) return false;
 
     this->ac_->setHealth(on);
 
@@ -385,23 +500,21 @@ class IRDahatsu {
   }
 
   bool set_health(const std::string& on) const {
-    if (str_equals_case_insensitive(on, "OFF") || str_equals_case_insensitive(on, "FALSE"))
-      return set_health(false);
+    auto value = parse_on_off(on);
 
-    if (str_equals_case_insensitive(on, "ON") || str_equals_case_insensitive(on, "TRUE"))
-      return set_health(true);
+    if (value != ENUM_UNDEFINED)
+      return set_health(value == 1);
 
     ESP_LOGW(TAG, "[set_health]: Unrecognized health mode %s", on.c_str());
-
     return false;
   }
 
   bool get_health() const { return this->ac_->getHealth(); }
 
-  bool health_allowed() const { return this->health_enabled_; }
+  bool health_allowed() const { return (this->features_ & CAP_HEALTH) != 0; }
 
   bool set_eco(const bool on) {
-    if (this->eco_enabled_ == false) return false;
+    if (eco_allowed() == false) return false;
 
     if (get_eco() == on) return true;
 
@@ -414,20 +527,18 @@ class IRDahatsu {
   }
 
   bool set_eco(const std::string& on) {
-    if (str_equals_case_insensitive(on, "OFF") || str_equals_case_insensitive(on, "FALSE"))
-      return set_eco(false);
+    auto value = parse_on_off(on);
 
-    if (str_equals_case_insensitive(on, "ON") || str_equals_case_insensitive(on, "TRUE"))
-      return set_eco(true);
+    if (value != ENUM_UNDEFINED)
+      return set_eco(value == 1);
 
     ESP_LOGW(TAG, "[set_eco]: Unrecognized econo mode %s", on.c_str());
-
     return false;
   }
 
   bool get_eco() const { return this->ac_->getEcono(); }
 
-  bool eco_allowed() const { return this->eco_enabled_; }
+  bool eco_allowed() const { return (this->features_ & CAP_ECO) != 0; }
 
   //используется при инициализации состояния при запуске
   void initialize(
@@ -436,7 +547,7 @@ class IRDahatsu {
                   const std::string& fan_mode_str,
                   const std::string& swing_mode_str,
                   State* state,
-                  const uint8_t temp,
+                  const float temp,
                   const bool turbo,
                   const bool eco,
                   const bool health,
@@ -452,11 +563,24 @@ class IRDahatsu {
     if(temp >= temp_min && temp <= temp_max)
       this->ac_->setTemp(temp);
 
-    if(turbo) {
+    //turbo только там, где режим его допускает, состояние до turbo без turbo не нужно
+    if(turbo && turbo_allowed()) {
+      if(state != this->state_)
+        delete this->state_;
       this->state_ = state;
+      //turbo и eco не включаются вместе, set_eco ниже выключит turbo, если eco тоже сохранен
+      this->ac_->setEcono(false);
       this->ac_->setTurbo(true);
+      //как в set_turbo_: осушение в turbo работает на low
+      if(get_mode() == AC_MODE::MODE_DRY)
+        this->ac_->setFan(2);
     } else{
+      if(state != this->state_)
+        delete state;
       this->ac_->setTurbo(false);
+      //обдув turbo в осушении без turbo недопустим, ограничения режима возвращают обдув по умолчанию
+      if(is_fan_mode_supported(get_fan()) == false)
+        set_constraints(get_mode());
     }
 
     set_eco(eco);
@@ -464,35 +588,227 @@ class IRDahatsu {
     set_light(light);
   }
 
-  const char* to_string() const {
-    String result = "";
-    result.reserve(140);
+  //состояние для сохранения во flash, кадр целиком и то, чего в кадре нет
+  struct CompactState {
+    uint8_t raw[kTcl112AcStateLength];
+    uint8_t has_prev_state;
+    //шаг температуры 0.5, храним удвоенное значение
+    uint8_t prev_temp;
+    uint8_t prev_fan_mode;
+    uint8_t prev_swing_mode;
+  };
+
+  CompactState get_compact_state() const {
+    CompactState state{};
+    memcpy(state.raw, this->ac_->getRaw(), kTcl112AcStateLength);
+
+    if(this->state_ != nullptr) {
+      state.has_prev_state = 1;
+      state.prev_temp = this->state_->temp * 2;
+      state.prev_fan_mode = this->state_->fan_mode;
+      state.prev_swing_mode = this->state_->swing_mode;
+    }
 
-    auto power_on = get_hvac_mode() != AC_MODE::MODE_OFF;
+    return state;
+  }
+
+  //уставка в сохраненном состоянии, контрольная сумма кадра пересчитывается
+  static void set_compact_state_temp(CompactState& state, const float temp) {
+    IRTcl112Ac ac(0);
+    ac.setRaw(state.raw);
+    ac.setTemp(temp);
+    memcpy(state.raw, ac.getRaw(), kTcl112AcStateLength);
+  }
+
+  //false - состояние не применено: режим в кадре или состояние до turbo не распознаны
+  bool restore_compact_state(const CompactState& state) {
+    uint8_t prev_raw[kTcl112AcStateLength];
+    memcpy(prev_raw, this->ac_->getRaw(), kTcl112AcStateLength);
+    this->ac_->setRaw(state.raw, kTcl112AcStateLength);
+
+    const bool has_prev_state = get_turbo() && state.has_prev_state != 0;
+
+    if(get_mode() == AC_MODE::MODE_UNDEFINED || (has_prev_state && is_valid_prev_state_(state) == false)) {
+      ESP_LOGW(TAG, "[restore_compact_state]: состояние не распознано, mode: %u", this->ac_->getMode());
+      this->ac_->setRaw(prev_raw, kTcl112AcStateLength);
+      return false;
+    }
+
+    //set_mode пересчитывает ограничения режима, но может сбросить turbo, поэтому кадр восстанавливаем повторно
+    const auto prev_features = this->features_;
+    const auto prev_fan_modes = this->fan_modes_;
+    set_mode(get_mode());
+    this->ac_->setRaw(state.raw, kTcl112AcStateLength);
+
+    //кадр, который драйвер не мог сохранить: поля вне ограничений режима
+    if(is_valid_raw_state_() == false) {
+      ESP_LOGW(TAG, "[restore_compact_state]: состояние нарушает ограничения режима %s", get_mode_str());
+      this->ac_->setRaw(prev_raw, kTcl112AcStateLength);
+      this->features_ = prev_features;
+      this->fan_modes_ = prev_fan_modes;
+      return false;
+    }
+
+    //состояние до turbo от прошлого режима не должно пережить восстановление
+    if(has_prev_state == false) {
+      delete this->state_;
+      this->state_ = nullptr;
+      return true;
+    }
 
-    result += irutils::addBoolToString(power_on, "power", false);
-    result += irutils::addIntToString(get_hvac_mode(), "hvac_mode") + " (" + get_hvac_mode_str() +")";
-    result += irutils::addIntToString(get_mode(), "mode") + " (" + get_mode_str() +")";
-    result += irutils::addTempToString(get_temp());
-    result += irutils::addIntToString(get_fan(), "fan") + " (" + get_fan_str() +")";
-    result += irutils::addIntToString(get_swing_mode(), "swing") + " (" + get_swing_mode_str() +")";
+    const auto prev_temp = state.prev_temp * 0.5f;
+    const auto prev_fan_mode = static_cast<FAN_MODE>(state.prev_fan_mode);
+    const auto prev_swing_mode = static_cast<SWING_MODE>(state.prev_swing_mode);
 
-    result += irutils::addBoolToString(get_turbo(), "turbo", true);
-    result += irutils::addBoolToString(get_eco(), "eco", true);
-    result += irutils::addBoolToString(get_health(), "health", true);
-    result += irutils::addBoolToString(get_light(), "light", true);
+    if(this->state_ == nullptr) {
+      this->state_ = new State(prev_temp, prev_fan_mode, prev_swing_mode);
+    } else {
+      this->state_->temp = prev_temp;
+      this->state_->fan_mode = prev_fan_mode;
+      this->state_->swing_mode = prev_swing_mode;
+    }
+
+    return true;
+  }
+
+  //компактный отпечаток всего, что публикуется в info топик
+  uint64_t get_state_fingerprint() const {
+    uint64_t fingerprint = 0;
+    auto turbo = get_turbo();
+
+    fingerprint |= (uint64_t) get_hvac_mode();
+    fingerprint |= (uint64_t) get_mode() << 4;
+    fingerprint |= (uint64_t) get_fan() << 8;
+    fingerprint |= (uint64_t) get_swing_mode() << 12;
+    //шаг температуры 0.5, храним удвоенное значение
+    fingerprint |= (uint64_t) (uint8_t) (get_temp() * 2) << 13;
+    fingerprint |= (uint64_t) get_light() << 21;
+    fingerprint |= (uint64_t) turbo << 22;
+    fingerprint |= (uint64_t) get_health() << 23;
+    fingerprint |= (uint64_t) get_eco() << 24;
+    fingerprint |= (uint64_t) this->features_ << 25;
+
+    //предыдущее состояние публикуется только при включенном turbo
+    if(turbo && this->state_ != nullptr) {
+      fingerprint |= (uint64_t) 1 << 30;
+      fingerprint |= (uint64_t) (uint8_t) (this->state_->temp * 2) << 31;
+      fingerprint |= (uint64_t) this->state_->fan_mode << 39;
+      fingerprint |= (uint64_t) this->state_->swing_mode << 43;
+    }
+
+    return fingerprint;
+  }
+
+  //используется только в отладочных логах, ниже уровня DEBUG не собирается
+  const char* to_string() const {
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+    auto power_on = get_hvac_mode() != AC_MODE::MODE_OFF;
 
-    std::string data = result.c_str();
-    return data.c_str();
+    snprintf(this->string_buffer_, sizeof(this->string_buffer_),
+             "power: %s, hvac_mode: %u (%s), mode: %u (%s), Temp: %.1fC, fan: %u (%s), swing: %u (%s), "
+             "turbo: %s, eco: %s, health: %s, light: %s",
+             bool_to_str_(power_on),
+             get_hvac_mode(), get_hvac_mode_str(),
+             get_mode(), get_mode_str(),
+             get_temp(),
+             get_fan(), get_fan_str(),
+             get_swing_mode(), get_swing_mode_str(),
+             bool_to_str_(get_turbo()),
+             bool_to_str_(get_eco()),
+             bool_to_str_(get_health()),
+             bool_to_str_(get_light()));
+
+    return this->string_buffer_;
+#else
+    return "";
+#endif
   }
 
   void loop() {
+    receiver_hub_->loop();
+    transmit_();
+  }
+
+ private:
+  //кадр уходит в эфир по прерываниям, loop() только запускает отправку и ждет ее конца
+  void transmit_() {
+    if(this->transmitting_ && this->ir_transmitter_->is_busy() == false) {
+      this->transmitting_ = false;
+      receiver_hub_->resume();
+      this->receiver_hub_->remember_sent(this->tx_hash_);
+
+      ESP_LOGD(TAG, "[transmit]: кадр отправлен");
+
+      send_callback_.call();
+    }
+
+    //передатчик другого кондиционера занимает timer1, ждем следующего loop()
+    if(this->tx_pending_ == false || IRTransmitter::is_any_busy())
+      return;
+
+    //память замеряем вокруг кодирования и запуска кадра, сама отправка идет в прерывании timer1
+    heap_diagnostics::HeapProbe probe(heap_diagnostics::PROBE_IR_SEND);
+    encode_frame_(this->tx_frame_);
 
-    if (ir_receiver_->decode(decode_results_) == false)
+    receiver_hub_->pause();
+    if(this->ir_transmitter_->start() == false) {
+      receiver_hub_->resume();
+      ESP_LOGW(TAG, "[transmit]: кадр не помещается в буфер передатчика");
+      this->tx_pending_ = false;
       return;
+    }
+
+    this->tx_pending_ = false;
+    this->transmitting_ = true;
+    this->tx_hash_ = FrameDedup::hash(this->tx_frame_, kTcl112AcStateLength);
+  }
+
+  //кадр как в IRsend::sendTcl112Ac: заголовок, байты младшим битом вперед, footer, gap
+  void encode_frame_(const uint8_t* frame) {
+    this->ir_transmitter_->clear();
+    this->ir_transmitter_->mark(kTcl112AcHdrMark);
+    this->ir_transmitter_->space(kTcl112AcHdrSpace);
+    for(uint16_t i = 0; i < kTcl112AcStateLength; i++)
+      this->ir_transmitter_->data(frame[i], 8, kTcl112AcBitMark, kTcl112AcOneSpace, kTcl112AcBitMark,
+                                  kTcl112AcZeroSpace, false);
+    this->ir_transmitter_->mark(kTcl112AcBitMark);
+    this->ir_transmitter_->space(kTcl112AcGap);
+  }
+
+  void on_frame_(const decode_results* results) {
+    //приемник может быть общим с кондиционерами других протоколов
+    if(results->decode_type != decode_type_t::TCL112AC)
+      return;
+
+    latency_histogram::LatencyProbe latency(latency_histogram::PHASE_IR_DECODE);
+
+    //длина состояния берется из bits, rawlen - количество таймингов, а не байт
+    if(results->bits != kTcl112AcBits) {
+      ESP_LOGW(TAG, "[decoder]: неверная длина кадра: %u бит", results->bits);
+      return;
+    }
+
+    //кадр с неизвестным режимом не применяем, остальные поля библиотека приводит к допустимым значениям
+    uint8_t prev_raw[kTcl112AcStateLength];
+    memcpy(prev_raw, ac_->getRaw(), kTcl112AcStateLength);
+    ac_->setRaw(results->state, kTcl112AcStateLength);
+
+    if(get_mode() == AC_MODE::MODE_UNDEFINED) {
+      ESP_LOGW(TAG, "[decoder]: Unrecognized mode %u", ac_->getMode());
+      ac_->setRaw(prev_raw, kTcl112AcStateLength);
+      return;
+    }
+
+    ac_->setFan(ac_->getFan());
+    ac_->setTemp(ac_->getTemp());
+
+    //состояние с пульта важнее, неотправленный кадр устарел
+    if(this->tx_pending_) {
+      ESP_LOGD(TAG, "[decoder]: неотправленный кадр отменен");
+      this->tx_pending_ = false;
+    }
 
     ESP_LOGD(TAG, "[decoder]: Получены данные, обновляем состояние");
-    ac_->setRaw(decode_results_->state, decode_results_->rawlen);
     auto turbo = get_turbo();
 
     //инициализируем режим работы
@@ -505,98 +821,30 @@ class IRDahatsu {
     state_callback_.call();
   }
 
-  static const char* mode_to_str(const AC_MODE mode) {
-    switch (mode) {
-      case AC_MODE::MODE_HEAT:
-        return "heat";
-      case AC_MODE::MODE_DRY:
-        return "dry";
-      case AC_MODE::MODE_COOL:
-        return "cool";
-      case AC_MODE::MODE_FAN:
-        return "fan_only";
-      case AC_MODE::MODE_AUTO:
-        return "auto";
-      case AC_MODE::MODE_UNDEFINED:
-        return "undefined";
-      case AC_MODE::MODE_OFF:
-        return "off";
-      default:
-        return "undefined";
-    }
-  }
+ public:
+  static const char* mode_to_str(const AC_MODE mode) { return enum_to_str(MODE_NAMES, mode, "undefined"); }
 
-  static const char* fan_mode_to_str(const FAN_MODE mode) {
-    switch (mode) {
-      case FAN_MODE::FAN_AUTO:
-        return "auto";
-      case FAN_MODE::FAN_LOW:
-        return "low";
-      case FAN_MODE::FAN_MEDIUM:
-        return "medium";
-      case FAN_MODE::FAN_HIGH:
-        return "high";
-      case FAN_MODE::FAN_UNDEFINED:
-        return "undefined";
-      default:
-        return "auto";
-    }
-  }
+  static const char* fan_mode_to_str(const FAN_MODE mode) { return enum_to_str(FAN_MODE_NAMES, mode, "auto"); }
 
-  static const char* swing_mode_to_str(const SWING_MODE mode) {
-    switch (mode) {
-      case SWING_MODE::SWING_OFF:
-        return "off";
-      case SWING_MODE::SWING_HORIZONTAL:
-        return "horizontal";
-      default:
-        return "off";
-    }
-  }
+  static const char* swing_mode_to_str(const SWING_MODE mode) { return enum_to_str(SWING_MODE_NAMES, mode, "off"); }
 
-  static const SWING_MODE parse_swing_mode(const std::string& swing_mode) {
-    if (str_equals_case_insensitive(swing_mode, "OFF"))
-      return SWING_MODE::SWING_OFF;
+  static SWING_MODE parse_swing_mode(const std::string& swing_mode) {
+    auto value = str_to_enum(SWING_MODE_NAMES, SWING_MODE_INDEX, swing_mode, ENUM_UNDEFINED);
 
-    if (str_equals_case_insensitive(swing_mode, "HORIZONTAL"))
-      return SWING_MODE::SWING_HORIZONTAL;
+    if (value != ENUM_UNDEFINED)
+      return static_cast<SWING_MODE>(value);
 
     ESP_LOGW(TAG, "[parse_swing_mode]: Unrecognized swing mode %s", swing_mode.c_str());
 
     return SWING_MODE::SWING_OFF;
   }
 
-  static const FAN_MODE parse_fan_mode(const std::string& fan_mode) {
-    if (str_equals_case_insensitive(fan_mode, "AUTO"))
-      return FAN_MODE::FAN_AUTO;
-
-    if (str_equals_case_insensitive(fan_mode, "LOW"))
-      return FAN_MODE::FAN_LOW;
-
-    if (str_equals_case_insensitive(fan_mode, "MEDIUM"))
-      return FAN_MODE::FAN_MEDIUM;
-
-    if (str_equals_case_insensitive(fan_mode, "HIGH"))
-      return FAN_MODE::FAN_HIGH;
-
-    return FAN_MODE::FAN_UNDEFINED;
+  static FAN_MODE parse_fan_mode(const std::string& fan_mode) {
+    return static_cast<FAN_MODE>(str_to_enum(FAN_MODE_NAMES, FAN_MODE_INDEX, fan_mode, FAN_MODE::FAN_UNDEFINED));
   }
 
-  static const AC_MODE parse_mode(const std::string& mode) {
-    if (str_equals_case_insensitive(mode, "OFF"))
-      return AC_MODE::MODE_OFF;
-    if (str_equals_case_insensitive(mode, "AUTO"))
-      return AC_MODE::MODE_AUTO;
-    if (str_equals_case_insensitive(mode, "COOL"))
-      return AC_MODE::MODE_COOL;
-    if (str_equals_case_insensitive(mode, "HEAT"))
-      return AC_MODE::MODE_HEAT;
-    if (str_equals_case_insensitive(mode, "FAN_ONLY"))
-      return AC_MODE::MODE_FAN;
-    if (str_equals_case_insensitive(mode, "DRY"))
-      return AC_MODE::MODE_DRY;
-
-    return AC_MODE::MODE_UNDEFINED;
+  static AC_MODE parse_mode(const std::string& mode) {
+    return static_cast<AC_MODE>(str_to_enum(MODE_NAMES, MODE_INDEX, mode, AC_MODE::MODE_UNDEFINED));
   }
 
  private:
@@ -639,6 +887,9 @@ class IRDahatsu {
       if (get_turbo() == true) {
         this->ac_->setTurbo(false);
         apply_state_();
+        //состояние до turbo могло остаться от другого режима, обдув turbo в осушении без turbo недопустим
+        if (is_fan_mode_supported(get_fan()) == false)
+          set_constraints(get_mode());
         return true;
       }
 
@@ -663,8 +914,7 @@ class IRDahatsu {
       case AC_MODE::MODE_DRY:
         //запоминаем предыдущее состояние
         save_state_();
-        //При включеении переключает Fan: 2 (Low) Swing(H);
-        this->ac_->setFan(2);
+        //При включеении переключает Fan: 2 (Low) Swing(H); Fan ставится после setTurbo
         set_swing_mode(SWING_MODE::SWING_HORIZONTAL);
         break;
       case AC_MODE::MODE_COOL:
@@ -687,11 +937,42 @@ class IRDahatsu {
     }
 
     this->ac_->setTurbo(on);
+    //библиотека включает turbo с high, осушение в turbo работает на low
+    if (mode == AC_MODE::MODE_DRY)
+      this->ac_->setFan(2);
     return true;
   }
 
   static const char* bool_to_str_(const bool value) { return value ? "on" : "off"; }
 
+  bool is_valid_raw_state_() const {
+    const auto temp = get_temp();
+    if (temp < this->temp_min || temp > this->temp_max)
+      return false;
+
+    const auto turbo = get_turbo();
+    //турбо в осушении ставит low, которого нет в списке режима
+    const bool turbo_dry_fan = turbo && get_mode() == AC_MODE::MODE_DRY && get_fan() == FAN_MODE::FAN_LOW;
+    if (is_fan_mode_supported(get_fan()) == false && turbo_dry_fan == false)
+      return false;
+
+    if ((turbo && turbo_allowed() == false) || (get_eco() && eco_allowed() == false) || (turbo && get_eco()))
+      return false;
+
+    return (get_health() == false || health_allowed()) && (get_light() == false || light_allowed());
+  }
+
+  bool is_valid_prev_state_(const CompactState& state) const {
+    const auto prev_temp = state.prev_temp * 0.5f;
+    if (prev_temp < this->temp_min || prev_temp > this->temp_max)
+      return false;
+
+    if (state.prev_fan_mode == FAN_MODE::FAN_UNDEFINED || enum_to_str(FAN_MODE_NAMES, state.prev_fan_mode, nullptr) == nullptr)
+      return false;
+
+    return enum_to_str(SWING_MODE_NAMES, state.prev_swing_mode, nullptr) != nullptr;
+  }
+
   void save_state_() {
     if (this->state_ == nullptr)
       this->state_ = new State(get_temp(), get_fan(), get_swing_mode());
@@ -719,17 +1000,18 @@ class IRDahatsu {
                  swing_mode_to_str(swing_mode));
   }
 
-  void set_constraints(const bool health_enabled,
-                       const bool light_enabled,
-                       const bool turbo_enabled,
-                       const bool eco_enabled,
-                       const bool set_temp_enabled,
-                       const FAN_MODE default_fan_mode) {
-    this->health_enabled_ = health_enabled;
-    this->light_enabled_ = light_enabled;
-    this->turbo_enabled_ = turbo_enabled;
-    this->eco_enabled_ = eco_enabled;
-    this->set_temp_enabled_ = set_temp_enabled;
+  void set_constraints(const AC_MODE mode) {
+    FAN_MODE default_fan_mode = FAN_MODE::FAN_MEDIUM;
+
+    for (const auto& capabilities : MODE_CAPABILITIES) {
+      if (capabilities.mode != mode)
+        continue;
+
+      this->features_ = capabilities.features;
+      this->fan_modes_ = capabilities.fan_modes;
+      default_fan_mode = capabilities.default_fan;
+      break;
+    }
 
     const auto health = this->ac_->getHealth();
     const auto light = this->ac_->getLight();
@@ -737,20 +1019,21 @@ class IRDahatsu {
     const auto eco = this->ac_->getEcono();
 
     //Если состояние не поддерживается, но было включено, то выключим его
-    if (health_enabled == false && health == true)
+    if (health_allowed() == false && health == true)
       this->ac_->setHealth(false);
 
-    if (light_enabled == false && light == true)
+    if (light_allowed() == false && light == true)
       this->ac_->setLight(false);
 
     if (turbo == true)
       set_turbo_(false);
 
-    if (eco_enabled == false && eco == true)
+    if (eco_allowed() == false && eco == true)
       this->ac_->setEcono(false);
 
     if(is_fan_mode_supported(get_fan()) == false)
       set_fan(default_fan_mode);
   }
 };
-}
\ No newline at end of file
+}  // namespace dahatsu
+}  // namespace ir_climate
@@ -1,7 +1,18 @@
+#pragma once
+
+#include "esphome.h"
+#include <IRsend.h>
 #include <ir_Daikin.h>
 #include <IRutils.h>
 
+#include "../../shared_libs/EnumNames.h"
+#include "../../shared_libs/HeapDiagnostics.h"
+#include "../../shared_libs/LatencyHistogram.h"
+#include "../../shared_libs/IRReceiverHub.h"
+#include "../../shared_libs/IRTransmitter.h"
+
 namespace ir_climate {
+namespace daikin {
 
 static const char *TAG = "ir.daikin";
 
@@ -30,20 +41,91 @@ enum AC_MODE : uint8_t {
   MODE_OFF = 11,
 };
 
+static constexpr EnumName MODE_NAMES[] PROGMEM = {
+    {"off", AC_MODE::MODE_OFF},
+    {"auto", AC_MODE::MODE_AUTO},
+    {"cool", AC_MODE::MODE_COOL},
+    {"heat", AC_MODE::MODE_HEAT},
+    {"fan_only", AC_MODE::MODE_FAN},
+    {"dry", AC_MODE::MODE_DRY},
+    {"undefined", AC_MODE::MODE_UNDEFINED}};
+static_assert(enum_keys_unique(MODE_NAMES), "MODE_NAMES: first letter and length must be unique");
+static constexpr EnumIndex MODE_INDEX PROGMEM = enum_index(MODE_NAMES);
+static_assert(MODE_INDEX.seed != 0, "MODE_NAMES: no perfect hash seed");
+
+static constexpr EnumName FAN_MODE_NAMES[] PROGMEM = {
+    {"auto", FAN_MODE::FAN_AUTO},
+    {"quiet", FAN_MODE::FAN_QUIET},
+    {"low", FAN_MODE::FAN_LOW},
+    {"medium", FAN_MODE::FAN_MEDIUM},
+    {"high", FAN_MODE::FAN_HIGH},
+    {"turbo", FAN_MODE::FAN_TURBO},
+    {"undefined", FAN_MODE::FAN_UNDEFINED}};
+static_assert(enum_keys_unique(FAN_MODE_NAMES), "FAN_MODE_NAMES: first letter and length must be unique");
+static constexpr EnumIndex FAN_MODE_INDEX PROGMEM = enum_index(FAN_MODE_NAMES);
+static_assert(FAN_MODE_INDEX.seed != 0, "FAN_MODE_NAMES: no perfect hash seed");
+
+static constexpr EnumName SWING_MODE_NAMES[] PROGMEM = {
+    {"off", SWING_MODE::SWING_OFF},
+    {"horizontal", SWING_MODE::SWING_HORIZONTAL}};
+static_assert(enum_keys_unique(SWING_MODE_NAMES), "SWING_MODE_NAMES: first letter and length must be unique");
+static constexpr EnumIndex SWING_MODE_INDEX PROGMEM = enum_index(SWING_MODE_NAMES);
+static_assert(SWING_MODE_INDEX.seed != 0, "SWING_MODE_NAMES: no perfect hash seed");
+
+//Возможности режима, биты маски features
+enum CAPABILITY : uint8_t {
+  CAP_SLEEP = 1 << 0,
+  CAP_SET_TEMP = 1 << 1,
+  CAP_TURBO = 1 << 2,
+  CAP_QUIET = 1 << 3,
+};
+
+static constexpr uint16_t fan_bit(const FAN_MODE fan_mode) { return 1 << fan_mode; }
+
+static constexpr uint16_t FAN_MASK_BASE = fan_bit(FAN_AUTO) | fan_bit(FAN_LOW) | fan_bit(FAN_MEDIUM) | fan_bit(FAN_HIGH);
+
+//Таблица возможностей по режимам, fan_modes - маска допустимых режимов обдува (fan_bit).
+//turbo и quiet - отдельные режимы обдува, они доступны там же, где одноименные кнопки
+struct ModeCapabilities {
+  AC_MODE mode;
+  uint8_t features;
+  uint16_t fan_modes;
+};
+
+static constexpr ModeCapabilities MODE_CAPABILITIES[] = {
+    {AC_MODE::MODE_HEAT, CAP_TURBO | CAP_QUIET | CAP_SLEEP | CAP_SET_TEMP, FAN_MASK_BASE | fan_bit(FAN_TURBO) | fan_bit(FAN_QUIET)},
+    {AC_MODE::MODE_DRY, CAP_SET_TEMP, FAN_MASK_BASE},
+    {AC_MODE::MODE_COOL, CAP_TURBO | CAP_QUIET | CAP_SLEEP | CAP_SET_TEMP, FAN_MASK_BASE | fan_bit(FAN_TURBO) | fan_bit(FAN_QUIET)},
+    {AC_MODE::MODE_FAN, 0, FAN_MASK_BASE & ~fan_bit(FAN_AUTO)},
+    {AC_MODE::MODE_AUTO, CAP_SLEEP | CAP_SET_TEMP, FAN_MASK_BASE}};
+
 class IRDaikin {
  private:
   IRDaikin64* ac_;
-  IRrecv* ir_receiver_{nullptr};
-  decode_results* decode_results_;
+  IRTransmitter* ir_transmitter_;
+  IRReceiverHub* receiver_hub_{nullptr};
   CallbackManager<void()> state_callback_{};
+  CallbackManager<void()> send_callback_{};
+
+  //кадр, ожидающий отправки из loop(), очередь на один кадр
+  uint64_t tx_frame_{0};
+  bool tx_power_toggle_{false};
+  bool tx_pending_{false};
+  //кадр в эфире, прерывание timer1 еще не закончило его отправку
+  bool transmitting_{false};
+  uint32_t tx_hash_{0};
 
   bool power_on_{false};//Индикатор питания, включен ли кондиционер
-  bool set_temp_enabled_{false};
-  bool turbo_enabled_{false};
-  bool quiet_enabled_{false};
-  bool sleep_enabled_{false};
+  //маски текущего режима из MODE_CAPABILITIES, до первого set_mode - без turbo и quiet
+  uint8_t features_{0};
+  uint16_t fan_modes_{FAN_MASK_BASE};
   FAN_MODE prev_fan_mode_{FAN_MODE::FAN_MEDIUM};
 
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+  //буфер для to_string, строка живет до следующего вызова
+  mutable char string_buffer_[160];
+#endif
+
  public:
   const uint8_t temp_min = 16;
   const uint8_t temp_max = 30;
@@ -77,46 +159,70 @@ class IRDaikin {
       swing_mode_to_str(SWING_MODE::SWING_OFF),
       swing_mode_to_str(SWING_MODE::SWING_HORIZONTAL)};
 
-  IRDaikin(uint16_t receiver_pin, uint16_t transmitter_pin) {
+  IRDaikin(uint16_t receiver_pin, uint16_t transmitter_pin)
+      : IRDaikin(new IRReceiverHub(receiver_pin, 140, 80, 50), transmitter_pin) {}
+
+  //приемник общий для нескольких кондиционеров на одном узле, передатчик у каждого свой
+  IRDaikin(IRReceiverHub* receiver_hub, uint16_t transmitter_pin) {
     ac_ = new IRDaikin64(transmitter_pin);
-    ir_receiver_ = new IRrecv(receiver_pin, 140, 80, true);
-    ir_receiver_->setTolerance(50);
+    ir_transmitter_ = new IRTransmitter(transmitter_pin, kDaikin64Freq);
+    receiver_hub_ = receiver_hub;
+    receiver_hub_->add_on_frame_callback([this](const decode_results* results) { this->on_frame_(results); });
     ac_->setPowerToggle(false);
 
     //инициализация констрейнтов
     set_mode(get_mode());
-    decode_results_ = new decode_results();
   }
 
  public:
 
   void setup() const {
-    ir_receiver_->enableIRIn();
+    receiver_hub_->setup();
     ac_->begin();
+    ir_transmitter_->begin();
   }
 
   void add_on_state_callback(std::function<void()>&& callback) { this->state_callback_.add(std::move(callback)); }
 
-  void send() const {
-    ir_receiver_->disableIRIn();
-    ac_->send();
-    ac_->setPowerToggle(false);//после отправки сбрасываем бит питания
+  //вызывается после того, как кадр ушел в эфир
+  void add_on_send_callback(std::function<void()>&& callback) { this->send_callback_.add(std::move(callback)); }
+
+  //ставит текущее состояние в очередь, сам кадр отправляется из loop()
+  void send() {
+    //неотправленный кадр заменяется новым, переключение питания из него сохраняем
+    auto power_toggle = this->ac_->getPowerToggle() != (this->tx_pending_ && this->tx_power_toggle_);
+
+    if(this->tx_pending_) {
+      ESP_LOGD(TAG, "[send]: предыдущий кадр еще не отправлен, заменяем");
+    }
+
+    this->ac_->setPowerToggle(power_toggle);
+    this->tx_frame_ = this->ac_->getRaw();
+    this->tx_power_toggle_ = power_toggle;
+    this->tx_pending_ = true;
+    ac_->setPowerToggle(false);//бит питания уже в кадре, сбрасываем
     ESP_LOGD(TAG, "[send]: %s", this->to_string());
-    ir_receiver_->enableIRIn();
   }
 
+  bool is_send_pending() const { return this->tx_pending_ || this->transmitting_; }
+
+  IRReceiverHub* get_receiver_hub() const { return this->receiver_hub_; }
+
+  //сколько повторных кадров с пульта не было применено
+  uint32_t get_duplicate_frames() const { return this->receiver_hub_->get_duplicate_frames(); }
+
   void set_power_state(const bool on) { this->power_on_ = on; }
 
   bool get_power_state() const { return this->power_on_; }
 
   void toggle_power() {
-    //изменение состояния питания
-    this->ac_->setPowerToggle(true);
+    //изменение состояния питания, два переключения до отправки кадра взаимно гасятся
+    this->ac_->setPowerToggle(!this->ac_->getPowerToggle());
 
     auto power = get_power_state();
     auto new_power = !power;
 
-    ESP_LOGD(TAG, "[toggle_power]: setPowerToggle: true, было power_on: %s, стало power_on: %s", bool_to_str_(power), bool_to_str_(new_power));
+    ESP_LOGD(TAG, "[toggle_power]: setPowerToggle: %s, было power_on: %s, стало power_on: %s", bool_to_str_(this->ac_->getPowerToggle()), bool_to_str_(power), bool_to_str_(new_power));
 
     set_power_state(new_power);
   }
@@ -128,7 +234,7 @@ class IRDaikin {
 
     this->ac_->setTemp(temp);
 
-    if(this->set_temp_enabled_ == false)
+    if(set_temp_allowed() == false)
       return false;
 
     return true;
@@ -136,7 +242,7 @@ class IRDaikin {
 
   uint8_t get_temp() const { return this->ac_->getTemp(); }
 
-  bool set_temp_allowed() const { return this->set_temp_enabled_; }
+  bool set_temp_allowed() const { return (this->features_ & CAP_SET_TEMP) != 0; }
 
   void set_hvac_mode(const AC_MODE mode) {
     set_mode(mode);
@@ -194,27 +300,24 @@ class IRDaikin {
     switch (mode) {
       case AC_MODE::MODE_HEAT:
         set_mode_(8);
-        set_constraints_(true, true, true, true);
         break;
       case AC_MODE::MODE_DRY:
         set_mode_(1);
-        set_constraints_(false, false, false, true);
         break;
       case AC_MODE::MODE_COOL:
         set_mode_(2);
-        set_constraints_(true, true, true, true);
         break;
       case AC_MODE::MODE_FAN:
         set_mode_(4);
-        set_constraints_(false, false, false, false);
         break;
       case AC_MODE::MODE_AUTO:
         set_mode_(10);
-        set_constraints_(false, false, true, true);
         break;
       default:
-        break;
+        return;
     }
+
+    set_constraints_(mode);
   }
 
   SWING_MODE get_swing_mode() const {
@@ -240,31 +343,19 @@ class IRDaikin {
     }
   }
 
-  void set_swing_mode(const std::string& swing_mode) const {
-    if (str_equals_case_insensitive(swing_mode, "OFF")) {
-      set_swing_mode(SWING_MODE::SWING_OFF);
-    } else if (str_equals_case_insensitive(swing_mode, "HORIZONTAL")) {
-      set_swing_mode(SWING_MODE::SWING_HORIZONTAL);
-    } else {
-      ESP_LOGW(TAG, "[set_swing_mode]: Unrecognized swing mode %s", swing_mode.c_str());
-    }
-  }
-
-  bool is_fan_mode_supported(const FAN_MODE fan_mode) const {
-    const auto mode = this->ac_->getMode();
+  void set_swing_mode(const std::string& swing_mode_str) const {
+    auto swing_mode = str_to_enum(SWING_MODE_NAMES, SWING_MODE_INDEX, swing_mode_str, ENUM_UNDEFINED);
 
-    if(fan_mode == FAN_QUIET)
-      return quiet_enabled_;
+    if (swing_mode == ENUM_UNDEFINED)
+      ESP_LOGW(TAG, "[set_swing_mode]: Unrecognized swing mode %s", swing_mode_str.c_str());
+    else
+      set_swing_mode(static_cast<SWING_MODE>(swing_mode));
+  }
 
-    if(fan_mode == FAN_TURBO)
-      return turbo_enabled_;
+  bool is_fan_mode_supported(const FAN_MODE fan_mode) const { return (this->fan_modes_ & fan_bit(fan_mode)) != 0; }
 
-    // для режима FAN auto недоступен
-    if (mode == AC_MODE::MODE_FAN && fan_mode == FAN_MODE::FAN_AUTO)
-      return false;
-
-    return true;
-  }
+  //маска fan_bit допустимых режимов обдува в текущем режиме
+  uint16_t get_fan_modes_mask() const { return this->fan_modes_; }
 
   bool set_fan(FAN_MODE fan_mode) {
     if (is_fan_mode_supported(fan_mode) == false) {
@@ -340,7 +431,7 @@ class IRDaikin {
   const char* get_prev_fan_str() const { return fan_mode_to_str(this->get_prev_fan()); }
 
   bool set_sleep(const bool on) const {
-    if (this->sleep_enabled_ == false) return false;
+    if (sleep_allowed() == false) return false;
 
     this->ac_->setSleep(on);
 
@@ -348,11 +439,10 @@ class IRDaikin {
   }
 
   bool set_sleep(const std::string& on) const {
-    if (str_equals_case_insensitive(on, "OFF") || str_equals_case_insensitive(on, "FALSE"))
-      return set_sleep(false);
+    auto value = parse_on_off(on);
 
-    if (str_equals_case_insensitive(on, "ON") || str_equals_case_insensitive(on, "TRUE"))
-      return set_sleep(true);
+    if (value != ENUM_UNDEFINED)
+      return set_sleep(value == 1);
 
     ESP_LOGW(TAG, "[set_sleep]: Unrecognized sleep mode %s", on.c_str());
     return false;
@@ -360,7 +450,7 @@ class IRDaikin {
 
   bool get_sleep() const { return this->ac_->getSleep(); }
 
-  bool sleep_allowed() const { return this->sleep_enabled_; }
+  bool sleep_allowed() const { return (this->features_ & CAP_SLEEP) != 0; }
 
   void initialize(
                   const std::string& hvac_mode_str,
@@ -402,135 +492,220 @@ class IRDaikin {
     set_sleep(sleep);
   }
 
-  const char* to_string() const {
-    String result = "";
-    result.reserve(120);
+  //состояние для сохранения во flash, кадр целиком и то, чего в кадре нет
+  struct CompactState {
+    uint64_t raw;
+    uint8_t power_on;
+    uint8_t prev_fan_mode;
+  };
+
+  CompactState get_compact_state() const {
+    CompactState state;
+    //обнуляем и выравнивание, состояния сравниваются через memcmp
+    memset(&state, 0, sizeof(state));
+    //бит переключения питания при восстановлении сбрасывается, питание хранится отдельно
+    state.raw = this->ac_->getRaw();
+    state.power_on = this->power_on_;
+    state.prev_fan_mode = this->prev_fan_mode_;
+    return state;
+  }
 
-    result += irutils::addBoolToString(get_power_state(), "power", false);
-    result += irutils::addIntToString(get_hvac_mode(), "hvac_mode") + " (" + get_hvac_mode_str() +")";
-    result += irutils::addIntToString(get_mode(), "mode") + " (" + get_mode_str() +")";
-    result += irutils::addTempToString(get_temp());
-    result += irutils::addIntToString(get_fan(), "fan") + " (" + get_fan_str() +")";
-    result += irutils::addBoolToString(get_sleep(), "sleep");
-    result += irutils::addIntToString(get_swing_mode(), "swing") + " (" + get_swing_mode_str() +")";
+  //уставка в сохраненном состоянии, контрольная сумма кадра пересчитывается
+  static void set_compact_state_temp(CompactState& state, const uint8_t temp) {
+    IRDaikin64 ac(0);
+    ac.setRaw(state.raw);
+    ac.setTemp(temp);
+    state.raw = ac.getRaw();
+  }
+
+  //false - состояние не применено: режим в кадре не распознан
+  bool restore_compact_state(const CompactState& state) {
+    const uint64_t prev_raw = this->ac_->getRaw();
+    this->ac_->setRaw(state.raw);
+    this->ac_->setPowerToggle(false);
 
-    std::string data = result.c_str();
-    return data.c_str();
+    if(get_mode() == AC_MODE::MODE_UNDEFINED) {
+      this->ac_->setRaw(prev_raw);
+      return false;
+    }
+
+    //поля кадра к допустимым значениям, как в on_frame_
+    this->ac_->setFan(this->ac_->getFan());
+    this->ac_->setTemp(this->ac_->getTemp());
+
+    set_power_state(state.power_on != 0);
+
+    auto prev_fan_mode = static_cast<FAN_MODE>(state.prev_fan_mode);
+    const bool known = prev_fan_mode != FAN_MODE::FAN_UNDEFINED && enum_to_str(FAN_MODE_NAMES, prev_fan_mode, nullptr) != nullptr;
+    this->prev_fan_mode_ = known ? prev_fan_mode : FAN_MODE::FAN_MEDIUM;
+
+    //ограничения режима: у сохраненного драйвером состояния set_mode ничего не меняет,
+    //испорченное приводится к допустимому через prev_fan_mode_
+    set_mode(get_mode());
+    return true;
+  }
+
+  //компактный отпечаток всего, что публикуется в info топик
+  uint64_t get_state_fingerprint() const {
+    uint64_t fingerprint = 0;
+
+    fingerprint |= (uint64_t) get_hvac_mode();
+    fingerprint |= (uint64_t) get_mode() << 4;
+    fingerprint |= (uint64_t) get_fan() << 8;
+    fingerprint |= (uint64_t) get_swing_mode() << 12;
+    fingerprint |= (uint64_t) get_temp() << 13;
+    fingerprint |= (uint64_t) get_sleep() << 21;
+    fingerprint |= (uint64_t) this->features_ << 22;
+    fingerprint |= (uint64_t) this->prev_fan_mode_ << 26;
+
+    return fingerprint;
+  }
+
+  //используется только в отладочных логах, ниже уровня DEBUG не собирается
+  const char* to_string() const {
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+    snprintf(this->string_buffer_, sizeof(this->string_buffer_),
+             "power: %s, hvac_mode: %u (%s), mode: %u (%s), Temp: %uC, fan: %u (%s), sleep: %s, swing: %u (%s)",
+             bool_to_str_(get_power_state()),
+             get_hvac_mode(), get_hvac_mode_str(),
+             get_mode(), get_mode_str(),
+             get_temp(),
+             get_fan(), get_fan_str(),
+             bool_to_str_(get_sleep()),
+             get_swing_mode(), get_swing_mode_str());
+
+    return this->string_buffer_;
+#else
+    return "";
+#endif
   }
 
   void loop() {
+    receiver_hub_->loop();
+    transmit_();
+  }
 
-    if (ir_receiver_->decode(decode_results_) == false)
-      return;
+ private:
+  //кадр уходит в эфир по прерываниям, loop() только запускает отправку и ждет ее конца
+  void transmit_() {
+    if(this->transmitting_ && this->ir_transmitter_->is_busy() == false) {
+      this->transmitting_ = false;
+      receiver_hub_->resume();
+      this->receiver_hub_->remember_sent(this->tx_hash_);
 
-    ESP_LOGD(TAG, "[decoder]: Получены данные, обновляем состояние");
-    ac_->setRaw(decode_results_->value);
-    auto const power_toggle = ac_->getPowerToggle();
-    ac_->setPowerToggle(false); //сбрасываем бит питания
+      ESP_LOGD(TAG, "[transmit]: кадр отправлен");
 
-    if(power_toggle) {  // переключаем текущее питание
-      ESP_LOGD(TAG, "[decoder]: меняем притание: с power: %s, на power: %s", bool_to_str_(get_power_state()), bool_to_str_(!get_power_state()));
-      set_power_state(!get_power_state());
+      send_callback_.call();
     }
 
-    //инициализируем режим
-    set_mode(get_mode());
+    //передатчик другого кондиционера занимает timer1, ждем следующего loop()
+    if(this->tx_pending_ == false || IRTransmitter::is_any_busy())
+      return;
 
-    ESP_LOGD(TAG, "[decoder]: %s", this->to_string());
+    //память замеряем вокруг кодирования и запуска кадра, сама отправка идет в прерывании timer1
+    heap_diagnostics::HeapProbe probe(heap_diagnostics::PROBE_IR_SEND);
+    encode_frame_(this->tx_frame_);
 
-    state_callback_.call();
+    receiver_hub_->pause();
+    if(this->ir_transmitter_->start() == false) {
+      receiver_hub_->resume();
+      ESP_LOGW(TAG, "[transmit]: кадр не помещается в буфер передатчика");
+      this->tx_pending_ = false;
+      return;
+    }
+
+    this->tx_pending_ = false;
+    this->transmitting_ = true;
+    this->tx_hash_ = FrameDedup::hash(reinterpret_cast<const uint8_t *>(&this->tx_frame_), sizeof(this->tx_frame_));
   }
 
-  static const char* mode_to_str(const AC_MODE mode) {
-    switch (mode) {
-      case AC_MODE::MODE_HEAT:
-        return "heat";
-      case AC_MODE::MODE_DRY:
-        return "dry";
-      case AC_MODE::MODE_COOL:
-        return "cool";
-      case AC_MODE::MODE_FAN:
-        return "fan_only";
-      case AC_MODE::MODE_AUTO:
-        return "auto";
-      case AC_MODE::MODE_UNDEFINED:
-        return "undefined";
-      case AC_MODE::MODE_OFF:
-        return "off";
-      default:
-        return "undefined";
+  //кадр как в IRsend::sendDaikin64: два leader, заголовок, 64 бита младшим вперед, footer, gap, mark
+  void encode_frame_(const uint64_t frame) {
+    this->ir_transmitter_->clear();
+    for(uint8_t i = 0; i < 2; i++) {
+      this->ir_transmitter_->mark(kDaikin64LdrMark);
+      this->ir_transmitter_->space(kDaikin64LdrSpace);
     }
+    this->ir_transmitter_->mark(kDaikin64HdrMark);
+    this->ir_transmitter_->space(kDaikin64HdrSpace);
+    this->ir_transmitter_->data(frame, kDaikin64Bits, kDaikin64BitMark, kDaikin64OneSpace, kDaikin64BitMark,
+                                kDaikin64ZeroSpace, false);
+    this->ir_transmitter_->mark(kDaikin64BitMark);
+    this->ir_transmitter_->space(kDaikin64Gap);
+    this->ir_transmitter_->mark(kDaikin64HdrMark);
+    this->ir_transmitter_->space(kDefaultMessageGap);
   }
 
-  static const char* fan_mode_to_str(const FAN_MODE mode) {
-    switch (mode) {
-      case FAN_MODE::FAN_AUTO:
-        return "auto";
-      case FAN_MODE::FAN_LOW:
-        return "low";
-      case FAN_MODE::FAN_MEDIUM:
-        return "medium";
-      case FAN_MODE::FAN_TURBO:
-        return "turbo";
-      case FAN_MODE::FAN_QUIET:
-        return "quiet";
-      case FAN_MODE::FAN_HIGH:
-        return "high";
-      case FAN_MODE::FAN_UNDEFINED:
-        return "undefined";
-      default:
-        return "auto";
+  void on_frame_(const decode_results* results) {
+    //приемник может быть общим с кондиционерами других протоколов
+    if(results->decode_type != decode_type_t::DAIKIN64)
+      return;
+
+    latency_histogram::LatencyProbe latency(latency_histogram::PHASE_IR_DECODE);
+
+    if(results->bits != kDaikin64Bits) {
+      ESP_LOGW(TAG, "[decoder]: неверная длина кадра: %u бит", results->bits);
+      return;
     }
-  }
 
-  static const char* swing_mode_to_str(const SWING_MODE mode) {
-    switch (mode) {
-      case SWING_MODE::SWING_OFF:
-        return "off";
-      case SWING_MODE::SWING_HORIZONTAL:
-        return "horizontal";
-      default:
-        return "off";
+    //кадр с неизвестным режимом не применяем, остальные поля библиотека приводит к допустимым значениям
+    const uint64_t prev_raw = ac_->getRaw();
+    //переключение питания командой, которая еще ждет окна объединения и не попала в очередь
+    const bool unsent_power_toggle = ac_->getPowerToggle();
+    ac_->setRaw(results->value);
+
+    if(get_mode() == AC_MODE::MODE_UNDEFINED) {
+      ac_->setRaw(prev_raw);
+      return;
     }
-  }
 
-  static const FAN_MODE parse_fan_mode(const std::string& fan_mode) {
-    if (str_equals_case_insensitive(fan_mode, "AUTO"))
-      return FAN_MODE::FAN_AUTO;
+    ac_->setFan(ac_->getFan());
+    ac_->setTemp(ac_->getTemp());
 
-    if (str_equals_case_insensitive(fan_mode, "QUIET"))
-      return FAN_MODE::FAN_QUIET;
+    //состояние с пульта важнее, неотправленный кадр устарел
+    //переключение питания из него кондиционер не получил, откатываем power_on_
+    if(this->tx_pending_) {
+      ESP_LOGD(TAG, "[decoder]: неотправленный кадр отменен");
+      this->tx_pending_ = false;
+      if(this->tx_power_toggle_)
+        set_power_state(!get_power_state());
+    }
 
-    if (str_equals_case_insensitive(fan_mode, "LOW"))
-      return FAN_MODE::FAN_LOW;
+    if(unsent_power_toggle) {
+      ESP_LOGD(TAG, "[decoder]: неотправленное переключение питания отменено");
+      set_power_state(!get_power_state());
+    }
 
-    if (str_equals_case_insensitive(fan_mode, "MEDIUM"))
-      return FAN_MODE::FAN_MEDIUM;
+    ESP_LOGD(TAG, "[decoder]: Получены данные, обновляем состояние");
+    auto const power_toggle = ac_->getPowerToggle();
+    ac_->setPowerToggle(false); //сбрасываем бит питания
 
-    if (str_equals_case_insensitive(fan_mode, "HIGH"))
-      return FAN_MODE::FAN_HIGH;
+    if(power_toggle) {  // переключаем текущее питание
+      ESP_LOGD(TAG, "[decoder]: меняем притание: с power: %s, на power: %s", bool_to_str_(get_power_state()), bool_to_str_(!get_power_state()));
+      set_power_state(!get_power_state());
+    }
 
-    if (str_equals_case_insensitive(fan_mode, "TURBO"))
-      return FAN_MODE::FAN_TURBO;
+    //инициализируем режим
+    set_mode(get_mode());
 
-    return FAN_MODE::FAN_UNDEFINED;
+    ESP_LOGD(TAG, "[decoder]: %s", this->to_string());
+
+    state_callback_.call();
   }
 
-  static const AC_MODE parse_mode(const std::string& mode) {
-    if (str_equals_case_insensitive(mode, "OFF"))
-      return AC_MODE::MODE_OFF;
-    if (str_equals_case_insensitive(mode, "AUTO"))
-      return AC_MODE::MODE_AUTO;
-    if (str_equals_case_insensitive(mode, "COOL"))
-      return AC_MODE::MODE_COOL;
-    if (str_equals_case_insensitive(mode, "HEAT"))
-      return AC_MODE::MODE_HEAT;
-    if (str_equals_case_insensitive(mode, "FAN_ONLY"))
-      return AC_MODE::MODE_FAN;
-    if (str_equals_case_insensitive(mode, "DRY"))
-      return AC_MODE::MODE_DRY;
+ public:
+  static const char* mode_to_str(const AC_MODE mode) { return enum_to_str(MODE_NAMES, mode, "undefined"); }
+
+  static const char* fan_mode_to_str(const FAN_MODE mode) { return enum_to_str(FAN_MODE_NAMES, mode, "auto"); }
 
-    return AC_MODE::MODE_UNDEFINED;
+  static const char* swing_mode_to_str(const SWING_MODE mode) { return enum_to_str(SWING_MODE_NAMES, mode, "off"); }
+
+  static FAN_MODE parse_fan_mode(const std::string& fan_mode) {
+    return static_cast<FAN_MODE>(str_to_enum(FAN_MODE_NAMES, FAN_MODE_INDEX, fan_mode, FAN_MODE::FAN_UNDEFINED));
+  }
+
+  static AC_MODE parse_mode(const std::string& mode) {
+    return static_cast<AC_MODE>(str_to_enum(MODE_NAMES, MODE_INDEX, mode, AC_MODE::MODE_UNDEFINED));
   }
 
  private:
@@ -550,19 +725,22 @@ class IRDaikin {
     set_fan(default_fan_mode);
   }
 
-  void set_constraints_(const bool turbo_enabled, const bool quiet_enabled,
-                       const bool sleep_enabled, const bool set_temp_enabled) {
-    this->turbo_enabled_ = turbo_enabled;
-    this->quiet_enabled_ = quiet_enabled;
-    this->sleep_enabled_ = sleep_enabled;
-    this->set_temp_enabled_ = set_temp_enabled;
+  void set_constraints_(const AC_MODE mode) {
+    for (const auto& capabilities : MODE_CAPABILITIES) {
+      if (capabilities.mode != mode)
+        continue;
+
+      this->features_ = capabilities.features;
+      this->fan_modes_ = capabilities.fan_modes;
+      break;
+    }
 
     ESP_LOGD(TAG,
              "[set_constraints]: turbo: %s, quiet: %s, sleep: %s, set_temp: %s",
-             bool_to_str_(this->turbo_enabled_),
-             bool_to_str_(this->quiet_enabled_),
-             bool_to_str_(this->sleep_enabled_),
-             bool_to_str_(this->set_temp_enabled_));
+             bool_to_str_(this->features_ & CAP_TURBO),
+             bool_to_str_(this->features_ & CAP_QUIET),
+             bool_to_str_(this->features_ & CAP_SLEEP),
+             bool_to_str_(this->features_ & CAP_SET_TEMP));
 
     re_initialize_fan_mode_(FAN_MODE::FAN_MEDIUM);
 
@@ -570,19 +748,19 @@ class IRDaikin {
     const auto quiet = this->ac_->getQuiet();
     const auto sleep = this->ac_->getSleep();
 
-    if (turbo_enabled_ == false && turbo == true) {
+    if ((this->features_ & CAP_TURBO) == 0 && turbo == true) {
       this->ac_->setTurbo(false);
       set_fan(this->prev_fan_mode_);
       ESP_LOGW(TAG, "[set_constraints]: Принудительный сброс состояния turbo");
     }
 
-    if (quiet_enabled_ == false && quiet == true) {
+    if ((this->features_ & CAP_QUIET) == 0 && quiet == true) {
       this->ac_->setQuiet(false);
       set_fan(this->prev_fan_mode_);
       ESP_LOGW(TAG, "[set_constraints]: Принудительный сброс состояния quiet");
     }
 
-    if (sleep_enabled_ == false && sleep == true) {
+    if (sleep_allowed() == false && sleep == true) {
       this->ac_->setSleep(false);
     }
   }
@@ -600,4 +778,5 @@ class IRDaikin {
     ac_->setRaw(raw_data);
   }
 };
-}
\ No newline at end of file
+}  // namespace daikin
+}  // namespace ir_climate
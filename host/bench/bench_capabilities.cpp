@@ -0,0 +1,481 @@
+//Применение команд режима и обдува: ограничения режима флагами из switch в set_mode (до таблиц)
+//и масками из MODE_CAPABILITIES. Обе модели повторяют set_mode/set_fan/set_constraints драйверов
+//на тех же классах IRremoteESP8266 и отличаются только представлением ограничений.
+//Перед замером последовательность команд прогоняется на обеих моделях, кадры должны совпасть.
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "esphome.h"
+#include "daikin/lib/IRDaikin.h"
+#include "dahatsu/lib/IRDahatsu.h"
+
+#include "bench.h"
+
+namespace {
+
+namespace daikin = ir_climate::daikin;
+namespace dahatsu = ir_climate::dahatsu;
+
+//---------------------------------------- daikin ----------------------------------------
+
+uint8_t daikin_mode_code(const daikin::AC_MODE mode) {
+  switch (mode) {
+    case daikin::MODE_HEAT:
+      return 8;
+    case daikin::MODE_DRY:
+      return 1;
+    case daikin::MODE_COOL:
+      return 2;
+    case daikin::MODE_FAN:
+      return 4;
+    default:
+      return 10;
+  }
+}
+
+uint8_t daikin_fan_code(const daikin::FAN_MODE fan_mode) {
+  switch (fan_mode) {
+    case daikin::FAN_LOW:
+      return 8;
+    case daikin::FAN_MEDIUM:
+      return 4;
+    case daikin::FAN_HIGH:
+      return 2;
+    case daikin::FAN_TURBO:
+      return 3;
+    case daikin::FAN_QUIET:
+      return 9;
+    default:
+      return 1;
+  }
+}
+
+//общая часть: кадр, обдув и сброс turbo/quiet/sleep как в IRDaikin::set_constraints_
+template<typename Constraints> class DaikinModel {
+ protected:
+  IRDaikin64 ac_{0};
+  daikin::FAN_MODE prev_fan_mode_{daikin::FAN_MEDIUM};
+
+  Constraints &self() { return static_cast<Constraints &>(*this); }
+
+  daikin::FAN_MODE get_fan() const { return static_cast<daikin::FAN_MODE>(this->ac_.getFan()); }
+
+  void apply_constraints_() {
+    const auto fan_mode = get_fan();
+    if (self().is_fan_mode_supported(fan_mode) == false) {
+      if (self().is_fan_mode_supported(this->prev_fan_mode_))
+        set_fan(this->prev_fan_mode_);
+      else
+        set_fan(daikin::FAN_MEDIUM);
+    }
+
+    if (self().turbo_allowed() == false && this->ac_.getTurbo()) {
+      this->ac_.setTurbo(false);
+      set_fan(this->prev_fan_mode_);
+    }
+
+    if (self().quiet_allowed() == false && this->ac_.getQuiet()) {
+      this->ac_.setQuiet(false);
+      set_fan(this->prev_fan_mode_);
+    }
+
+    if (self().sleep_allowed() == false && this->ac_.getSleep())
+      this->ac_.setSleep(false);
+  }
+
+ public:
+  bool set_fan(const daikin::FAN_MODE fan_mode) {
+    if (self().is_fan_mode_supported(fan_mode) == false)
+      return false;
+
+    this->ac_.setFan(daikin_fan_code(fan_mode));
+    if (fan_mode != daikin::FAN_TURBO && fan_mode != daikin::FAN_QUIET)
+      this->prev_fan_mode_ = fan_mode;
+    return true;
+  }
+
+  uint64_t get_raw() { return this->ac_.getRaw(); }
+};
+
+//до таблиц: флаги по режиму в switch, режим обдува проверяется ветвлениями
+class DaikinBranchy : public DaikinModel<DaikinBranchy> {
+ private:
+  bool turbo_enabled_{false};
+  bool quiet_enabled_{false};
+  bool sleep_enabled_{false};
+  bool set_temp_enabled_{false};
+
+  void set_constraints_(const bool turbo_enabled, const bool quiet_enabled, const bool sleep_enabled,
+                        const bool set_temp_enabled) {
+    this->turbo_enabled_ = turbo_enabled;
+    this->quiet_enabled_ = quiet_enabled;
+    this->sleep_enabled_ = sleep_enabled;
+    this->set_temp_enabled_ = set_temp_enabled;
+    apply_constraints_();
+  }
+
+ public:
+  bool turbo_allowed() const { return this->turbo_enabled_; }
+  bool quiet_allowed() const { return this->quiet_enabled_; }
+  bool sleep_allowed() const { return this->sleep_enabled_; }
+  bool set_temp_allowed() const { return this->set_temp_enabled_; }
+
+  bool is_fan_mode_supported(const daikin::FAN_MODE fan_mode) const {
+    if (fan_mode == daikin::FAN_QUIET)
+      return this->quiet_enabled_;
+
+    if (fan_mode == daikin::FAN_TURBO)
+      return this->turbo_enabled_;
+
+    if (this->ac_.getMode() == daikin::MODE_FAN && fan_mode == daikin::FAN_AUTO)
+      return false;
+
+    return true;
+  }
+
+  void set_mode(const daikin::AC_MODE mode) {
+    this->ac_.setMode(daikin_mode_code(mode));
+    switch (mode) {
+      case daikin::MODE_HEAT:
+        set_constraints_(true, true, true, true);
+        break;
+      case daikin::MODE_DRY:
+        set_constraints_(false, false, false, true);
+        break;
+      case daikin::MODE_COOL:
+        set_constraints_(true, true, true, true);
+        break;
+      case daikin::MODE_FAN:
+        set_constraints_(false, false, false, false);
+        break;
+      case daikin::MODE_AUTO:
+        set_constraints_(false, false, true, true);
+        break;
+      default:
+        break;
+    }
+  }
+};
+
+//маски из MODE_CAPABILITIES, как в IRDaikin
+class DaikinMask : public DaikinModel<DaikinMask> {
+ private:
+  uint8_t features_{0};
+  uint16_t fan_modes_{daikin::FAN_MASK_BASE};
+
+ public:
+  bool turbo_allowed() const { return (this->features_ & daikin::CAP_TURBO) != 0; }
+  bool quiet_allowed() const { return (this->features_ & daikin::CAP_QUIET) != 0; }
+  bool sleep_allowed() const { return (this->features_ & daikin::CAP_SLEEP) != 0; }
+  bool set_temp_allowed() const { return (this->features_ & daikin::CAP_SET_TEMP) != 0; }
+
+  bool is_fan_mode_supported(const daikin::FAN_MODE fan_mode) const {
+    return (this->fan_modes_ & daikin::fan_bit(fan_mode)) != 0;
+  }
+
+  uint16_t get_fan_modes_mask() const { return this->fan_modes_; }
+
+  void set_mode(const daikin::AC_MODE mode) {
+    this->ac_.setMode(daikin_mode_code(mode));
+    for (const auto &capabilities : daikin::MODE_CAPABILITIES) {
+      if (capabilities.mode != mode)
+        continue;
+
+      this->features_ = capabilities.features;
+      this->fan_modes_ = capabilities.fan_modes;
+      break;
+    }
+    apply_constraints_();
+  }
+};
+
+const daikin::AC_MODE DAIKIN_MODES[] = {daikin::MODE_HEAT, daikin::MODE_DRY, daikin::MODE_COOL, daikin::MODE_FAN,
+                                        daikin::MODE_AUTO};
+const daikin::FAN_MODE DAIKIN_FANS[] = {daikin::FAN_AUTO, daikin::FAN_QUIET, daikin::FAN_LOW,
+                                        daikin::FAN_MEDIUM, daikin::FAN_HIGH, daikin::FAN_TURBO};
+const uint32_t DAIKIN_COMMANDS = 5 * 6;
+
+template<typename Model> void daikin_command(Model &model, const uint32_t i) {
+  model.set_mode(DAIKIN_MODES[i % 5]);
+  model.set_fan(DAIKIN_FANS[(i / 5) % 6]);
+}
+
+//---------------------------------------- dahatsu ----------------------------------------
+
+uint8_t dahatsu_mode_code(const dahatsu::AC_MODE mode) {
+  switch (mode) {
+    case dahatsu::MODE_HEAT:
+      return 1;
+    case dahatsu::MODE_DRY:
+      return 2;
+    case dahatsu::MODE_COOL:
+      return 3;
+    case dahatsu::MODE_FAN:
+      return 7;
+    default:
+      return 8;
+  }
+}
+
+//общая часть: кадр и сброс health/light/eco как в IRDahatsu::set_constraints, turbo в последовательности не включается
+template<typename Constraints> class DahatsuModel {
+ protected:
+  IRTcl112Ac ac_{0};
+
+  Constraints &self() { return static_cast<Constraints &>(*this); }
+
+  dahatsu::FAN_MODE get_fan() const { return static_cast<dahatsu::FAN_MODE>(this->ac_.getFan()); }
+
+  void apply_constraints_(const dahatsu::FAN_MODE default_fan_mode) {
+    if (self().health_allowed() == false && this->ac_.getHealth())
+      this->ac_.setHealth(false);
+
+    if (self().light_allowed() == false && this->ac_.getLight())
+      this->ac_.setLight(false);
+
+    if (self().eco_allowed() == false && this->ac_.getEcono())
+      this->ac_.setEcono(false);
+
+    if (self().is_fan_mode_supported(get_fan()) == false)
+      set_fan(default_fan_mode);
+  }
+
+ public:
+  bool set_fan(const dahatsu::FAN_MODE fan_mode) {
+    if (self().is_fan_mode_supported(fan_mode) == false)
+      return false;
+
+    this->ac_.setFan(fan_mode);
+    return true;
+  }
+
+  uint64_t get_raw() {
+    const uint8_t *raw = this->ac_.getRaw();
+    uint64_t hash = 0;
+    for (uint16_t i = 0; i < kTcl112AcStateLength; i++)
+      hash = hash * 31 + raw[i];
+    return hash;
+  }
+};
+
+class DahatsuBranchy : public DahatsuModel<DahatsuBranchy> {
+ private:
+  bool health_enabled_{true};
+  bool light_enabled_{true};
+  bool turbo_enabled_{true};
+  bool eco_enabled_{true};
+  bool set_temp_enabled_{true};
+
+  void set_constraints(const bool health_enabled, const bool light_enabled, const bool turbo_enabled,
+                       const bool eco_enabled, const bool set_temp_enabled,
+                       const dahatsu::FAN_MODE default_fan_mode) {
+    this->health_enabled_ = health_enabled;
+    this->light_enabled_ = light_enabled;
+    this->turbo_enabled_ = turbo_enabled;
+    this->eco_enabled_ = eco_enabled;
+    this->set_temp_enabled_ = set_temp_enabled;
+    apply_constraints_(default_fan_mode);
+  }
+
+ public:
+  bool health_allowed() const { return this->health_enabled_; }
+  bool light_allowed() const { return this->light_enabled_; }
+  bool turbo_allowed() const { return this->turbo_enabled_; }
+  bool eco_allowed() const { return this->eco_enabled_; }
+  bool set_temp_allowed() const { return this->set_temp_enabled_; }
+
+  bool is_fan_mode_supported(const dahatsu::FAN_MODE fan_mode) const {
+    const auto mode = this->ac_.getMode();
+
+    if (mode == dahatsu_mode_code(dahatsu::MODE_FAN))
+      return fan_mode != dahatsu::FAN_AUTO;
+
+    if (mode == dahatsu_mode_code(dahatsu::MODE_DRY))
+      return fan_mode == dahatsu::FAN_AUTO;
+
+    return true;
+  }
+
+  void set_mode(const dahatsu::AC_MODE mode) {
+    this->ac_.setMode(dahatsu_mode_code(mode));
+    switch (mode) {
+      case dahatsu::MODE_HEAT:
+        set_constraints(true, true, true, true, true, dahatsu::FAN_MEDIUM);
+        break;
+      case dahatsu::MODE_DRY:
+        set_constraints(true, true, true, false, false, dahatsu::FAN_AUTO);
+        break;
+      case dahatsu::MODE_COOL:
+        set_constraints(true, true, true, true, true, dahatsu::FAN_MEDIUM);
+        break;
+      case dahatsu::MODE_FAN:
+        set_constraints(true, true, true, false, false, dahatsu::FAN_MEDIUM);
+        break;
+      case dahatsu::MODE_AUTO:
+        set_constraints(true, true, false, false, false, dahatsu::FAN_MEDIUM);
+        break;
+      default:
+        break;
+    }
+  }
+};
+
+class DahatsuMask : public DahatsuModel<DahatsuMask> {
+ private:
+  uint8_t features_{dahatsu::CAP_HEALTH | dahatsu::CAP_LIGHT | dahatsu::CAP_TURBO | dahatsu::CAP_ECO |
+                    dahatsu::CAP_SET_TEMP};
+  uint16_t fan_modes_{dahatsu::FAN_MASK_ALL};
+
+ public:
+  bool health_allowed() const { return (this->features_ & dahatsu::CAP_HEALTH) != 0; }
+  bool light_allowed() const { return (this->features_ & dahatsu::CAP_LIGHT) != 0; }
+  bool turbo_allowed() const { return (this->features_ & dahatsu::CAP_TURBO) != 0; }
+  bool eco_allowed() const { return (this->features_ & dahatsu::CAP_ECO) != 0; }
+  bool set_temp_allowed() const { return (this->features_ & dahatsu::CAP_SET_TEMP) != 0; }
+
+  bool is_fan_mode_supported(const dahatsu::FAN_MODE fan_mode) const {
+    return (this->fan_modes_ & dahatsu::fan_bit(fan_mode)) != 0;
+  }
+
+  uint16_t get_fan_modes_mask() const { return this->fan_modes_; }
+
+  void set_mode(const dahatsu::AC_MODE mode) {
+    this->ac_.setMode(dahatsu_mode_code(mode));
+    dahatsu::FAN_MODE default_fan_mode = dahatsu::FAN_MEDIUM;
+    for (const auto &capabilities : dahatsu::MODE_CAPABILITIES) {
+      if (capabilities.mode != mode)
+        continue;
+
+      this->features_ = capabilities.features;
+      this->fan_modes_ = capabilities.fan_modes;
+      default_fan_mode = capabilities.default_fan;
+      break;
+    }
+    apply_constraints_(default_fan_mode);
+  }
+};
+
+const dahatsu::AC_MODE DAHATSU_MODES[] = {dahatsu::MODE_HEAT, dahatsu::MODE_DRY, dahatsu::MODE_COOL,
+                                          dahatsu::MODE_FAN, dahatsu::MODE_AUTO};
+const dahatsu::FAN_MODE DAHATSU_FANS[] = {dahatsu::FAN_AUTO, dahatsu::FAN_LOW, dahatsu::FAN_MEDIUM,
+                                          dahatsu::FAN_HIGH};
+const uint32_t DAHATSU_COMMANDS = 5 * 4;
+
+template<typename Model> void dahatsu_command(Model &model, const uint32_t i) {
+  model.set_mode(DAHATSU_MODES[i % 5]);
+  model.set_fan(DAHATSU_FANS[(i / 5) % 4]);
+}
+
+//------------------------------------------------------------------------------------------
+
+//модели должны давать одинаковые кадры и ограничения на всей последовательности команд, иначе замер бессмысленен
+template<typename Branchy, typename Mask>
+void check_same(const char *name, const uint32_t commands, void (*branchy_command)(Branchy &, uint32_t),
+                void (*mask_command)(Mask &, uint32_t)) {
+  Branchy branchy;
+  Mask mask;
+  for (uint32_t i = 0; i < commands * 2; i++) {
+    branchy_command(branchy, i);
+    mask_command(mask, i);
+    if (branchy.get_raw() != mask.get_raw() || branchy.turbo_allowed() != mask.turbo_allowed() ||
+        branchy.set_temp_allowed() != mask.set_temp_allowed()) {
+      fprintf(stderr, "%s: branchy and mask models differ at command %u\n", name, i);
+      abort();
+    }
+  }
+}
+
+//список fan_modes_al как в MQTTClimateComponent: до таблиц - is_fan_mode_supported на каждый режим обдува
+template<typename Model, size_t N, typename Fan> uint16_t allowed_fans_branchy(const Model &model, const Fan (&fans)[N]) {
+  uint16_t allowed = 0;
+  for (const auto fan_mode : fans) {
+    if (model.is_fan_mode_supported(fan_mode))
+      allowed |= 1 << fan_mode;
+  }
+  return allowed;
+}
+
+template<typename Model, size_t N, typename Fan> uint16_t allowed_fans_mask(const Model &model, const Fan (&fans)[N]) {
+  const auto fan_modes_mask = model.get_fan_modes_mask();
+  uint16_t allowed = 0;
+  for (const auto fan_mode : fans) {
+    if (fan_modes_mask & (1 << fan_mode))
+      allowed |= 1 << fan_mode;
+  }
+  return allowed;
+}
+
+}  // namespace
+
+BENCH_CASE(daikin_apply_command) {
+  check_same("daikin", DAIKIN_COMMANDS, daikin_command<DaikinBranchy>, daikin_command<DaikinMask>);
+
+  DaikinBranchy branchy;
+  DaikinMask mask;
+  uint32_t i = 0;
+
+  host_bench::run("daikin set_mode + set_fan: branchy (before)", 2000000, [&] {
+    daikin_command(branchy, i++);
+    host_bench::do_not_optimize(branchy.get_raw());
+  });
+
+  host_bench::run("daikin set_mode + set_fan: MODE_CAPABILITIES mask", 2000000, [&] {
+    daikin_command(mask, i++);
+    host_bench::do_not_optimize(mask.get_raw());
+  });
+}
+
+BENCH_CASE(daikin_allowed_fans) {
+  DaikinBranchy branchy;
+  DaikinMask mask;
+  uint32_t i = 0;
+
+  host_bench::run("daikin fan_modes_al: is_fan_mode_supported branchy (before)", 2000000, [&] {
+    if ((i++ & 0xFF) == 0)
+      daikin_command(branchy, i >> 8);
+    host_bench::do_not_optimize(allowed_fans_branchy(branchy, DAIKIN_FANS));
+  });
+
+  host_bench::run("daikin fan_modes_al: mask", 2000000, [&] {
+    if ((i++ & 0xFF) == 0)
+      daikin_command(mask, i >> 8);
+    host_bench::do_not_optimize(allowed_fans_mask(mask, DAIKIN_FANS));
+  });
+}
+
+BENCH_CASE(dahatsu_apply_command) {
+  check_same("dahatsu", DAHATSU_COMMANDS, dahatsu_command<DahatsuBranchy>, dahatsu_command<DahatsuMask>);
+
+  DahatsuBranchy branchy;
+  DahatsuMask mask;
+  uint32_t i = 0;
+
+  host_bench::run("dahatsu set_mode + set_fan: branchy (before)", 2000000, [&] {
+    dahatsu_command(branchy, i++);
+    host_bench::do_not_optimize(branchy.get_raw());
+  });
+
+  host_bench::run("dahatsu set_mode + set_fan: MODE_CAPABILITIES mask", 2000000, [&] {
+    dahatsu_command(mask, i++);
+    host_bench::do_not_optimize(mask.get_raw());
+  });
+}
+
+BENCH_CASE(dahatsu_allowed_fans) {
+  DahatsuBranchy branchy;
+  DahatsuMask mask;
+  uint32_t i = 0;
+
+  host_bench::run("dahatsu fan_modes_al: is_fan_mode_supported branchy (before)", 2000000, [&] {
+    if ((i++ & 0xFF) == 0)
+      dahatsu_command(branchy, i >> 8);
+    host_bench::do_not_optimize(allowed_fans_branchy(branchy, DAHATSU_FANS));
+  });
+
+  host_bench::run("dahatsu fan_modes_al: mask", 2000000, [&] {
+    if ((i++ & 0xFF) == 0)
+      dahatsu_command(mask, i >> 8);
+    host_bench::do_not_optimize(allowed_fans_mask(mask, DAHATSU_FANS));
+  });
+}
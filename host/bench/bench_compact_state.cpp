@@ -0,0 +1,64 @@
+//Восстановление состояния из retain сообщения: компактное состояние в hex (<name>/r) против json (<name>/i).
+//Размер сообщения и время разбора с применением к драйверу, сообщения берутся из публикаций компонента.
+
+#include "esphome.h"
+#include "daikin/DaikinClimateComponent.h"
+#include "dahatsu/DahatsuClimateComponent.h"
+
+#include "bench.h"
+#include "node.h"
+
+namespace {
+
+//компонент публикует оба топика, берем последние сообщения
+template<typename C> void published_state(C *component, const std::string &name, std::string &compact, std::string &info) {
+  component->enable_compact_state_topic();
+  host_node::start(component, name + "/i");
+  global_mqtt_client->deliver(name + "/m/c", "cool");
+  global_mqtt_client->deliver(name + "/t/c", "22");
+  global_mqtt_client->deliver(name + "/f/c", "low");
+  host_node::loop_for(component, 400);
+
+  compact = global_mqtt_client->last(name + "/r")->payload;
+  info = global_mqtt_client->last(name + "/i")->payload;
+  printf("%-52s %6u B compact %6u B json\n", (name + ": payload").c_str(), static_cast<unsigned>(compact.size()),
+         static_cast<unsigned>(info.size()));
+}
+
+}  // namespace
+
+BENCH_CASE(daikin_restore_state) {
+  typedef mqtt_climate::DaikinClimateComponent Component;
+  std::string compact, info;
+  published_state(new Component(D5, D2, "daikin"), "daikin", compact, info);
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+
+  host_bench::run("daikin: /r hex -> restore_compact_state", 200000, [&] {
+    ir_climate::daikin::IRDaikin::CompactState state;
+    if(Component::decode_compact_state(compact, state))
+      host_bench::do_not_optimize(ac.restore_compact_state(state));
+  });
+
+  host_bench::run("daikin: /i json -> restore_state", 200000, [&] {
+    json::parse_json(info, [&ac](JsonObject &root) { mqtt_climate::DaikinClimateTraits::restore_state(&ac, root); });
+    host_bench::do_not_optimize(ac.get_hvac_mode());
+  });
+}
+
+BENCH_CASE(dahatsu_restore_state) {
+  typedef mqtt_climate::DahatsuClimateComponent Component;
+  std::string compact, info;
+  published_state(new Component(D5, D2, "dahatsu"), "dahatsu", compact, info);
+  ir_climate::dahatsu::IRDahatsu ac(D5, D2);
+
+  host_bench::run("dahatsu: /r hex -> restore_compact_state", 200000, [&] {
+    ir_climate::dahatsu::IRDahatsu::CompactState state;
+    if(Component::decode_compact_state(compact, state))
+      host_bench::do_not_optimize(ac.restore_compact_state(state));
+  });
+
+  host_bench::run("dahatsu: /i json -> restore_state", 200000, [&] {
+    json::parse_json(info, [&ac](JsonObject &root) { mqtt_climate::DahatsuClimateTraits::restore_state(&ac, root); });
+    host_bench::do_not_optimize(ac.get_hvac_mode());
+  });
+}
@@ -0,0 +1,135 @@
+//Драйвер dahatsu и компонент на хосте: разбор команд, turbo, постановка кадра, прием кадра с пульта,
+//команда из mqtt до кадра.
+
+#include "esphome.h"
+#include "dahatsu/DahatsuClimateComponent.h"
+
+#include "bench.h"
+#include "node.h"
+
+namespace {
+
+std::vector<uint32_t> remote_timings(uint8_t mode, float temp) {
+  IRTcl112Ac remote(0);
+  remote.on();
+  remote.setMode(mode);
+  remote.setTemp(temp);
+  IRsend sender(0);
+  sender.sendTcl112Ac(remote.getRaw());
+  auto timings = host::ir_sent().back().timings;
+  host::ir_sent().clear();
+  timings.pop_back();
+  return timings;
+}
+
+//to_string до перехода на snprintf: сборка строки конкатенацией и копия в std::string, две кучи на вызов
+std::string legacy_to_string(const ir_climate::dahatsu::IRDahatsu &ac) {
+  std::string result;
+  result.reserve(120);
+  result += std::string("power: ") + (ac.get_hvac_mode() != ir_climate::dahatsu::AC_MODE::MODE_OFF ? "On" : "Off");
+  result += ", hvac_mode: " + std::to_string(ac.get_hvac_mode()) + " (" + ac.get_hvac_mode_str() + ")";
+  result += ", mode: " + std::to_string(ac.get_mode()) + " (" + ac.get_mode_str() + ")";
+  result += ", Temp: " + std::to_string(ac.get_temp()) + "C";
+  result += ", fan: " + std::to_string(ac.get_fan()) + " (" + ac.get_fan_str() + ")";
+  result += ", swing: " + std::to_string(ac.get_swing_mode()) + " (" + ac.get_swing_mode_str() + ")";
+  result += std::string(", turbo: ") + (ac.get_turbo() ? "On" : "Off");
+  result += std::string(", eco: ") + (ac.get_eco() ? "On" : "Off");
+  result += std::string(", health: ") + (ac.get_health() ? "On" : "Off");
+  result += std::string(", light: ") + (ac.get_light() ? "On" : "Off");
+  return std::string(result.c_str());
+}
+
+}  // namespace
+
+BENCH_CASE(dahatsu_set_hvac_mode) {
+  ir_climate::dahatsu::IRDahatsu ac(D5, D2);
+  static const char *const MODES[] = {"cool", "heat", "dry", "fan_only", "auto", "off"};
+  uint32_t i = 0;
+
+  host_bench::run("IRDahatsu::set_hvac_mode(string)", 1000000, [&] {
+    ac.set_hvac_mode(MODES[i++ % 6]);
+    host_bench::do_not_optimize(ac.get_hvac_mode());
+  });
+}
+
+BENCH_CASE(dahatsu_set_fan) {
+  ir_climate::dahatsu::IRDahatsu ac(D5, D2);
+  ac.set_hvac_mode(ir_climate::dahatsu::AC_MODE::MODE_COOL);
+  static const char *const FANS[] = {"auto", "low", "medium", "high"};
+  uint32_t i = 0;
+
+  host_bench::run("IRDahatsu::set_fan(string)", 1000000, [&] {
+    host_bench::do_not_optimize(ac.set_fan(FANS[i++ % 4]));
+  });
+}
+
+BENCH_CASE(dahatsu_turbo_toggle) {
+  ir_climate::dahatsu::IRDahatsu ac(D5, D2);
+  ac.set_hvac_mode(ir_climate::dahatsu::AC_MODE::MODE_HEAT);
+  uint32_t i = 0;
+
+  host_bench::run("IRDahatsu::set_turbo on/off", 1000000, [&] {
+    host_bench::do_not_optimize(ac.set_turbo((i++ & 1) == 0));
+  });
+}
+
+BENCH_CASE(dahatsu_send_and_transmit) {
+  ir_climate::dahatsu::IRDahatsu ac(D5, D2);
+  ac.setup();
+  ac.set_hvac_mode(ir_climate::dahatsu::AC_MODE::MODE_COOL);
+
+  //главный цикл только запускает кадр и проверяет, не закончил ли его timer1
+  ac.send();
+  ac.loop();
+  host_bench::run("IRDahatsu::loop (frame on air)", 1000000, [&] { ac.loop(); });
+  host::advance_ms(300);
+  ac.loop();
+
+  //полный цикл с прерываниями timer1, их стоимость - стоимость симуляции на хосте
+  host_bench::run("IRDahatsu::send + frame by timer1 (simulated)", 2000, [&] {
+    ac.send();
+    ac.loop();
+    host::advance_ms(300);
+    ac.loop();
+    host::ir_sent().clear();
+  });
+}
+
+BENCH_CASE(dahatsu_decode_remote_frame) {
+  ir_climate::dahatsu::IRDahatsu ac(D5, D2);
+  ac.setup();
+  const std::vector<uint32_t> frames[] = {remote_timings(kTcl112AcCool, 22), remote_timings(kTcl112AcHeat, 26.5)};
+  uint32_t i = 0;
+
+  host_bench::run("IRDahatsu::loop (decode remote frame)", 100000, [&] {
+    host::ir_air_push(frames[i++ & 1]);
+    ac.loop();
+  });
+}
+
+BENCH_CASE(dahatsu_command_to_frame) {
+  auto component = new mqtt_climate::DahatsuClimateComponent(D5, D2, "dahatsu");
+  host_node::start(component, "dahatsu/i");
+  global_mqtt_client->deliver("dahatsu/m/c", "cool");
+  host_node::loop_for(component, 100);
+  static const char *const TEMPS[] = {"21.5", "25"};
+  uint32_t i = 0;
+
+  host_bench::run("mqtt command -> ir frame + state publish", 5000, [&] {
+    global_mqtt_client->deliver("dahatsu/t/c", TEMPS[i++ & 1]);
+    //окно объединения, кадр и пауза после него
+    host_node::loop_for(component, 300);
+    host::ir_sent().clear();
+    global_mqtt_client->published.clear();
+  });
+}
+
+//на уровне INFO to_string не собирается и возвращает пустую строку
+BENCH_CASE(dahatsu_to_string) {
+  ir_climate::dahatsu::IRDahatsu ac(D5, D2);
+  ac.set_hvac_mode(ir_climate::dahatsu::AC_MODE::MODE_COOL);
+
+  host_bench::run("IRDahatsu::to_string", 1000000, [&] { host_bench::do_not_optimize(ac.to_string()); });
+  host_bench::run("IRDahatsu::to_string, String concatenation (before)", 1000000,
+                  [&] { host_bench::do_not_optimize(legacy_to_string(ac).size()); });
+}
@@ -0,0 +1,119 @@
+//Драйвер daikin и компонент на хосте: разбор команд, постановка кадра, прием кадра с пульта, команда из mqtt до кадра.
+
+#include "esphome.h"
+#include "daikin/DaikinClimateComponent.h"
+
+#include "bench.h"
+#include "node.h"
+
+namespace {
+
+//тайминги кадра пульта, кодируются один раз
+std::vector<uint32_t> remote_timings(uint8_t mode, uint8_t temp) {
+  IRDaikin64 remote(0);
+  remote.setMode(mode);
+  remote.setTemp(temp);
+  IRsend sender(0);
+  sender.sendDaikin64(remote.getRaw());
+  auto timings = host::ir_sent().back().timings;
+  host::ir_sent().clear();
+  timings.pop_back();
+  return timings;
+}
+
+//to_string до перехода на snprintf: сборка строки конкатенацией и копия в std::string, две кучи на вызов
+std::string legacy_to_string(const ir_climate::daikin::IRDaikin &ac) {
+  std::string result;
+  result.reserve(120);
+  result += std::string("power: ") + (ac.get_power_state() ? "On" : "Off");
+  result += ", hvac_mode: " + std::to_string(ac.get_hvac_mode()) + " (" + ac.get_hvac_mode_str() + ")";
+  result += ", mode: " + std::to_string(ac.get_mode()) + " (" + ac.get_mode_str() + ")";
+  result += ", Temp: " + std::to_string(ac.get_temp()) + "C";
+  result += ", fan: " + std::to_string(ac.get_fan()) + " (" + ac.get_fan_str() + ")";
+  result += std::string(", sleep: ") + (ac.get_sleep() ? "On" : "Off");
+  result += ", swing: " + std::to_string(ac.get_swing_mode()) + " (" + ac.get_swing_mode_str() + ")";
+  return std::string(result.c_str());
+}
+
+}  // namespace
+
+BENCH_CASE(daikin_set_hvac_mode) {
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+  static const char *const MODES[] = {"cool", "heat", "dry", "fan_only", "auto", "off"};
+  uint32_t i = 0;
+
+  host_bench::run("IRDaikin::set_hvac_mode(string)", 1000000, [&] {
+    ac.set_hvac_mode(MODES[i++ % 6]);
+    host_bench::do_not_optimize(ac.get_hvac_mode());
+  });
+}
+
+BENCH_CASE(daikin_set_fan) {
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+  ac.set_hvac_mode(ir_climate::daikin::AC_MODE::MODE_COOL);
+  static const char *const FANS[] = {"auto", "quiet", "low", "medium", "high", "turbo"};
+  uint32_t i = 0;
+
+  host_bench::run("IRDaikin::set_fan(string)", 1000000, [&] {
+    host_bench::do_not_optimize(ac.set_fan(FANS[i++ % 6]));
+  });
+}
+
+BENCH_CASE(daikin_send_and_transmit) {
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+  ac.setup();
+  ac.set_hvac_mode(ir_climate::daikin::AC_MODE::MODE_COOL);
+
+  //главный цикл только запускает кадр и проверяет, не закончил ли его timer1
+  ac.send();
+  ac.loop();
+  host_bench::run("IRDaikin::loop (frame on air)", 1000000, [&] { ac.loop(); });
+  host::advance_ms(300);
+  ac.loop();
+
+  //полный цикл с прерываниями timer1, их стоимость - стоимость симуляции на хосте
+  host_bench::run("IRDaikin::send + frame by timer1 (simulated)", 2000, [&] {
+    ac.send();
+    ac.loop();
+    host::advance_ms(300);
+    ac.loop();
+    host::ir_sent().clear();
+  });
+}
+
+BENCH_CASE(daikin_decode_remote_frame) {
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+  ac.setup();
+  const std::vector<uint32_t> frames[] = {remote_timings(kDaikin64Cool, 22), remote_timings(kDaikin64Heat, 26)};
+  uint32_t i = 0;
+
+  host_bench::run("IRDaikin::loop (decode remote frame)", 100000, [&] {
+    host::ir_air_push(frames[i++ & 1]);
+    ac.loop();
+  });
+}
+
+BENCH_CASE(daikin_command_to_frame) {
+  auto component = new mqtt_climate::DaikinClimateComponent(D5, D2, "daikin");
+  host_node::start(component, "daikin/i");
+  static const char *const TEMPS[] = {"21", "25"};
+  uint32_t i = 0;
+
+  host_bench::run("mqtt command -> ir frame + state publish", 5000, [&] {
+    global_mqtt_client->deliver("daikin/t/c", TEMPS[i++ & 1]);
+    //окно объединения, кадр и пауза после него
+    host_node::loop_for(component, 300);
+    host::ir_sent().clear();
+    global_mqtt_client->published.clear();
+  });
+}
+
+//на уровне INFO to_string не собирается и возвращает пустую строку
+BENCH_CASE(daikin_to_string) {
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+  ac.set_hvac_mode(ir_climate::daikin::AC_MODE::MODE_COOL);
+
+  host_bench::run("IRDaikin::to_string", 1000000, [&] { host_bench::do_not_optimize(ac.to_string()); });
+  host_bench::run("IRDaikin::to_string, String concatenation (before)", 1000000,
+                  [&] { host_bench::do_not_optimize(legacy_to_string(ac).size()); });
+}
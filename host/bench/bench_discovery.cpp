@@ -0,0 +1,64 @@
+//Пик кучи на итерации главного цикла, которая публикует discovery: первая публикация собирает json документ,
+//переподключение публикует готовую строку. До кеширования каждое переподключение повторяло первую публикацию,
+//поэтому первая строка - это и пик переподключения до изменения.
+
+#include "esphome.h"
+#include "daikin/DaikinClimateComponent.h"
+#include "dahatsu/DahatsuClimateComponent.h"
+
+#include "bench.h"
+#include "node.h"
+
+namespace {
+
+struct DiscoveryPeak {
+  uint64_t peak_bytes;
+  uint64_t allocations;
+  size_t payload_bytes;
+};
+
+//главный цикл до итерации с публикацией discovery, пик живых выделений сверх уровня перед этой итерацией
+template<typename C> DiscoveryPeak discovery_iteration(C *component, const std::string &topic) {
+  const size_t published = global_mqtt_client->count(topic);
+  for(uint32_t i = 0; i < 1000; i++) {
+    const auto before = host::alloc_stats();
+    host::reset_alloc_peak();
+    component->call_loop();
+    const auto after = host::alloc_stats();
+
+    if(global_mqtt_client->count(topic) > published)
+      return DiscoveryPeak{after.peak_bytes - before.live_bytes, after.allocations - before.allocations,
+                           global_mqtt_client->last(topic)->payload.size()};
+    host::advance_ms(host_node::LOOP_INTERVAL_MS);
+  }
+  return DiscoveryPeak{0, 0, 0};
+}
+
+void print(const char *name, const DiscoveryPeak &peak) {
+  printf("%-52s %10llu B peak %8llu allocs %8u B payload\n", name, static_cast<unsigned long long>(peak.peak_bytes),
+         static_cast<unsigned long long>(peak.allocations), static_cast<unsigned>(peak.payload_bytes));
+}
+
+template<typename C> void bench_discovery(C *component, const std::string &name) {
+  const std::string topic = "homeassistant/climate/" + name + "/config";
+  component->call_setup();
+
+  print((name + ": first discovery (render + publish)").c_str(), discovery_iteration(component, topic));
+
+  host_node::loop_for(component, 1000);
+  global_mqtt_client->set_connected(false);
+  host_node::loop_for(component, 100);
+  global_mqtt_client->reconnect();
+
+  print((name + ": reconnect (publish from cache)").c_str(), discovery_iteration(component, topic));
+}
+
+}  // namespace
+
+BENCH_CASE(daikin_discovery_heap) {
+  bench_discovery(new mqtt_climate::DaikinClimateComponent(D5, D2, "daikin"), "daikin");
+}
+
+BENCH_CASE(dahatsu_discovery_heap) {
+  bench_discovery(new mqtt_climate::DahatsuClimateComponent(D5, D2, "dahatsu"), "dahatsu");
+}
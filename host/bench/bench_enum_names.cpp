@@ -0,0 +1,65 @@
+//Разбор строк команд в перечисления: цепочка str_equals_case_insensitive (до таблиц),
+//перебор таблицы по ключу (первая версия таблиц) и идеальный хэш.
+
+#include "esphome.h"
+#include "daikin/lib/IRDaikin.h"
+
+#include "bench.h"
+
+using namespace ir_climate;
+using namespace ir_climate::daikin;
+
+namespace {
+
+//команды, как они приходят из mqtt: в основном известные, в разном регистре, иногда мусор
+const std::string INPUTS[] = {"cool", "heat", "off", "fan_only", "auto", "dry", "COOL", "Heat", "eco", "warm"};
+const size_t INPUT_COUNT = sizeof(INPUTS) / sizeof(INPUTS[0]);
+
+AC_MODE parse_mode_chain(const std::string &mode) {
+  if (str_equals_case_insensitive(mode, "OFF"))
+    return AC_MODE::MODE_OFF;
+  if (str_equals_case_insensitive(mode, "AUTO"))
+    return AC_MODE::MODE_AUTO;
+  if (str_equals_case_insensitive(mode, "COOL"))
+    return AC_MODE::MODE_COOL;
+  if (str_equals_case_insensitive(mode, "HEAT"))
+    return AC_MODE::MODE_HEAT;
+  if (str_equals_case_insensitive(mode, "FAN_ONLY"))
+    return AC_MODE::MODE_FAN;
+  if (str_equals_case_insensitive(mode, "DRY"))
+    return AC_MODE::MODE_DRY;
+
+  return AC_MODE::MODE_UNDEFINED;
+}
+
+template<size_t N> uint8_t parse_key_scan(const EnumName (&names)[N], const std::string &str, const uint8_t fallback) {
+  if (str.empty() || str.size() > UINT8_MAX)
+    return fallback;
+
+  const auto key = enum_name_key_(str[0], static_cast<uint8_t>(str.size()));
+
+  for (const auto &entry : names) {
+    if (entry.key == key && strncasecmp(entry.name, str.c_str(), str.size()) == 0)
+      return entry.value;
+  }
+
+  return fallback;
+}
+
+}  // namespace
+
+BENCH_CASE(parse_mode) {
+  uint32_t i = 0;
+
+  host_bench::run("parse_mode: str_equals_case_insensitive chain", 2000000, [&] {
+    host_bench::do_not_optimize(parse_mode_chain(INPUTS[i++ % INPUT_COUNT]));
+  });
+
+  host_bench::run("parse_mode: key scan", 2000000, [&] {
+    host_bench::do_not_optimize(parse_key_scan(MODE_NAMES, INPUTS[i++ % INPUT_COUNT], AC_MODE::MODE_UNDEFINED));
+  });
+
+  host_bench::run("parse_mode: perfect hash", 2000000, [&] {
+    host_bench::do_not_optimize(IRDaikin::parse_mode(INPUTS[i++ % INPUT_COUNT]));
+  });
+}
@@ -0,0 +1,159 @@
+//Фаззинг IRDahatsu: кадры пульта и мусор в эфире (on_frame_), initialize() из retain строк,
+//строковые сеттеры из mqtt и восстановление из flash. После каждой операции - инварианты драйвера.
+
+#include "esphome.h"
+#include "dahatsu/lib/IRDahatsu.h"
+
+#include "fuzz.h"
+
+using namespace ir_climate::dahatsu;
+
+namespace {
+
+enum Operation : uint8_t {
+  OP_REMOTE_FRAME,
+  OP_RAW_TIMINGS,
+  OP_HVAC_MODE,
+  OP_FAN,
+  OP_SWING,
+  OP_TURBO,
+  OP_ECO,
+  OP_HEALTH,
+  OP_LIGHT,
+  OP_TEMP,
+  OP_INITIALIZE,
+  OP_SEND,
+  OP_RESTORE,
+  OP_COUNT,
+};
+
+const ModeCapabilities *find_capabilities(const AC_MODE mode) {
+  for(const auto &capabilities : MODE_CAPABILITIES) {
+    if(capabilities.mode == mode)
+      return &capabilities;
+  }
+  return nullptr;
+}
+
+void check_invariants(const IRDahatsu &ac) {
+  const auto mode = ac.get_mode();
+  FUZZ_CHECK(mode != MODE_UNDEFINED && mode != MODE_OFF, ac.to_string());
+
+  //маски режима всегда из таблицы возможностей
+  const auto capabilities = find_capabilities(mode);
+  FUZZ_CHECK(capabilities != nullptr, ac.to_string());
+  FUZZ_CHECK(ac.get_fan_modes_mask() == capabilities->fan_modes, ac.to_string());
+
+  //турбо в осушении ставит low, которого в режиме нет
+  const bool turbo_dry_fan = ac.get_turbo() && mode == MODE_DRY && ac.get_fan() == FAN_LOW;
+  FUZZ_CHECK(ac.is_fan_mode_supported(ac.get_fan()) || turbo_dry_fan, ac.to_string());
+
+  FUZZ_CHECK(ac.get_temp() >= ac.temp_min && ac.get_temp() <= ac.temp_max, ac.to_string());
+  FUZZ_CHECK(ac.get_turbo() == false || ac.turbo_allowed(), ac.to_string());
+  FUZZ_CHECK(ac.get_eco() == false || ac.eco_allowed(), ac.to_string());
+  FUZZ_CHECK(ac.get_health() == false || ac.health_allowed(), ac.to_string());
+  FUZZ_CHECK(ac.get_light() == false || ac.light_allowed(), ac.to_string());
+  FUZZ_CHECK((ac.get_turbo() && ac.get_eco()) == false, ac.to_string());
+}
+
+IRDahatsu &driver() {
+  static IRDahatsu *ac = nullptr;
+  if(ac == nullptr) {
+    host::set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+    ac = new IRDahatsu(D5, D2);
+    ac->setup();
+  }
+  return *ac;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  auto &ac = driver();
+  static const IRDahatsu::CompactState initial_state = ac.get_compact_state();
+  host_fuzz::begin_input(ac, initial_state);
+
+  host_fuzz::Input input(data, size);
+  while(input.empty() == false) {
+    switch(input.byte() % OP_COUNT) {
+      case OP_REMOTE_FRAME: {
+        //контрольная сумма исправляется, иначе приемник отбросит почти все кадры
+        uint8_t raw[kTcl112AcStateLength];
+        input.bytes(raw, sizeof(raw));
+        raw[kTcl112AcStateLength - 1] = IRTcl112Ac::calcChecksum(raw);
+        host::ir_air_push_tcl112ac(raw);
+        host_fuzz::loop_for(ac, 50);
+        break;
+      }
+      case OP_RAW_TIMINGS: {
+        std::vector<uint32_t> timings(input.byte() % 240);
+        for(auto &timing : timings)
+          timing = input.word();
+        host::ir_air_push(timings);
+        host_fuzz::loop_for(ac, 50);
+        break;
+      }
+      case OP_HVAC_MODE:
+        ac.set_hvac_mode(input.string());
+        break;
+      case OP_FAN:
+        ac.set_fan(input.string());
+        break;
+      case OP_SWING:
+        ac.set_swing_mode(input.string());
+        break;
+      case OP_TURBO:
+        ac.set_turbo(input.string());
+        break;
+      case OP_ECO:
+        ac.set_eco(input.string());
+        break;
+      case OP_HEALTH:
+        ac.set_health(input.string());
+        break;
+      case OP_LIGHT:
+        ac.set_light(input.string());
+        break;
+      case OP_TEMP:
+        //шаг 0.5, значения и за пределами диапазона
+        ac.set_temp(input.byte() * 0.5f);
+        break;
+      case OP_INITIALIZE: {
+        const auto hvac_mode = input.string();
+        const auto mode = input.string();
+        const auto fan_mode = input.string();
+        const auto swing_mode = input.string();
+        const auto temp = input.byte() * 0.5f;
+        const bool turbo = input.flag();
+        const bool eco = input.flag();
+        const bool health = input.flag();
+        const bool light = input.flag();
+        //как restore_state компонента: состояние до turbo только вместе с turbo
+        State *prev_state = nullptr;
+        if(turbo && input.flag()) {
+          const auto prev_temp = input.byte() * 0.5f;
+          const auto prev_fan_mode = IRDahatsu::parse_fan_mode(input.string());
+          prev_state = new State(prev_temp, prev_fan_mode, IRDahatsu::parse_swing_mode(input.string()));
+        }
+        ac.initialize(hvac_mode, mode, fan_mode, swing_mode, prev_state, temp, turbo, eco, health, light);
+        break;
+      }
+      case OP_SEND:
+        ac.send();
+        host_fuzz::loop_for(ac, 300);
+        //кадр tcl112ac с паузой ~200 мс, за 300 мс он целиком в эфире
+        FUZZ_CHECK(ac.is_send_pending() == false, ac.to_string());
+        break;
+      case OP_RESTORE: {
+        IRDahatsu::CompactState state;
+        input.bytes(reinterpret_cast<uint8_t *>(&state), sizeof(state));
+        ac.restore_compact_state(state);
+        break;
+      }
+    }
+
+    check_invariants(ac);
+  }
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+//Фаззинг IRDaikin: кадры пульта и мусор в эфире (on_frame_), initialize() из retain строк,
+//строковые сеттеры из mqtt и восстановление из flash. После каждой операции - инварианты драйвера.
+
+#include "esphome.h"
+#include "daikin/lib/IRDaikin.h"
+
+#include "fuzz.h"
+
+using namespace ir_climate::daikin;
+
+namespace {
+
+enum Operation : uint8_t {
+  OP_REMOTE_FRAME,
+  OP_RAW_TIMINGS,
+  OP_HVAC_MODE,
+  OP_FAN,
+  OP_SWING,
+  OP_SLEEP,
+  OP_TEMP,
+  OP_INITIALIZE,
+  OP_SEND,
+  OP_RESTORE,
+  OP_COUNT,
+};
+
+const ModeCapabilities *find_capabilities(const AC_MODE mode) {
+  for(const auto &capabilities : MODE_CAPABILITIES) {
+    if(capabilities.mode == mode)
+      return &capabilities;
+  }
+  return nullptr;
+}
+
+void check_invariants(const IRDaikin &ac) {
+  const auto mode = ac.get_mode();
+  FUZZ_CHECK(mode != MODE_UNDEFINED && mode != MODE_OFF, ac.to_string());
+
+  //маски режима всегда из таблицы возможностей
+  const auto capabilities = find_capabilities(mode);
+  FUZZ_CHECK(capabilities != nullptr, ac.to_string());
+  FUZZ_CHECK(ac.get_fan_modes_mask() == capabilities->fan_modes, ac.to_string());
+
+  FUZZ_CHECK(ac.is_fan_mode_supported(ac.get_fan()), ac.to_string());
+  FUZZ_CHECK(ac.get_prev_fan() != FAN_UNDEFINED, ac.to_string());
+  FUZZ_CHECK(enum_to_str(FAN_MODE_NAMES, ac.get_prev_fan(), nullptr) != nullptr, ac.to_string());
+  FUZZ_CHECK(ac.get_temp() >= ac.temp_min && ac.get_temp() <= ac.temp_max, ac.to_string());
+  FUZZ_CHECK(ac.get_sleep() == false || ac.sleep_allowed(), ac.to_string());
+  FUZZ_CHECK((ac.get_hvac_mode() == MODE_OFF) == (ac.get_power_state() == false), ac.to_string());
+}
+
+IRDaikin &driver() {
+  static IRDaikin *ac = nullptr;
+  if(ac == nullptr) {
+    host::set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+    ac = new IRDaikin(D5, D2);
+    ac->setup();
+  }
+  return *ac;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  auto &ac = driver();
+  static const IRDaikin::CompactState initial_state = ac.get_compact_state();
+  host_fuzz::begin_input(ac, initial_state);
+
+  host_fuzz::Input input(data, size);
+  while(input.empty() == false) {
+    switch(input.byte() % OP_COUNT) {
+      case OP_REMOTE_FRAME: {
+        //контрольная сумма исправляется, иначе приемник отбросит почти все кадры
+        uint64_t raw = 0;
+        input.bytes(reinterpret_cast<uint8_t *>(&raw), sizeof(raw));
+        IRDaikin64 remote(0);
+        remote.setRaw(raw);
+        host::ir_air_push_daikin64(remote.getRaw());
+        host_fuzz::loop_for(ac, 50);
+        break;
+      }
+      case OP_RAW_TIMINGS: {
+        std::vector<uint32_t> timings(input.byte() % 160);
+        for(auto &timing : timings)
+          timing = input.word();
+        host::ir_air_push(timings);
+        host_fuzz::loop_for(ac, 50);
+        break;
+      }
+      case OP_HVAC_MODE:
+        ac.set_hvac_mode(input.string());
+        break;
+      case OP_FAN:
+        ac.set_fan(input.string());
+        break;
+      case OP_SWING:
+        ac.set_swing_mode(input.string());
+        break;
+      case OP_SLEEP:
+        ac.set_sleep(input.string());
+        break;
+      case OP_TEMP:
+        ac.set_temp(input.byte());
+        break;
+      case OP_INITIALIZE: {
+        const auto hvac_mode = input.string();
+        const auto mode = input.string();
+        const auto fan_mode = input.string();
+        const auto prev_fan_mode = input.string();
+        const auto swing_mode = input.string();
+        const auto temp = input.byte();
+        const auto sleep = input.flag();
+        ac.initialize(hvac_mode, mode, fan_mode, prev_fan_mode, swing_mode, temp, sleep);
+        break;
+      }
+      case OP_SEND:
+        ac.send();
+        host_fuzz::loop_for(ac, 300);
+        //кадр daikin с паузой ~230 мс, за 300 мс он целиком в эфире
+        FUZZ_CHECK(ac.is_send_pending() == false, ac.to_string());
+        break;
+      case OP_RESTORE: {
+        IRDaikin::CompactState state;
+        input.bytes(reinterpret_cast<uint8_t *>(&state), sizeof(state));
+        ac.restore_compact_state(state);
+        break;
+      }
+    }
+
+    check_invariants(ac);
+  }
+
+  return 0;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+//Часть ядра Arduino ESP8266, которую используют компоненты, для сборки на хосте.
+//Время виртуальное: millis()/micros() возвращают host::time_us(), тесты двигают его сами.
+//timer1 работает по виртуальному времени: прерывания вызываются, когда advance_us/advance_ms/delay
+//проходят момент срабатывания, внутри прерывания время равно моменту срабатывания.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+using std::isnan;
+
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+
+//на хосте flash и ram - одна память, чтение из PROGMEM - обычное разыменование
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t *>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t *>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t *>(addr))
+#define pgm_read_ptr(addr) (*reinterpret_cast<const void *const *>(addr))
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x00
+#define OUTPUT 0x01
+
+//выводы платы d1_mini/esp12e
+#define D1 5
+#define D2 4
+#define D5 14
+#define D6 12
+#define D7 13
+
+//делитель и режим timer1, значения как в core_esp8266_timer.c
+#define TIM_DIV1 0
+#define TIM_DIV16 1
+#define TIM_DIV256 3
+#define TIM_EDGE 0
+#define TIM_LEVEL 1
+#define TIM_SINGLE 0
+#define TIM_LOOP 1
+
+typedef void (*timercallback)(void);
+
+namespace host {
+
+inline uint64_t &time_us_() {
+  static uint64_t time_us = 0;
+  return time_us;
+}
+
+inline uint64_t time_us() { return time_us_(); }
+
+//timer1: тики считаются в пикосекундах, на DIV16 тик - 0.2 мкс
+struct Timer1 {
+  timercallback callback;
+  bool enabled;
+  bool armed;
+  bool loop;
+  uint32_t ps_per_tick;
+  uint32_t reload_ticks;
+  //момент срабатывания
+  uint64_t due_ps;
+  //внутри прерывания - момент его срабатывания, от него считается timer1_write
+  bool in_isr;
+  uint64_t isr_ps;
+};
+
+inline Timer1 &timer1_() {
+  static Timer1 timer{nullptr, false, false, false, 200000, 0, 0, false, 0};
+  return timer;
+}
+
+inline void reset_timer1() { timer1_() = Timer1{nullptr, false, false, false, 200000, 0, 0, false, 0}; }
+
+//текущее время в пикосекундах, для прерывания - момент срабатывания
+inline uint64_t time_ps() { return timer1_().in_isr ? timer1_().isr_ps : time_us_() * 1000000; }
+
+inline void run_timer1_until_(uint64_t time_us) {
+  auto &timer = timer1_();
+  while(timer.enabled && timer.armed && timer.callback != nullptr && timer.due_ps <= time_us * 1000000) {
+    time_us_() = timer.due_ps / 1000000;
+    timer.armed = timer.loop;
+    timer.in_isr = true;
+    timer.isr_ps = timer.due_ps;
+    if(timer.loop)
+      timer.due_ps += static_cast<uint64_t>(timer.reload_ticks) * timer.ps_per_tick;
+    timer.callback();
+    timer.in_isr = false;
+  }
+  time_us_() = time_us;
+}
+
+//назад время идет без прерываний: так тесты начинают с нуля
+inline void set_time_us(uint64_t time_us) {
+  if(time_us > time_us_())
+    run_timer1_until_(time_us);
+  else
+    time_us_() = time_us;
+}
+
+inline void advance_us(uint64_t us) { run_timer1_until_(time_us_() + us); }
+
+inline void advance_ms(uint32_t ms) { advance_us(static_cast<uint64_t>(ms) * 1000); }
+
+//вызывается на каждую запись в вывод, модель ИК светодиода в esphome_host.cpp
+void on_pin_write_(uint8_t pin, uint8_t value);
+
+//состояние выводов: последний записанный уровень
+inline uint8_t *pin_levels_() {
+  static uint8_t levels[17] = {};
+  return levels;
+}
+
+inline uint8_t pin_level(uint8_t pin) { return pin < 17 ? pin_levels_()[pin] : 0; }
+
+}  // namespace host
+
+//на устройстве 32 бита, переполнение millis() через 49 дней воспроизводится так же
+inline uint32_t millis() { return static_cast<uint32_t>(host::time_us() / 1000); }
+
+inline uint32_t micros() { return static_cast<uint32_t>(host::time_us()); }
+
+inline void delay(uint32_t ms) { host::advance_ms(ms); }
+
+inline void delayMicroseconds(uint32_t us) { host::advance_us(us); }
+
+inline void yield() {}
+
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+
+inline void digitalWrite(uint8_t pin, uint8_t value) {
+  if(pin < 17)
+    host::pin_levels_()[pin] = value;
+  host::on_pin_write_(pin, value);
+}
+
+inline void timer1_isr_init() {}
+
+inline void timer1_attachInterrupt(timercallback callback) { host::timer1_().callback = callback; }
+
+inline void timer1_detachInterrupt() {
+  host::timer1_().callback = nullptr;
+  host::timer1_().enabled = false;
+}
+
+inline void timer1_enable(uint8_t divider, uint8_t int_type, uint8_t reload) {
+  auto &timer = host::timer1_();
+  timer.enabled = true;
+  timer.loop = reload == TIM_LOOP;
+  //80 МГц: 12.5 нс на тик без делителя
+  timer.ps_per_tick = divider == TIM_DIV256 ? 3200000 : divider == TIM_DIV16 ? 200000 : 12500;
+}
+
+inline void timer1_disable() {
+  host::timer1_().enabled = false;
+  host::timer1_().armed = false;
+}
+
+//срабатывание через ticks от текущего момента, счетчик 23 бита
+inline void timer1_write(uint32_t ticks) {
+  auto &timer = host::timer1_();
+  ticks &= 0x7FFFFF;
+  timer.reload_ticks = ticks;
+  timer.due_ps = host::time_ps() + static_cast<uint64_t>(ticks) * timer.ps_per_tick;
+  timer.armed = true;
+}
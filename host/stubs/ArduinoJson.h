@@ -0,0 +1,694 @@
+#pragma once
+
+//Подмножество ArduinoJson 5, которое используют компоненты: JsonObject/JsonArray по ссылке,
+//чтение полей с преобразованием типов, operator| со значением по умолчанию, печать и разбор.
+//Память не из JsonBuffer, а из кучи, поэтому замеры памяти на хосте - только ориентир.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class JsonObject;
+class JsonArray;
+
+namespace ajson_host {
+
+struct Value {
+  enum Type : uint8_t { NUL, BOOL, INTEGER, FLOAT, STRING, OBJECT, ARRAY };
+
+  Type type{NUL};
+  bool boolean{false};
+  long long integer{0};
+  double number{0};
+  //float печатается с точностью float, как на устройстве
+  bool single{false};
+  std::string string;
+  std::shared_ptr<JsonObject> object;
+  std::shared_ptr<JsonArray> array;
+
+  void set(bool value) { reset_(BOOL); boolean = value; }
+  void set(signed char value) { set_integer_(value); }
+  void set(unsigned char value) { set_integer_(value); }
+  void set(short value) { set_integer_(value); }
+  void set(unsigned short value) { set_integer_(value); }
+  void set(int value) { set_integer_(value); }
+  void set(unsigned value) { set_integer_(value); }
+  void set(long value) { set_integer_(value); }
+  void set(unsigned long value) { set_integer_(static_cast<long long>(value)); }
+  void set(long long value) { set_integer_(value); }
+  void set(unsigned long long value) { set_integer_(static_cast<long long>(value)); }
+  void set(float value) { reset_(FLOAT); number = value; single = true; }
+  void set(double value) { reset_(FLOAT); number = value; }
+  void set(const char *value) {
+    if(value == nullptr) {
+      reset_(NUL);
+      return;
+    }
+    reset_(STRING);
+    string = value;
+  }
+  void set(const std::string &value) { reset_(STRING); string = value; }
+
+  double as_number() const {
+    switch(type) {
+      case BOOL: return boolean ? 1 : 0;
+      case INTEGER: return static_cast<double>(integer);
+      case FLOAT: return number;
+      case STRING: return strtod(string.c_str(), nullptr);
+      default: return 0;
+    }
+  }
+
+  long long as_integer() const {
+    switch(type) {
+      case BOOL: return boolean ? 1 : 0;
+      case INTEGER: return integer;
+      case FLOAT: return static_cast<long long>(number);
+      case STRING: return strtoll(string.c_str(), nullptr, 10);
+      default: return 0;
+    }
+  }
+
+  bool as_bool() const {
+    switch(type) {
+      case BOOL: return boolean;
+      case INTEGER: return integer != 0;
+      case FLOAT: return number != 0;
+      case STRING: return string == "true";
+      default: return false;
+    }
+  }
+
+  const char *as_string() const { return type == STRING ? string.c_str() : nullptr; }
+
+  bool is_number() const { return type == INTEGER || type == FLOAT; }
+
+ private:
+  void reset_(Type new_type) {
+    type = new_type;
+    single = false;
+    string.clear();
+    object.reset();
+    array.reset();
+  }
+
+  void set_integer_(long long value) { reset_(INTEGER); integer = value; }
+};
+
+inline void print_value(const Value &value, std::string &out);
+inline bool parse_value(const char *&cursor, Value &value, uint8_t depth);
+
+}  // namespace ajson_host
+
+//Ссылка на поле объекта или элемент массива.
+//Поле объекта создается только при записи, чтение отсутствующего поля дает null, как в ArduinoJson
+class JsonVariant {
+ private:
+  JsonObject *object_{nullptr};
+  std::string key_;
+  ajson_host::Value *value_{nullptr};
+
+ public:
+  JsonVariant() {}
+  JsonVariant(JsonObject *object, const std::string &key) : object_(object), key_(key) {}
+  explicit JsonVariant(ajson_host::Value *value) : value_(value) {}
+
+  const ajson_host::Value *get() const;
+  ajson_host::Value *slot();
+
+  template<typename T> JsonVariant &operator=(const T &value) {
+    ajson_host::Value *target = slot();
+    if(target != nullptr)
+      target->set(value);
+    return *this;
+  }
+
+  JsonVariant &operator=(const JsonVariant &other) {
+    const ajson_host::Value *source = other.get();
+    ajson_host::Value *target = slot();
+    if(target != nullptr)
+      *target = source != nullptr ? *source : ajson_host::Value();
+    return *this;
+  }
+
+  JsonVariant(const JsonVariant &other) = default;
+
+  JsonVariant operator[](const char *key) const;
+  JsonVariant operator[](const std::string &key) const { return (*this)[key.c_str()]; }
+  JsonVariant operator[](int index) const;
+
+  operator const char *() const { return get() != nullptr ? get()->as_string() : nullptr; }
+  operator float() const { return get() != nullptr ? static_cast<float>(get()->as_number()) : 0; }
+  operator double() const { return get() != nullptr ? get()->as_number() : 0; }
+  operator int() const { return static_cast<int>(integer_()); }
+  operator unsigned int() const { return static_cast<unsigned>(integer_()); }
+  operator long() const { return static_cast<long>(integer_()); }
+  operator unsigned long() const { return static_cast<unsigned long>(integer_()); }
+  operator uint8_t() const { return static_cast<uint8_t>(integer_()); }
+  operator uint16_t() const { return static_cast<uint16_t>(integer_()); }
+  operator bool() const { return get() != nullptr && get()->as_bool(); }
+  operator JsonObject &() const;
+  operator JsonArray &() const;
+
+  template<typename T> T as() const { return static_cast<T>(*this); }
+
+  template<typename T> bool is() const;
+
+  bool success() const { return get() != nullptr; }
+
+  const char *operator|(const char *fallback) const {
+    const char *value = get() != nullptr ? get()->as_string() : nullptr;
+    return value != nullptr ? value : fallback;
+  }
+  bool operator|(bool fallback) const { return is_type_(ajson_host::Value::BOOL) ? get()->boolean : fallback; }
+  float operator|(float fallback) const { return number_() ? static_cast<float>(get()->as_number()) : fallback; }
+  double operator|(double fallback) const { return number_() ? get()->as_number() : fallback; }
+  int operator|(int fallback) const { return number_() ? static_cast<int>(get()->as_integer()) : fallback; }
+
+  size_t printTo(std::string &out) const {
+    const ajson_host::Value *value = get();
+    if(value != nullptr)
+      ajson_host::print_value(*value, out);
+    else
+      out += "null";
+    return out.size();
+  }
+
+ private:
+  long long integer_() const { return get() != nullptr ? get()->as_integer() : 0; }
+  bool is_type_(ajson_host::Value::Type type) const { return get() != nullptr && get()->type == type; }
+  bool number_() const { return get() != nullptr && get()->is_number(); }
+};
+
+class JsonArray {
+ private:
+  std::vector<ajson_host::Value> items_;
+  bool valid_{true};
+
+ public:
+  JsonArray() {}
+  explicit JsonArray(bool valid) : valid_(valid) {}
+
+  static JsonArray &invalid() {
+    static JsonArray array(false);
+    return array;
+  }
+
+  template<typename T> bool add(const T &value) {
+    if(this->valid_ == false)
+      return false;
+    this->items_.emplace_back();
+    this->items_.back().set(value);
+    return true;
+  }
+
+  JsonObject &createNestedObject();
+  JsonArray &createNestedArray();
+
+  bool success() const { return this->valid_; }
+
+  size_t size() const { return this->items_.size(); }
+
+  JsonVariant operator[](size_t index) {
+    return index < this->items_.size() ? JsonVariant(&this->items_[index]) : JsonVariant();
+  }
+
+  std::vector<ajson_host::Value> &items() { return this->items_; }
+  const std::vector<ajson_host::Value> &items() const { return this->items_; }
+
+  size_t measureLength() const {
+    std::string out;
+    return printTo(out);
+  }
+
+  size_t printTo(std::string &out) const;
+};
+
+class JsonObject {
+ private:
+  std::vector<std::pair<std::string, ajson_host::Value>> members_;
+  bool valid_{true};
+
+ public:
+  JsonObject() {}
+  explicit JsonObject(bool valid) : valid_(valid) {}
+
+  static JsonObject &invalid() {
+    static JsonObject object(false);
+    return object;
+  }
+
+  JsonVariant operator[](const char *key) { return JsonVariant(this, key); }
+  JsonVariant operator[](const std::string &key) { return JsonVariant(this, key); }
+  JsonVariant get(const char *key) { return JsonVariant(this, key); }
+
+  bool containsKey(const char *key) const { return find(key) != nullptr; }
+  bool containsKey(const std::string &key) const { return find(key.c_str()) != nullptr; }
+
+  bool success() const { return this->valid_; }
+
+  size_t size() const { return this->members_.size(); }
+
+  template<typename T> bool set(const char *key, const T &value) {
+    ajson_host::Value *target = slot(key);
+    if(target == nullptr)
+      return false;
+    target->set(value);
+    return true;
+  }
+
+  void remove(const char *key) {
+    for(auto it = this->members_.begin(); it != this->members_.end(); ++it) {
+      if(it->first == key) {
+        this->members_.erase(it);
+        return;
+      }
+    }
+  }
+
+  JsonObject &createNestedObject(const char *key) {
+    ajson_host::Value *target = slot(key);
+    if(target == nullptr)
+      return JsonObject::invalid();
+    *target = ajson_host::Value();
+    target->type = ajson_host::Value::OBJECT;
+    target->object = std::make_shared<JsonObject>();
+    return *target->object;
+  }
+
+  JsonArray &createNestedArray(const char *key) {
+    ajson_host::Value *target = slot(key);
+    if(target == nullptr)
+      return JsonArray::invalid();
+    *target = ajson_host::Value();
+    target->type = ajson_host::Value::ARRAY;
+    target->array = std::make_shared<JsonArray>();
+    return *target->array;
+  }
+
+  const ajson_host::Value *find(const char *key) const {
+    for(const auto &member : this->members_) {
+      if(member.first == key)
+        return &member.second;
+    }
+    return nullptr;
+  }
+
+  ajson_host::Value *slot(const char *key) {
+    if(this->valid_ == false)
+      return nullptr;
+
+    for(auto &member : this->members_) {
+      if(member.first == key)
+        return &member.second;
+    }
+
+    this->members_.emplace_back(key, ajson_host::Value());
+    return &this->members_.back().second;
+  }
+
+  const std::vector<std::pair<std::string, ajson_host::Value>> &members() const { return this->members_; }
+
+  size_t measureLength() const {
+    std::string out;
+    return printTo(out);
+  }
+
+  size_t printTo(std::string &out) const {
+    out += '{';
+    bool first = true;
+    for(const auto &member : this->members_) {
+      if(first == false)
+        out += ',';
+      first = false;
+      ajson_host::Value key;
+      key.set(member.first);
+      ajson_host::print_value(key, out);
+      out += ':';
+      ajson_host::print_value(member.second, out);
+    }
+    out += '}';
+    return out.size();
+  }
+
+  size_t printTo(char *buffer, size_t size) const {
+    std::string out;
+    printTo(out);
+    if(size == 0)
+      return 0;
+    size_t length = std::min(out.size(), size - 1);
+    memcpy(buffer, out.data(), length);
+    buffer[length] = '\0';
+    return length;
+  }
+};
+
+//разбор json, поддерживает то, что приходит в топики компонентов
+class DynamicJsonBuffer {
+ private:
+  std::vector<std::shared_ptr<JsonObject>> objects_;
+
+ public:
+  explicit DynamicJsonBuffer(size_t capacity = 0) {}
+
+  JsonObject &createObject() {
+    this->objects_.push_back(std::make_shared<JsonObject>());
+    return *this->objects_.back();
+  }
+
+  JsonObject &parseObject(const std::string &json) {
+    ajson_host::Value value;
+    const char *cursor = json.c_str();
+
+    if(ajson_host::parse_value(cursor, value, 0) == false || value.type != ajson_host::Value::OBJECT)
+      return JsonObject::invalid();
+
+    while(*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')
+      cursor++;
+    if(*cursor != '\0')
+      return JsonObject::invalid();
+
+    this->objects_.push_back(value.object);
+    return *value.object;
+  }
+
+  void clear() { this->objects_.clear(); }
+};
+
+inline const ajson_host::Value *JsonVariant::get() const {
+  if(this->object_ != nullptr)
+    return this->object_->find(this->key_.c_str());
+  return this->value_;
+}
+
+inline ajson_host::Value *JsonVariant::slot() {
+  if(this->object_ != nullptr)
+    return this->object_->slot(this->key_.c_str());
+  return this->value_;
+}
+
+inline JsonVariant JsonVariant::operator[](const char *key) const {
+  const ajson_host::Value *value = get();
+  if(value == nullptr || value->type != ajson_host::Value::OBJECT)
+    return JsonVariant();
+  return JsonVariant(value->object.get(), key);
+}
+
+inline JsonVariant JsonVariant::operator[](int index) const {
+  const ajson_host::Value *value = get();
+  if(value == nullptr || value->type != ajson_host::Value::ARRAY || index < 0)
+    return JsonVariant();
+  return (*value->array)[static_cast<size_t>(index)];
+}
+
+inline JsonVariant::operator JsonObject &() const {
+  const ajson_host::Value *value = get();
+  if(value == nullptr || value->type != ajson_host::Value::OBJECT)
+    return JsonObject::invalid();
+  return *value->object;
+}
+
+inline JsonVariant::operator JsonArray &() const {
+  const ajson_host::Value *value = get();
+  if(value == nullptr || value->type != ajson_host::Value::ARRAY)
+    return JsonArray::invalid();
+  return *value->array;
+}
+
+template<> inline bool JsonVariant::is<bool>() const { return is_type_(ajson_host::Value::BOOL); }
+template<> inline bool JsonVariant::is<int>() const { return is_type_(ajson_host::Value::INTEGER); }
+template<> inline bool JsonVariant::is<float>() const { return number_(); }
+template<> inline bool JsonVariant::is<double>() const { return number_(); }
+template<> inline bool JsonVariant::is<const char *>() const { return is_type_(ajson_host::Value::STRING); }
+template<> inline bool JsonVariant::is<JsonObject>() const { return is_type_(ajson_host::Value::OBJECT); }
+template<> inline bool JsonVariant::is<JsonArray>() const { return is_type_(ajson_host::Value::ARRAY); }
+
+inline JsonObject &JsonArray::createNestedObject() {
+  if(this->valid_ == false)
+    return JsonObject::invalid();
+  this->items_.emplace_back();
+  this->items_.back().type = ajson_host::Value::OBJECT;
+  this->items_.back().object = std::make_shared<JsonObject>();
+  return *this->items_.back().object;
+}
+
+inline JsonArray &JsonArray::createNestedArray() {
+  if(this->valid_ == false)
+    return JsonArray::invalid();
+  this->items_.emplace_back();
+  this->items_.back().type = ajson_host::Value::ARRAY;
+  this->items_.back().array = std::make_shared<JsonArray>();
+  return *this->items_.back().array;
+}
+
+inline size_t JsonArray::printTo(std::string &out) const {
+  out += '[';
+  for(size_t i = 0; i < this->items_.size(); i++) {
+    if(i != 0)
+      out += ',';
+    ajson_host::print_value(this->items_[i], out);
+  }
+  out += ']';
+  return out.size();
+}
+
+namespace ajson_host {
+
+inline void print_value(const Value &value, std::string &out) {
+  char buffer[32];
+
+  switch(value.type) {
+    case Value::NUL:
+      out += "null";
+      break;
+    case Value::BOOL:
+      out += value.boolean ? "true" : "false";
+      break;
+    case Value::INTEGER:
+      snprintf(buffer, sizeof(buffer), "%lld", value.integer);
+      out += buffer;
+      break;
+    case Value::FLOAT:
+      snprintf(buffer, sizeof(buffer), value.single ? "%.7g" : "%.15g", value.number);
+      out += buffer;
+      break;
+    case Value::STRING:
+      out += '"';
+      for(char c : value.string) {
+        switch(c) {
+          case '"': out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n"; break;
+          case '\r': out += "\\r"; break;
+          case '\t': out += "\\t"; break;
+          default:
+            if(static_cast<uint8_t>(c) < 0x20) {
+              snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+              out += buffer;
+            } else {
+              out += c;
+            }
+        }
+      }
+      out += '"';
+      break;
+    case Value::OBJECT:
+      value.object->printTo(out);
+      break;
+    case Value::ARRAY:
+      value.array->printTo(out);
+      break;
+  }
+}
+
+inline void skip_spaces_(const char *&cursor) {
+  while(*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')
+    cursor++;
+}
+
+inline bool parse_string_(const char *&cursor, std::string &out) {
+  if(*cursor != '"')
+    return false;
+  cursor++;
+
+  while(*cursor != '"') {
+    if(*cursor == '\0')
+      return false;
+
+    if(*cursor != '\\') {
+      out += *cursor++;
+      continue;
+    }
+
+    cursor++;
+    switch(*cursor) {
+      case '"': out += '"'; break;
+      case '\\': out += '\\'; break;
+      case '/': out += '/'; break;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        unsigned code = 0;
+        for(uint8_t i = 1; i <= 4; i++) {
+          char c = cursor[i];
+          code <<= 4;
+          if(c >= '0' && c <= '9') code |= c - '0';
+          else if(c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+          else if(c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+          else return false;
+        }
+        cursor += 4;
+        if(code < 0x80) {
+          out += static_cast<char>(code);
+        } else if(code < 0x800) {
+          out += static_cast<char>(0xC0 | (code >> 6));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+          out += static_cast<char>(0xE0 | (code >> 12));
+          out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+          out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        break;
+      }
+      default:
+        return false;
+    }
+    cursor++;
+  }
+
+  cursor++;
+  return true;
+}
+
+//вложенность ограничена, как nestingLimit в ArduinoJson
+static const uint8_t NESTING_LIMIT = 10;
+
+inline bool parse_value(const char *&cursor, Value &value, uint8_t depth) {
+  skip_spaces_(cursor);
+
+  if(*cursor == '{') {
+    if(depth >= NESTING_LIMIT)
+      return false;
+    cursor++;
+    value = Value();
+    value.type = Value::OBJECT;
+    value.object = std::make_shared<JsonObject>();
+
+    skip_spaces_(cursor);
+    if(*cursor == '}') {
+      cursor++;
+      return true;
+    }
+
+    while(true) {
+      skip_spaces_(cursor);
+      std::string key;
+      if(parse_string_(cursor, key) == false)
+        return false;
+      skip_spaces_(cursor);
+      if(*cursor++ != ':')
+        return false;
+      Value member;
+      if(parse_value(cursor, member, depth + 1) == false)
+        return false;
+      *value.object->slot(key.c_str()) = member;
+      skip_spaces_(cursor);
+      if(*cursor == ',') {
+        cursor++;
+        continue;
+      }
+      if(*cursor++ != '}')
+        return false;
+      return true;
+    }
+  }
+
+  if(*cursor == '[') {
+    if(depth >= NESTING_LIMIT)
+      return false;
+    cursor++;
+    value = Value();
+    value.type = Value::ARRAY;
+    value.array = std::make_shared<JsonArray>();
+
+    skip_spaces_(cursor);
+    if(*cursor == ']') {
+      cursor++;
+      return true;
+    }
+
+    while(true) {
+      Value item;
+      if(parse_value(cursor, item, depth + 1) == false)
+        return false;
+      value.array->items().push_back(item);
+      skip_spaces_(cursor);
+      if(*cursor == ',') {
+        cursor++;
+        continue;
+      }
+      if(*cursor++ != ']')
+        return false;
+      return true;
+    }
+  }
+
+  if(*cursor == '"') {
+    std::string string;
+    if(parse_string_(cursor, string) == false)
+      return false;
+    value.set(string);
+    return true;
+  }
+
+  if(strncmp(cursor, "true", 4) == 0) {
+    cursor += 4;
+    value.set(true);
+    return true;
+  }
+
+  if(strncmp(cursor, "false", 5) == 0) {
+    cursor += 5;
+    value.set(false);
+    return true;
+  }
+
+  if(strncmp(cursor, "null", 4) == 0) {
+    cursor += 4;
+    value = Value();
+    return true;
+  }
+
+  if(*cursor == '-' || (*cursor >= '0' && *cursor <= '9')) {
+    const char *start = cursor;
+    bool is_float = false;
+    if(*cursor == '-')
+      cursor++;
+    while((*cursor >= '0' && *cursor <= '9') || *cursor == '.' || *cursor == 'e' || *cursor == 'E' ||
+          ((*cursor == '+' || *cursor == '-') && (cursor[-1] == 'e' || cursor[-1] == 'E'))) {
+      if(*cursor == '.' || *cursor == 'e' || *cursor == 'E')
+        is_float = true;
+      cursor++;
+    }
+
+    std::string number(start, cursor - start);
+    if(is_float)
+      value.set(static_cast<float>(strtod(number.c_str(), nullptr)));
+    else
+      value.set(strtoll(number.c_str(), nullptr, 10));
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace ajson_host
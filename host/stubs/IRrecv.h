@@ -0,0 +1,301 @@
+#pragma once
+
+//Приемник без железа: кадры "в эфире" кладутся в host::ir_air(), decode() забирает их по одному,
+//пока приемник включен. Тайминги переводятся в тики rawbuf и разбираются декодерами DAIKIN64 и TCL112AC
+//с допуском tolerance, как в библиотеке, контрольная сумма проверяется. С DECODE_HASH остальное - UNKNOWN с хешем.
+
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+#include "IRremoteESP8266.h"
+#include "ir_Daikin.h"
+#include "ir_Tcl.h"
+
+const uint16_t kRawTick = 2;
+const uint16_t kStateSizeMax = 53;
+const uint8_t kTolerance = 25;
+const uint16_t kMarkExcess = 50;
+
+class decode_results {
+ public:
+  decode_type_t decode_type;
+  union {
+    struct {
+      uint64_t value;
+      uint32_t address;
+      uint32_t command;
+    };
+    uint8_t state[kStateSizeMax];
+  };
+  uint16_t bits;
+  volatile uint16_t *rawbuf;
+  uint16_t rawlen;
+  bool overflow;
+  bool repeat;
+
+  decode_results() : decode_type(UNKNOWN), bits(0), rawbuf(nullptr), rawlen(0), overflow(false), repeat(false) {
+    memset(state, 0, sizeof(state));
+  }
+};
+
+namespace host {
+
+//кадр в эфире: mark, space, mark, ... в us, заканчивается на mark
+inline std::deque<std::vector<uint32_t>> &ir_air() {
+  static std::deque<std::vector<uint32_t>> frames;
+  return frames;
+}
+
+inline void ir_air_push(const std::vector<uint32_t> &timings) { ir_air().push_back(timings); }
+
+//отправленный кадр в эфир, пауза в конце отбрасывается, как ее отбрасывает приемник по таймауту
+inline void ir_air_push_sent(const IRSentFrame &frame) {
+  std::vector<uint32_t> timings = frame.timings;
+  if(timings.size() % 2 == 0 && timings.empty() == false)
+    timings.pop_back();
+  ir_air_push(timings);
+}
+
+//кадр пульта daikin64, state - 64 бита как в getRaw()
+inline void ir_air_push_daikin64(uint64_t state) {
+  IRsend sender(0);
+  sender.sendDaikin64(state);
+  IRSentFrame frame = ir_sent().back();
+  ir_sent().pop_back();
+  ir_air_push_sent(frame);
+}
+
+inline void ir_air_push_tcl112ac(const uint8_t *state) {
+  IRsend sender(0);
+  sender.sendTcl112Ac(state);
+  IRSentFrame frame = ir_sent().back();
+  ir_sent().pop_back();
+  ir_air_push_sent(frame);
+}
+
+class RawReader {
+ private:
+  const volatile uint16_t *rawbuf_;
+  uint16_t rawlen_;
+  uint16_t offset_;
+  uint8_t tolerance_;
+
+ public:
+  RawReader(const volatile uint16_t *rawbuf, uint16_t rawlen, uint8_t tolerance)
+      : rawbuf_(rawbuf), rawlen_(rawlen), offset_(1), tolerance_(tolerance) {}
+
+  bool done() const { return this->offset_ >= this->rawlen_; }
+
+  bool mark(uint32_t desired) { return match_(desired + kMarkExcess); }
+
+  bool space(uint32_t desired) { return match_(desired > kMarkExcess ? desired - kMarkExcess : 1); }
+
+  //пауза не короче desired, последняя пауза кадра может отсутствовать
+  bool gap(uint32_t desired) {
+    if(done())
+      return true;
+    uint32_t measured = this->rawbuf_[this->offset_++] * kRawTick;
+    return measured >= desired * (100 - this->tolerance_) / 100;
+  }
+
+  //бит: mark, затем space one или zero
+  int8_t bit(uint32_t bit_mark, uint32_t one_space, uint32_t zero_space) {
+    if(mark(bit_mark) == false)
+      return -1;
+    if(done())
+      return -1;
+    uint32_t measured = this->rawbuf_[this->offset_] * kRawTick;
+    if(within_(measured, one_space > kMarkExcess ? one_space - kMarkExcess : 1)) {
+      this->offset_++;
+      return 1;
+    }
+    if(within_(measured, zero_space > kMarkExcess ? zero_space - kMarkExcess : 1)) {
+      this->offset_++;
+      return 0;
+    }
+    return -1;
+  }
+
+ private:
+  bool within_(uint32_t measured, uint32_t desired) const {
+    uint32_t delta = desired * this->tolerance_ / 100 + kRawTick;
+    return measured + delta >= desired && measured <= desired + delta;
+  }
+
+  bool match_(uint32_t desired) {
+    if(done())
+      return false;
+    uint32_t measured = this->rawbuf_[this->offset_++] * kRawTick;
+    return within_(measured, desired);
+  }
+};
+
+inline bool decode_daikin64(decode_results *results, uint8_t tolerance) {
+  RawReader reader(results->rawbuf, results->rawlen, tolerance);
+
+  for(uint8_t i = 0; i < 2; i++) {
+    if(reader.mark(kDaikin64LdrMark) == false || reader.space(kDaikin64LdrSpace) == false)
+      return false;
+  }
+
+  if(reader.mark(kDaikin64HdrMark) == false || reader.space(kDaikin64HdrSpace) == false)
+    return false;
+
+  uint64_t data = 0;
+  for(uint8_t i = 0; i < kDaikin64Bits; i++) {
+    int8_t bit = reader.bit(kDaikin64BitMark, kDaikin64OneSpace, kDaikin64ZeroSpace);
+    if(bit < 0)
+      return false;
+    data |= static_cast<uint64_t>(bit) << i;
+  }
+
+  if(reader.mark(kDaikin64BitMark) == false || reader.gap(kDaikin64Gap) == false)
+    return false;
+
+  if(reader.mark(kDaikin64HdrMark) == false)
+    return false;
+
+  if(IRDaikin64::validChecksum(data) == false)
+    return false;
+
+  results->decode_type = DAIKIN64;
+  results->value = data;
+  results->bits = kDaikin64Bits;
+  results->repeat = false;
+  return true;
+}
+
+inline bool decode_tcl112ac(decode_results *results, uint8_t tolerance) {
+  RawReader reader(results->rawbuf, results->rawlen, tolerance);
+
+  if(reader.mark(kTcl112AcHdrMark) == false || reader.space(kTcl112AcHdrSpace) == false)
+    return false;
+
+  uint8_t state[kTcl112AcStateLength] = {};
+  for(uint16_t i = 0; i < kTcl112AcBits; i++) {
+    int8_t bit = reader.bit(kTcl112AcBitMark, kTcl112AcOneSpace, kTcl112AcZeroSpace);
+    if(bit < 0)
+      return false;
+    state[i / 8] |= bit << (i % 8);
+  }
+
+  if(reader.mark(kTcl112AcBitMark) == false || reader.gap(kTcl112AcGap) == false)
+    return false;
+
+  if(IRTcl112Ac::validChecksum(state) == false)
+    return false;
+
+  results->decode_type = TCL112AC;
+  memset(results->state, 0, sizeof(results->state));
+  memcpy(results->state, state, kTcl112AcStateLength);
+  results->bits = kTcl112AcBits;
+  results->repeat = false;
+  return true;
+}
+
+//IRrecv::decodeHash: FNV по сравнению соседних mark/space, шум тоже "разбирается", как UNKNOWN 32 бит
+inline bool decode_hash(decode_results *results) {
+  if(results->rawlen < 6)
+    return false;
+
+  int32_t hash = 2166136261UL;
+  for(uint16_t i = 1; i + 2 < results->rawlen; i++) {
+    const uint16_t oldval = results->rawbuf[i];
+    const uint16_t newval = results->rawbuf[i + 2];
+    const int16_t value = newval < oldval * 8 / 10 ? 0 : (oldval < newval * 8 / 10 ? 2 : 1);
+    hash = static_cast<int32_t>(static_cast<uint32_t>(hash) * 16777619UL) ^ value;
+  }
+
+  results->value = static_cast<uint32_t>(hash);
+  results->address = 0;
+  results->command = 0;
+  results->bits = 32;
+  results->decode_type = UNKNOWN;
+  return true;
+}
+
+}  // namespace host
+
+class IRrecv {
+ private:
+  uint16_t pin_;
+  uint16_t buffer_size_;
+  uint8_t timeout_ms_;
+  uint8_t tolerance_{kTolerance};
+  bool enabled_{false};
+  std::vector<uint16_t> rawbuf_;
+
+ public:
+  IRrecv(uint16_t recvpin, uint16_t bufsize = 1024, uint8_t timeout = 15, bool save_buffer = false)
+      : pin_(recvpin), buffer_size_(bufsize), timeout_ms_(timeout) {
+    this->rawbuf_.resize(bufsize);
+  }
+
+  void setTolerance(uint8_t percent = kTolerance) { this->tolerance_ = percent > 100 ? 100 : percent; }
+  uint8_t getTolerance() const { return this->tolerance_; }
+
+  void enableIRIn(bool pullup = false) { this->enabled_ = true; }
+  void disableIRIn() { this->enabled_ = false; }
+  void resume() {}
+
+  bool is_enabled() const { return this->enabled_; }
+
+  uint16_t getBufSize() const { return this->buffer_size_; }
+
+  bool decode(decode_results *results) {
+    auto &air = host::ir_air();
+    if(this->enabled_ == false || air.empty())
+      return false;
+
+    std::vector<uint32_t> timings = air.front();
+    air.pop_front();
+
+    //пауза длиннее таймаута заканчивает кадр, остаток - следующий кадр
+    for(size_t i = 1; i < timings.size(); i += 2) {
+      if(timings[i] >= this->timeout_ms_ * 1000UL) {
+        air.push_front(std::vector<uint32_t>(timings.begin() + i + 1, timings.end()));
+        timings.resize(i);
+        break;
+      }
+    }
+
+    if(timings.empty()) {
+      results->rawlen = 0;
+      return false;
+    }
+
+    this->rawbuf_[0] = 0;
+    uint16_t rawlen = 1;
+    results->overflow = false;
+    for(auto timing : timings) {
+      if(rawlen >= this->buffer_size_) {
+        results->overflow = true;
+        break;
+      }
+      uint32_t ticks = timing / kRawTick;
+      this->rawbuf_[rawlen++] = ticks > UINT16_MAX ? UINT16_MAX : ticks;
+    }
+
+    results->rawbuf = this->rawbuf_.data();
+    results->rawlen = rawlen;
+    results->decode_type = UNKNOWN;
+    results->bits = 0;
+
+    if(host::decode_daikin64(results, this->tolerance_))
+      return true;
+
+    if(host::decode_tcl112ac(results, this->tolerance_))
+      return true;
+
+#if DECODE_HASH
+    if(host::decode_hash(results))
+      return true;
+#endif
+
+    results->decode_type = UNKNOWN;
+    return false;
+  }
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+//IRremoteESP8266 2.7.x для сборки на хосте: протоколы, которые используют драйверы репозитория.
+//Номера decode_type_t совпадают с библиотекой, чтобы выгрузки IRC1 с устройства читались как есть.
+
+#include <cstdint>
+
+//как в библиотеке по умолчанию: неразобранный кадр от 6 значений rawbuf возвращается как UNKNOWN с хешем таймингов
+#ifndef DECODE_HASH
+#define DECODE_HASH true
+#endif
+
+enum decode_type_t {
+  UNKNOWN = -1,
+  UNUSED = 0,
+  TCL112AC = 57,
+  DAIKIN64 = 78,
+};
+
+const uint16_t kDaikin64Bits = 64;
+const uint16_t kDaikin64DefaultRepeat = 0;
+const uint16_t kTcl112AcStateLength = 14;
+const uint16_t kTcl112AcBits = kTcl112AcStateLength * 8;
+const uint16_t kTcl112AcDefaultRepeat = 0;
+
+inline const char *typeToString(const decode_type_t protocol) {
+  switch(protocol) {
+    case DAIKIN64: return "DAIKIN64";
+    case TCL112AC: return "TCL112AC";
+    case UNUSED: return "UNUSED";
+    default: return "UNKNOWN";
+  }
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+//Передатчик без железа: mark/space записываются в host::ir_sent() и двигают виртуальное время
+//на свою длительность, как блокирующая отправка на устройстве.
+
+#include <cstdint>
+#include <vector>
+
+#include "Arduino.h"
+#include "IRremoteESP8266.h"
+
+const uint32_t kDefaultMessageGap = 100000;
+const uint8_t kDutyDefault = 50;
+
+namespace host {
+
+//отправленный кадр: длительности mark, space, mark, ... в us
+struct IRSentFrame {
+  uint16_t pin;
+  decode_type_t protocol;
+  uint64_t started_at_us;
+  std::vector<uint32_t> timings;
+
+  uint64_t duration_us() const {
+    uint64_t duration = 0;
+    for(auto timing : timings)
+      duration += timing;
+    return duration;
+  }
+};
+
+inline std::vector<IRSentFrame> &ir_sent() {
+  static std::vector<IRSentFrame> frames;
+  return frames;
+}
+
+}  // namespace host
+
+class IRsend {
+ private:
+  uint16_t pin_;
+  bool inverted_;
+  bool modulation_;
+  uint32_t frequency_{38000};
+  //кадр, в который пишутся mark/space, nullptr - отдельные вызовы, каждый пишется как RAW
+  bool recording_{false};
+
+ public:
+  explicit IRsend(uint16_t pin, bool inverted = false, bool use_modulation = true)
+      : pin_(pin), inverted_(inverted), modulation_(use_modulation) {}
+
+  void begin() {
+    pinMode(this->pin_, OUTPUT);
+    digitalWrite(this->pin_, this->inverted_ ? HIGH : LOW);
+  }
+
+  void enableIROut(uint32_t frequency, uint8_t duty = kDutyDefault) { this->frequency_ = frequency < 1000 ? frequency * 1000 : frequency; }
+
+  uint16_t mark(uint16_t usec) {
+    auto &timings = frame_().timings;
+    //два mark подряд - один импульс
+    if(timings.size() % 2 == 1)
+      timings.back() += usec;
+    else
+      timings.push_back(usec);
+    host::advance_us(usec);
+    return usec;
+  }
+
+  void space(uint32_t usec) {
+    auto &timings = frame_().timings;
+    if(timings.empty())
+      return;
+    if(timings.size() % 2 == 0)
+      timings.back() += usec;
+    else
+      timings.push_back(usec);
+    host::advance_us(usec);
+  }
+
+  void sendData(uint16_t onemark, uint32_t onespace, uint16_t zeromark, uint32_t zerospace, uint64_t data, uint16_t nbits,
+                bool MSBfirst = true) {
+    for(uint16_t i = 0; i < nbits; i++) {
+      const uint16_t bit = MSBfirst ? nbits - 1 - i : i;
+      if((data >> bit) & 1) {
+        mark(onemark);
+        space(onespace);
+      } else {
+        mark(zeromark);
+        space(zerospace);
+      }
+    }
+  }
+
+  void sendGeneric(uint16_t headermark, uint32_t headerspace, uint16_t onemark, uint32_t onespace, uint16_t zeromark,
+                   uint32_t zerospace, uint16_t footermark, uint32_t gap, uint64_t data, uint16_t nbits, uint16_t frequency,
+                   bool MSBfirst, uint16_t repeat, uint8_t dutycycle) {
+    enableIROut(frequency, dutycycle);
+    for(uint16_t r = 0; r <= repeat; r++) {
+      if(headermark)
+        mark(headermark);
+      if(headerspace)
+        space(headerspace);
+      sendData(onemark, onespace, zeromark, zerospace, data, nbits, MSBfirst);
+      if(footermark)
+        mark(footermark);
+      space(gap);
+    }
+  }
+
+  void sendGeneric(uint16_t headermark, uint32_t headerspace, uint16_t onemark, uint32_t onespace, uint16_t zeromark,
+                   uint32_t zerospace, uint16_t footermark, uint32_t gap, const uint8_t *dataptr, uint16_t nbytes,
+                   uint16_t frequency, bool MSBfirst, uint16_t repeat, uint8_t dutycycle) {
+    enableIROut(frequency, dutycycle);
+    for(uint16_t r = 0; r <= repeat; r++) {
+      if(headermark)
+        mark(headermark);
+      if(headerspace)
+        space(headerspace);
+      for(uint16_t i = 0; i < nbytes; i++)
+        sendData(onemark, onespace, zeromark, zerospace, dataptr[i], 8, MSBfirst);
+      if(footermark)
+        mark(footermark);
+      space(gap);
+    }
+  }
+
+  void sendDaikin64(uint64_t data, uint16_t nbits = kDaikin64Bits, uint16_t repeat = kDaikin64DefaultRepeat);
+
+  void sendTcl112Ac(const unsigned char data[], uint16_t nbytes = kTcl112AcStateLength,
+                    uint16_t repeat = kTcl112AcDefaultRepeat);
+
+  uint16_t get_pin() const { return this->pin_; }
+
+ private:
+  host::IRSentFrame &frame_() {
+    if(this->recording_ == false || host::ir_sent().empty())
+      begin_frame_(UNKNOWN);
+    return host::ir_sent().back();
+  }
+
+  void begin_frame_(decode_type_t protocol) {
+    host::ir_sent().push_back(host::IRSentFrame{this->pin_, protocol, host::time_us(), {}});
+  }
+
+  void start_(decode_type_t protocol) {
+    begin_frame_(protocol);
+    this->recording_ = true;
+  }
+
+  void end_() { this->recording_ = false; }
+};
+
+#include "ir_Daikin.h"
+#include "ir_Tcl.h"
+
+inline void IRsend::sendDaikin64(uint64_t data, uint16_t nbits, uint16_t repeat) {
+  start_(DAIKIN64);
+  enableIROut(kDaikin64Freq);
+  for(uint16_t r = 0; r <= repeat; r++) {
+    for(uint8_t i = 0; i < 2; i++) {
+      mark(kDaikin64LdrMark);
+      space(kDaikin64LdrSpace);
+    }
+    sendGeneric(kDaikin64HdrMark, kDaikin64HdrSpace, kDaikin64BitMark, kDaikin64OneSpace, kDaikin64BitMark,
+                kDaikin64ZeroSpace, kDaikin64BitMark, kDaikin64Gap, data, nbits, kDaikin64Freq, false, 0, 50);
+    mark(kDaikin64HdrMark);
+    space(kDefaultMessageGap);
+  }
+  end_();
+}
+
+inline void IRsend::sendTcl112Ac(const unsigned char data[], uint16_t nbytes, uint16_t repeat) {
+  start_(TCL112AC);
+  sendGeneric(kTcl112AcHdrMark, kTcl112AcHdrSpace, kTcl112AcBitMark, kTcl112AcOneSpace, kTcl112AcBitMark,
+              kTcl112AcZeroSpace, kTcl112AcBitMark, kTcl112AcGap, data, nbytes, 38000, false, repeat, 50);
+  end_();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "IRremoteESP8266.h"
+
+inline uint8_t bcdToUint8(const uint8_t bcd) { return (bcd >> 4) * 10 + (bcd & 0x0F); }
+
+inline uint8_t uint8ToBcd(const uint8_t integer) { return ((integer / 10) << 4) | (integer % 10); }
+
+inline uint8_t sumBytes(const uint8_t * const start, const uint16_t length, const uint8_t init = 0) {
+  uint8_t checksum = init;
+  for(uint16_t i = 0; i < length; i++)
+    checksum += start[i];
+  return checksum;
+}
+
+inline uint64_t getBits64(const uint64_t data, const uint8_t offset, const uint8_t size) {
+  return (data >> offset) & ((size >= 64) ? UINT64_MAX : ((1ULL << size) - 1));
+}
+
+inline void setBits64(uint64_t * const data, const uint8_t offset, const uint8_t size, const uint64_t value) {
+  const uint64_t mask = ((size >= 64) ? UINT64_MAX : ((1ULL << size) - 1)) << offset;
+  *data = (*data & ~mask) | ((value << offset) & mask);
+}
+
+inline void setBit64(uint64_t * const data, const uint8_t position, const bool on) { setBits64(data, position, 1, on); }
+
+inline void setBits8(uint8_t * const data, const uint8_t offset, const uint8_t size, const uint8_t value) {
+  const uint8_t mask = static_cast<uint8_t>(((1U << size) - 1) << offset);
+  *data = (*data & ~mask) | ((value << offset) & mask);
+}
+
+inline void setBit8(uint8_t * const data, const uint8_t position, const bool on) { setBits8(data, position, 1, on); }
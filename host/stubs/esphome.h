@@ -0,0 +1,638 @@
+#pragma once
+
+//ESPHome 1.14 для сборки компонентов на хосте: то, что используют компоненты репозитория.
+//Поведение повторяет прошивку там, где от него зависит логика компонентов:
+//  - уровни логов и вырезание ESP_LOGx ниже ESPHOME_LOG_LEVEL при компиляции;
+//  - publish/publish_json у MQTTComponent с retain по умолчанию, subscribe_json пропускает неразобранный json;
+//  - fnv1_hash, sanitize_string_whitelist, parse_float.
+//Состояние хоста (время, опубликованные сообщения, flash, память) - в пространстве имен host.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <strings.h>
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+#include "ArduinoJson.h"
+
+using std::abs;
+
+#define ESPHOME_VERSION "1.14.3"
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#define ESPHOME_LOG_LEVEL_VERY_VERBOSE 7
+
+#ifndef ESPHOME_LOG_LEVEL
+#define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_DEBUG
+#endif
+
+namespace host {
+
+//статистика кучи, считается заменой operator new/delete в esphome_host.cpp
+struct AllocStats {
+  uint64_t allocations;
+  uint64_t frees;
+  uint64_t live_bytes;
+  uint64_t peak_bytes;
+  uint64_t allocated_bytes;
+};
+
+AllocStats alloc_stats();
+
+//пик живых выделений начинается с текущего значения, так меряется пик одного участка кода
+void reset_alloc_peak();
+
+//свободная куча, которую видит ESP.getFreeHeap(): heap_size() минус живые выделения
+uint32_t heap_size();
+
+void log(int level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+//сообщения уровня не выше level печатаются в stderr, по умолчанию только WARN и ERROR
+void set_log_level(int level);
+
+//все сообщения, прошедшие компиляцию, независимо от set_log_level
+void set_log_hook(std::function<void(int level, const char *tag, const char *message)> hook);
+
+//время, сообщения mqtt, flash - к начальному состоянию
+void reset();
+
+}  // namespace host
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_ERROR
+#define ESP_LOGE(tag, ...) host::log(ESPHOME_LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define ESP_LOGE(tag, ...)
+#endif
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_WARN
+#define ESP_LOGW(tag, ...) host::log(ESPHOME_LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define ESP_LOGW(tag, ...)
+#endif
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_INFO
+#define ESP_LOGI(tag, ...) host::log(ESPHOME_LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define ESP_LOGI(tag, ...)
+#endif
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_CONFIG
+#define ESP_LOGCONFIG(tag, ...) host::log(ESPHOME_LOG_LEVEL_CONFIG, tag, __VA_ARGS__)
+#else
+#define ESP_LOGCONFIG(tag, ...)
+#endif
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+#define ESP_LOGD(tag, ...) host::log(ESPHOME_LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define ESP_LOGD(tag, ...)
+#endif
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+#define ESP_LOGV(tag, ...) host::log(ESPHOME_LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#else
+#define ESP_LOGV(tag, ...)
+#endif
+
+//как в esphome: вызов функции, TAG используется на любом уровне логов
+#define LOG_SENSOR(prefix, type, obj) sensor::log_sensor(TAG, prefix, type, obj)
+
+// ---------------------------------------------------------------- helpers
+
+template<typename T> class optional {
+ private:
+  bool has_value_{false};
+  T value_{};
+
+ public:
+  optional() {}
+  optional(const T &value) : has_value_(true), value_(value) {}
+
+  bool has_value() const { return this->has_value_; }
+  explicit operator bool() const { return this->has_value_; }
+  const T &value() const { return this->value_; }
+  const T &operator*() const { return this->value_; }
+  T value_or(const T &fallback) const { return this->has_value_ ? this->value_ : fallback; }
+};
+
+extern const char *HOSTNAME_CHARACTER_WHITELIST;
+
+inline std::string sanitize_string_whitelist(const std::string &s, const std::string &whitelist) {
+  std::string out(s);
+  for(auto &c : out) {
+    if(whitelist.find(c) == std::string::npos)
+      c = '_';
+  }
+  return out;
+}
+
+inline uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for(char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+inline optional<float> parse_float(const std::string &str) {
+  char *end;
+  float value = ::strtof(str.c_str(), &end);
+  if(end == nullptr || end != str.c_str() + str.size())
+    return {};
+  return value;
+}
+
+inline bool str_equals_case_insensitive(const std::string &a, const std::string &b) {
+  return strcasecmp(a.c_str(), b.c_str()) == 0;
+}
+
+inline std::string get_mac_address() { return "a0b1c2d3e4f5"; }
+
+template<typename T> class CallbackManager;
+
+template<typename... Ts> class CallbackManager<void(Ts...)> {
+ private:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+
+ public:
+  void add(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+
+  void call(Ts... args) {
+    for(auto &callback : this->callbacks_)
+      callback(args...);
+  }
+};
+
+// ---------------------------------------------------------------- json
+
+namespace json {
+
+typedef std::function<void(JsonObject &)> json_build_t;
+typedef std::function<void(JsonObject &)> json_parse_t;
+
+//строка живет до следующего вызова, как глобальный буфер в esphome
+inline const char *build_json(const json_build_t &f, size_t *length) {
+  static std::string buffer;
+  JsonObject root;
+  f(root);
+  buffer.clear();
+  root.printTo(buffer);
+  *length = buffer.size();
+  return buffer.c_str();
+}
+
+inline std::string build_json(const json_build_t &f) {
+  size_t length;
+  const char *json = build_json(f, &length);
+  return std::string(json, length);
+}
+
+inline void parse_json(const std::string &data, const json_parse_t &f) {
+  DynamicJsonBuffer buffer;
+  JsonObject &root = buffer.parseObject(data);
+
+  if(root.success() == false) {
+    ESP_LOGW("json", "Parsing JSON failed.");
+    return;
+  }
+
+  f(root);
+}
+
+}  // namespace json
+
+// ---------------------------------------------------------------- components
+
+namespace setup_priority {
+static const float HARDWARE = 800.0f;
+static const float DATA = 600.0f;
+static const float PROCESSOR = 400.0f;
+static const float WIFI = 250.0f;
+static const float AFTER_WIFI = 200.0f;
+static const float AFTER_CONNECTION = 100.0f;
+static const float LATE = -100.0f;
+}  // namespace setup_priority
+
+class Component {
+ public:
+  virtual ~Component() {}
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void call_setup() { this->setup(); }
+  virtual void call_loop() { this->loop(); }
+  virtual float get_setup_priority() const { return setup_priority::DATA; }
+  virtual void dump_config() {}
+};
+
+class PollingComponent : public Component {
+ protected:
+  uint32_t update_interval_{0};
+
+ public:
+  PollingComponent() {}
+  explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+
+  virtual void update() = 0;
+
+  uint32_t get_update_interval() const { return this->update_interval_; }
+};
+
+class Application {
+ private:
+  std::string name_{"host"};
+  std::vector<Component *> components_;
+
+ public:
+  const std::string &get_name() const { return this->name_; }
+  void set_name(const std::string &name) { this->name_ = name; }
+
+  template<typename C> C *register_component(C *component) {
+    this->components_.push_back(component);
+    return component;
+  }
+
+  void clear() { this->components_.clear(); }
+};
+
+extern Application App;
+
+// ---------------------------------------------------------------- sensor
+
+namespace sensor {
+
+class Sensor {
+ private:
+  std::string name_;
+  float state_{NAN};
+  bool has_state_{false};
+  CallbackManager<void(float)> raw_callback_{};
+  CallbackManager<void(float)> callback_{};
+
+ public:
+  Sensor() {}
+  explicit Sensor(const std::string &name) : name_(name) {}
+  virtual ~Sensor() {}
+
+  void publish_state(float state) {
+    this->raw_callback_.call(state);
+    this->state_ = state;
+    this->has_state_ = true;
+    this->callback_.call(state);
+  }
+
+  void add_on_raw_state_callback(std::function<void(float)> &&callback) { this->raw_callback_.add(std::move(callback)); }
+  void add_on_state_callback(std::function<void(float)> &&callback) { this->callback_.add(std::move(callback)); }
+
+  float get_state() const { return this->state_; }
+  bool has_state() const { return this->has_state_; }
+  const std::string &get_name() const { return this->name_; }
+};
+
+inline void log_sensor(const char *tag, const char *prefix, const char *type, Sensor *obj) {
+  if(obj != nullptr)
+    ESP_LOGCONFIG(tag, "%s%s '%s'", prefix, type, obj->get_name().c_str());
+}
+
+}  // namespace sensor
+
+// ---------------------------------------------------------------- mqtt
+
+struct SendDiscoveryConfig {
+  bool state_topic{true};
+  bool command_topic{true};
+};
+
+struct Availability {
+  std::string topic;
+  std::string payload_available;
+  std::string payload_not_available;
+};
+
+struct MQTTDiscoveryInfo {
+  std::string prefix;
+  bool retain;
+  bool clean;
+};
+
+typedef MQTTDiscoveryInfo DiscoveryInfo;
+
+typedef std::function<void(const std::string &, const std::string &)> mqtt_callback_t;
+typedef std::function<void(const std::string &, JsonObject &)> mqtt_json_callback_t;
+
+namespace mqtt {
+
+class MQTTComponent;
+
+struct MQTTMessage {
+  std::string topic;
+  std::string payload;
+  bool retain;
+};
+
+//клиент без брокера: опубликованное складывается в published, retain сообщения - в retained,
+//deliver() раздает сообщение подписчикам так, как это сделал бы брокер
+class MQTTClientComponent {
+ private:
+  struct Subscription {
+    std::string topic;
+    mqtt_callback_t callback;
+  };
+
+  MQTTDiscoveryInfo discovery_info_{"homeassistant", true, false};
+  Availability availability_{"host/status", "online", "offline"};
+  std::vector<Subscription> subscriptions_;
+  std::vector<MQTTComponent *> components_;
+  bool connected_{true};
+
+ public:
+  std::vector<MQTTMessage> published;
+  std::map<std::string, std::string> retained;
+
+  const MQTTDiscoveryInfo &get_discovery_info() const { return this->discovery_info_; }
+  void set_discovery_info(const MQTTDiscoveryInfo &info) { this->discovery_info_ = info; }
+
+  const Availability &get_availability() { return this->availability_; }
+  void set_availability(const Availability &availability) { this->availability_ = availability; }
+
+  bool publish(const std::string &topic, const std::string &payload, uint8_t qos = 0, bool retain = false) {
+    if(this->connected_ == false)
+      return false;
+
+    this->published.push_back(MQTTMessage{topic, payload, retain});
+    if(retain) {
+      if(payload.empty())
+        this->retained.erase(topic);
+      else
+        this->retained[topic] = payload;
+    }
+    return true;
+  }
+
+  bool publish(const std::string &topic, const char *payload, size_t payload_length, uint8_t qos = 0, bool retain = false) {
+    return publish(topic, std::string(payload, payload_length), qos, retain);
+  }
+
+  bool publish_json(const std::string &topic, const json::json_build_t &f, uint8_t qos = 0, bool retain = false) {
+    size_t length;
+    const char *payload = json::build_json(f, &length);
+    return publish(topic, payload, length, qos, retain);
+  }
+
+  void subscribe(const std::string &topic, mqtt_callback_t callback, uint8_t qos = 0) {
+    this->subscriptions_.push_back(Subscription{topic, std::move(callback)});
+  }
+
+  void subscribe_json(const std::string &topic, mqtt_json_callback_t callback, uint8_t qos = 0) {
+    subscribe(topic, [callback](const std::string &topic, const std::string &payload) {
+      json::parse_json(payload, [&topic, &callback](JsonObject &root) { callback(topic, root); });
+    }, qos);
+  }
+
+  void register_mqtt_component(MQTTComponent *component) { this->components_.push_back(component); }
+
+  bool is_connected() { return this->connected_; }
+  void set_connected(bool connected) { this->connected_ = connected; }
+
+  //подключение к брокеру восстановлено: как в esphome, все компоненты переотправляют состояние
+  void reconnect();
+
+  //сообщение от брокера всем подписчикам топика, + и # поддерживаются
+  void deliver(const std::string &topic, const std::string &payload) {
+    //обработчик может подписаться еще раз, поэтому идем по индексу
+    for(size_t i = 0; i < this->subscriptions_.size(); i++) {
+      if(topic_matches(this->subscriptions_[i].topic, topic)) {
+        mqtt_callback_t callback = this->subscriptions_[i].callback;
+        callback(topic, payload);
+      }
+    }
+  }
+
+  //retain сообщения подписчикам, как брокер при подписке: в порядке подписок, каждой подписке - свои топики
+  void deliver_retained() {
+    auto retained = this->retained;
+    for(size_t i = 0; i < this->subscriptions_.size(); i++) {
+      for(const auto &message : retained) {
+        if(topic_matches(this->subscriptions_[i].topic, message.first)) {
+          mqtt_callback_t callback = this->subscriptions_[i].callback;
+          callback(message.first, message.second);
+        }
+      }
+    }
+  }
+
+  //последнее сообщение в топик, nullptr если публикаций не было
+  const MQTTMessage *last(const std::string &topic) const {
+    for(auto it = this->published.rbegin(); it != this->published.rend(); ++it) {
+      if(it->topic == topic)
+        return &*it;
+    }
+    return nullptr;
+  }
+
+  size_t count(const std::string &topic) const {
+    return std::count_if(this->published.begin(), this->published.end(),
+                         [&topic](const MQTTMessage &message) { return message.topic == topic; });
+  }
+
+  size_t subscription_count() const { return this->subscriptions_.size(); }
+
+  //память освобождается целиком, чтобы замеры кучи в тестах не зависели от предыдущих тестов
+  void reset() {
+    std::vector<MQTTMessage>().swap(this->published);
+    this->retained.clear();
+    std::vector<Subscription>().swap(this->subscriptions_);
+    decltype(this->components_)().swap(this->components_);
+    this->connected_ = true;
+    this->discovery_info_ = MQTTDiscoveryInfo{"homeassistant", true, false};
+  }
+
+  static bool topic_matches(const std::string &filter, const std::string &topic) {
+    size_t f = 0, t = 0;
+    while(f < filter.size()) {
+      if(filter[f] == '#')
+        return true;
+
+      if(filter[f] == '+') {
+        while(t < topic.size() && topic[t] != '/')
+          t++;
+        f++;
+        continue;
+      }
+
+      if(t >= topic.size() || filter[f] != topic[t])
+        return false;
+      f++;
+      t++;
+    }
+    return t == topic.size();
+  }
+};
+
+extern MQTTClientComponent *global_mqtt_client;
+
+class MQTTComponent : public Component {
+ protected:
+  bool resend_state_{false};
+  bool retain_{true};
+  uint8_t qos_{0};
+  std::unique_ptr<Availability> availability_;
+
+ public:
+  virtual void send_discovery(JsonObject &root, SendDiscoveryConfig &config) = 0;
+  virtual bool send_initial_state() = 0;
+  virtual bool is_internal() = 0;
+  virtual std::string component_type() const = 0;
+  virtual std::string unique_id() { return ""; }
+
+  void set_retain(bool retain) { this->retain_ = retain; }
+  bool get_retain() const { return this->retain_; }
+
+  void set_availability(std::string topic, std::string payload_available, std::string payload_not_available) {
+    this->availability_.reset(new Availability{topic, payload_available, payload_not_available});
+  }
+
+  bool is_discovery_enabled() const { return true; }
+
+  void schedule_resend_state() { this->resend_state_ = true; }
+
+  bool publish(const std::string &topic, const std::string &payload) {
+    if(topic.empty())
+      return false;
+    return global_mqtt_client->publish(topic, payload, this->qos_, this->retain_);
+  }
+
+  bool publish_json(const std::string &topic, const json::json_build_t &f) {
+    if(topic.empty())
+      return false;
+    return global_mqtt_client->publish_json(topic, f, this->qos_, this->retain_);
+  }
+
+  void subscribe(const std::string &topic, mqtt_callback_t callback, uint8_t qos = 0) {
+    if(topic.empty() == false)
+      global_mqtt_client->subscribe(topic, std::move(callback), qos);
+  }
+
+  void subscribe_json(const std::string &topic, mqtt_json_callback_t callback, uint8_t qos = 0) {
+    if(topic.empty() == false)
+      global_mqtt_client->subscribe_json(topic, std::move(callback), qos);
+  }
+
+ protected:
+  virtual std::string friendly_name() const = 0;
+
+  std::string get_default_object_id_() const {
+    std::string id;
+    for(char c : this->friendly_name())
+      id += c == ' ' ? '_' : static_cast<char>(tolower(c));
+    return sanitize_string_whitelist(id, HOSTNAME_CHARACTER_WHITELIST);
+  }
+
+  bool is_connected_() const { return global_mqtt_client->is_connected(); }
+};
+
+inline void MQTTClientComponent::reconnect() {
+  this->connected_ = true;
+  for(auto component : this->components_)
+    component->schedule_resend_state();
+}
+
+}  // namespace mqtt
+
+using mqtt::global_mqtt_client;
+using mqtt::MQTTComponent;
+
+// ---------------------------------------------------------------- preferences
+
+//flash в памяти: значения по ключу, save считается записью во flash
+class ESPPreferenceObject {
+ private:
+  uint32_t key_{0};
+  size_t length_{0};
+  bool valid_{false};
+
+ public:
+  ESPPreferenceObject() {}
+  ESPPreferenceObject(uint32_t key, size_t length) : key_(key), length_(length), valid_(true) {}
+
+  template<typename T> bool save(const T *src);
+  template<typename T> bool load(T *dest);
+
+  uint32_t get_key() const { return this->key_; }
+};
+
+class ESPPreferences {
+ public:
+  std::map<uint32_t, std::vector<uint8_t>> storage;
+  uint32_t writes{0};
+  //ошибка записи во flash, для проверки обработки
+  bool fail_writes{false};
+
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash = false) {
+    return ESPPreferenceObject(type, sizeof(T));
+  }
+
+  void reset() {
+    this->storage.clear();
+    this->writes = 0;
+    this->fail_writes = false;
+  }
+};
+
+extern ESPPreferences global_preferences;
+
+template<typename T> bool ESPPreferenceObject::save(const T *src) {
+  if(this->valid_ == false || global_preferences.fail_writes)
+    return false;
+
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(src);
+  global_preferences.storage[this->key_].assign(bytes, bytes + sizeof(T));
+  global_preferences.writes++;
+  return true;
+}
+
+template<typename T> bool ESPPreferenceObject::load(T *dest) {
+  if(this->valid_ == false)
+    return false;
+
+  auto it = global_preferences.storage.find(this->key_);
+  //размер другой - структура поменялась, на устройстве не совпала бы контрольная сумма
+  if(it == global_preferences.storage.end() || it->second.size() != sizeof(T))
+    return false;
+
+  memcpy(dest, it->second.data(), sizeof(T));
+  return true;
+}
+
+// ---------------------------------------------------------------- ESP
+
+class EspClass {
+ public:
+  uint32_t getFreeHeap() {
+    auto stats = host::alloc_stats();
+    return stats.live_bytes < host::heap_size() ? host::heap_size() - stats.live_bytes : 0;
+  }
+  uint32_t getMaxFreeBlockSize() { return getFreeHeap(); }
+  uint8_t getHeapFragmentation() { return 0; }
+  uint32_t getFreeContStack() { return 4096; }
+  //такты при 80MHz по виртуальному времени
+  uint32_t getCycleCount() { return static_cast<uint32_t>(host::time_us() * 80); }
+  uint32_t getCpuFreqMHz() { return 80; }
+};
+
+extern EspClass ESP;
@@ -0,0 +1,171 @@
+//Глобальные объекты esphome и учет памяти для сборки на хосте.
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "esphome.h"
+#include <IRrecv.h>
+#include <IRsend.h>
+
+const char *HOSTNAME_CHARACTER_WHITELIST = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_";
+
+Application App;
+ESPPreferences global_preferences;
+EspClass ESP;
+
+static mqtt::MQTTClientComponent host_mqtt_client;
+mqtt::MQTTClientComponent *mqtt::global_mqtt_client = &host_mqtt_client;
+
+namespace host {
+
+namespace {
+
+//размер заголовка выделения, сохраняет выравнивание max_align_t
+const size_t ALLOC_HEADER = alignof(std::max_align_t) > sizeof(size_t) ? alignof(std::max_align_t) : sizeof(size_t);
+
+AllocStats stats{0, 0, 0, 0, 0};
+int log_level = ESPHOME_LOG_LEVEL_WARN;
+std::function<void(int, const char *, const char *)> log_hook;
+
+const char *level_letter(int level) {
+  switch(level) {
+    case ESPHOME_LOG_LEVEL_ERROR: return "E";
+    case ESPHOME_LOG_LEVEL_WARN: return "W";
+    case ESPHOME_LOG_LEVEL_INFO: return "I";
+    case ESPHOME_LOG_LEVEL_CONFIG: return "C";
+    case ESPHOME_LOG_LEVEL_DEBUG: return "D";
+    default: return "V";
+  }
+}
+
+//ИК светодиод: несущая демодулируется в кадры host::ir_sent(), как ее видит приемник.
+//Перерыв несущей длиннее LED_CARRIER_GAP_PS - space, длиннее LED_FRAME_GAP_PS - новый кадр.
+const uint64_t LED_CARRIER_GAP_PS = 80000000ULL;
+const uint64_t LED_FRAME_GAP_PS = 50000000000ULL;
+
+struct LedState {
+  bool on;
+  bool in_frame;
+  //номер кадра в ir_sent(), тесты могут очистить список посреди кадра
+  size_t frame;
+  uint64_t mark_start_ps;
+  uint64_t last_fall_ps;
+};
+
+LedState led[17];
+
+uint32_t ps_to_us(uint64_t ps) { return static_cast<uint32_t>((ps + 500000) / 1000000); }
+
+}  // namespace
+
+void on_pin_write_(uint8_t pin, uint8_t value) {
+  if(pin >= 17 || led[pin].on == (value != LOW))
+    return;
+
+  auto &state = led[pin];
+  const uint64_t now = time_ps();
+  state.on = value != LOW;
+  if(state.frame >= ir_sent().size() || ir_sent()[state.frame].pin != pin)
+    state.in_frame = false;
+
+  if(state.on == false) {
+    state.last_fall_ps = now;
+    //mark растет с каждым периодом несущей
+    if(state.in_frame)
+      ir_sent()[state.frame].timings.back() = ps_to_us(now - state.mark_start_ps);
+    return;
+  }
+
+  const uint64_t gap = now - state.last_fall_ps;
+  if(state.in_frame && gap <= LED_CARRIER_GAP_PS)
+    return;
+
+  if(state.in_frame == false || gap > LED_FRAME_GAP_PS) {
+    ir_sent().push_back(IRSentFrame{pin, UNKNOWN, now / 1000000, {}});
+    state.in_frame = true;
+    state.frame = ir_sent().size() - 1;
+  } else {
+    ir_sent()[state.frame].timings.push_back(ps_to_us(gap));
+  }
+
+  ir_sent()[state.frame].timings.push_back(0);
+  state.mark_start_ps = now;
+}
+
+AllocStats alloc_stats() { return stats; }
+
+void reset_alloc_peak() { stats.peak_bytes = stats.live_bytes; }
+
+//куча ESP8266 после загрузки прошивки esphome с wifi и mqtt
+uint32_t heap_size() { return 40000; }
+
+void log(int level, const char *tag, const char *format, ...) {
+  if(log_hook == nullptr && level > log_level)
+    return;
+
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+
+  if(log_hook != nullptr)
+    log_hook(level, tag, message);
+
+  if(level <= log_level)
+    fprintf(stderr, "[%10.3f][%s][%s]: %s\n", time_us() / 1e6, level_letter(level), tag, message);
+}
+
+void set_log_level(int level) { log_level = level; }
+
+void set_log_hook(std::function<void(int level, const char *tag, const char *message)> hook) { log_hook = std::move(hook); }
+
+void reset() {
+  //кадр предыдущего теста доходит до конца, иначе его передатчик так и останется активным
+  auto &timer = timer1_();
+  while(timer.enabled && timer.armed && timer.callback != nullptr && timer.loop == false)
+    run_timer1_until_(timer.due_ps / 1000000 + 1);
+  reset_timer1();
+  set_time_us(0);
+  for(auto &state : led)
+    state = LedState{false, false, 0, 0, 0};
+  global_mqtt_client->reset();
+  global_preferences.reset();
+  ir_air().clear();
+  ir_sent().clear();
+  log_hook = nullptr;
+}
+
+void *allocate(size_t size) {
+  void *block = malloc(size + ALLOC_HEADER);
+  if(block == nullptr)
+    throw std::bad_alloc();
+
+  *static_cast<size_t *>(block) = size;
+  stats.allocations++;
+  stats.live_bytes += size;
+  stats.allocated_bytes += size;
+  if(stats.live_bytes > stats.peak_bytes)
+    stats.peak_bytes = stats.live_bytes;
+  return static_cast<char *>(block) + ALLOC_HEADER;
+}
+
+void release(void *pointer) {
+  if(pointer == nullptr)
+    return;
+
+  void *block = static_cast<char *>(pointer) - ALLOC_HEADER;
+  stats.frees++;
+  stats.live_bytes -= *static_cast<size_t *>(block);
+  free(block);
+}
+
+}  // namespace host
+
+void *operator new(size_t size) { return host::allocate(size); }
+void *operator new[](size_t size) { return host::allocate(size); }
+void operator delete(void *pointer) noexcept { host::release(pointer); }
+void operator delete[](void *pointer) noexcept { host::release(pointer); }
+void operator delete(void *pointer, size_t) noexcept { host::release(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { host::release(pointer); }
@@ -0,0 +1,158 @@
+#pragma once
+
+//IRDaikin64 для хоста: раскладка битов и поведение сеттеров как в IRremoteESP8266 2.7.6.
+//  режим - биты 8-11, вентилятор - 12-15, температура BCD - 48-55,
+//  swing - 56, sleep - 57, переключение питания - 59, контрольная сумма - 60-63
+
+#include <cstdint>
+
+#include "IRremoteESP8266.h"
+#include "IRutils.h"
+
+const uint16_t kDaikin128Freq = 38000;
+const uint16_t kDaikin128LeaderMark = 9800;
+const uint16_t kDaikin128LeaderSpace = 9800;
+const uint16_t kDaikin128HdrMark = 4600;
+const uint16_t kDaikin128HdrSpace = 2500;
+const uint16_t kDaikin128BitMark = 350;
+const uint16_t kDaikin128OneSpace = 954;
+const uint16_t kDaikin128ZeroSpace = 382;
+const uint32_t kDaikin128Gap = 20300;
+
+const uint16_t kDaikin64HdrMark = kDaikin128HdrMark;
+const uint16_t kDaikin64BitMark = kDaikin128BitMark;
+const uint16_t kDaikin64HdrSpace = kDaikin128HdrSpace;
+const uint16_t kDaikin64OneSpace = kDaikin128OneSpace;
+const uint16_t kDaikin64ZeroSpace = kDaikin128ZeroSpace;
+const uint16_t kDaikin64LdrMark = kDaikin128LeaderMark;
+const uint32_t kDaikin64Gap = kDaikin128Gap;
+const uint16_t kDaikin64LdrSpace = kDaikin128LeaderSpace;
+const uint16_t kDaikin64Freq = kDaikin128Freq;
+
+const uint64_t kDaikin64KnownGoodState = 0x7C16161607204216ULL;
+
+const uint8_t kDaikin64Dry = 0b001;
+const uint8_t kDaikin64Cool = 0b010;
+const uint8_t kDaikin64Fan = 0b100;
+const uint8_t kDaikin64Heat = 0b1000;
+const uint8_t kDaikin64Auto = 0b1010;
+
+const uint8_t kDaikin64FanAuto = 0b0001;
+const uint8_t kDaikin64FanLow = 0b1000;
+const uint8_t kDaikin64FanMed = 0b0100;
+const uint8_t kDaikin64FanHigh = 0b0010;
+const uint8_t kDaikin64FanQuiet = 0b1001;
+const uint8_t kDaikin64FanTurbo = 0b0011;
+
+const uint8_t kDaikin64MinTemp = 16;
+const uint8_t kDaikin64MaxTemp = 30;
+
+const uint8_t kDaikin64ModeOffset = 8;
+const uint8_t kDaikin64FanOffset = 12;
+const uint8_t kDaikin64TempOffset = 48;
+const uint8_t kDaikin64SwingVBit = 56;
+const uint8_t kDaikin64SleepBit = 57;
+const uint8_t kDaikin64PowerToggleBit = 59;
+const uint8_t kDaikin64ChecksumOffset = 60;
+
+#include "IRsend.h"
+
+class IRDaikin64 {
+ private:
+  IRsend irsend_;
+  uint64_t remote_state_;
+
+ public:
+  explicit IRDaikin64(const uint16_t pin, const bool inverted = false, const bool use_modulation = true)
+      : irsend_(pin, inverted, use_modulation) {
+    stateReset();
+  }
+
+  void begin() { this->irsend_.begin(); }
+
+  void send(const uint16_t repeat = kDaikin64DefaultRepeat) { this->irsend_.sendDaikin64(getRaw(), kDaikin64Bits, repeat); }
+
+  static uint8_t calcChecksum(const uint64_t state) {
+    uint8_t sum = 0;
+    for(uint8_t i = 0; i < kDaikin64ChecksumOffset; i += 4)
+      sum += (state >> i) & 0x0F;
+    return sum & 0x0F;
+  }
+
+  static bool validChecksum(const uint64_t state) { return getBits64(state, kDaikin64ChecksumOffset, 4) == calcChecksum(state); }
+
+  void stateReset() { this->remote_state_ = kDaikin64KnownGoodState; }
+
+  uint64_t getRaw() {
+    checksum_();
+    return this->remote_state_;
+  }
+
+  void setRaw(const uint64_t new_state) { this->remote_state_ = new_state; }
+
+  void setPowerToggle(const bool on) { setBit64(&this->remote_state_, kDaikin64PowerToggleBit, on); }
+  bool getPowerToggle() const { return getBits64(this->remote_state_, kDaikin64PowerToggleBit, 1); }
+
+  void setTemp(const uint8_t temp) {
+    uint8_t degrees = temp < kDaikin64MinTemp ? kDaikin64MinTemp : temp;
+    degrees = degrees > kDaikin64MaxTemp ? kDaikin64MaxTemp : degrees;
+    setBits64(&this->remote_state_, kDaikin64TempOffset, 8, uint8ToBcd(degrees));
+  }
+  uint8_t getTemp() const { return bcdToUint8(getBits64(this->remote_state_, kDaikin64TempOffset, 8)); }
+
+  uint8_t getMode() const { return getBits64(this->remote_state_, kDaikin64ModeOffset, 4); }
+  void setMode(const uint8_t mode) {
+    switch(mode) {
+      case kDaikin64Fan:
+      case kDaikin64Dry:
+      case kDaikin64Cool:
+      case kDaikin64Heat:
+      case kDaikin64Auto:
+        setBits64(&this->remote_state_, kDaikin64ModeOffset, 4, mode);
+        break;
+      default:
+        setMode(kDaikin64Cool);
+    }
+  }
+
+  uint8_t getFan() const { return getBits64(this->remote_state_, kDaikin64FanOffset, 4); }
+  void setFan(const uint8_t speed) {
+    switch(speed) {
+      case kDaikin64FanQuiet:
+      case kDaikin64FanTurbo:
+      case kDaikin64FanAuto:
+      case kDaikin64FanHigh:
+      case kDaikin64FanMed:
+      case kDaikin64FanLow:
+        setBits64(&this->remote_state_, kDaikin64FanOffset, 4, speed);
+        break;
+      default:
+        setFan(kDaikin64FanAuto);
+    }
+  }
+
+  bool getTurbo() const { return getFan() == kDaikin64FanTurbo; }
+  void setTurbo(const bool on) {
+    if(on)
+      setFan(kDaikin64FanTurbo);
+    else if(getTurbo())
+      setFan(kDaikin64FanAuto);
+  }
+
+  bool getQuiet() const { return getFan() == kDaikin64FanQuiet; }
+  void setQuiet(const bool on) {
+    if(on)
+      setFan(kDaikin64FanQuiet);
+    else if(getQuiet())
+      setFan(kDaikin64FanAuto);
+  }
+
+  bool getSwingVertical() const { return getBits64(this->remote_state_, kDaikin64SwingVBit, 1); }
+  void setSwingVertical(const bool on) { setBit64(&this->remote_state_, kDaikin64SwingVBit, on); }
+
+  bool getSleep() const { return getBits64(this->remote_state_, kDaikin64SleepBit, 1); }
+  void setSleep(const bool on) { setBit64(&this->remote_state_, kDaikin64SleepBit, on); }
+
+ private:
+  void checksum_() { setBits64(&this->remote_state_, kDaikin64ChecksumOffset, 4, calcChecksum(this->remote_state_)); }
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+//IRTcl112Ac для хоста: раскладка байтов и поведение сеттеров как в IRremoteESP8266 2.7.6.
+//  байт 5: питание - бит 2, light (инвертирован) - бит 6, econo - бит 7
+//  байт 6: режим - младшая тетрада, health - бит 4, turbo - бит 6
+//  байт 7: 31 - температура, байт 8: вентилятор - биты 0-2, swing vertical - биты 3-5
+//  байт 12: swing horizontal - бит 3, половина градуса - бит 5, байт 13 - сумма байтов 0-12
+
+#include <cstdint>
+#include <cstring>
+
+#include "IRremoteESP8266.h"
+#include "IRutils.h"
+
+const uint16_t kTcl112AcHdrMark = 3000;
+const uint16_t kTcl112AcHdrSpace = 1650;
+const uint16_t kTcl112AcBitMark = 500;
+const uint16_t kTcl112AcOneSpace = 1050;
+const uint16_t kTcl112AcZeroSpace = 325;
+const uint32_t kTcl112AcGap = 100000;
+
+const uint8_t kTcl112AcHeat = 1;
+const uint8_t kTcl112AcDry = 2;
+const uint8_t kTcl112AcCool = 3;
+const uint8_t kTcl112AcFan = 7;
+const uint8_t kTcl112AcAuto = 8;
+
+const uint8_t kTcl112AcFanAuto = 0b000;
+const uint8_t kTcl112AcFanLow = 0b010;
+const uint8_t kTcl112AcFanMed = 0b011;
+const uint8_t kTcl112AcFanHigh = 0b101;
+
+const float kTcl112AcTempMax = 31.0;
+const float kTcl112AcTempMin = 16.0;
+
+const uint8_t kTcl112AcPowerOffset = 2;
+const uint8_t kTcl112AcLightOffset = 6;
+const uint8_t kTcl112AcBitEconoOffset = 7;
+const uint8_t kTcl112AcHealthOffset = 4;
+const uint8_t kTcl112AcTurboOffset = 6;
+const uint8_t kTcl112AcSwingVOffset = 3;
+const uint8_t kTcl112AcSwingHOffset = 3;
+const uint8_t kTcl112AcHalfDegreeOffset = 5;
+
+#include "IRsend.h"
+
+class IRTcl112Ac {
+ private:
+  IRsend irsend_;
+  uint8_t remote_state_[kTcl112AcStateLength];
+
+ public:
+  explicit IRTcl112Ac(const uint16_t pin, const bool inverted = false, const bool use_modulation = true)
+      : irsend_(pin, inverted, use_modulation) {
+    stateReset();
+  }
+
+  void begin() { this->irsend_.begin(); }
+
+  void send(const uint16_t repeat = kTcl112AcDefaultRepeat) {
+    this->irsend_.sendTcl112Ac(getRaw(), kTcl112AcStateLength, repeat);
+  }
+
+  static uint8_t calcChecksum(const uint8_t state[], const uint16_t length = kTcl112AcStateLength) {
+    return length ? sumBytes(state, length - 1) : 0;
+  }
+
+  static bool validChecksum(const uint8_t state[], const uint16_t length = kTcl112AcStateLength) {
+    return length > 1 && state[length - 1] == calcChecksum(state, length);
+  }
+
+  void stateReset() {
+    static const uint8_t reset[kTcl112AcStateLength] = {0x23, 0xCB, 0x26, 0x01, 0x00, 0x24, 0x03,
+                                                        0x07, 0x40, 0x00, 0x00, 0x00, 0x00, 0x03};
+    memcpy(this->remote_state_, reset, kTcl112AcStateLength);
+  }
+
+  uint8_t *getRaw() {
+    this->remote_state_[kTcl112AcStateLength - 1] = calcChecksum(this->remote_state_);
+    return this->remote_state_;
+  }
+
+  void setRaw(const uint8_t new_code[], const uint16_t length = kTcl112AcStateLength) {
+    memcpy(this->remote_state_, new_code, length < kTcl112AcStateLength ? length : kTcl112AcStateLength);
+  }
+
+  void on() { setPower(true); }
+  void off() { setPower(false); }
+  void setPower(const bool on) { setBit8(&this->remote_state_[5], kTcl112AcPowerOffset, on); }
+  bool getPower() const { return (this->remote_state_[5] >> kTcl112AcPowerOffset) & 1; }
+
+  uint8_t getMode() const { return this->remote_state_[6] & 0x0F; }
+  void setMode(const uint8_t mode) {
+    switch(mode) {
+      case kTcl112AcFan:
+      case kTcl112AcAuto:
+      case kTcl112AcCool:
+      case kTcl112AcHeat:
+      case kTcl112AcDry:
+        setBits8(&this->remote_state_[6], 0, 4, mode);
+        break;
+      default:
+        setMode(kTcl112AcAuto);
+    }
+  }
+
+  void setTemp(const float celsius) {
+    float safe = celsius < kTcl112AcTempMin ? kTcl112AcTempMin : celsius;
+    safe = safe > kTcl112AcTempMax ? kTcl112AcTempMax : safe;
+    const uint8_t half_degrees = safe * 2;
+    setBit8(&this->remote_state_[12], kTcl112AcHalfDegreeOffset, half_degrees & 1);
+    setBits8(&this->remote_state_[7], 0, 4, static_cast<uint8_t>(kTcl112AcTempMax) - half_degrees / 2);
+  }
+
+  float getTemp() const {
+    float result = kTcl112AcTempMax - (this->remote_state_[7] & 0x0F);
+    if((this->remote_state_[12] >> kTcl112AcHalfDegreeOffset) & 1)
+      result += 0.5;
+    return result;
+  }
+
+  void setFan(const uint8_t speed) {
+    switch(speed) {
+      case kTcl112AcFanAuto:
+      case kTcl112AcFanLow:
+      case kTcl112AcFanMed:
+      case kTcl112AcFanHigh:
+        setBits8(&this->remote_state_[8], 0, 3, speed);
+        break;
+      default:
+        setFan(kTcl112AcFanAuto);
+    }
+  }
+  uint8_t getFan() const { return this->remote_state_[8] & 0x07; }
+
+  void setEcono(const bool on) { setBit8(&this->remote_state_[5], kTcl112AcBitEconoOffset, on); }
+  bool getEcono() const { return (this->remote_state_[5] >> kTcl112AcBitEconoOffset) & 1; }
+
+  void setHealth(const bool on) { setBit8(&this->remote_state_[6], kTcl112AcHealthOffset, on); }
+  bool getHealth() const { return (this->remote_state_[6] >> kTcl112AcHealthOffset) & 1; }
+
+  void setLight(const bool on) { setBit8(&this->remote_state_[5], kTcl112AcLightOffset, !on); }
+  bool getLight() const { return ((this->remote_state_[5] >> kTcl112AcLightOffset) & 1) == 0; }
+
+  void setSwingHorizontal(const bool on) { setBit8(&this->remote_state_[12], kTcl112AcSwingHOffset, on); }
+  bool getSwingHorizontal() const { return (this->remote_state_[12] >> kTcl112AcSwingHOffset) & 1; }
+
+  void setSwingVertical(const bool on) { setBits8(&this->remote_state_[8], kTcl112AcSwingVOffset, 3, on ? 0b111 : 0b000); }
+  bool getSwingVertical() const { return ((this->remote_state_[8] >> kTcl112AcSwingVOffset) & 0b111) != 0; }
+
+  void setTurbo(const bool on) {
+    setBit8(&this->remote_state_[6], kTcl112AcTurboOffset, on);
+    if(on) {
+      setFan(kTcl112AcFanHigh);
+      setSwingVertical(true);
+    }
+  }
+  bool getTurbo() const { return (this->remote_state_[6] >> kTcl112AcTurboOffset) & 1; }
+};
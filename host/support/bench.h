@@ -0,0 +1,76 @@
+#pragma once
+
+//Замеры на хосте: время на операцию по часам хоста и выделения памяти на операцию.
+//Абсолютные значения к ESP8266 не переносятся, сравнивать имеет смысл варианты между собой.
+//--quick (так бенчмарки запускает ctest) уменьшает количество итераций в 100 раз.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "esphome.h"
+
+namespace host_bench {
+
+struct BenchCase {
+  const char *name;
+  void (*function)();
+};
+
+inline std::vector<BenchCase> &registry() {
+  static std::vector<BenchCase> benches;
+  return benches;
+}
+
+struct Registrar {
+  Registrar(const char *name, void (*function)()) { registry().push_back(BenchCase{name, function}); }
+};
+
+inline bool &quick() {
+  static bool value = false;
+  return value;
+}
+
+struct Result {
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+};
+
+//значение считается использованным, компилятор не выкидывает вычисление
+template<typename T> inline void do_not_optimize(const T &value) { asm volatile("" : : "r,m"(value) : "memory"); }
+
+template<typename F> Result run(const char *name, uint64_t iterations, F &&function) {
+  if(quick())
+    iterations = iterations / 100 > 0 ? iterations / 100 : 1;
+
+  //прогрев: статические буферы и ленивые выделения не попадают в замер
+  function();
+
+  const auto stats_before = host::alloc_stats();
+  const auto started_at = std::chrono::steady_clock::now();
+
+  for(uint64_t i = 0; i < iterations; i++)
+    function();
+
+  const auto elapsed = std::chrono::steady_clock::now() - started_at;
+  const auto stats_after = host::alloc_stats();
+
+  Result result;
+  result.ns_per_op = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+  result.allocs_per_op = static_cast<double>(stats_after.allocations - stats_before.allocations) / iterations;
+  result.bytes_per_op = static_cast<double>(stats_after.allocated_bytes - stats_before.allocated_bytes) / iterations;
+
+  printf("%-52s %12.1f ns/op %8.2f allocs/op %10.1f B/op\n", name, result.ns_per_op, result.allocs_per_op,
+         result.bytes_per_op);
+  return result;
+}
+
+}  // namespace host_bench
+
+#define BENCH_CASE(name) \
+  static void name(); \
+  static host_bench::Registrar name##_registrar(#name, name); \
+  static void name()
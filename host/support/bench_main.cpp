@@ -0,0 +1,33 @@
+//Запуск бенчмарков: --quick - короткий прогон, остальные аргументы - имена бенчмарков.
+
+#include <cstring>
+
+#include "bench.h"
+
+int main(int argc, char **argv) {
+  std::vector<const char *> names;
+
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--quick") == 0)
+      host_bench::quick() = true;
+    else
+      names.push_back(argv[i]);
+  }
+
+  int executed = 0;
+  for(const auto &bench : host_bench::registry()) {
+    bool selected = names.empty();
+    for(auto name : names)
+      selected |= strcmp(name, bench.name) == 0;
+
+    if(selected == false)
+      continue;
+
+    host::reset();
+    printf("== %s\n", bench.name);
+    bench.function();
+    executed++;
+  }
+
+  return executed > 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+//Фаззинг на хосте: цель определяет LLVMFuzzerTestOneInput, как для libFuzzer.
+//С clang и -DHOST_LIBFUZZER=ON цели собираются с -fsanitize=fuzzer, иначе их гоняет fuzz_main.cpp
+//на случайных входах. FUZZ_CHECK - инвариант: при нарушении печатает его и вызывает abort(),
+//вход сохраняется драйвером для воспроизведения.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "esphome.h"
+#include <IRrecv.h>
+
+#include "node.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace host_fuzz {
+
+//строки, которые парсеры драйверов действительно различают: без них случайные байты почти
+//никогда не попадают в имя режима
+static const char *const DICTIONARY[] = {
+    "off", "on", "true", "false", "auto", "cool", "heat", "dry", "fan_only", "undefined",
+    "low", "medium", "high", "quiet", "turbo", "horizontal", "COOL", "Fan_Only", "oft", "", "cooling"};
+
+//вход разбирается по байтам, как FuzzedDataProvider: после конца данных - нули
+class Input {
+ private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t offset_{0};
+
+ public:
+  Input(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  bool empty() const { return this->offset_ >= this->size_; }
+
+  uint8_t byte() { return empty() ? 0 : this->data_[this->offset_++]; }
+
+  uint16_t word() { return static_cast<uint16_t>(byte() | (byte() << 8)); }
+
+  bool flag() { return (byte() & 1) != 0; }
+
+  void bytes(uint8_t *out, size_t count) {
+    for(size_t i = 0; i < count; i++)
+      out[i] = byte();
+  }
+
+  //слово из словаря или до 16 произвольных байт
+  std::string string() {
+    const uint8_t selector = byte();
+    const size_t words = sizeof(DICTIONARY) / sizeof(DICTIONARY[0]);
+    if(selector < 0xC0)
+      return DICTIONARY[selector % words];
+
+    std::string value;
+    const uint8_t length = selector & 0x0F;
+    for(uint8_t i = 0; i < length && empty() == false; i++)
+      value.push_back(static_cast<char>(byte()));
+    return value;
+  }
+};
+
+//цикл прошивки: loop() драйвера с шагом LOOP_INTERVAL_MS, timer1 отправляет кадры в эфир
+template<typename Driver> void loop_for(Driver &driver, uint32_t duration_ms) {
+  const uint64_t until = host::time_us() + static_cast<uint64_t>(duration_ms) * 1000;
+  while(host::time_us() < until) {
+    driver.loop();
+    host::advance_ms(host_node::LOOP_INTERVAL_MS);
+  }
+}
+
+//драйвер один на процесс, как в прошивке: деструкторов у драйверов нет.
+//Перед каждым входом кадр в эфире отправляется до конца, окно повторов приемника истекает,
+//состояние возвращается к начальному - вход воспроизводится отдельно от предыдущих
+template<typename Driver> void begin_input(Driver &driver, const typename Driver::CompactState &initial_state) {
+  for(uint8_t i = 0; i < 100 && driver.is_send_pending(); i++)
+    loop_for(driver, host_node::LOOP_INTERVAL_MS);
+  host::ir_air().clear();
+  host::ir_sent().clear();
+  host::advance_ms(1000);
+  driver.restore_compact_state(initial_state);
+}
+
+inline void fail(const char *file, int line, const char *expression, const char *state) {
+  fprintf(stderr, "%s:%d: invariant violated: %s\n  state: %s\n", file, line, expression, state);
+  abort();
+}
+
+}  // namespace host_fuzz
+
+#define FUZZ_CHECK(expr, state) \
+  do { \
+    if(!(expr)) \
+      host_fuzz::fail(__FILE__, __LINE__, #expr, state); \
+  } while(0)
@@ -0,0 +1,124 @@
+//Запуск фаззинга без libFuzzer: случайные входы и мутации уже прогнанных, без покрытия.
+//  fuzz_<name> [--runs=N] [--seed=S] [--max-len=L] [--quick] [файл...]
+//С файлами - прогон только их (воспроизведение), иначе N случайных входов и отчет exec/s.
+//При нарушении инварианта вход записывается в crash-<name>.bin в текущем каталоге.
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "fuzz.h"
+
+namespace {
+
+const char *program_name = "fuzz";
+std::vector<uint8_t> current_input;
+
+void save_crash(int signal) {
+  std::string path = std::string("crash-") + program_name + ".bin";
+  FILE *file = fopen(path.c_str(), "wb");
+  if(file != nullptr) {
+    fwrite(current_input.data(), 1, current_input.size(), file);
+    fclose(file);
+    fprintf(stderr, "input saved to %s (%u bytes)\n", path.c_str(), static_cast<unsigned>(current_input.size()));
+  }
+  std::signal(signal, SIG_DFL);
+  std::raise(signal);
+}
+
+uint64_t next_random(uint64_t &state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+void run(const std::vector<uint8_t> &input) {
+  current_input = input;
+  LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+//половина входов - новые случайные, половина - мутации из пула уже прогнанных
+void generate(uint64_t &random, size_t max_length, std::vector<std::vector<uint8_t>> &pool, std::vector<uint8_t> &input) {
+  if(pool.empty() || (next_random(random) & 1) == 0) {
+    input.resize(next_random(random) % (max_length + 1));
+    for(auto &value : input)
+      value = static_cast<uint8_t>(next_random(random));
+    return;
+  }
+
+  input = pool[next_random(random) % pool.size()];
+  const uint64_t mutations = 1 + next_random(random) % 4;
+  for(uint64_t i = 0; i < mutations; i++) {
+    const uint64_t kind = next_random(random) % 3;
+    if(kind == 0 && input.empty() == false)
+      input[next_random(random) % input.size()] ^= static_cast<uint8_t>(1 << (next_random(random) % 8));
+    else if(kind == 1 && input.size() < max_length)
+      input.insert(input.begin() + next_random(random) % (input.size() + 1), static_cast<uint8_t>(next_random(random)));
+    else if(input.empty() == false)
+      input.erase(input.begin() + next_random(random) % input.size());
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint64_t runs = 100000;
+  uint64_t seed = 1;
+  size_t max_length = 256;
+  std::vector<const char *> files;
+
+  program_name = strrchr(argv[0], '/') != nullptr ? strrchr(argv[0], '/') + 1 : argv[0];
+
+  for(int i = 1; i < argc; i++) {
+    if(strncmp(argv[i], "--runs=", 7) == 0)
+      runs = strtoull(argv[i] + 7, nullptr, 10);
+    else if(strncmp(argv[i], "--seed=", 7) == 0)
+      seed = strtoull(argv[i] + 7, nullptr, 10);
+    else if(strncmp(argv[i], "--max-len=", 10) == 0)
+      max_length = strtoul(argv[i] + 10, nullptr, 10);
+    else if(strcmp(argv[i], "--quick") == 0)
+      runs /= 100;
+    else
+      files.push_back(argv[i]);
+  }
+
+  std::signal(SIGABRT, save_crash);
+  std::signal(SIGSEGV, save_crash);
+
+  if(files.empty() == false) {
+    for(auto path : files) {
+      std::ifstream file(path, std::ios::binary);
+      std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+      run(input);
+      printf("%s: ok\n", path);
+    }
+    return 0;
+  }
+
+  uint64_t random = seed * 0x9E3779B97F4A7C15ULL + 1;
+  std::vector<std::vector<uint8_t>> pool;
+  std::vector<uint8_t> input;
+  uint64_t total_bytes = 0;
+
+  const auto started_at = std::chrono::steady_clock::now();
+  for(uint64_t i = 0; i < runs; i++) {
+    generate(random, max_length, pool, input);
+    total_bytes += input.size();
+    run(input);
+
+    if(pool.size() < 256)
+      pool.push_back(input);
+    else
+      pool[next_random(random) % pool.size()] = input;
+  }
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+
+  printf("%s: runs: %llu, seed: %llu, mean input: %.0f B, time: %.2f s, exec/s: %.0f\n", program_name,
+         static_cast<unsigned long long>(runs), static_cast<unsigned long long>(seed),
+         runs > 0 ? static_cast<double>(total_bytes) / runs : 0.0, elapsed, elapsed > 0 ? runs / elapsed : 0.0);
+  return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+//Узел esphome на хосте: главный цикл с виртуальным временем и кадры пульта в эфире.
+
+#include <string>
+
+#include "esphome.h"
+#include <IRrecv.h>
+#include <IRsend.h>
+
+namespace host_node {
+
+//интервал главного цикла esphome по умолчанию
+const uint32_t LOOP_INTERVAL_MS = 16;
+
+template<typename C> void loop_for(C *component, uint32_t duration_ms, uint32_t step_ms = LOOP_INTERVAL_MS) {
+  const uint64_t until = host::time_us() + static_cast<uint64_t>(duration_ms) * 1000;
+  while(host::time_us() < until) {
+    component->call_loop();
+    host::advance_ms(step_ms);
+  }
+}
+
+//setup, подписка, retain сообщения брокера и главный цикл до первой публикации info топика
+template<typename C> bool start(C *component, const std::string &info_topic, uint32_t timeout_ms = 10000) {
+  const size_t published = global_mqtt_client->count(info_topic);
+
+  component->call_setup();
+  component->call_loop();
+  global_mqtt_client->deliver_retained();
+
+  const uint64_t until = host::time_us() + static_cast<uint64_t>(timeout_ms) * 1000;
+  while(host::time_us() < until) {
+    if(global_mqtt_client->count(info_topic) > published)
+      return true;
+    host::advance_ms(LOOP_INTERVAL_MS);
+    component->call_loop();
+  }
+
+  return global_mqtt_client->count(info_topic) > published;
+}
+
+//последний отправленный кадр обратно в эфир, как отражение от стен
+inline void echo_last_sent() { host::ir_air_push_sent(host::ir_sent().back()); }
+
+}  // namespace host_node
@@ -0,0 +1,88 @@
+#pragma once
+
+//Минимальный набор для тестов на хосте: TEST_CASE регистрирует тест, CHECK* считают ошибки,
+//перед каждым тестом состояние хоста сбрасывается (host::reset()).
+
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace host_test {
+
+struct TestCase {
+  const char *name;
+  void (*function)();
+};
+
+inline std::vector<TestCase> &registry() {
+  static std::vector<TestCase> tests;
+  return tests;
+}
+
+inline int &failures() {
+  static int count = 0;
+  return count;
+}
+
+struct Registrar {
+  Registrar(const char *name, void (*function)()) { registry().push_back(TestCase{name, function}); }
+};
+
+inline void fail(const char *file, int line, const std::string &message) {
+  failures()++;
+  fprintf(stderr, "%s:%d: FAILED: %s\n", file, line, message.c_str());
+}
+
+inline std::string to_string(const std::string &value) { return "\"" + value + "\""; }
+inline std::string to_string(const char *value) { return value == nullptr ? "nullptr" : "\"" + std::string(value) + "\""; }
+inline std::string to_string(bool value) { return value ? "true" : "false"; }
+inline std::string to_string(float value) { return std::to_string(value); }
+inline std::string to_string(double value) { return std::to_string(value); }
+template<typename T> std::string to_string(const T &value) { return std::to_string(static_cast<long long>(value)); }
+
+}  // namespace host_test
+
+#define TEST_CASE(name) \
+  static void name(); \
+  static host_test::Registrar name##_registrar(#name, name); \
+  static void name()
+
+#define CHECK(expr) \
+  do { \
+    if(!(expr)) \
+      host_test::fail(__FILE__, __LINE__, #expr); \
+  } while(0)
+
+#define CHECK_EQ(actual, expected) \
+  do { \
+    const auto &actual_value_ = (actual); \
+    const auto &expected_value_ = (expected); \
+    if(!(actual_value_ == expected_value_)) \
+      host_test::fail(__FILE__, __LINE__, std::string(#actual " == " #expected ", got ") + \
+                                              host_test::to_string(actual_value_) + " vs " + \
+                                              host_test::to_string(expected_value_)); \
+  } while(0)
+
+#define CHECK_NEAR(actual, expected, epsilon) \
+  do { \
+    const double actual_value_ = (actual); \
+    const double expected_value_ = (expected); \
+    if(std::fabs(actual_value_ - expected_value_) > (epsilon)) \
+      host_test::fail(__FILE__, __LINE__, std::string(#actual " ~= " #expected ", got ") + \
+                                              std::to_string(actual_value_) + " vs " + std::to_string(expected_value_)); \
+  } while(0)
+
+//строки сравниваются по содержимому, nullptr - отдельное значение
+#define CHECK_STR(actual, expected) \
+  do { \
+    const char *actual_value_ = (actual); \
+    const char *expected_value_ = (expected); \
+    if(actual_value_ == nullptr || expected_value_ == nullptr ? actual_value_ != expected_value_ \
+                                                              : strcmp(actual_value_, expected_value_) != 0) \
+      host_test::fail(__FILE__, __LINE__, std::string(#actual " == " #expected ", got ") + \
+                                              host_test::to_string(actual_value_) + " vs " + \
+                                              host_test::to_string(expected_value_)); \
+  } while(0)
@@ -0,0 +1,29 @@
+//Запуск тестов: без аргументов - все, иначе только тесты с именами из аргументов.
+
+#include <cstring>
+
+#include "esphome.h"
+#include "test.h"
+
+int main(int argc, char **argv) {
+  int executed = 0;
+
+  for(const auto &test : host_test::registry()) {
+    bool selected = argc < 2;
+    for(int i = 1; i < argc; i++)
+      selected |= strcmp(argv[i], test.name) == 0;
+
+    if(selected == false)
+      continue;
+
+    host::reset();
+    const int failures_before = host_test::failures();
+    test.function();
+    executed++;
+
+    printf("%-48s %s\n", test.name, host_test::failures() == failures_before ? "ok" : "FAILED");
+  }
+
+  printf("%d tests, %d failures\n", executed, host_test::failures());
+  return host_test::failures() == 0 && executed > 0 ? 0 : 1;
+}
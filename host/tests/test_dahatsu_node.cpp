@@ -0,0 +1,282 @@
+//Узел с кондиционером dahatsu (TCL112AC) целиком: mqtt команды, кнопки, ir кадры, восстановление состояния.
+//Собирается с уровнями логов INFO и DEBUG.
+
+#include <algorithm>
+
+#include "esphome.h"
+#include "dahatsu/DahatsuClimateComponent.h"
+
+#include "dump_reader.h"
+#include "node.h"
+#include "test.h"
+
+namespace {
+
+const std::string INFO_TOPIC = "dahatsu/i";
+
+mqtt_climate::DahatsuClimateComponent *make_component() {
+  return new mqtt_climate::DahatsuClimateComponent(D5, D2, "dahatsu");
+}
+
+JsonObject &last_json(DynamicJsonBuffer &buffer, const std::string &topic) {
+  auto message = global_mqtt_client->last(topic);
+  return message == nullptr ? JsonObject::invalid() : buffer.parseObject(message->payload);
+}
+
+IRTcl112Ac last_sent_frame() {
+  IRTcl112Ac frame(0);
+  host::ir_air_push_sent(host::ir_sent().back());
+  IRrecv receiver(D5, 300, 20, true);
+  receiver.enableIRIn();
+  decode_results results;
+  if(receiver.decode(&results))
+    frame.setRaw(results.state);
+  return frame;
+}
+
+}  // namespace
+
+TEST_CASE(initial_state_after_retain_timeout) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+  CHECK(millis() >= 5500);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK(state.success());
+  CHECK_STR(state["hvac"] | "", "off");
+  CHECK(state["attrs"].as<JsonObject &>().containsKey("turbo_al"));
+}
+
+TEST_CASE(json_command_sends_one_frame) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  global_mqtt_client->deliver("dahatsu/j/c", "{\"hvac\":\"cool\",\"t\":23.5,\"fm\":\"high\",\"health\":true}");
+  host_node::loop_for(component, 200);
+
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  CHECK_EQ(host::ir_sent().back().pin, D2);
+
+  IRTcl112Ac frame = last_sent_frame();
+  CHECK_EQ(frame.getPower(), true);
+  CHECK_EQ(frame.getMode(), kTcl112AcCool);
+  CHECK_NEAR(frame.getTemp(), 23.5, 1e-6);
+  CHECK_EQ(frame.getFan(), kTcl112AcFanHigh);
+  CHECK_EQ(frame.getHealth(), true);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "cool");
+  CHECK_NEAR(state["t"].as<float>(), 23.5, 1e-6);
+  CHECK_EQ(state["attrs"]["health"].as<bool>(), true);
+}
+
+TEST_CASE(turbo_button_keeps_previous_state) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  global_mqtt_client->deliver("dahatsu/j/c", "{\"hvac\":\"heat\",\"t\":24,\"fm\":\"low\"}");
+  host_node::loop_for(component, 200);
+  global_mqtt_client->deliver("dahatsu/turbo/set", "on");
+  host_node::loop_for(component, 200);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_EQ(state["attrs"]["turbo"].as<bool>(), true);
+  CHECK_NEAR(state["t"].as<float>(), 31, 1e-6);
+  CHECK_NEAR(state["prev_state"]["temp"].as<float>(), 24, 1e-6);
+  CHECK_STR(state["prev_state"]["fan"] | "", "low");
+
+  global_mqtt_client->deliver("dahatsu/turbo/set", "off");
+  host_node::loop_for(component, 200);
+
+  JsonObject &restored = last_json(buffer, INFO_TOPIC);
+  CHECK_EQ(restored["attrs"]["turbo"].as<bool>(), false);
+  CHECK_NEAR(restored["t"].as<float>(), 24, 1e-6);
+  CHECK_STR(restored["fm"] | "", "low");
+  CHECK_EQ(host::ir_sent().size(), 3u);
+}
+
+TEST_CASE(remote_frame_updates_state) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  IRTcl112Ac remote(0);
+  remote.on();
+  remote.setMode(kTcl112AcHeat);
+  remote.setTemp(25.5);
+  host::ir_air_push_tcl112ac(remote.getRaw());
+  host_node::loop_for(component, 100);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "heat");
+  CHECK_NEAR(state["t"].as<float>(), 25.5, 1e-6);
+  CHECK(host::ir_sent().empty());
+}
+
+TEST_CASE(sent_frame_echo_is_ignored) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  global_mqtt_client->deliver("dahatsu/m/c", "cool");
+  host_node::loop_for(component, 200);
+
+  const size_t published = global_mqtt_client->count(INFO_TOPIC);
+  host_node::echo_last_sent();
+  host_node::loop_for(component, 200);
+
+  CHECK_EQ(component->get_ir_duplicate_frames(), 1u);
+  CHECK_EQ(global_mqtt_client->count(INFO_TOPIC), published);
+}
+
+TEST_CASE(state_restored_from_flash) {
+  auto first = make_component();
+  CHECK(host_node::start(first, INFO_TOPIC));
+  global_mqtt_client->deliver("dahatsu/j/c", "{\"hvac\":\"dry\",\"light\":true}");
+  host_node::loop_for(first, 11000);
+  CHECK(global_preferences.writes > 0);
+
+  global_mqtt_client->reset();
+  host::set_time_us(0);
+  std::vector<std::string> info_logs;
+  host::set_log_hook([&info_logs](int level, const char *, const char *message) {
+    if(level == ESPHOME_LOG_LEVEL_INFO)
+      info_logs.push_back(message);
+  });
+  auto second = make_component();
+  CHECK(host_node::start(second, INFO_TOPIC));
+  CHECK(millis() < 1000);
+  host::set_log_hook(nullptr);
+
+  //на уровне INFO сообщение без to_string: он собирается только с DEBUG
+  CHECK(std::find(info_logs.begin(), info_logs.end(), "State restored from flash") != info_logs.end());
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "dry");
+  CHECK_STR(state["fm"] | "", "auto");
+  CHECK_EQ(state["attrs"]["light"].as<bool>(), true);
+}
+
+//состояние до turbo: восстановление переиспользует объект, без turbo в сохраненном состоянии - удаляет
+TEST_CASE(compact_state_restore_reuses_prev_state) {
+  using namespace ir_climate::dahatsu;
+  IRDahatsu ac(D5, D2);
+  ac.set_hvac_mode(AC_MODE::MODE_COOL);
+  ac.set_temp(24.5f);
+  ac.set_fan(FAN_MODE::FAN_LOW);
+  CHECK(ac.set_turbo(true));
+  const auto turbo_state = ac.get_compact_state();
+  CHECK_EQ(turbo_state.has_prev_state, 1u);
+  CHECK(ac.set_turbo(false));
+  const auto plain_state = ac.get_compact_state();
+
+  CHECK(ac.restore_compact_state(turbo_state));
+  CHECK(ac.get_prev_state() != nullptr);
+  const auto live_bytes = host::alloc_stats().live_bytes;
+  for(int i = 0; i < 10; i++)
+    CHECK(ac.restore_compact_state(turbo_state));
+  CHECK_EQ(host::alloc_stats().live_bytes, live_bytes);
+  CHECK_NEAR(ac.get_prev_state()->temp, 24.5, 0.01);
+  CHECK_EQ(ac.get_prev_state()->fan_mode, FAN_MODE::FAN_LOW);
+
+  CHECK(ac.restore_compact_state(plain_state));
+  CHECK(ac.get_prev_state() == nullptr);
+  CHECK(host::alloc_stats().live_bytes < live_bytes);
+}
+
+TEST_CASE(invalid_compact_state_is_rejected) {
+  using namespace ir_climate::dahatsu;
+  IRDahatsu ac(D5, D2);
+  ac.set_hvac_mode(AC_MODE::MODE_HEAT);
+  ac.set_temp(22);
+  CHECK(ac.set_turbo(true));
+  const auto valid = ac.get_compact_state();
+  const auto fingerprint = ac.get_state_fingerprint();
+
+  auto unknown_mode = valid;
+  unknown_mode.raw[6] = (unknown_mode.raw[6] & 0xF0) | 0x0F;
+  auto unknown_fan = valid;
+  unknown_fan.prev_fan_mode = FAN_MODE::FAN_UNDEFINED;
+  auto unknown_swing = valid;
+  unknown_swing.prev_swing_mode = 7;
+  auto temp_out_of_range = valid;
+  temp_out_of_range.prev_temp = 200;
+  //кадры вне ограничений режима: turbo в auto, 31.5 градуса
+  auto turbo_in_auto = valid;
+  turbo_in_auto.raw[6] = (turbo_in_auto.raw[6] & 0xF0) | 0x08;
+  auto frame_temp_out_of_range = valid;
+  frame_temp_out_of_range.raw[7] &= 0xF0;
+  frame_temp_out_of_range.raw[12] |= 1 << 5;
+
+  for(const auto &state : {unknown_mode, unknown_fan, unknown_swing, temp_out_of_range, turbo_in_auto, frame_temp_out_of_range}) {
+    CHECK_EQ(ac.restore_compact_state(state), false);
+    CHECK_EQ(ac.get_state_fingerprint(), fingerprint);
+  }
+}
+
+//turbo в осушении на low: библиотека включает turbo с high, восстановление из retain - тоже low
+TEST_CASE(dry_turbo_runs_on_low_fan) {
+  using namespace ir_climate::dahatsu;
+  IRDahatsu ac(D5, D2);
+  ac.set_hvac_mode(AC_MODE::MODE_DRY);
+  CHECK(ac.set_turbo(true));
+  CHECK_EQ(ac.get_fan(), FAN_MODE::FAN_LOW);
+  CHECK(ac.set_turbo(false));
+  CHECK_EQ(ac.get_fan(), FAN_MODE::FAN_AUTO);
+
+  ac.initialize("dry", "dry", "low", "off", nullptr, 24, true, false, false, true);
+  CHECK_EQ(ac.get_turbo(), true);
+  CHECK_EQ(ac.get_fan(), FAN_MODE::FAN_LOW);
+
+  //turbo из retain только там, где режим его допускает, и без eco
+  ac.initialize("auto", "auto", "auto", "off", new State(24, FAN_MODE::FAN_LOW, SWING_MODE::SWING_OFF), 24, true, false, false, true);
+  CHECK_EQ(ac.get_turbo(), false);
+  ac.initialize("cool", "cool", "high", "off", nullptr, 16, true, true, false, true);
+  CHECK((ac.get_turbo() && ac.get_eco()) == false);
+}
+
+//испорченное состояние во flash не применяется, узел ждет retain сообщения как без сохранения
+TEST_CASE(unrecognized_flash_state_falls_back_to_retain) {
+  auto first = make_component();
+  CHECK(host_node::start(first, INFO_TOPIC));
+  global_mqtt_client->deliver("dahatsu/m/c", "heat");
+  host_node::loop_for(first, 11000);
+  CHECK(global_preferences.writes > 0);
+
+  //режим в сохраненном кадре - младшие 4 бита байта 6
+  for(auto &entry : global_preferences.storage)
+    entry.second[6] |= 0x0F;
+
+  global_mqtt_client->reset();
+  host::set_time_us(0);
+  auto second = make_component();
+  CHECK(host_node::start(second, INFO_TOPIC));
+  CHECK(millis() >= 5000);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "off");
+}
+
+TEST_CASE(ir_capture_dump_is_not_retained) {
+  auto component = make_component();
+  component->set_ir_capture(2048);
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  IRTcl112Ac remote(0);
+  remote.on();
+  remote.setMode(kTcl112AcCool);
+  host::ir_air_push_tcl112ac(remote.getRaw());
+  host_node::loop_for(component, 100);
+  global_mqtt_client->deliver("dahatsu/ir/c", "dump");
+
+  auto dump = global_mqtt_client->last("dahatsu/ir/d");
+  CHECK(dump != nullptr && dump->retain == false);
+  std::vector<dump_reader::IRRecord> records;
+  CHECK(dump != nullptr && dump_reader::read_irc1(dump->payload, records));
+  CHECK_EQ(records.size(), 1u);
+  CHECK_EQ(records[0].decode_type, TCL112AC);
+}
@@ -0,0 +1,580 @@
+//Узел с кондиционером daikin целиком: mqtt команды, ir кадры, восстановление состояния.
+//Собирается с уровнями логов INFO и DEBUG.
+
+#include <algorithm>
+#include <map>
+
+#include "esphome.h"
+#include "daikin/DaikinClimateComponent.h"
+
+#include "dump_reader.h"
+#include "node.h"
+#include "test.h"
+
+namespace {
+
+const std::string INFO_TOPIC = "daikin/i";
+const std::string COMPACT_TOPIC = "daikin/r";
+
+mqtt_climate::DaikinClimateComponent *make_component() {
+  return new mqtt_climate::DaikinClimateComponent(D5, D2, "daikin");
+}
+
+JsonObject &last_json(DynamicJsonBuffer &buffer, const std::string &topic) {
+  auto message = global_mqtt_client->last(topic);
+  return message == nullptr ? JsonObject::invalid() : buffer.parseObject(message->payload);
+}
+
+//регулятор по датчику в комнате: гистерезис 0.5, смещение до 1, шаг раз в минуту, показания живут 5 минут
+mqtt_climate::DaikinClimateComponent *make_thermostat_component() {
+  auto component = make_component();
+  component->set_current_temperature_sensor("room/sensor", "temperature");
+  component->enable_thermostat(0.5, 1, 60, 300);
+  return component;
+}
+
+//уставка во flash, как ее восстановит компонент; -1 - записи нет
+int saved_temp() {
+  typedef ir_climate::daikin::IRDaikin::CompactState CompactState;
+  auto preference = global_preferences.make_preference<CompactState>(fnv1_hash("climate_state_daikin"), true);
+  CompactState state;
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+  if(preference.load(&state) == false || ac.restore_compact_state(state) == false)
+    return -1;
+  return ac.get_temp();
+}
+
+mqtt_climate::DaikinClimateComponent *make_compact_component() {
+  auto component = make_component();
+  component->enable_compact_state_topic();
+  return component;
+}
+
+//перезагрузка узла: flash пустой, у брокера остаются только retained сообщения
+void reboot_with_retained(mqtt_climate::DaikinClimateComponent *component,
+                          const std::map<std::string, std::string> &retained) {
+  auto messages = retained;
+  global_mqtt_client->reset();
+  global_mqtt_client->retained = messages;
+  global_preferences.reset();
+  host::set_time_us(0);
+  CHECK(host_node::start(component, INFO_TOPIC));
+}
+
+//последний отправленный кадр, как его разберет приемник
+IRDaikin64 last_sent_frame() {
+  IRDaikin64 frame(0);
+  host::ir_air_push_sent(host::ir_sent().back());
+  IRrecv receiver(D5, 140, 80, true);
+  receiver.enableIRIn();
+  decode_results results;
+  if(receiver.decode(&results))
+    frame.setRaw(results.value);
+  return frame;
+}
+
+}  // namespace
+
+TEST_CASE(initial_state_after_retain_timeout) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  //retain сообщения нет: ждем 5 с, затем discovery и через 500 мс начальное состояние
+  CHECK(millis() >= 5500);
+  auto discovery = global_mqtt_client->last("homeassistant/climate/daikin/config");
+  CHECK(discovery != nullptr && discovery->retain);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK(state.success());
+  CHECK_STR(state["hvac"] | "", "off");
+  CHECK(host::ir_sent().empty());
+}
+
+//переподключение к брокеру: discovery публикуется заново из готовой строки, json не собирается
+TEST_CASE(reconnect_republishes_cached_discovery) {
+  const std::string discovery_topic = "homeassistant/climate/daikin/config";
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+  CHECK_EQ(global_mqtt_client->count(discovery_topic), 1u);
+  CHECK_EQ(component->get_discovery_renders(), 1u);
+  const std::string payload = global_mqtt_client->last(discovery_topic)->payload;
+
+  global_mqtt_client->set_connected(false);
+  host_node::loop_for(component, 1000);
+  const size_t published = global_mqtt_client->count(INFO_TOPIC);
+  global_mqtt_client->reconnect();
+  //без сохраненного состояния discovery уходит после 5 с ожидания retain сообщения
+  host_node::loop_for(component, 6000);
+
+  CHECK_EQ(global_mqtt_client->count(discovery_topic), 2u);
+  CHECK_STR(global_mqtt_client->last(discovery_topic)->payload.c_str(), payload.c_str());
+  CHECK_EQ(component->get_discovery_renders(), 1u);
+  //начальное состояние после discovery отправлено снова
+  CHECK(global_mqtt_client->count(INFO_TOPIC) > published);
+}
+
+//переподключение: ни одна итерация главного цикла не стоит на паузе перед начальным состоянием,
+//время итерации меряется по виртуальным часам, которые двигает только delay() внутри итерации
+TEST_CASE(reconnect_does_not_block_loop) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  global_mqtt_client->set_connected(false);
+  host_node::loop_for(component, 1000);
+  const size_t published = global_mqtt_client->count(INFO_TOPIC);
+  global_mqtt_client->reconnect();
+
+  uint64_t max_iteration_us = 0;
+  const uint64_t until = host::time_us() + 7000000;
+  while(host::time_us() < until) {
+    const uint64_t started_at = host::time_us();
+    component->call_loop();
+    max_iteration_us = std::max(max_iteration_us, host::time_us() - started_at);
+    host::advance_ms(host_node::LOOP_INTERVAL_MS);
+  }
+
+  CHECK(global_mqtt_client->count(INFO_TOPIC) > published);
+  CHECK(max_iteration_us < 50000);
+}
+
+TEST_CASE(mode_command_sends_one_frame) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  global_mqtt_client->deliver("daikin/t/c", "22");
+  global_mqtt_client->deliver("daikin/f/c", "low");
+  //кадр идет по прерываниям: окно объединения, сам кадр и пауза после него
+  host_node::loop_for(component, 400);
+
+  //три команды в окне объединения - один кадр
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  CHECK_EQ(host::ir_sent().back().pin, D2);
+  CHECK_EQ(component->get_ir_frames_sent(), 1u);
+  CHECK_EQ(component->get_ir_frames_saved(), 2u);
+
+  IRDaikin64 frame = last_sent_frame();
+  CHECK_EQ(frame.getMode(), kDaikin64Cool);
+  CHECK_EQ(frame.getTemp(), 22);
+  CHECK_EQ(frame.getFan(), kDaikin64FanLow);
+  CHECK_EQ(frame.getPowerToggle(), true);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "cool");
+  CHECK_STR(state["fm"] | "", "low");
+  CHECK_EQ(state["t"].as<int>(), 22);
+}
+
+TEST_CASE(sent_frame_echo_is_ignored) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  global_mqtt_client->deliver("daikin/m/c", "heat");
+  host_node::loop_for(component, 200);
+  CHECK_EQ(host::ir_sent().size(), 1u);
+
+  const size_t published = global_mqtt_client->count(INFO_TOPIC);
+  host_node::echo_last_sent();
+  host_node::loop_for(component, 200);
+
+  //отражение своего кадра с битом питания не должно выключить кондиционер
+  CHECK_EQ(component->get_ir_duplicate_frames(), 1u);
+  CHECK_EQ(global_mqtt_client->count(INFO_TOPIC), published);
+}
+
+//та же уставка повторно: кадр уходит, но состояние не публикуется, растет счетчик пропусков
+TEST_CASE(repeated_state_is_not_republished) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  global_mqtt_client->deliver("daikin/t/c", "22");
+  host_node::loop_for(component, 400);
+
+  const size_t published = global_mqtt_client->count(INFO_TOPIC);
+  const uint32_t suppressed = component->get_suppressed_publishes();
+
+  global_mqtt_client->deliver("daikin/t/c", "22");
+  host_node::loop_for(component, 400);
+  CHECK_EQ(global_mqtt_client->count(INFO_TOPIC), published);
+  CHECK_EQ(component->get_suppressed_publishes(), suppressed + 1);
+
+  global_mqtt_client->deliver("daikin/t/c", "23");
+  host_node::loop_for(component, 400);
+  CHECK_EQ(global_mqtt_client->count(INFO_TOPIC), published + 1);
+  CHECK_EQ(component->get_suppressed_publishes(), suppressed + 1);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_EQ(state["t"].as<int>(), 23);
+}
+
+//вне cool/heat регулировать нечего: смещение снимается сразу, с командой режима уходит цель
+TEST_CASE(thermostat_offset_cleared_outside_cool_heat) {
+  auto component = make_thermostat_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  global_mqtt_client->deliver("daikin/t/c", "24");
+  global_mqtt_client->deliver("room/sensor", "{\"temperature\":26}");
+  host_node::loop_for(component, 61000, 100);
+  CHECK_EQ(last_sent_frame().getTemp(), 23);
+
+  host::ir_sent().clear();
+  global_mqtt_client->deliver("daikin/m/c", "dry");
+  host_node::loop_for(component, 400);
+
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  CHECK_EQ(last_sent_frame().getTemp(), 24);
+  DynamicJsonBuffer buffer;
+  JsonObject &control = last_json(buffer, "daikin/ctl");
+  CHECK_EQ(control["target"].as<int>(), 24);
+  CHECK_EQ(control["offset"].as<int>(), 0);
+  CHECK_EQ(control["sp"].as<int>(), 24);
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"].as<const char *>(), "dry");
+  CHECK_EQ(state["t"].as<int>(), 24);
+
+  //датчик по-прежнему показывает жару, но в dry уставка не двигается
+  host_node::loop_for(component, 121000, 100);
+  CHECK_EQ(host::ir_sent().size(), 1u);
+}
+
+TEST_CASE(remote_frame_updates_state) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  IRDaikin64 remote(0);
+  remote.setMode(kDaikin64Heat);
+  remote.setTemp(27);
+  remote.setPowerToggle(true);
+  host::ir_air_push_daikin64(remote.getRaw());
+  host_node::loop_for(component, 100);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "heat");
+  CHECK_EQ(state["t"].as<int>(), 27);
+  CHECK(host::ir_sent().empty());
+}
+
+//кадр с пульта пришел раньше, чем очередь драйвера дошла до эфира: включение из отмененного кадра не считается
+TEST_CASE(discarded_power_toggle_is_rolled_back) {
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+  ac.setup();
+  ac.set_hvac_mode(ir_climate::daikin::AC_MODE::MODE_COOL);
+  CHECK(ac.get_power_state());
+  ac.send();
+
+  IRDaikin64 remote(0);
+  remote.setMode(kDaikin64Heat);
+  remote.setTemp(25);
+  remote.setPowerToggle(false);
+  host::ir_air_push_daikin64(remote.getRaw());
+  ac.loop();
+
+  CHECK_EQ(ac.is_send_pending(), false);
+  CHECK_EQ(ac.get_power_state(), false);
+  CHECK_EQ(ac.get_hvac_mode(), ir_climate::daikin::AC_MODE::MODE_OFF);
+  CHECK_EQ(ac.get_temp(), 25);
+
+  host::advance_ms(300);
+  ac.loop();
+  CHECK(host::ir_sent().empty());
+}
+
+//команда ждет окна объединения, кадр с пульта его отменяет
+TEST_CASE(remote_frame_cancels_pending_command) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  global_mqtt_client->deliver("daikin/t/c", "19");
+  IRDaikin64 remote(0);
+  remote.setMode(kDaikin64Heat);
+  remote.setTemp(27);
+  remote.setPowerToggle(true);
+  host::ir_air_push_daikin64(remote.getRaw());
+  host_node::loop_for(component, 400);
+
+  CHECK(host::ir_sent().empty());
+  CHECK_EQ(component->get_ir_frames_sent(), 0u);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "heat");
+  CHECK_EQ(state["t"].as<int>(), 27);
+}
+
+//включение командой еще в окне объединения, кадр с пульта без бита питания: кондиционер остается выключенным
+TEST_CASE(remote_frame_cancels_pending_power_on) {
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  //кадр пульта собирается заранее: IRsend двигает время на длину кадра, окно бы закрылось
+  IRDaikin64 remote(0);
+  remote.setMode(kDaikin64Heat);
+  remote.setTemp(24);
+  remote.setPowerToggle(false);
+  host::ir_air_push_daikin64(remote.getRaw());
+  const auto timings = host::ir_air().back();
+  host::ir_air().pop_back();
+
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  host_node::loop_for(component, 16);
+  host::ir_air_push(timings);
+  host_node::loop_for(component, 400);
+
+  CHECK(host::ir_sent().empty());
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "off");
+  CHECK_EQ(state["t"].as<int>(), 24);
+
+  //следующее включение отправляет кадр с битом питания
+  global_mqtt_client->deliver("daikin/m/c", "heat");
+  host_node::loop_for(component, 400);
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  CHECK_EQ(last_sent_frame().getPowerToggle(), true);
+}
+
+TEST_CASE(state_restored_from_retain_message) {
+  global_mqtt_client->publish(INFO_TOPIC,
+                              std::string("{\"hvac\":\"heat\",\"fm\":\"low\",\"t\":26,\"sm\":\"off\","
+                              "\"attrs\":{\"sleep\":false,\"mode\":\"heat\",\"prev_fan_mode\":\"low\"}}"),
+                              0, true);
+
+  auto component = make_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "heat");
+  CHECK_STR(state["fm"] | "", "low");
+  CHECK_EQ(state["t"].as<int>(), 26);
+}
+
+TEST_CASE(state_restored_from_flash) {
+  auto first = make_component();
+  CHECK(host_node::start(first, INFO_TOPIC));
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  global_mqtt_client->deliver("daikin/t/c", "21");
+  //запись во flash через 10 с без изменений
+  host_node::loop_for(first, 11000);
+  CHECK(global_preferences.writes > 0);
+
+  //перезагрузка: retain сообщения нет, состояние из flash применяется без ожидания
+  global_mqtt_client->reset();
+  host::set_time_us(0);
+  std::vector<std::string> info_logs;
+  host::set_log_hook([&info_logs](int level, const char *, const char *message) {
+    if(level == ESPHOME_LOG_LEVEL_INFO)
+      info_logs.push_back(message);
+  });
+  auto second = make_component();
+  CHECK(host_node::start(second, INFO_TOPIC));
+  CHECK(millis() < 1000);
+  host::set_log_hook(nullptr);
+
+  //на уровне INFO сообщение без to_string: он собирается только с DEBUG
+  CHECK(std::find(info_logs.begin(), info_logs.end(), "State restored from flash") != info_logs.end());
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "cool");
+  CHECK_EQ(state["t"].as<int>(), 21);
+}
+
+//компактное состояние в daikin/r: версия, размер и Driver::CompactState в hex
+TEST_CASE(compact_state_round_trip) {
+  auto first = make_compact_component();
+  CHECK(host_node::start(first, INFO_TOPIC));
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  global_mqtt_client->deliver("daikin/t/c", "21");
+  global_mqtt_client->deliver("daikin/f/c", "low");
+  host_node::loop_for(first, 400);
+
+  auto compact = global_mqtt_client->last(COMPACT_TOPIC);
+  CHECK(compact != nullptr && compact->retain);
+  const std::string payload = compact->payload;
+  CHECK_EQ(payload.size(), (2 + sizeof(ir_climate::daikin::IRDaikin::CompactState)) * 2);
+
+  //перезагрузка без flash: состояние из retain сообщения
+  auto second = make_compact_component();
+  reboot_with_retained(second, global_mqtt_client->retained);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "cool");
+  CHECK_STR(state["fm"] | "", "low");
+  CHECK_EQ(state["t"].as<int>(), 21);
+  CHECK_STR(global_mqtt_client->last(COMPACT_TOPIC)->payload.c_str(), payload.c_str());
+}
+
+//daikin/r подписан первым и приходит раньше json, json после восстановления игнорируется
+TEST_CASE(compact_state_takes_precedence_over_info) {
+  auto first = make_compact_component();
+  CHECK(host_node::start(first, INFO_TOPIC));
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  global_mqtt_client->deliver("daikin/t/c", "21");
+  host_node::loop_for(first, 400);
+
+  auto retained = global_mqtt_client->retained;
+  retained[INFO_TOPIC] = "{\"hvac\":\"heat\",\"fm\":\"high\",\"t\":26,\"sm\":\"off\"}";
+
+  auto second = make_compact_component();
+  reboot_with_retained(second, retained);
+
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_STR(state["hvac"] | "", "cool");
+  CHECK_EQ(state["t"].as<int>(), 21);
+}
+
+//испорченное, короткое или чужой версии компактное состояние отбрасывается, состояние из json
+TEST_CASE(malformed_compact_state_falls_back_to_info) {
+  typedef mqtt_climate::DaikinClimateComponent Component;
+  ir_climate::daikin::IRDaikin ac(D5, D2);
+  ac.set_hvac_mode(ir_climate::daikin::AC_MODE::MODE_COOL);
+  const std::string valid = Component::encode_compact_state(ac.get_compact_state());
+  const std::string size = valid.substr(2, 2);
+  const std::string body = valid.substr(4);
+
+  ir_climate::daikin::IRDaikin::CompactState decoded;
+  CHECK(Component::decode_compact_state(valid, decoded));
+  CHECK(Component::decode_compact_state("01" + size + body.substr(0, body.size() - 2) + "ZZ", decoded) == false);
+
+  const std::string payloads[] = {
+      "",
+      "01" + size,
+      valid.substr(0, valid.size() - 2),
+      valid + "00",
+      "01" + size + std::string(body.size(), 'z'),
+      "02" + size + body,
+      "01ff" + body,
+  };
+
+  for(const auto &payload : payloads) {
+    std::map<std::string, std::string> retained;
+    retained[INFO_TOPIC] = "{\"hvac\":\"heat\",\"fm\":\"high\",\"t\":26,\"sm\":\"off\"}";
+    retained[COMPACT_TOPIC] = payload;
+
+    auto component = make_compact_component();
+    reboot_with_retained(component, retained);
+
+    DynamicJsonBuffer buffer;
+    JsonObject &state = last_json(buffer, INFO_TOPIC);
+    CHECK_STR(state["hvac"] | "", "heat");
+    CHECK_EQ(state["t"].as<int>(), 26);
+  }
+}
+
+//испорченный кадр во flash приводится к ограничениям режима, как кадр с пульта
+TEST_CASE(corrupt_compact_state_is_normalized) {
+  using namespace ir_climate::daikin;
+  IRDaikin ac(D5, D2);
+  ac.set_hvac_mode(AC_MODE::MODE_FAN);
+  CHECK(ac.set_fan(FAN_MODE::FAN_HIGH));
+  auto state = ac.get_compact_state();
+
+  //auto обдув в fan_only, температура 0 в BCD, sleep
+  state.raw = (state.raw & ~(0xFULL << kDaikin64FanOffset)) | (uint64_t) kDaikin64FanAuto << kDaikin64FanOffset;
+  state.raw &= ~(0xFFULL << kDaikin64TempOffset);
+  state.raw |= 1ULL << kDaikin64SleepBit;
+
+  CHECK(ac.restore_compact_state(state));
+  CHECK_EQ(ac.get_mode(), AC_MODE::MODE_FAN);
+  CHECK_EQ(ac.get_fan(), FAN_MODE::FAN_HIGH);
+  CHECK_EQ(ac.get_temp(), ac.temp_min);
+  CHECK_EQ(ac.get_sleep(), false);
+}
+
+TEST_CASE(power_dump_is_not_retained) {
+  sensor::Sensor power_sensor;
+  auto component = make_component();
+  component->set_power_sensor(&power_sensor);
+  component->set_power_recorder(16);
+  CHECK(host_node::start(component, INFO_TOPIC));
+
+  power_sensor.publish_state(650);
+  power_sensor.publish_state(0.8);
+  global_mqtt_client->deliver("daikin/pwr/c", "dump");
+
+  auto dump = global_mqtt_client->last("daikin/pwr/d");
+  CHECK(dump != nullptr && dump->retain == false);
+  std::vector<dump_reader::PowerSample> samples;
+  CHECK(dump != nullptr && dump_reader::read_pwr1(dump->payload, samples));
+  CHECK_EQ(samples.size(), 2u);
+}
+
+TEST_CASE(thermostat_offset_stays_on_device) {
+  auto first = make_thermostat_component();
+  CHECK(host_node::start(first, INFO_TOPIC));
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  global_mqtt_client->deliver("daikin/t/c", "24");
+  global_mqtt_client->deliver("room/sensor", "{\"temperature\":26}");
+  host_node::loop_for(first, 61000, 100);
+
+  //в комнате теплее цели: уставка кондиционера на шаг ниже, HA видит цель
+  CHECK_EQ(last_sent_frame().getTemp(), 23);
+  DynamicJsonBuffer buffer;
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_EQ(state["t"].as<int>(), 24);
+  JsonObject &control = last_json(buffer, "daikin/ctl");
+  CHECK_EQ(control["target"].as<int>(), 24);
+  CHECK_EQ(control["offset"].as<int>(), -1);
+  CHECK_EQ(control["sp"].as<int>(), 23);
+
+  //во flash цель: после перезагрузки уставка 24, смещение снова с нуля
+  host_node::loop_for(first, 11000, 100);
+  CHECK(global_preferences.writes > 0);
+  global_mqtt_client->reset();
+  host::set_time_us(0);
+  auto second = make_thermostat_component();
+  CHECK(host_node::start(second, INFO_TOPIC));
+  host_node::loop_for(second, 100);
+
+  JsonObject &restored = last_json(buffer, INFO_TOPIC);
+  CHECK_EQ(restored["t"].as<int>(), 24);
+  JsonObject &restored_control = last_json(buffer, "daikin/ctl");
+  CHECK_EQ(restored_control["target"].as<int>(), 24);
+  CHECK_EQ(restored_control["offset"].as<int>(), 0);
+}
+
+TEST_CASE(thermostat_reverts_to_target_without_readings) {
+  auto component = make_thermostat_component();
+  CHECK(host_node::start(component, INFO_TOPIC));
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  global_mqtt_client->deliver("daikin/t/c", "24");
+  global_mqtt_client->deliver("room/sensor", "{\"temperature\":26}");
+  host_node::loop_for(component, 61000, 100);
+  CHECK_EQ(last_sent_frame().getTemp(), 23);
+
+  //HA выставляет ту же уставку, что и регулятор: это новая цель, а не его шаг
+  //кадр тот же, но в /i и во flash цель меняется с 24 на 23
+  CHECK_EQ(saved_temp(), 24);
+  global_mqtt_client->deliver("daikin/t/c", "23");
+  host_node::loop_for(component, 400);
+  DynamicJsonBuffer buffer;
+  JsonObject &control = last_json(buffer, "daikin/ctl");
+  CHECK_EQ(control["target"].as<int>(), 23);
+  CHECK_EQ(control["offset"].as<int>(), 0);
+  JsonObject &retargeted = last_json(buffer, INFO_TOPIC);
+  CHECK_EQ(retargeted["t"].as<int>(), 23);
+  host_node::loop_for(component, 11000, 100);
+  CHECK_EQ(saved_temp(), 23);
+
+  host_node::loop_for(component, 61000, 100);
+  CHECK_EQ(last_sent_frame().getTemp(), 22);
+
+  //датчик молчит дольше 5 минут: уставка кондиционера возвращается к цели
+  host::ir_sent().clear();
+  host_node::loop_for(component, 300000, 100);
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  CHECK_EQ(last_sent_frame().getTemp(), 23);
+  JsonObject &expired = last_json(buffer, "daikin/ctl");
+  CHECK_EQ(expired["offset"].as<int>(), 0);
+  CHECK_EQ(expired["sp"].as<int>(), 23);
+  JsonObject &state = last_json(buffer, INFO_TOPIC);
+  CHECK_EQ(state["t"].as<int>(), 23);
+}
@@ -0,0 +1,148 @@
+//Диагностика: бакеты гистограмм задержки, json в <name>/lat и <name>/diag, замер разбора json в sj.
+
+#include "esphome.h"
+#include "daikin/DaikinClimateComponent.h"
+
+#include "node.h"
+#include "test.h"
+
+namespace {
+
+JsonObject &last_json(DynamicJsonBuffer &buffer, const std::string &topic) {
+  auto message = global_mqtt_client->last(topic);
+  return message == nullptr ? JsonObject::invalid() : buffer.parseObject(message->payload);
+}
+
+}  // namespace
+
+//бакет i - [2^i, 2^(i+1)) us, нулевой - меньше 2us, последний - все что дольше
+TEST_CASE(latency_bucket_bounds) {
+  latency_histogram::LatencyHistogram histogram;
+  histogram.add(0);
+  histogram.add(1);
+  histogram.add(2);
+  histogram.add(3);
+  histogram.add(4);
+  histogram.add(1023);
+  histogram.add(1024);
+  histogram.add(1u << 15);
+  histogram.add(UINT32_MAX);
+
+  CHECK_EQ(histogram.get_bucket(0), 2u);
+  CHECK_EQ(histogram.get_bucket(1), 2u);
+  CHECK_EQ(histogram.get_bucket(2), 1u);
+  CHECK_EQ(histogram.get_bucket(9), 1u);
+  CHECK_EQ(histogram.get_bucket(10), 1u);
+  CHECK_EQ(histogram.get_bucket(latency_histogram::LATENCY_BUCKETS - 1), 2u);
+  CHECK_EQ(histogram.get_max(), UINT32_MAX);
+  CHECK_EQ(histogram.used_buckets(), latency_histogram::LATENCY_BUCKETS);
+
+  histogram.reset();
+  CHECK_EQ(histogram.used_buckets(), 0u);
+  CHECK_EQ(histogram.get_max(), 0u);
+}
+
+TEST_CASE(latency_bucket_saturates) {
+  latency_histogram::LatencyHistogram histogram;
+  for(uint32_t i = 0; i < UINT16_MAX + 10u; i++)
+    histogram.add(5);
+
+  CHECK_EQ(histogram.get_bucket(2), UINT16_MAX);
+  CHECK_EQ(histogram.used_buckets(), 3u);
+}
+
+//такты переводятся в us по частоте процессора, хвост из нулевых бакетов не публикуется, после публикации - обнуление
+TEST_CASE(latency_payload) {
+  auto tracker = new latency_histogram::LatencyTracker("node", 60000);
+  CHECK(latency_histogram::global_latency_tracker() == tracker);
+
+  {
+    latency_histogram::LatencyProbe probe(latency_histogram::PHASE_LOOP);
+    host::advance_us(5);
+  }
+  tracker->record(latency_histogram::PHASE_LOOP, 80 * 300);
+  tracker->update();
+
+  DynamicJsonBuffer buffer;
+  JsonObject &root = last_json(buffer, "node/lat");
+  CHECK(root.success());
+  CHECK_EQ(root.size(), 2u);
+  JsonArray &loop = root["l"];
+  CHECK_EQ(loop.size(), 9u);
+  CHECK_EQ(loop[2].as<int>(), 1);
+  CHECK_EQ(loop[8].as<int>(), 1);
+  CHECK_EQ(root["l_max"].as<int>(), 300);
+
+  tracker->update();
+  DynamicJsonBuffer empty_buffer;
+  CHECK_EQ(last_json(empty_buffer, "node/lat").size(), 0u);
+
+  latency_histogram::global_latency_tracker() = nullptr;
+}
+
+//ret - память, оставшаяся занятой после участка, min_heap - свободная куча после него
+TEST_CASE(heap_diagnostics_payload) {
+  auto diagnostics = new heap_diagnostics::HeapDiagnostics("node", 60000);
+  CHECK(heap_diagnostics::global_heap_diagnostics() == diagnostics);
+
+  //operator new напрямую: выделение через new-выражение компилятор вправе выкинуть
+  void *retained = nullptr;
+  {
+    heap_diagnostics::HeapProbe probe(heap_diagnostics::PROBE_IR_SEND);
+    retained = ::operator new(100);
+  }
+  const uint32_t heap_after = ESP.getFreeHeap();
+  {
+    heap_diagnostics::HeapProbe probe(heap_diagnostics::PROBE_IR_SEND);
+  }
+  diagnostics->update();
+
+  DynamicJsonBuffer buffer;
+  JsonObject &root = last_json(buffer, "node/diag");
+  CHECK(root.success());
+  CHECK(root.containsKey("heap") && root.containsKey("block") && root.containsKey("stack"));
+  CHECK(root["min_heap"].as<uint32_t>() <= heap_after);
+  CHECK(root.containsKey("pj") == false);
+  CHECK(root.containsKey("sj") == false);
+  CHECK_EQ(root["ir"]["n"].as<int>(), 2);
+  CHECK_EQ(root["ir"]["ret"].as<int>(), 100);
+  CHECK_EQ(root["ir"]["min_heap"].as<uint32_t>(), heap_after);
+
+  ::operator delete(retained);
+  heap_diagnostics::global_heap_diagnostics() = nullptr;
+}
+
+//sj замеряет разбор json вместе с обработчиком: один вызов на сообщение, даже если json не разобрался
+TEST_CASE(subscribe_json_probe_covers_parse) {
+  auto diagnostics = new heap_diagnostics::HeapDiagnostics("node", 60000);
+  auto component = new mqtt_climate::DaikinClimateComponent(D5, D2, "daikin");
+  CHECK(host_node::start(component, "daikin/i"));
+
+  global_mqtt_client->deliver("daikin/j/c", "{\"hvac\":\"cool\",\"t\":23}");
+  global_mqtt_client->deliver("daikin/j/c", "{not json");
+  diagnostics->update();
+
+  DynamicJsonBuffer buffer;
+  JsonObject &root = last_json(buffer, "node/diag");
+  CHECK_EQ(root["sj"]["n"].as<int>(), 2);
+
+  heap_diagnostics::global_heap_diagnostics() = nullptr;
+}
+
+//ir замеряет кодирование и запуск кадра, один замер на кадр, а не на каждую итерацию loop во время отправки
+TEST_CASE(ir_probe_covers_frame_start) {
+  auto diagnostics = new heap_diagnostics::HeapDiagnostics("node", 60000);
+  auto component = new mqtt_climate::DaikinClimateComponent(D5, D2, "daikin");
+  CHECK(host_node::start(component, "daikin/i"));
+
+  global_mqtt_client->deliver("daikin/m/c", "cool");
+  host_node::loop_for(component, 400);
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  diagnostics->update();
+
+  DynamicJsonBuffer buffer;
+  JsonObject &root = last_json(buffer, "node/diag");
+  CHECK_EQ(root["ir"]["n"].as<int>(), 1);
+
+  heap_diagnostics::global_heap_diagnostics() = nullptr;
+}
@@ -0,0 +1,70 @@
+//Выгрузки с устройства читаются утилитами на хосте в том же виде, в каком их пишет прошивка.
+
+#include "esphome.h"
+#include "shared_libs/PowerSampleRecorder.h"
+#include "shared_libs/IRRawCapture.h"
+
+#include "dump_reader.h"
+#include "test.h"
+
+TEST_CASE(pwr1_round_trip) {
+  PowerSampleRecorder recorder(3);
+  recorder.add(1000, 650.5);
+  recorder.add(2000, 0.8);
+  recorder.add(3000, 12);
+  //буфер на 3 отсчета: самый старый вытесняется
+  recorder.add(4000, 700);
+
+  std::vector<dump_reader::PowerSample> samples;
+  CHECK(dump_reader::read_pwr1(recorder.dump(), samples));
+  CHECK_EQ(samples.size(), 3u);
+  CHECK_EQ(samples[0].time, 2000u);
+  CHECK_NEAR(samples[0].power, 0.8, 1e-6);
+  CHECK_EQ(samples[2].time, 4000u);
+  CHECK_NEAR(samples[2].power, 700, 1e-6);
+}
+
+TEST_CASE(pwr1_rejects_bad_dumps) {
+  PowerSampleRecorder recorder(4);
+  recorder.add(1000, 650);
+  const std::string dump = recorder.dump();
+  std::vector<dump_reader::PowerSample> samples;
+
+  CHECK(dump_reader::read_pwr1(PowerSampleRecorder(4).dump(), samples));
+  CHECK(samples.empty());
+  CHECK_EQ(dump_reader::read_pwr1(dump.substr(0, dump.size() - 1), samples), false);
+  CHECK_EQ(dump_reader::read_pwr1(dump + "x", samples), false);
+  CHECK_EQ(dump_reader::read_pwr1("IRC1" + dump.substr(4), samples), false);
+}
+
+TEST_CASE(irc1_round_trip) {
+  IRDaikin64 remote(0);
+  remote.setTemp(24);
+  host::ir_air_push_daikin64(remote.getRaw());
+  host::ir_air_push({9000, 4500, 560});
+
+  IRrecv receiver(D5, 140, 80, true);
+  receiver.enableIRIn();
+  ir_climate::IRRawCapture capture(1024);
+  decode_results results;
+  capture.add(&results, receiver.decode(&results));
+  const std::vector<uint32_t> frame(results.rawbuf + 1, results.rawbuf + results.rawlen);
+  host::advance_ms(1500);
+  capture.add(&results, receiver.decode(&results));
+
+  std::vector<dump_reader::IRRecord> records;
+  CHECK(dump_reader::read_irc1(capture.dump(), records));
+  CHECK_EQ(records.size(), 2u);
+  CHECK_EQ(records[0].decode_type, DAIKIN64);
+  CHECK_EQ(records[0].bits, kDaikin64Bits);
+  CHECK_EQ(records[0].timings.size(), frame.size());
+  CHECK_EQ(records[0].timings[0], frame[0] * kRawTick);
+  CHECK_EQ(records[1].decode_type, UNKNOWN);
+  CHECK_EQ(records[1].bits, 0);
+  CHECK_EQ(records[1].time - records[0].time, 1500u);
+  CHECK_EQ(records[1].timings.size(), 3u);
+
+  const std::string dump = capture.dump();
+  CHECK_EQ(dump_reader::read_irc1(dump.substr(0, dump.size() - 1), records), false);
+  CHECK_EQ(dump_reader::read_irc1("PWR1" + dump.substr(4), records), false);
+}
@@ -0,0 +1,71 @@
+//Таблицы имен перечислений: идеальный хэш, разбор без учета регистра, обратное преобразование.
+
+#include "esphome.h"
+#include "daikin/lib/IRDaikin.h"
+
+#include "test.h"
+
+using namespace ir_climate;
+using namespace ir_climate::daikin;
+
+namespace {
+
+//свои таблицы: ключи совпадают с таблицами драйвера, но не все
+constexpr EnumName TEST_NAMES[] PROGMEM = {{"a", 1}, {"b", 2}, {"ab", 3}, {"abc", 4}, {"B_C", 5}};
+constexpr EnumIndex TEST_INDEX PROGMEM = enum_index(TEST_NAMES);
+
+constexpr EnumName DUPLICATE_KEY_NAMES[] = {{"off", 0}, {"oft", 1}};
+
+}  // namespace
+
+static_assert(enum_keys_unique(TEST_NAMES), "unique keys");
+static_assert(enum_keys_unique(DUPLICATE_KEY_NAMES) == false, "off and oft share first letter and length");
+static_assert(TEST_INDEX.seed != 0, "perfect hash seed");
+
+TEST_CASE(every_name_parses_back) {
+  for(const auto &entry : MODE_NAMES)
+    CHECK_EQ(str_to_enum(MODE_NAMES, MODE_INDEX, entry.name, ENUM_UNDEFINED), entry.value);
+  for(const auto &entry : FAN_MODE_NAMES)
+    CHECK_EQ(str_to_enum(FAN_MODE_NAMES, FAN_MODE_INDEX, entry.name, ENUM_UNDEFINED), entry.value);
+  for(const auto &entry : SWING_MODE_NAMES)
+    CHECK_EQ(str_to_enum(SWING_MODE_NAMES, SWING_MODE_INDEX, entry.name, ENUM_UNDEFINED), entry.value);
+  for(const auto &entry : TEST_NAMES)
+    CHECK_EQ(str_to_enum(TEST_NAMES, TEST_INDEX, entry.name, ENUM_UNDEFINED), entry.value);
+}
+
+TEST_CASE(slots_point_to_their_entries) {
+  size_t used = 0;
+  for(uint8_t slot = 0; slot < ENUM_SLOTS; slot++) {
+    const uint8_t entry = MODE_INDEX.slots[slot];
+    if(entry == ENUM_NO_ENTRY)
+      continue;
+    used++;
+    CHECK_EQ(enum_slot_(MODE_NAMES[entry].key, MODE_INDEX.seed), slot);
+  }
+  CHECK_EQ(used, sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0]));
+}
+
+TEST_CASE(parse_ignores_case) {
+  CHECK_EQ(IRDaikin::parse_mode("COOL"), AC_MODE::MODE_COOL);
+  CHECK_EQ(IRDaikin::parse_mode("Fan_Only"), AC_MODE::MODE_FAN);
+  CHECK_EQ(IRDaikin::parse_fan_mode("QUIET"), FAN_MODE::FAN_QUIET);
+  CHECK_EQ(parse_on_off("TRUE"), 1);
+  CHECK_EQ(parse_on_off("Off"), 0);
+}
+
+TEST_CASE(unknown_strings_fall_back) {
+  //тот же ключ, что у "off": первая буква и длина совпадают, строка - нет
+  CHECK_EQ(IRDaikin::parse_mode("oft"), AC_MODE::MODE_UNDEFINED);
+  CHECK_EQ(IRDaikin::parse_mode(""), AC_MODE::MODE_UNDEFINED);
+  CHECK_EQ(IRDaikin::parse_mode("cooling"), AC_MODE::MODE_UNDEFINED);
+  CHECK_EQ(IRDaikin::parse_mode(std::string(300, 'c')), AC_MODE::MODE_UNDEFINED);
+  CHECK_EQ(parse_on_off("1"), ENUM_UNDEFINED);
+  CHECK_EQ(str_to_enum(TEST_NAMES, TEST_INDEX, "ac", ENUM_UNDEFINED), ENUM_UNDEFINED);
+}
+
+TEST_CASE(value_to_name) {
+  CHECK_STR(IRDaikin::mode_to_str(AC_MODE::MODE_HEAT), "heat");
+  CHECK_STR(IRDaikin::fan_mode_to_str(FAN_MODE::FAN_TURBO), "turbo");
+  CHECK_STR(IRDaikin::swing_mode_to_str(SWING_MODE::SWING_HORIZONTAL), "horizontal");
+  CHECK_STR(enum_to_str(TEST_NAMES, 42, "fallback"), "fallback");
+}
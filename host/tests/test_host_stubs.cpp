@@ -0,0 +1,208 @@
+//Заглушки сами должны вести себя как esphome и IRremoteESP8266, иначе тесты компонентов ничего не проверяют.
+
+#include "esphome.h"
+#include <IRrecv.h>
+#include <IRsend.h>
+
+#include "test.h"
+
+TEST_CASE(json_round_trip) {
+  DynamicJsonBuffer buffer;
+  JsonObject &root = buffer.parseObject("{\"hvac\":\"cool\",\"t\":24.5,\"attrs\":{\"sleep\":true},\"a\":[1,2]}");
+
+  CHECK(root.success());
+  CHECK_STR(root["hvac"] | "", "cool");
+  CHECK_NEAR(root["t"].as<float>(), 24.5, 1e-6);
+  CHECK_EQ(root["attrs"]["sleep"].as<bool>(), true);
+  CHECK_EQ(root["attrs"]["missing"].as<bool>(), false);
+  CHECK_STR(root["missing"] | "default", "default");
+  CHECK_EQ(root.containsKey("missing"), false);
+
+  std::string printed;
+  root.printTo(printed);
+  CHECK_EQ(printed, std::string("{\"hvac\":\"cool\",\"t\":24.5,\"attrs\":{\"sleep\":true},\"a\":[1,2]}"));
+}
+
+TEST_CASE(json_parse_errors) {
+  DynamicJsonBuffer buffer;
+  CHECK_EQ(buffer.parseObject("{\"hvac\":").success(), false);
+  CHECK_EQ(buffer.parseObject("{} trailing").success(), false);
+  CHECK_EQ(buffer.parseObject("[1]").success(), false);
+
+  bool called = false;
+  json::parse_json("not json", [&called](JsonObject &) { called = true; });
+  CHECK_EQ(called, false);
+}
+
+TEST_CASE(topic_filters) {
+  using mqtt::MQTTClientComponent;
+  CHECK(MQTTClientComponent::topic_matches("a/+/c", "a/b/c"));
+  CHECK(MQTTClientComponent::topic_matches("a/#", "a/b/c"));
+  CHECK(MQTTClientComponent::topic_matches("a/b", "a/b"));
+  CHECK_EQ(MQTTClientComponent::topic_matches("a/b", "a/b/c"), false);
+  CHECK_EQ(MQTTClientComponent::topic_matches("a/+", "a/b/c"), false);
+}
+
+TEST_CASE(retained_messages) {
+  global_mqtt_client->publish(std::string("a/i"), std::string("1"), 0, true);
+  global_mqtt_client->publish(std::string("a/d"), std::string("2"), 0, false);
+
+  std::vector<std::string> received;
+  global_mqtt_client->subscribe("a/#", [&received](const std::string &topic, const std::string &payload) {
+    received.push_back(topic + "=" + payload);
+  });
+  global_mqtt_client->deliver_retained();
+
+  CHECK_EQ(received.size(), 1u);
+  CHECK_EQ(received[0], std::string("a/i=1"));
+}
+
+TEST_CASE(preferences_require_same_size) {
+  auto preference = global_preferences.make_preference<uint32_t>(1, true);
+  uint32_t value = 42;
+  CHECK(preference.save(&value));
+
+  uint32_t loaded = 0;
+  CHECK(preference.load(&loaded));
+  CHECK_EQ(loaded, 42u);
+
+  auto other = global_preferences.make_preference<uint16_t>(1, true);
+  uint16_t small = 0;
+  CHECK_EQ(other.load(&small), false);
+}
+
+TEST_CASE(daikin64_frame_round_trip) {
+  IRDaikin64 remote(0);
+  remote.setMode(kDaikin64Heat);
+  remote.setTemp(27);
+  remote.setFan(kDaikin64FanLow);
+  remote.setPowerToggle(true);
+  const uint64_t raw = remote.getRaw();
+
+  const uint64_t started_at = host::time_us();
+  host::ir_air_push_daikin64(raw);
+  CHECK(host::time_us() > started_at);
+
+  IRrecv receiver(D5, 140, 80, true);
+  receiver.enableIRIn();
+  decode_results results;
+  CHECK(receiver.decode(&results));
+  CHECK_EQ(results.decode_type, DAIKIN64);
+  CHECK_EQ(results.bits, kDaikin64Bits);
+  CHECK(results.value == raw);
+
+  IRDaikin64 decoded(0);
+  decoded.setRaw(results.value);
+  CHECK_EQ(decoded.getMode(), kDaikin64Heat);
+  CHECK_EQ(decoded.getTemp(), 27);
+  CHECK_EQ(decoded.getPowerToggle(), true);
+}
+
+TEST_CASE(tcl112ac_frame_round_trip) {
+  IRTcl112Ac remote(0);
+  remote.on();
+  remote.setMode(kTcl112AcCool);
+  remote.setTemp(22.5);
+  remote.setTurbo(true);
+  uint8_t raw[kTcl112AcStateLength];
+  memcpy(raw, remote.getRaw(), kTcl112AcStateLength);
+
+  host::ir_air_push_tcl112ac(raw);
+
+  IRrecv receiver(D5, 300, 20, true);
+  receiver.enableIRIn();
+  decode_results results;
+  CHECK(receiver.decode(&results));
+  CHECK_EQ(results.decode_type, TCL112AC);
+  CHECK_EQ(memcmp(results.state, raw, kTcl112AcStateLength), 0);
+
+  IRTcl112Ac decoded(0);
+  decoded.setRaw(results.state);
+  CHECK_NEAR(decoded.getTemp(), 22.5, 1e-6);
+  CHECK_EQ(decoded.getFan(), kTcl112AcFanHigh);
+}
+
+TEST_CASE(receiver_rejects_bad_frames) {
+  IRrecv receiver(D5, 140, 80, true);
+  decode_results results;
+
+  //выключенный приемник кадры не забирает
+  host::ir_air_push({9000, 4500, 560});
+  CHECK_EQ(receiver.decode(&results), false);
+  CHECK_EQ(host::ir_air().size(), 1u);
+
+  receiver.enableIRIn();
+  CHECK_EQ(receiver.decode(&results), false);
+  CHECK_EQ(results.decode_type, UNKNOWN);
+  CHECK_EQ(results.rawlen, 4);
+
+  //испорченная контрольная сумма: протокол не разобран, с DECODE_HASH - UNKNOWN с хешем, как в библиотеке
+  IRDaikin64 remote(0);
+  host::ir_air_push_daikin64(remote.getRaw() ^ (1ULL << 60));
+  CHECK(receiver.decode(&results));
+  CHECK_EQ(results.decode_type, UNKNOWN);
+  CHECK_EQ(results.bits, 32);
+  const uint64_t hash = results.value;
+
+  //тот же кадр - тот же хеш
+  host::ir_air_push_daikin64(remote.getRaw() ^ (1ULL << 60));
+  CHECK(receiver.decode(&results));
+  CHECK_EQ(results.value, hash);
+
+  //кадр длиннее буфера
+  IRrecv small(D5, 20, 80, true);
+  small.enableIRIn();
+  host::ir_air_push_daikin64(remote.getRaw());
+  CHECK(small.decode(&results));
+  CHECK_EQ(results.decode_type, UNKNOWN);
+  CHECK(results.overflow);
+}
+
+TEST_CASE(receiver_splits_frames_at_timeout) {
+  IRDaikin64 remote(0);
+  IRsend sender(D2);
+  sender.sendDaikin64(remote.getRaw());
+  sender.sendDaikin64(remote.getRaw());
+
+  //два кадра подряд, как их слышит приемник: между ними пауза длиннее таймаута
+  std::vector<uint32_t> timings = host::ir_sent()[0].timings;
+  timings.insert(timings.end(), host::ir_sent()[1].timings.begin(), host::ir_sent()[1].timings.end());
+  timings.pop_back();
+  host::ir_air_push(timings);
+
+  IRrecv receiver(D5, 140, 80, true);
+  receiver.enableIRIn();
+  decode_results results;
+  CHECK(receiver.decode(&results));
+  CHECK(receiver.decode(&results));
+  CHECK_EQ(receiver.decode(&results), false);
+  CHECK(host::ir_air().empty());
+}
+
+TEST_CASE(allocations_are_counted) {
+  auto before = host::alloc_stats();
+  auto *value = new uint32_t[16];
+  //указатель уходит в asm, компилятор не может убрать пару new/delete
+  asm volatile("" : : "r"(value) : "memory");
+  auto during = host::alloc_stats();
+  delete[] value;
+  auto after = host::alloc_stats();
+
+  CHECK_EQ(during.allocations - before.allocations, 1u);
+  CHECK_EQ(during.live_bytes - before.live_bytes, 64u);
+  CHECK_EQ(after.live_bytes, before.live_bytes);
+  CHECK_EQ(ESP.getFreeHeap(), host::heap_size() - static_cast<uint32_t>(after.live_bytes));
+}
+
+TEST_CASE(log_levels_compile_out) {
+  std::vector<int> levels;
+  host::set_log_hook([&levels](int level, const char *, const char *) { levels.push_back(level); });
+
+  ESP_LOGW("test", "warn");
+  ESP_LOGI("test", "info");
+  ESP_LOGD("test", "debug");
+  ESP_LOGV("test", "verbose");
+
+  //тест собирается с уровнем INFO: DEBUG и VERBOSE вырезаны препроцессором
+  CHECK_EQ(levels.size(), 2u);
+}
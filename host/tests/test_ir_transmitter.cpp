@@ -0,0 +1,189 @@
+//Отправка кадра по прерываниям timer1 на симулированном таймере: start() не ждет кадра,
+//несущая на выводе демодулируется моделью светодиода в host::ir_sent() и разбирается приемником.
+
+#include "esphome.h"
+#include "shared_libs/IRTransmitter.h"
+#include <IRrecv.h>
+#include <IRsend.h>
+
+#include "test.h"
+
+using ir_climate::IRTransmitter;
+
+namespace {
+
+//кадр daikin64 как в IRsend::sendDaikin64
+void encode_daikin64(IRTransmitter &transmitter, uint64_t data) {
+  transmitter.clear();
+  for(uint8_t i = 0; i < 2; i++) {
+    transmitter.mark(kDaikin64LdrMark);
+    transmitter.space(kDaikin64LdrSpace);
+  }
+  transmitter.mark(kDaikin64HdrMark);
+  transmitter.space(kDaikin64HdrSpace);
+  transmitter.data(data, kDaikin64Bits, kDaikin64BitMark, kDaikin64OneSpace, kDaikin64BitMark, kDaikin64ZeroSpace,
+                   false);
+  transmitter.mark(kDaikin64BitMark);
+  transmitter.space(kDaikin64Gap);
+  transmitter.mark(kDaikin64HdrMark);
+  transmitter.space(kDefaultMessageGap);
+}
+
+uint64_t remote_state() {
+  IRDaikin64 remote(0);
+  remote.setMode(kDaikin64Cool);
+  remote.setTemp(23);
+  remote.setPowerToggle(true);
+  return remote.getRaw();
+}
+
+//длительность кадра без паузы в конце, как ее отправляет IRsend
+uint64_t reference_duration_us(uint64_t data) {
+  IRsend sender(0);
+  sender.sendDaikin64(data);
+  auto frame = host::ir_sent().back();
+  host::ir_sent().pop_back();
+  return frame.duration_us() - frame.timings.back();
+}
+
+}  // namespace
+
+TEST_CASE(start_does_not_wait_for_frame) {
+  IRTransmitter transmitter(D2, kDaikin64Freq);
+  transmitter.begin();
+  encode_daikin64(transmitter, remote_state());
+
+  const uint64_t started_at = host::time_us();
+  CHECK(transmitter.start());
+  CHECK_EQ(host::time_us(), started_at);
+  CHECK(transmitter.is_busy());
+  CHECK(IRTransmitter::is_any_busy());
+
+  //за 10 мс ушли только leader импульсы
+  host::advance_ms(10);
+  CHECK(transmitter.is_busy());
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  CHECK(host::ir_sent().back().timings.size() < 4u);
+
+  host::advance_ms(300);
+  CHECK_EQ(transmitter.is_busy(), false);
+  CHECK_EQ(IRTransmitter::is_any_busy(), false);
+  CHECK_EQ(host::pin_level(D2), LOW);
+}
+
+TEST_CASE(frame_decodes_from_carrier) {
+  const uint64_t state = remote_state();
+  IRTransmitter transmitter(D2, kDaikin64Freq);
+  transmitter.begin();
+  encode_daikin64(transmitter, state);
+  CHECK(transmitter.start());
+  host::advance_ms(300);
+
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  const auto frame = host::ir_sent().back();
+  CHECK_EQ(frame.pin, D2);
+  CHECK_EQ(frame.timings.size(), 137u);
+  //каждый mark - целое число периодов несущей без выключенной половины последнего, до 26 мкс на mark
+  CHECK_NEAR(static_cast<double>(frame.duration_us()), static_cast<double>(reference_duration_us(state)), 69 * 26.0);
+
+  host::ir_air_push_sent(frame);
+  IRrecv receiver(D5, 140, 80, true);
+  receiver.enableIRIn();
+  decode_results results;
+  CHECK(receiver.decode(&results));
+  CHECK_EQ(results.decode_type, DAIKIN64);
+  CHECK_EQ(results.value, state);
+}
+
+TEST_CASE(busy_until_trailing_gap_ends) {
+  const uint64_t state = remote_state();
+  //IRsend двигает время, поэтому до start()
+  const uint64_t frame_us = reference_duration_us(state);
+  IRTransmitter transmitter(D2, kDaikin64Freq);
+  transmitter.begin();
+  encode_daikin64(transmitter, state);
+  CHECK(transmitter.start());
+
+  //последний mark закончился, пауза между кадрами еще идет
+  host::advance_us(frame_us + 1000);
+  CHECK(transmitter.is_busy());
+
+  host::advance_us(kDefaultMessageGap);
+  CHECK_EQ(transmitter.is_busy(), false);
+}
+
+TEST_CASE(one_frame_on_air_at_a_time) {
+  IRTransmitter first(D2, kDaikin64Freq);
+  IRTransmitter second(D1, kDaikin64Freq);
+  first.begin();
+  second.begin();
+  encode_daikin64(first, remote_state());
+  encode_daikin64(second, remote_state());
+
+  CHECK(first.start());
+  CHECK_EQ(second.start(), false);
+  CHECK_EQ(second.is_busy(), false);
+
+  host::advance_ms(300);
+  CHECK(second.start());
+  host::advance_ms(300);
+
+  CHECK_EQ(host::ir_sent().size(), 2u);
+  CHECK_EQ(host::ir_sent()[0].pin, D2);
+  CHECK_EQ(host::ir_sent()[1].pin, D1);
+}
+
+TEST_CASE(buffer_is_kept_while_busy) {
+  IRTransmitter transmitter(D2, kDaikin64Freq);
+  transmitter.begin();
+  encode_daikin64(transmitter, remote_state());
+  CHECK(transmitter.start());
+
+  CHECK_EQ(transmitter.clear(), false);
+  CHECK_EQ(transmitter.size(), 137u);
+  host::advance_ms(300);
+  CHECK(transmitter.clear());
+  CHECK_EQ(transmitter.size(), 0u);
+}
+
+TEST_CASE(invalid_frames_are_rejected) {
+  IRTransmitter transmitter(D2);
+  transmitter.begin();
+
+  //пустой кадр
+  CHECK_EQ(transmitter.start(), false);
+
+  //больше MAX_TIMINGS
+  for(uint16_t i = 0; i <= IRTransmitter::MAX_TIMINGS / 2; i++) {
+    transmitter.mark(500);
+    transmitter.space(500);
+  }
+  CHECK(transmitter.is_overflow());
+  CHECK_EQ(transmitter.start(), false);
+
+  //длинная пауза посреди кадра
+  transmitter.clear();
+  transmitter.mark(500);
+  transmitter.space(100000);
+  transmitter.mark(500);
+  CHECK(transmitter.is_overflow());
+  CHECK_EQ(transmitter.start(), false);
+
+  CHECK_EQ(IRTransmitter::is_any_busy(), false);
+  CHECK(host::ir_sent().empty());
+}
+
+TEST_CASE(short_mark_is_one_carrier_period) {
+  IRTransmitter transmitter(D2);
+  transmitter.begin();
+  transmitter.mark(5);
+  transmitter.space(1000);
+  CHECK(transmitter.start());
+  host::advance_ms(10);
+
+  CHECK_EQ(transmitter.is_busy(), false);
+  CHECK_EQ(host::ir_sent().size(), 1u);
+  CHECK_EQ(host::ir_sent().back().timings.size(), 1u);
+  //включенная половина периода 38 кГц
+  CHECK_NEAR(host::ir_sent().back().timings[0], 13.0, 1.0);
+}
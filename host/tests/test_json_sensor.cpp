@@ -0,0 +1,106 @@
+//MQTTSubscribeJsonSensor: одна подписка на несколько полей, пути через точку, отсутствующие поля.
+//Собирается с DEBUG: dump_config пишет на уровне CONFIG.
+
+#include "esphome.h"
+#include "shared_libs/MQTTSubscribeJsonSensor.h"
+
+#include "test.h"
+
+namespace {
+
+const std::string TOPIC = "zigbee2mqtt/air_conditioner_bedroom";
+
+//сообщение розетки zigbee2mqtt
+const char *const PLUG_PAYLOAD =
+    "{\"power\":612.5,\"voltage\":229,\"current\":2.71,\"energy\":14.2,\"linkquality\":87,\"state\":\"ON\","
+    "\"update\":{\"state\":\"idle\",\"installed_version\":268,\"latest_version\":269}}";
+
+}  // namespace
+
+//одно сообщение разбирается один раз и раздается всем сенсорам
+TEST_CASE(one_subscription_feeds_all_fields) {
+  auto sensor = new mqtt_subscribe_json::MQTTSubscribeJsonSensor();
+  sensor->set_topic(TOPIC, "power");
+  auto voltage = sensor->add_field("voltage");
+  auto current = sensor->add_field("current");
+  auto linkquality = sensor->add_field("linkquality");
+  sensor->setup();
+  CHECK_EQ(global_mqtt_client->subscription_count(), 1u);
+
+  global_mqtt_client->deliver(TOPIC, PLUG_PAYLOAD);
+
+  CHECK_EQ(sensor->get_state(), 612.5f);
+  CHECK_EQ(voltage->get_state(), 229.0f);
+  CHECK_EQ(current->get_state(), 2.71f);
+  CHECK_EQ(linkquality->get_state(), 87.0f);
+}
+
+TEST_CASE(dotted_path_reads_nested_field) {
+  auto sensor = new mqtt_subscribe_json::MQTTSubscribeJsonSensor();
+  sensor->set_topic(TOPIC, "update.installed_version");
+  auto latest = sensor->add_field("update.latest_version");
+  sensor->setup();
+
+  global_mqtt_client->deliver(TOPIC, PLUG_PAYLOAD);
+
+  CHECK_EQ(sensor->get_state(), 268.0f);
+  CHECK_EQ(latest->get_state(), 269.0f);
+}
+
+//нет промежуточного объекта или самого поля: сенсор не обновляется, остальные поля обновляются
+TEST_CASE(missing_fields_keep_previous_state) {
+  auto sensor = new mqtt_subscribe_json::MQTTSubscribeJsonSensor();
+  sensor->set_topic(TOPIC, "power");
+  auto missing_parent = sensor->add_field("ota.progress");
+  auto missing_leaf = sensor->add_field("update.progress");
+  auto through_value = sensor->add_field("power.value");
+  auto voltage = sensor->add_field("voltage");
+  sensor->setup();
+
+  global_mqtt_client->deliver(TOPIC, PLUG_PAYLOAD);
+  CHECK_EQ(sensor->get_state(), 612.5f);
+  CHECK_EQ(voltage->get_state(), 229.0f);
+  CHECK(missing_parent->has_state() == false);
+  CHECK(missing_leaf->has_state() == false);
+  CHECK(through_value->has_state() == false);
+
+  //в следующем сообщении нет power: сенсор сохраняет прошлое значение
+  global_mqtt_client->deliver(TOPIC, "{\"voltage\":231}");
+  CHECK_EQ(sensor->get_state(), 612.5f);
+  CHECK_EQ(voltage->get_state(), 231.0f);
+
+  //нечисловое значение и не json - тоже без обновления
+  global_mqtt_client->deliver(TOPIC, "{\"power\":\"high\"}");
+  global_mqtt_client->deliver(TOPIC, "not json");
+  CHECK_EQ(sensor->get_state(), 612.5f);
+}
+
+//add_field() до set_topic() и повторный set_topic(): основное поле одно и принадлежит самому сенсору
+TEST_CASE(set_topic_replaces_primary_field) {
+  auto sensor = new mqtt_subscribe_json::MQTTSubscribeJsonSensor();
+  auto voltage = sensor->add_field("voltage");
+  sensor->set_topic(TOPIC, "current");
+  sensor->set_topic(TOPIC, "power");
+  sensor->setup();
+
+  std::vector<std::string> fields;
+  host::set_log_hook([&fields](int, const char *, const char *message) { fields.push_back(message); });
+  sensor->dump_config();
+  host::set_log_hook(nullptr);
+
+  global_mqtt_client->deliver(TOPIC, PLUG_PAYLOAD);
+
+  CHECK_EQ(sensor->get_state(), 612.5f);
+  CHECK_EQ(voltage->get_state(), 229.0f);
+
+  //current больше не читается: иначе сенсор получил бы 2.71 после power или до него
+  global_mqtt_client->deliver(TOPIC, "{\"current\":3.5}");
+  CHECK_EQ(sensor->get_state(), 612.5f);
+
+  //основное поле в строке топика, дополнительное - отдельной строкой, без current
+  CHECK_EQ(fields.size(), 3u);
+  if(fields.size() == 3u) {
+    CHECK_STR(fields[1].c_str(), "  Topic: zigbee2mqtt/air_conditioner_bedroom, Field: power");
+    CHECK_STR(fields[2].c_str(), "  Field: voltage");
+  }
+}
@@ -0,0 +1,188 @@
+//Узел с восемью кондиционерами: четыре daikin и четыре dahatsu в одной единице трансляции,
+//общий приемник, у каждого свой передатчик. Память на кондиционер и задержка команды до эфира.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "esphome.h"
+#include "daikin/DaikinClimateComponent.h"
+#include "dahatsu/DahatsuClimateComponent.h"
+
+#include "node.h"
+#include "test.h"
+
+namespace {
+
+const uint8_t UNITS = 8;
+//D5 занят приемником
+const uint8_t TRANSMITTER_PINS[UNITS] = {4, 5, 12, 13, 15, 16, 0, 2};
+
+struct Node {
+  ir_climate::IRReceiverHub *hub;
+  std::vector<Component *> units;
+  std::vector<std::string> names;
+  //сколько кондиционеров опубликовали начальное состояние
+  uint8_t started;
+  uint64_t bytes_per_unit;
+};
+
+uint32_t frames_sent(const Node &node, uint8_t unit) {
+  return unit % 2 == 0 ? static_cast<mqtt_climate::DaikinClimateComponent *>(node.units[unit])->get_ir_frames_sent()
+                       : static_cast<mqtt_climate::DahatsuClimateComponent *>(node.units[unit])->get_ir_frames_sent();
+}
+
+void loop_all(Node &node, uint32_t duration_ms) {
+  const uint64_t until = host::time_us() + static_cast<uint64_t>(duration_ms) * 1000;
+  while(host::time_us() < until) {
+    for(auto *unit : node.units)
+      unit->call_loop();
+    host::advance_ms(host_node::LOOP_INTERVAL_MS);
+  }
+}
+
+//четные - daikin, нечетные - dahatsu, приемник один на всех
+Node make_node() {
+  Node node;
+  const auto before = host::alloc_stats();
+
+  //timeout как у daikin: между частями его кадра 20 мс
+  node.hub = new ir_climate::IRReceiverHub(D5, 300, 80, 50);
+  const auto after_hub = host::alloc_stats();
+
+  for(uint8_t i = 0; i < UNITS; i++) {
+    node.names.push_back("unit" + std::to_string(i));
+    if(i % 2 == 0)
+      node.units.push_back(new mqtt_climate::DaikinClimateComponent(node.hub, TRANSMITTER_PINS[i], node.names.back()));
+    else
+      node.units.push_back(new mqtt_climate::DahatsuClimateComponent(node.hub, TRANSMITTER_PINS[i], node.names.back()));
+  }
+
+  for(auto *unit : node.units)
+    unit->call_setup();
+  global_mqtt_client->deliver_retained();
+  //ожидание retain сообщения и начальная публикация
+  loop_all(node, 6000);
+
+  node.started = 0;
+  for(const auto &name : node.names)
+    node.started += global_mqtt_client->last(name + "/i") != nullptr;
+
+  //сообщения, которые запомнила заглушка брокера, в память узла не входят
+  std::vector<mqtt::MQTTMessage>().swap(global_mqtt_client->published);
+  global_mqtt_client->retained.clear();
+
+  const auto after = host::alloc_stats();
+  node.bytes_per_unit = (after.live_bytes - after_hub.live_bytes) / UNITS;
+  printf("receiver hub: %llu B, per unit: %llu B\n", static_cast<unsigned long long>(after_hub.live_bytes - before.live_bytes),
+         static_cast<unsigned long long>(node.bytes_per_unit));
+  return node;
+}
+
+}  // namespace
+
+TEST_CASE(eight_units_start_on_one_receiver) {
+  Node node = make_node();
+
+  CHECK_EQ(node.started, UNITS);
+  CHECK(host::ir_sent().empty());
+  //компонент, драйвер, трекер питания, топики и discovery; приемник и буфер кадров общие
+  CHECK(node.bytes_per_unit < 4096);
+}
+
+TEST_CASE(command_latency_with_eight_units) {
+  Node node = make_node();
+
+  //команда всем сразу: кадры идут по одному, timer1 на узле один
+  const uint64_t sent_at = host::time_us();
+  for(const auto &name : node.names)
+    global_mqtt_client->deliver(name + "/m/c", "cool");
+
+  std::vector<uint64_t> latency_us(UNITS, 0);
+  const uint64_t until = sent_at + 5000000;
+  while(host::time_us() < until) {
+    for(auto *unit : node.units)
+      unit->call_loop();
+    host::advance_ms(host_node::LOOP_INTERVAL_MS);
+    for(uint8_t i = 0; i < UNITS; i++) {
+      if(latency_us[i] == 0 && frames_sent(node, i) == 1)
+        latency_us[i] = host::time_us() - sent_at;
+    }
+  }
+
+  uint64_t max_latency = 0;
+  for(uint8_t i = 0; i < UNITS; i++) {
+    CHECK(latency_us[i] != 0);
+    CHECK_EQ(frames_sent(node, i), 1u);
+    max_latency = std::max(max_latency, latency_us[i]);
+  }
+  printf("command -> frame sent: first %.0f ms, last %.0f ms\n", latency_us[0] / 1000.0, max_latency / 1000.0);
+
+  //окно объединения и восемь кадров с паузами: daikin ~230 мс, dahatsu ~200 мс
+  CHECK(max_latency < 2500000);
+
+  //кадр каждого кондиционера на своем выводе, ни один не перекрыл другой
+  CHECK_EQ(host::ir_sent().size(), static_cast<size_t>(UNITS));
+  for(size_t i = 1; i < host::ir_sent().size(); i++) {
+    const auto &previous = host::ir_sent()[i - 1];
+    CHECK(host::ir_sent()[i].started_at_us >= previous.started_at_us + previous.duration_us());
+  }
+  for(uint8_t i = 0; i < UNITS; i++) {
+    CHECK(std::count_if(host::ir_sent().begin(), host::ir_sent().end(),
+                        [i](const host::IRSentFrame &frame) { return frame.pin == TRANSMITTER_PINS[i]; }) == 1);
+  }
+
+  //отражения своих кадров не меняют состояние
+  for(const auto &frame : host::ir_sent())
+    host::ir_air_push_sent(frame);
+  loop_all(node, 500);
+  for(uint8_t i = 0; i < UNITS; i++)
+    CHECK_EQ(frames_sent(node, i), 1u);
+}
+
+//кадр пульта daikin применяют все daikin, dahatsu его пропускают
+TEST_CASE(remote_frame_reaches_its_protocol_only) {
+  Node node = make_node();
+
+  IRDaikin64 remote(0);
+  remote.setMode(kDaikin64Heat);
+  remote.setTemp(28);
+  remote.setPowerToggle(true);
+  host::ir_air_push_daikin64(remote.getRaw());
+  loop_all(node, 200);
+
+  //после make_node список публикаций пуст: dahatsu не публиковали ничего
+  for(uint8_t i = 0; i < UNITS; i++) {
+    auto message = global_mqtt_client->last(node.names[i] + "/i");
+    if(i % 2 == 1) {
+      CHECK(message == nullptr);
+      continue;
+    }
+    CHECK(message != nullptr);
+    if(message == nullptr)
+      continue;
+    DynamicJsonBuffer buffer;
+    JsonObject &state = buffer.parseObject(message->payload);
+    CHECK_STR(state["hvac"] | "", "heat");
+    CHECK_EQ(state["t"].as<int>(), 28);
+  }
+  CHECK(host::ir_sent().empty());
+}
+
+//с DECODE_HASH шум разбирается как UNKNOWN: приемник считает его неразобранным и не раздает драйверам
+TEST_CASE(hashed_noise_is_undecoded) {
+  ir_climate::IRReceiverHub hub(D5, 300, 80, 50);
+  hub.setup();
+  uint32_t frames = 0;
+  hub.add_on_frame_callback([&frames](const decode_results *) { frames++; });
+
+  //6 и больше значений rawbuf: библиотека возвращает хеш, короче - просто не разобран
+  host::ir_air_push({9000, 4500, 560, 1690, 560, 560, 560});
+  host::ir_air_push({9000, 4500, 560});
+  hub.loop();
+  hub.loop();
+
+  CHECK_EQ(frames, 0u);
+  CHECK_EQ(hub.get_undecoded_frames(), 2u);
+  CHECK_EQ(hub.get_duplicate_frames(), 0u);
+}
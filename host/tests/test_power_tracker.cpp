@@ -0,0 +1,143 @@
+//PowerTracker: подтверждение смены уровня по CUSUM, отсчетам и времени.
+
+#include "esphome.h"
+#include "shared_libs/PowerTracker.h"
+
+#include "test.h"
+
+namespace {
+
+struct Tracker {
+  PowerTracker tracker{20, 10, 20};
+  std::vector<float> callbacks;
+
+  explicit Tracker(float power) {
+    tracker.add_on_power_callback([this](float power) { callbacks.push_back(power); });
+    tracker.initialize(power, 0);
+  }
+
+  //главный цикл между отсчетами, шаг 16 мс
+  void run(uint32_t from, uint32_t to) {
+    for(uint32_t now = from; now < to; now += 16)
+      tracker.update(now);
+  }
+};
+
+}  // namespace
+
+TEST_CASE(rise_is_confirmed_by_one_sample) {
+  Tracker t(0);
+  t.tracker.set_power(600, 1000);
+  CHECK(t.tracker.power_on());
+  CHECK_EQ(t.callbacks.size(), 1u);
+}
+
+TEST_CASE(repeated_reading_confirms_drop) {
+  Tracker t(500);
+  t.tracker.set_power(0, 1000);
+  CHECK(t.tracker.power_on());
+
+  //тот же ноль еще раз - второй отсчет падения
+  t.tracker.set_power(0, 2000);
+  CHECK_EQ(t.tracker.power_on(), false);
+  CHECK_EQ(t.callbacks.size(), 1u);
+}
+
+TEST_CASE(single_drop_reading_is_confirmed_by_time) {
+  Tracker t(500);
+  t.tracker.set_power(0, 1000);
+  t.run(1000, 5900);
+  CHECK(t.tracker.power_on());
+
+  t.run(5900, 6100);
+  CHECK_EQ(t.tracker.power_on(), false);
+  CHECK_EQ(t.callbacks.size(), 1u);
+  CHECK_NEAR(t.callbacks[0], 0, 1e-6);
+}
+
+TEST_CASE(short_dip_is_not_power_off) {
+  Tracker t(650);
+  t.tracker.set_power(0, 1000);
+  t.run(1000, 2000);
+  t.tracker.set_power(655, 2000);
+  t.run(2000, 9000);
+
+  CHECK(t.tracker.power_on());
+  CHECK(t.tracker.is_power_stable());
+  CHECK(t.callbacks.empty());
+}
+
+TEST_CASE(small_drop_below_off_level_is_power_off) {
+  //38W -> 1W: меньше порога CUSUM, но переход через границу выключенного состояния
+  Tracker t(38);
+  t.tracker.set_power(1, 1000);
+  t.run(1000, 6100);
+
+  CHECK_EQ(t.tracker.power_on(), false);
+  CHECK_EQ(t.callbacks.size(), 1u);
+  CHECK_NEAR(t.callbacks[0], 1, 1e-6);
+}
+
+TEST_CASE(small_rise_above_off_level_is_power_on) {
+  Tracker t(1);
+  t.tracker.set_power(38, 1000);
+  CHECK(t.tracker.power_on());
+}
+
+TEST_CASE(unconfirmed_change_settles_on_last_sample) {
+  //300W -> 260W: меньше порога, уровень берется по таймауту - последний отсчет, а не сглаженное значение
+  Tracker t(300);
+  t.tracker.set_power(262, 1000);
+  t.run(1000, 2000);
+  t.tracker.set_power(260, 2000);
+  t.run(2000, 22100);
+
+  CHECK_EQ(t.callbacks.size(), 1u);
+  CHECK_NEAR(t.callbacks[0], 260, 1e-6);
+}
+
+TEST_CASE(noise_does_not_change_level) {
+  Tracker t(650);
+  const float readings[] = {660, 640, 670, 645, 655, 630, 668};
+  uint32_t now = 0;
+  for(float power : readings) {
+    now += 1000;
+    t.tracker.set_power(power, now);
+    t.run(now, now + 1000);
+  }
+
+  CHECK(t.callbacks.empty());
+  CHECK(t.tracker.power_on());
+}
+
+TEST_CASE(stable_level_is_rechecked_periodically) {
+  Tracker t(650);
+  t.run(0, 10100);
+  CHECK_EQ(t.callbacks.size(), 1u);
+  t.run(10100, 20200);
+  CHECK_EQ(t.callbacks.size(), 2u);
+  CHECK_NEAR(t.callbacks[1], 650, 1e-6);
+}
+
+TEST_CASE(nothing_before_initialize) {
+  PowerTracker tracker(20, 10, 20);
+  bool called = false;
+  tracker.add_on_power_callback([&called](float) { called = true; });
+  tracker.set_power(600, 1000);
+  tracker.update(60000);
+
+  CHECK_EQ(called, false);
+  CHECK_EQ(tracker.power_on(), false);
+}
+
+TEST_CASE(drop_confirmation_is_configurable) {
+  Tracker t(500);
+  t.tracker.set_drop_confirmation(3, 60000);
+  t.tracker.set_power(0, 1000);
+  t.tracker.set_power(0, 2000);
+  t.run(2000, 10000);
+  CHECK(t.tracker.power_on());
+
+  t.tracker.set_power(0, 10000);
+  CHECK_EQ(t.tracker.power_on(), false);
+}
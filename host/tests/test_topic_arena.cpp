@@ -0,0 +1,98 @@
+//TopicArena: буфер точного размера, смещения, защита от переполнения uint16 смещений,
+//память топиков компонента в арене против отдельных std::string по учету выделений.
+
+#include <cstdio>
+
+#include "esphome.h"
+#include "daikin/DaikinClimateComponent.h"
+
+#include "node.h"
+#include "test.h"
+
+TEST_CASE(arena_is_exactly_sized) {
+  const std::vector<std::string> topics = {"ac/m/c", "", "ac/i", "homeassistant/climate/ac/config"};
+  TopicArena arena;
+
+  const auto before = host::alloc_stats();
+  CHECK(arena.build(topics));
+  const auto after = host::alloc_stats();
+
+  //строки с нулями и таблица смещений, два выделения
+  CHECK_EQ(arena.size(), 7u + 1u + 5u + 32u);
+  CHECK_EQ(arena.memory_usage(), arena.size() + topics.size() * sizeof(uint16_t));
+  CHECK_EQ(after.live_bytes - before.live_bytes, arena.memory_usage());
+  CHECK_EQ(after.allocations - before.allocations, 2u);
+
+  CHECK_EQ(arena.count(), 4u);
+  CHECK_EQ(arena.offset(0), 0u);
+  CHECK_EQ(arena.offset(1), 7u);
+  CHECK_EQ(arena.offset(2), 8u);
+  CHECK_EQ(arena.offset(3), 13u);
+
+  for(uint8_t i = 0; i < topics.size(); i++)
+    CHECK_STR(arena.get(i), topics[i].c_str());
+  CHECK(arena.has(0));
+  CHECK(arena.has(1) == false);
+  CHECK(arena.has(4) == false);
+  CHECK_STR(arena.get(4), "");
+}
+
+//65535 байт со всеми нулями помещаются, на байт больше - нет, арена остается пустой
+TEST_CASE(arena_rejects_uint16_overflow) {
+  TopicArena arena;
+
+  std::vector<std::string> topics = {std::string(40000, 'a'), std::string(25533, 'b')};
+  CHECK(arena.build(topics));
+  CHECK_EQ(arena.size(), UINT16_MAX);
+  CHECK_EQ(arena.offset(1), 40001u);
+  CHECK_EQ(arena.get(1)[25532], 'b');
+
+  const auto before = host::alloc_stats();
+  topics[1].push_back('b');
+  CHECK(arena.build(topics) == false);
+  CHECK_EQ(arena.count(), 0u);
+  CHECK_EQ(arena.size(), 0u);
+  CHECK(arena.has(0) == false);
+  CHECK_STR(arena.get(0), "");
+  //прежний буфер освобожден
+  CHECK(host::alloc_stats().live_bytes < before.live_bytes);
+
+  CHECK(arena.build(std::vector<std::string>(256, "t")) == false);
+  CHECK(arena.build(std::vector<std::string>(255, "t")));
+  CHECK_EQ(arena.count(), 255u);
+}
+
+//топики компонента daikin со всеми необязательными топиками: арена против std::string на топик
+TEST_CASE(component_topics_savings) {
+  auto component = new mqtt_climate::DaikinClimateComponent(D5, D2, "bedroom_air_conditioner");
+  component->enable_compact_state_topic();
+  component->set_current_temperature_sensor("zigbee2mqtt/sensor_temp_hum_pre_bedroom", "temperature");
+  component->enable_thermostat(0.5, 1);
+  CHECK(host_node::start(component, "bedroom_air_conditioner/i"));
+
+  const TopicArena &arena = component->get_topics();
+  std::vector<std::string> topics;
+  for(uint8_t i = 0; i < arena.count(); i++)
+    topics.push_back(arena.get(i));
+
+  //как отдельные члены компонента: объект строки и ее буфер
+  std::vector<std::string *> strings;
+  strings.reserve(topics.size());
+  const auto reserved = host::alloc_stats();
+  for(const auto &topic : topics)
+    strings.push_back(new std::string(topic));
+  const uint64_t strings_bytes = host::alloc_stats().live_bytes - reserved.live_bytes;
+
+  const auto before = host::alloc_stats();
+  TopicArena copy;
+  CHECK(copy.build(topics));
+  const uint64_t arena_bytes = host::alloc_stats().live_bytes - before.live_bytes;
+
+  CHECK_EQ(arena_bytes, arena.memory_usage());
+  CHECK(arena_bytes < strings_bytes);
+  printf("%u topics: arena %llu B, std::string per topic %llu B\n", static_cast<unsigned>(topics.size()),
+         static_cast<unsigned long long>(arena_bytes), static_cast<unsigned long long>(strings_bytes));
+
+  for(auto string : strings)
+    delete string;
+}
@@ -0,0 +1,503 @@
+//Полный перебор состояний IRDahatsu: BFS от начального состояния по всем командам mqtt
+//(режим, обдув, swing, температура с шагом 0.5, turbo/eco/health/light), достигнутые состояния
+//запоминаются по упакованному ключу. Каждое состояние и каждый переход сверяются с таблицей
+//поведения режимов, прочитанной из dahatsu/README, сама таблица README - с MODE_RULES драйвера.
+//  dahatsu_verifier [путь к README]
+//Код возврата ненулевой при расхождении таблиц или нарушении правил.
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "esphome.h"
+#include "dahatsu/lib/IRDahatsu.h"
+
+using namespace ir_climate::dahatsu;
+
+namespace {
+
+//--- таблица README
+
+//раздел "Поведение режимов": заголовок "Cool(3):", дальше поля "  Turbo    : enabled (...)"
+std::vector<ModeRule> read_readme_rules(const char *path) {
+  std::ifstream file(path);
+  std::vector<ModeRule> rules;
+  const std::regex mode_line("^(\\w+)\\((\\d+)\\):.*");
+  const std::regex field_line("^\\s+(\\w+)\\s*:\\s*(.*)$");
+  const std::regex turbo_temp("Temp: (\\d+)C");
+  const std::regex turbo_fan("Fan: \\d+ \\((\\w+)\\)");
+  bool behaviour = false;
+
+  std::string line;
+  while(std::getline(file, line)) {
+    std::smatch match;
+    if(line.find("//Поведение режимов") == 0) {
+      behaviour = true;
+      continue;
+    }
+    if(behaviour == false)
+      continue;
+
+    if(std::regex_match(line, match, mode_line)) {
+      rules.push_back({static_cast<AC_MODE>(std::stoi(match[2])), 0, false, false, false, false, false, FAN_UNDEFINED, 0});
+      continue;
+    }
+    if(rules.empty() || std::regex_match(line, match, field_line) == false)
+      continue;
+
+    auto &rule = rules.back();
+    const std::string field = match[1];
+    const std::string value = match[2];
+    const bool enabled = value.find("enabled") == 0;
+
+    if(field == "fan_modes") {
+      const auto begin = value.find('[');
+      const auto end = value.find(']');
+      std::string names = begin == std::string::npos || end == std::string::npos ? "" : value.substr(begin + 1, end - begin - 1);
+      std::smatch name;
+      while(std::regex_search(names, name, std::regex("\\w+"))) {
+        const auto fan_mode = IRDahatsu::parse_fan_mode(name[0]);
+        if(fan_mode != FAN_UNDEFINED)
+          rule.fan_modes |= fan_bit(fan_mode);
+        names = name.suffix();
+      }
+    } else if(field == "set_temp") {
+      rule.set_temp = enabled;
+    } else if(field == "Health") {
+      rule.health = enabled;
+    } else if(field == "Light") {
+      rule.light = enabled;
+    } else if(field == "Econo") {
+      rule.eco = enabled;
+    } else if(field == "Turbo") {
+      rule.turbo = enabled;
+      if(std::regex_search(value, match, turbo_temp))
+        rule.turbo_temp = std::stoi(match[1]);
+      if(std::regex_search(value, match, turbo_fan)) {
+        std::string name = match[1];
+        for(auto &c : name)
+          c = tolower(c);
+        rule.turbo_fan = IRDahatsu::parse_fan_mode(name);
+      }
+    }
+  }
+
+  return rules;
+}
+
+bool same_rule(const ModeRule &a, const ModeRule &b) {
+  return a.mode == b.mode && a.fan_modes == b.fan_modes && a.set_temp == b.set_temp && a.health == b.health &&
+         a.light == b.light && a.turbo == b.turbo && a.eco == b.eco && a.turbo_fan == b.turbo_fan &&
+         a.turbo_temp == b.turbo_temp;
+}
+
+void print_rule(const char *source, const ModeRule &rule) {
+  printf("  %-10s %-8s fans: 0x%02x, set_temp: %u, health: %u, light: %u, turbo: %u (%s, %u), eco: %u\n", source,
+         IRDahatsu::mode_to_str(rule.mode), rule.fan_modes, rule.set_temp, rule.health, rule.light, rule.turbo,
+         IRDahatsu::fan_mode_to_str(rule.turbo_fan), rule.turbo_temp, rule.eco);
+}
+
+//таблица README и MODE_RULES драйвера: одни и те же режимы и значения
+bool compare_rules(const std::vector<ModeRule> &readme) {
+  bool same = readme.size() == sizeof(MODE_RULES) / sizeof(MODE_RULES[0]);
+
+  for(const auto &rule : MODE_RULES) {
+    const ModeRule *found = nullptr;
+    for(const auto &item : readme) {
+      if(item.mode == rule.mode)
+        found = &item;
+    }
+
+    if(found != nullptr && same_rule(*found, rule))
+      continue;
+
+    same = false;
+    printf("README and MODE_RULES differ for mode %s\n", IRDahatsu::mode_to_str(rule.mode));
+    print_rule("MODE_RULES", rule);
+    if(found != nullptr)
+      print_rule("README", *found);
+  }
+
+  return same;
+}
+
+//--- состояние драйвера
+
+struct View {
+  bool power;
+  AC_MODE mode;
+  FAN_MODE fan;
+  //температура с шагом 0.5, удвоенная
+  uint8_t temp2;
+  SWING_MODE swing;
+  bool turbo;
+  bool eco;
+  bool health;
+  bool light;
+  //состояние до turbo, только при включенном turbo - без него оно не используется
+  bool has_prev;
+  uint8_t prev_temp2;
+  FAN_MODE prev_fan;
+  SWING_MODE prev_swing;
+  uint8_t features;
+  uint16_t fan_modes;
+};
+
+View view(const IRDahatsu &ac) {
+  View state{};
+  state.power = ac.get_hvac_mode() != MODE_OFF;
+  state.mode = ac.get_mode();
+  state.fan = ac.get_fan();
+  state.temp2 = static_cast<uint8_t>(ac.get_temp() * 2);
+  state.swing = ac.get_swing_mode();
+  state.turbo = ac.get_turbo();
+  state.eco = ac.get_eco();
+  state.health = ac.get_health();
+  state.light = ac.get_light();
+
+  const auto prev = ac.get_prev_state();
+  if(state.turbo && prev != nullptr) {
+    state.has_prev = true;
+    state.prev_temp2 = static_cast<uint8_t>(prev->temp * 2);
+    state.prev_fan = prev->fan_mode;
+    state.prev_swing = prev->swing_mode;
+  }
+
+  state.features = (ac.light_allowed() ? CAP_LIGHT : 0) | (ac.turbo_allowed() ? CAP_TURBO : 0) |
+                   (ac.health_allowed() ? CAP_HEALTH : 0) | (ac.eco_allowed() ? CAP_ECO : 0) |
+                   (ac.set_temp_allowed() ? CAP_SET_TEMP : 0);
+  state.fan_modes = ac.get_fan_modes_mask();
+  return state;
+}
+
+//ключ состояния для BFS: 49 бит
+uint64_t pack(const View &state) {
+  uint64_t key = 0;
+  key |= (uint64_t) state.power;
+  key |= (uint64_t) (state.mode & 0x0F) << 1;
+  key |= (uint64_t) (state.fan & 0x0F) << 5;
+  key |= (uint64_t) state.temp2 << 9;
+  key |= (uint64_t) (state.swing & 1) << 17;
+  key |= (uint64_t) state.turbo << 18;
+  key |= (uint64_t) state.eco << 19;
+  key |= (uint64_t) state.health << 20;
+  key |= (uint64_t) state.light << 21;
+  key |= (uint64_t) state.has_prev << 22;
+  key |= (uint64_t) state.prev_temp2 << 23;
+  key |= (uint64_t) (state.prev_fan & 0x0F) << 31;
+  key |= (uint64_t) (state.prev_swing & 1) << 35;
+  key |= (uint64_t) (state.features & 0x1F) << 36;
+  key |= (uint64_t) (state.fan_modes & 0xFF) << 41;
+  return key;
+}
+
+void print_view(const char *label, const View &state) {
+  printf("    %-7s power: %u, mode: %s, fan: %s, temp: %.1f, swing: %s, turbo: %u, eco: %u, health: %u, light: %u",
+         label, state.power, IRDahatsu::mode_to_str(state.mode), IRDahatsu::fan_mode_to_str(state.fan),
+         state.temp2 * 0.5, IRDahatsu::swing_mode_to_str(state.swing), state.turbo, state.eco, state.health,
+         state.light);
+  if(state.has_prev)
+    printf(", prev: %.1f/%s/%s", state.prev_temp2 * 0.5, IRDahatsu::fan_mode_to_str(state.prev_fan),
+           IRDahatsu::swing_mode_to_str(state.prev_swing));
+  printf("\n");
+}
+
+//--- команды
+
+enum CommandKind : uint8_t { CMD_HVAC_MODE, CMD_FAN, CMD_SWING, CMD_TEMP, CMD_TURBO, CMD_ECO, CMD_HEALTH, CMD_LIGHT };
+
+struct Command {
+  CommandKind kind;
+  float value;
+};
+
+std::vector<Command> commands() {
+  std::vector<Command> all;
+  for(const auto mode : {MODE_OFF, MODE_HEAT, MODE_DRY, MODE_COOL, MODE_FAN, MODE_AUTO})
+    all.push_back({CMD_HVAC_MODE, static_cast<float>(mode)});
+  for(const auto fan : {FAN_AUTO, FAN_LOW, FAN_MEDIUM, FAN_HIGH})
+    all.push_back({CMD_FAN, static_cast<float>(fan)});
+  for(const auto swing : {SWING_OFF, SWING_HORIZONTAL})
+    all.push_back({CMD_SWING, static_cast<float>(swing)});
+  for(float temp = 16; temp <= 31; temp += 0.5f)
+    all.push_back({CMD_TEMP, temp});
+  for(const auto kind : {CMD_TURBO, CMD_ECO, CMD_HEALTH, CMD_LIGHT}) {
+    all.push_back({kind, 0});
+    all.push_back({kind, 1});
+  }
+  return all;
+}
+
+std::string command_to_string(const Command &command) {
+  char buffer[48];
+  switch(command.kind) {
+    case CMD_HVAC_MODE:
+      snprintf(buffer, sizeof(buffer), "set_hvac_mode(%s)", IRDahatsu::mode_to_str(static_cast<AC_MODE>(command.value)));
+      break;
+    case CMD_FAN:
+      snprintf(buffer, sizeof(buffer), "set_fan(%s)", IRDahatsu::fan_mode_to_str(static_cast<FAN_MODE>(command.value)));
+      break;
+    case CMD_SWING:
+      snprintf(buffer, sizeof(buffer), "set_swing_mode(%s)",
+               IRDahatsu::swing_mode_to_str(static_cast<SWING_MODE>(command.value)));
+      break;
+    case CMD_TEMP:
+      snprintf(buffer, sizeof(buffer), "set_temp(%.1f)", command.value);
+      break;
+    default:
+      static const char *const NAMES[] = {"set_turbo", "set_eco", "set_health", "set_light"};
+      snprintf(buffer, sizeof(buffer), "%s(%s)", NAMES[command.kind - CMD_TURBO], command.value != 0 ? "on" : "off");
+      break;
+  }
+  return buffer;
+}
+
+bool apply(IRDahatsu &ac, const Command &command) {
+  const bool on = command.value != 0;
+  switch(command.kind) {
+    case CMD_HVAC_MODE:
+      ac.set_hvac_mode(static_cast<AC_MODE>(command.value));
+      return true;
+    case CMD_FAN:
+      return ac.set_fan(static_cast<FAN_MODE>(command.value));
+    case CMD_SWING:
+      ac.set_swing_mode(static_cast<SWING_MODE>(command.value));
+      return true;
+    case CMD_TEMP:
+      return ac.set_temp(command.value);
+    case CMD_TURBO:
+      return ac.set_turbo(on);
+    case CMD_ECO:
+      return ac.set_eco(on);
+    case CMD_HEALTH:
+      return ac.set_health(on);
+    case CMD_LIGHT:
+      return ac.set_light(on);
+  }
+  return false;
+}
+
+//--- проверки
+
+class Verifier {
+ private:
+  std::vector<ModeRule> rules_;
+  std::map<std::string, uint64_t> violations_;
+  uint32_t printed_{0};
+
+  const ModeRule *rule_(const AC_MODE mode) const {
+    for(const auto &rule : this->rules_) {
+      if(rule.mode == mode)
+        return &rule;
+    }
+    return nullptr;
+  }
+
+  bool fail_(const char *what, const View *before, const Command *command, const View &after) {
+    if(this->violations_[what]++ != 0 || this->printed_++ >= 20)
+      return false;
+
+    printf("violation: %s\n", what);
+    if(before != nullptr)
+      print_view("before", *before);
+    if(command != nullptr)
+      printf("    %s\n", command_to_string(*command).c_str());
+    print_view("after", after);
+    return false;
+  }
+
+ public:
+  explicit Verifier(const std::vector<ModeRule> &rules) : rules_(rules) {}
+
+  const std::map<std::string, uint64_t> &violations() const { return this->violations_; }
+
+  //состояние само по себе: ограничения режима из README
+  void check_state(const View &state, const View *before = nullptr, const Command *command = nullptr) {
+    const auto rule = rule_(state.mode);
+    if(rule == nullptr) {
+      fail_("no README rule for mode", before, command, state);
+      return;
+    }
+
+    const uint8_t features = (rule->light ? CAP_LIGHT : 0) | (rule->turbo ? CAP_TURBO : 0) |
+                             (rule->health ? CAP_HEALTH : 0) | (rule->eco ? CAP_ECO : 0) |
+                             (rule->set_temp ? CAP_SET_TEMP : 0);
+    if(state.features != features || state.fan_modes != rule->fan_modes)
+      fail_("mode constraints differ from README", before, command, state);
+
+    //турбо в осушении ставит low, которого нет в списке режима
+    const bool turbo_fan = state.turbo && state.fan == rule->turbo_fan;
+    if((rule->fan_modes & fan_bit(state.fan)) == 0 && turbo_fan == false)
+      fail_("fan mode not allowed in mode", before, command, state);
+
+    if((state.health && rule->health == false) || (state.light && rule->light == false) ||
+       (state.eco && rule->eco == false) || (state.turbo && rule->turbo == false))
+      fail_("feature on in mode that disables it", before, command, state);
+
+    if(state.turbo && state.eco)
+      fail_("turbo and eco on together", before, command, state);
+
+    //смена обдува и температуры сбрасывает турбо, пока оно включено, значения должны быть турбо
+    if(state.turbo && rule->turbo && state.fan != rule->turbo_fan)
+      fail_("turbo without its fan mode", before, command, state);
+
+    if(state.turbo && rule->turbo_temp != 0 && state.temp2 != rule->turbo_temp * 2)
+      fail_("turbo without its temperature", before, command, state);
+
+    if(state.temp2 < 32 || state.temp2 > 62)
+      fail_("temperature out of range", before, command, state);
+  }
+
+  //переход: что команда должна сделать по README
+  void check_transition(const View &before, const Command &command, const bool result, const View &after) {
+    check_state(after, &before, &command);
+
+    const auto rule = rule_(before.mode);
+    if(rule == nullptr)
+      return;
+
+    const bool on = command.value != 0;
+    const bool changed = pack(before) != pack(after);
+
+    switch(command.kind) {
+      case CMD_HVAC_MODE: {
+        const auto mode = static_cast<AC_MODE>(command.value);
+        if(mode == MODE_OFF ? after.power : (after.power == false || after.mode != mode))
+          fail_("hvac mode not applied", &before, &command, after);
+        break;
+      }
+      case CMD_FAN:
+        if((rule->fan_modes & fan_bit(static_cast<FAN_MODE>(command.value))) == 0 && (result || changed))
+          fail_("fan mode not allowed by README was applied", &before, &command, after);
+        break;
+      case CMD_TEMP:
+        //set_temp disabled: команда не отправляется
+        if(result != rule->set_temp)
+          fail_("set_temp result differs from README", &before, &command, after);
+        //set_temp сбрасывает Turbo
+        if(rule->set_temp && before.turbo && before.temp2 != command.value * 2 && after.turbo)
+          fail_("set_temp kept turbo", &before, &command, after);
+        break;
+      case CMD_TURBO:
+        if(rule->turbo == false) {
+          if(result || changed)
+            fail_("turbo disabled by README was applied", &before, &command, after);
+          break;
+        }
+        if(on && before.turbo == false) {
+          //включение: значения турбо, Swing(H), сброс Econo, запоминаем что было
+          if(after.turbo == false || after.eco || after.swing != SWING_HORIZONTAL)
+            fail_("turbo on did not force its state", &before, &command, after);
+          if(after.has_prev == false || after.prev_temp2 != before.temp2 || after.prev_fan != before.fan ||
+             after.prev_swing != before.swing)
+            fail_("turbo on did not save previous state", &before, &command, after);
+        }
+        if(on == false && before.turbo && before.has_prev) {
+          //выключение возвращает состояние до turbo
+          const bool fan_allowed = (rule->fan_modes & fan_bit(before.prev_fan)) != 0;
+          if(after.turbo || after.swing != before.prev_swing || (fan_allowed && after.fan != before.prev_fan) ||
+             (rule->set_temp && after.temp2 != before.prev_temp2))
+            fail_("turbo off did not restore previous state", &before, &command, after);
+        }
+        break;
+      case CMD_ECO:
+        if(rule->eco == false) {
+          if(result || changed)
+            fail_("eco disabled by README was applied", &before, &command, after);
+          break;
+        }
+        //Econo сбрасывает Turbo
+        if(on && (after.eco == false || after.turbo))
+          fail_("eco on did not reset turbo", &before, &command, after);
+        break;
+      case CMD_HEALTH:
+      case CMD_LIGHT: {
+        const bool allowed = command.kind == CMD_HEALTH ? rule->health : rule->light;
+        const bool value = command.kind == CMD_HEALTH ? after.health : after.light;
+        if(allowed == false ? (result || changed) : value != on)
+          fail_("health/light differs from README", &before, &command, after);
+        break;
+      }
+      case CMD_SWING:
+        if(after.swing != static_cast<SWING_MODE>(command.value))
+          fail_("swing not applied", &before, &command, after);
+        break;
+    }
+  }
+
+  //достигнутое состояние должно пережить сохранение во flash
+  void check_restored(const uint64_t key, const bool restored, const View &actual) {
+    if(restored == false || pack(actual) != key)
+      fail_("reachable state does not survive restore_compact_state", nullptr, nullptr, actual);
+  }
+};
+
+struct Node {
+  IRDahatsu::CompactState state;
+  uint64_t key;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *readme_path = argc > 1 ? argv[1] : DAHATSU_README;
+  host::set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+
+  const auto readme = read_readme_rules(readme_path);
+  printf("%s: %u modes\n", readme_path, static_cast<unsigned>(readme.size()));
+  const bool rules_match = compare_rules(readme);
+
+  Verifier verifier(readme);
+  const auto all_commands = commands();
+
+  IRDahatsu ac(D5, D2);
+  std::unordered_set<uint64_t> visited;
+  std::deque<Node> queue;
+
+  const auto initial = view(ac);
+  verifier.check_state(initial);
+  visited.insert(pack(initial));
+  queue.push_back({ac.get_compact_state(), pack(initial)});
+
+  uint64_t transitions = 0;
+  const auto started_at = std::chrono::steady_clock::now();
+
+  while(queue.empty() == false) {
+    const Node node = queue.front();
+    queue.pop_front();
+
+    const bool restored = ac.restore_compact_state(node.state);
+    const View before = view(ac);
+    verifier.check_restored(node.key, restored, before);
+
+    for(const auto &command : all_commands) {
+      ac.restore_compact_state(node.state);
+      const bool result = apply(ac, command);
+      const View after = view(ac);
+      transitions++;
+
+      verifier.check_transition(before, command, result, after);
+
+      const uint64_t key = pack(after);
+      if(visited.insert(key).second)
+        queue.push_back({ac.get_compact_state(), key});
+    }
+  }
+
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+  printf("states: %u, transitions: %llu, commands: %u, time: %.2f s, states/s: %.0f, transitions/s: %.0f\n",
+         static_cast<unsigned>(visited.size()), static_cast<unsigned long long>(transitions),
+         static_cast<unsigned>(all_commands.size()), elapsed, visited.size() / elapsed, transitions / elapsed);
+
+  for(const auto &violation : verifier.violations())
+    printf("  %-56s %llu\n", violation.first.c_str(), static_cast<unsigned long long>(violation.second));
+
+  return rules_match && verifier.violations().empty() ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+//Разбор выгрузок с устройства для утилит и тестов на хосте.
+//Форматы описаны рядом с тем, кто их пишет: PWR1 - PowerSampleRecorder.h, IRC1 - IRRawCapture.h.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace dump_reader {
+
+struct PowerSample {
+  uint32_t time;
+  float power;
+};
+
+struct IRRecord {
+  uint32_t time;
+  //decode_type_t, -1 - кадр не разобран
+  int16_t decode_type;
+  uint16_t bits;
+  //mark, space, mark, ... в мкс
+  std::vector<uint32_t> timings;
+};
+
+class Reader {
+ private:
+  const std::string &data_;
+  size_t offset_;
+
+ public:
+  explicit Reader(const std::string &data) : data_(data), offset_(0) {}
+
+  bool magic(const char *magic) {
+    if(this->data_.compare(0, 4, magic) != 0)
+      return false;
+    this->offset_ = 4;
+    return true;
+  }
+
+  bool u16(uint16_t &value) {
+    if(this->offset_ + 2 > this->data_.size())
+      return false;
+    value = byte_(0) | (byte_(1) << 8);
+    this->offset_ += 2;
+    return true;
+  }
+
+  bool u32(uint32_t &value) {
+    uint16_t low, high;
+    if(u16(low) == false || u16(high) == false)
+      return false;
+    value = low | (static_cast<uint32_t>(high) << 16);
+    return true;
+  }
+
+  bool at_end() const { return this->offset_ == this->data_.size(); }
+
+ private:
+  uint32_t byte_(size_t index) const { return static_cast<uint8_t>(this->data_[this->offset_ + index]); }
+};
+
+//false - не PWR1, выгрузка обрезана или после отсчетов есть лишние байты
+inline bool read_pwr1(const std::string &data, std::vector<PowerSample> &samples) {
+  Reader reader(data);
+  uint32_t count;
+  if(reader.magic("PWR1") == false || reader.u32(count) == false)
+    return false;
+
+  samples.clear();
+  for(uint32_t i = 0; i < count; i++) {
+    PowerSample sample;
+    uint32_t power_bits;
+    if(reader.u32(sample.time) == false || reader.u32(power_bits) == false)
+      return false;
+    memcpy(&sample.power, &power_bits, sizeof(sample.power));
+    samples.push_back(sample);
+  }
+
+  return reader.at_end();
+}
+
+//false - не IRC1, выгрузка обрезана или после записей есть лишние байты
+inline bool read_irc1(const std::string &data, std::vector<IRRecord> &records) {
+  Reader reader(data);
+  uint16_t count;
+  if(reader.magic("IRC1") == false || reader.u16(count) == false)
+    return false;
+
+  records.clear();
+  for(uint16_t i = 0; i < count; i++) {
+    IRRecord record;
+    uint16_t decode_type, timings;
+    if(reader.u32(record.time) == false || reader.u16(decode_type) == false || reader.u16(record.bits) == false ||
+       reader.u16(timings) == false)
+      return false;
+    record.decode_type = static_cast<int16_t>(decode_type);
+
+    for(uint16_t j = 0; j < timings; j++) {
+      uint16_t us;
+      if(reader.u16(us) == false)
+        return false;
+      record.timings.push_back(us);
+    }
+    records.push_back(record);
+  }
+
+  return reader.at_end();
+}
+
+}  // namespace dump_reader
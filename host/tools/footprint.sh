@@ -0,0 +1,155 @@
+#!/usr/bin/env bash
+#Flash и RAM узлов ac_daikin.yaml и ac_dahatsu.yaml для нескольких ревизий, чтобы сравнить до и после изменения.
+#  host/tools/footprint.sh [--host] <rev> [<rev>...]
+#
+#Сборка прошивки: если есть esphome, каждая ревизия собирается esphome <yaml> compile,
+#размеры берутся из firmware.elf через xtensa-lx106-elf-size:
+#  flash = .irom0.text + .text + .data + .rodata, ram = .data + .rodata + .bss (rodata на ESP8266 лежит в DRAM).
+#
+#--host (или esphome не найден) - оценка на хосте: заголовки из includes yaml и лямбды custom_component и сенсора
+#собираются с заглушками host/stubs (g++ -Os, уровень логов INFO, --gc-sections), из размера вычитается пустая программа.
+#  text - код и константы компонентов, data/bss - статическая память, heap - куча после создания и setup().
+#Это оценка: x86-64 вместо xtensa, 8-байтовые указатели, заглушки вместо esphome и IRremoteESP8266.
+#Сравнивать имеет смысл ревизии между собой, а не с размером прошивки.
+
+set -euo pipefail
+
+HOST_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+REPO_ROOT="$(cd "$HOST_DIR/.." && pwd)"
+YAMLS=(ac_daikin.yaml ac_dahatsu.yaml)
+
+mode=firmware
+if [[ "${1:-}" == "--host" ]]; then
+  mode=host
+  shift
+fi
+if [[ $# -eq 0 ]]; then
+  echo "usage: $0 [--host] <rev> [<rev>...]" >&2
+  exit 2
+fi
+if [[ $mode == firmware ]] && ! command -v esphome >/dev/null; then
+  echo "esphome not found, host estimate" >&2
+  mode=host
+fi
+
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+
+#строки блока "lambda: |-" после строки-заголовка $2: все, что с отступом больше, чем у lambda
+lambda_body() {
+  awk -v section="$2" '
+    $0 ~ "^" section { in_section = 1; next }
+    in_section && /lambda: \|-/ { indent = match($0, /[^ ]/); in_lambda = 1; next }
+    in_lambda {
+      if ($0 ~ /^ *$/) { print; next }
+      if (match($0, /[^ ]/) <= indent) exit
+      print
+    }' "$1"
+}
+
+#список includes из секции esphome
+yaml_includes() {
+  awk '
+    /^  includes:/ { in_includes = 1; next }
+    in_includes && /^    - / { sub(/^    - /, ""); print; next }
+    in_includes { exit }' "$1"
+}
+
+host_measure() {
+  local root="$1" yaml="$2" out="$3"
+  local name
+  name="$(awk '/^  device_name:/ { print $2; exit }' "$root/$yaml")"
+
+  {
+    #библиотека IRremoteESP8266 из libraries: старые ревизии не подключали ее заголовки сами
+    printf '#include "%s"\n' esphome.h IRremoteESP8266.h IRrecv.h IRsend.h IRutils.h ir_Daikin.h ir_Tcl.h
+    yaml_includes "$root/$yaml" | sed 's/.*/#include "&"/'
+    cat <<'EOF'
+#include <cstdio>
+#include <vector>
+
+namespace {
+sensor::Sensor *footprint_power_sensor = nullptr;
+}
+#define id(x) footprint_##x
+
+std::vector<sensor::Sensor *> footprint_sensors() {
+EOF
+    lambda_body "$root/$yaml" "sensor:" | sed "s/\${device_name}/$name/g"
+    echo '}'
+    echo 'std::vector<Component *> footprint_components() {'
+    lambda_body "$root/$yaml" "custom_component:" | sed "s/\${device_name}/$name/g"
+    cat <<'EOF'
+}
+
+int main() {
+  const auto before = host::alloc_stats();
+  footprint_power_sensor = footprint_sensors()[0];
+  for(auto *component : footprint_components())
+    component->call_setup();
+  const auto after = host::alloc_stats();
+  printf("%llu\n", static_cast<unsigned long long>(after.live_bytes - before.live_bytes));
+  return 0;
+}
+EOF
+  } >"$out.cpp"
+
+  g++ $CXXFLAGS -I"$root" -c "$out.cpp" -o "$out.o"
+  g++ $CXXFLAGS -Wl,--gc-sections "$out.o" "$work/esphome_host.o" -o "$out"
+}
+
+host_sizes() {
+  #text data bss
+  size "$1" | awk 'NR == 2 { print $1, $2, $3 }'
+}
+
+firmware_measure() {
+  local root="$1" yaml="$2"
+  local name elf size_tool
+  name="$(awk '/^  device_name:/ { print $2; exit }' "$root/$yaml")"
+  [[ -f "$REPO_ROOT/secrets.yaml" ]] && cp "$REPO_ROOT/secrets.yaml" "$root/"
+  (cd "$root" && esphome "$yaml" compile >"$root/$name.log" 2>&1) || {
+    echo "esphome compile failed, see $root/$name.log" >&2
+    return 1
+  }
+  elf="$(find "$root/$name" -name firmware.elf | head -1)"
+  size_tool="$(find "$HOME/.platformio/packages" -name xtensa-lx106-elf-size -type f | head -1)"
+  "$size_tool" -A "$elf" | awk '
+    $1 == ".irom0.text" || $1 == ".text" { flash += $2 }
+    $1 == ".data" || $1 == ".rodata" { flash += $2; ram += $2 }
+    $1 == ".bss" { ram += $2 }
+    END { print flash, ram }'
+}
+
+if [[ $mode == host ]]; then
+  CXXFLAGS="-std=c++11 -Os -ffunction-sections -fdata-sections -DARDUINO_ARCH_ESP8266 -DESPHOME_LOG_LEVEL=3 \
+-I$HOST_DIR/stubs -w"
+  g++ $CXXFLAGS -c "$HOST_DIR/stubs/esphome_host.cpp" -o "$work/esphome_host.o"
+  echo 'int main() { return 0; }' >"$work/empty.cpp"
+  g++ $CXXFLAGS -Wl,--gc-sections "$work/empty.cpp" "$work/esphome_host.o" -o "$work/empty"
+  read -r base_text base_data base_bss < <(host_sizes "$work/empty")
+  printf "%-12s %-16s %10s %8s %8s %8s\n" rev yaml text data bss heap
+else
+  printf "%-12s %-16s %10s %10s\n" rev yaml flash ram
+fi
+
+for rev in "$@"; do
+  short="$(git -C "$REPO_ROOT" rev-parse --short "$rev")"
+  root="$work/$short"
+  mkdir -p "$root"
+  git -C "$REPO_ROOT" archive "$short" | tar -x -C "$root"
+
+  for yaml in "${YAMLS[@]}"; do
+    if [[ $mode == host ]]; then
+      out="$work/$short-${yaml%.yaml}"
+      host_measure "$root" "$yaml" "$out"
+      read -r text data bss < <(host_sizes "$out")
+      heap="$("$out")"
+      printf "%-12s %-16s %10d %8d %8d %8d\n" "$rev" "$yaml" $((text - base_text)) $((data - base_data)) \
+        $((bss - base_bss)) "$heap"
+    else
+      read -r flash ram < <(firmware_measure "$root" "$yaml")
+      printf "%-12s %-16s %10d %10d\n" "$rev" "$yaml" "$flash" "$ram"
+    fi
+  done
+done
@@ -0,0 +1,182 @@
+//Разбор выгрузки IRC1 с устройства (<name>/ir/d): каждая запись заново проходит через общий приемник и loop()
+//драйверов IRDaikin и IRDahatsu хоста - декодер, отсев повторов FrameDedup, проверка и применение состояния.
+//Протокол, который разобрал хост, сравнивается с тем, что записала прошивка.
+//  mosquitto_sub -h <broker> -t daikin/ir/d -C 1 > ir.bin & mosquitto_pub -h <broker> -t daikin/ir/c -m dump
+//  ir_replay ir.bin [-v]
+//-v - печатать тайминги. Код возврата 1, если разбор на хосте разошелся с устройством.
+//В конце - скорость прогона через loop() драйверов в кадрах в секунду по часам хоста.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "esphome.h"
+#include <IRrecv.h>
+#include "daikin/lib/IRDaikin.h"
+#include "dahatsu/lib/IRDahatsu.h"
+#include "dump_reader.h"
+
+namespace {
+
+const char *protocol_name(int16_t decode_type) { return typeToString(static_cast<decode_type_t>(decode_type)); }
+
+enum Outcome : uint8_t {
+  OUTCOME_UNDECODED = 0,
+  OUTCOME_DUPLICATE = 1,
+  OUTCOME_REJECTED = 2,
+  OUTCOME_APPLIED = 3,
+  OUTCOME_COUNT = 4,
+};
+
+const char *const OUTCOME_NAMES[OUTCOME_COUNT] = {"not decoded", "duplicate", "rejected", "applied"};
+
+//узел как в прошивке: один приемник, оба драйвера подписаны на его кадры
+struct Node {
+  ir_climate::IRReceiverHub *hub;
+  ir_climate::daikin::IRDaikin *daikin;
+  ir_climate::dahatsu::IRDahatsu *dahatsu;
+
+  //что увидел и сделал последний loop()
+  decode_results frame;
+  bool frame_seen{false};
+  const char *applied_by{nullptr};
+
+  Node() {
+    //буфер и таймаут с запасом: записи уже разделены на кадры прошивкой
+    hub = new ir_climate::IRReceiverHub(D5, 1024, 80, 50);
+    daikin = new ir_climate::daikin::IRDaikin(hub, D2);
+    dahatsu = new ir_climate::dahatsu::IRDahatsu(hub, D6);
+    daikin->setup();
+    dahatsu->setup();
+
+    hub->add_on_frame_callback([this](const decode_results *results) {
+      this->frame.decode_type = results->decode_type;
+      this->frame.bits = results->bits;
+      this->frame.value = results->value;
+      memcpy(this->frame.state, results->state, sizeof(this->frame.state));
+      this->frame_seen = true;
+    });
+    daikin->add_on_state_callback([this]() { this->applied_by = "daikin"; });
+    dahatsu->add_on_state_callback([this]() { this->applied_by = "dahatsu"; });
+  }
+
+  //кадр в эфир в момент записи и главный цикл, как на устройстве
+  Outcome replay(const dump_reader::IRRecord &record, uint64_t time_offset_us) {
+    const uint64_t at = time_offset_us + static_cast<uint64_t>(record.time) * 1000;
+    if(at > host::time_us())
+      host::set_time_us(at);
+
+    const uint32_t undecoded = this->hub->get_undecoded_frames();
+    const uint32_t duplicates = this->hub->get_duplicate_frames();
+    this->frame_seen = false;
+    this->applied_by = nullptr;
+
+    host::ir_air_push(record.timings);
+    this->daikin->loop();
+    this->dahatsu->loop();
+    host::ir_air().clear();
+
+    if(this->hub->get_undecoded_frames() != undecoded)
+      return OUTCOME_UNDECODED;
+    if(this->hub->get_duplicate_frames() != duplicates)
+      return OUTCOME_DUPLICATE;
+    return this->applied_by != nullptr ? OUTCOME_APPLIED : OUTCOME_REJECTED;
+  }
+};
+
+void print_state(const decode_results &results) {
+  if(results.decode_type == DAIKIN64) {
+    printf(" 0x%016llx", static_cast<unsigned long long>(results.value));
+    return;
+  }
+
+  printf(" ");
+  for(uint16_t i = 0; i < results.bits / 8; i++)
+    printf("%02X", results.state[i]);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s <ir.bin> [-v]\n", argv[0]);
+    return 2;
+  }
+  const bool verbose = argc > 2 && std::string(argv[2]) == "-v";
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  std::vector<dump_reader::IRRecord> records;
+  if(dump_reader::read_irc1(data, records) == false) {
+    fprintf(stderr, "%s: not an IRC1 dump or truncated\n", argv[1]);
+    return 1;
+  }
+
+  Node node;
+  uint32_t mismatches = 0;
+  uint32_t outcomes[OUTCOME_COUNT] = {};
+
+  for(const auto &record : records) {
+    printf("%10.3f  device %s(%d) %u bits, %zu timings; host", record.time / 1000.0, protocol_name(record.decode_type),
+           record.decode_type, record.bits, record.timings.size());
+
+    const Outcome outcome = node.replay(record, 0);
+    outcomes[outcome]++;
+
+    if(node.frame_seen) {
+      printf(" %s %u bits", typeToString(node.frame.decode_type), node.frame.bits);
+      print_state(node.frame);
+    }
+    printf(" %s", OUTCOME_NAMES[outcome]);
+    if(node.applied_by != nullptr)
+      printf(" by %s", node.applied_by);
+
+    //повтор отсеивается после декодера, протокол у него тот же, что у первого кадра
+    bool match;
+    if(outcome == OUTCOME_UNDECODED)
+      match = record.decode_type == UNKNOWN;
+    else if(outcome == OUTCOME_DUPLICATE)
+      match = record.decode_type != UNKNOWN;
+    else
+      match = node.frame.decode_type == record.decode_type && node.frame.bits == record.bits;
+
+    if(match == false) {
+      mismatches++;
+      printf("  MISMATCH");
+    }
+    printf("\n");
+
+    if(verbose) {
+      printf("           ");
+      for(size_t i = 0; i < record.timings.size(); i++)
+        printf("%s%u", i % 2 ? " -" : " +", record.timings[i]);
+      printf("\n");
+    }
+  }
+
+  printf("%zu records: %u applied, %u rejected, %u duplicates, %u not decoded; %u mismatches\n", records.size(),
+         outcomes[OUTCOME_APPLIED], outcomes[OUTCOME_REJECTED], outcomes[OUTCOME_DUPLICATE],
+         outcomes[OUTCOME_UNDECODED], mismatches);
+
+  //скорость: выгрузка по кругу на отдельном узле, каждый круг сдвинут во времени за окно повторов
+  if(records.empty() == false) {
+    Node bench;
+    const uint32_t passes = records.size() >= 200000 ? 1 : 200000 / records.size();
+    const uint64_t pass_us = (static_cast<uint64_t>(records.back().time) + 10000) * 1000;
+
+    const auto started_at = std::chrono::steady_clock::now();
+    for(uint32_t pass = 0; pass < passes; pass++) {
+      for(const auto &record : records)
+        bench.replay(record, pass * pass_us);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started_at).count();
+
+    const double frames = static_cast<double>(passes) * records.size();
+    printf("driver loop(): %.0f frames in %.3f s, %.0f frames/s\n", frames, seconds, frames / seconds);
+  }
+
+  return mismatches == 0 ? 0 : 1;
+}
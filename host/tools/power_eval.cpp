@@ -0,0 +1,295 @@
+//Офлайн оценка PowerTracker на синтетических трассах питания с известным состоянием кондиционера.
+//Для каждой трассы и модели датчика считаются задержка определения включения и выключения
+//и ложные переключения power_on(), для текущей версии и прежних (power_tracker_versions.h).
+//Трекеры вызываются так же, как их вызывал компонент своей версии: отсчеты из датчика и главный цикл каждые 16 мс.
+//Код возврата ненулевой, если текущая версия пропустила переключение или дала ложное.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "esphome.h"
+#include "shared_libs/PowerTracker.h"
+#include "power_tracker_versions.h"
+
+namespace {
+
+const uint32_t LOOP_STEP_MS = 16;
+
+//участок трассы: состояние кондиционера и потребление, провалы dip_level на dip_duration каждые dip_every
+struct Phase {
+  uint32_t duration_ms;
+  bool on;
+  float level;
+  float noise;
+  uint32_t dip_every_ms;
+  uint32_t dip_duration_ms;
+  float dip_level;
+};
+
+struct Scenario {
+  const char *name;
+  std::vector<Phase> phases;
+};
+
+const uint32_t MINUTE = 60000;
+
+std::vector<Scenario> scenarios() {
+  return {
+      {"cool_then_off", {{10 * MINUTE, true, 650, 15, 0, 0, 0},
+                         {10 * MINUTE, false, 0.8, 0.3, 0, 0, 0},
+                         {10 * MINUTE, true, 700, 15, 0, 0, 0},
+                         {5 * MINUTE, false, 0.8, 0.3, 0, 0, 0}}},
+      {"heat_with_defrost", {{10 * MINUTE, true, 900, 20, 0, 0, 0},
+                             {3 * MINUTE, true, 70, 5, 0, 0, 0},
+                             {10 * MINUTE, true, 900, 20, 0, 0, 0},
+                             {5 * MINUTE, false, 1, 0.3, 0, 0, 0}}},
+      {"fan_only_then_off", {{5 * MINUTE, true, 38, 3, 0, 0, 0},
+                             {5 * MINUTE, false, 1, 0.3, 0, 0, 0},
+                             {5 * MINUTE, true, 38, 3, 0, 0, 0}}},
+      //провалы датчика до нуля на одну секунду
+      {"sensor_glitches", {{30 * MINUTE, true, 650, 15, 2 * MINUTE, 1000, 0},
+                           {5 * MINUTE, false, 0.8, 0.3, 0, 0, 0}}},
+      //компрессор остановился по достижению температуры, работает только вентилятор
+      {"compressor_idle", {{5 * MINUTE, true, 650, 15, 0, 0, 0},
+                           {10 * MINUTE, true, 28, 2, 0, 0, 0},
+                           {5 * MINUTE, true, 650, 15, 0, 0, 0},
+                           {5 * MINUTE, false, 1, 0.3, 0, 0, 0}}},
+  };
+}
+
+//модель датчика: отсчет при изменении не меньше min_change не чаще min_interval, иначе раз в max_interval
+struct SensorModel {
+  const char *name;
+  float min_change;
+  uint32_t min_interval_ms;
+  uint32_t max_interval_ms;
+};
+
+const SensorModel SENSORS[] = {
+    {"on_change", 2, 1000, 300000},
+    {"every_10s", 0, 10000, 10000},
+};
+
+class Random {
+ private:
+  uint32_t state_;
+
+ public:
+  explicit Random(uint32_t seed) : state_(seed) {}
+
+  //-1..1
+  float next() {
+    this->state_ = this->state_ * 1664525u + 1013904223u;
+    return static_cast<float>(this->state_ >> 8) / static_cast<float>(1u << 23) - 1.0f;
+  }
+};
+
+struct Sample {
+  uint32_t time;
+  float power;
+};
+
+//истинное потребление раз в 100 мс и то, что из него отправит датчик
+std::vector<Sample> sensor_samples(const Scenario &scenario, const SensorModel &sensor, uint32_t seed) {
+  Random random(seed);
+  std::vector<Sample> samples;
+  uint32_t phase_start = 0;
+  float reported = NAN;
+  uint32_t reported_at = 0;
+
+  for(const auto &phase : scenario.phases) {
+    for(uint32_t t = 0; t < phase.duration_ms; t += 100) {
+      float power = phase.level + phase.noise * random.next();
+      if(phase.dip_every_ms != 0 && t % phase.dip_every_ms >= phase.dip_every_ms - phase.dip_duration_ms)
+        power = phase.dip_level;
+
+      const uint32_t now = phase_start + t;
+      const uint32_t since = now - reported_at;
+      const bool changed = isnan(reported) || std::fabs(power - reported) >= sensor.min_change;
+
+      if(isnan(reported) || (changed && since >= sensor.min_interval_ms) || since >= sensor.max_interval_ms) {
+        samples.push_back(Sample{now, power});
+        reported = power;
+        reported_at = now;
+      }
+    }
+    phase_start += phase.duration_ms;
+  }
+
+  return samples;
+}
+
+struct Metrics {
+  uint32_t on_changes{0};
+  uint32_t off_changes{0};
+  double on_latency_sum{0};
+  double off_latency_sum{0};
+  uint32_t off_latency_max{0};
+  uint32_t missed{0};
+  uint32_t false_toggles{0};
+  double hours{0};
+
+  void add(const Metrics &other) {
+    on_changes += other.on_changes;
+    off_changes += other.off_changes;
+    on_latency_sum += other.on_latency_sum;
+    off_latency_sum += other.off_latency_sum;
+    off_latency_max = std::max(off_latency_max, other.off_latency_max);
+    missed += other.missed;
+    false_toggles += other.false_toggles;
+    hours += other.hours;
+  }
+};
+
+//компонент текущей версии: отсчеты в set_power, update из loop
+struct CurrentDriver {
+  PowerTracker tracker{20, 10, 20};
+  void initialize(float power, uint32_t now) { tracker.initialize(power, now); }
+  void sample(float power, uint32_t now) { tracker.set_power(power, now); }
+  void loop(float, uint32_t now) { tracker.update(now); }
+  bool power_on() { return tracker.power_on(); }
+};
+
+//прежние версии берут время из millis(), виртуальные часы хоста выставлены на now
+//компонент вызывал set_power и из датчика, и каждый loop с последним значением
+struct CusumV1Driver {
+  PowerTrackerCusumV1 tracker{20, 10, 20};
+  void initialize(float power, uint32_t) { tracker.initialize(power); }
+  void sample(float power, uint32_t) { tracker.set_power(power); }
+  void loop(float last, uint32_t) { tracker.set_power(last); }
+  bool power_on() { return tracker.power_on(); }
+};
+
+struct CountersDriver {
+  PowerTrackerCounters tracker{20, 10, 20};
+  void initialize(float power, uint32_t) { tracker.initialize(power); }
+  void sample(float power, uint32_t) { tracker.set_power(power); }
+  void loop(float last, uint32_t) { tracker.set_power(last); }
+  bool power_on() { return tracker.power_on(); }
+};
+
+template<typename Driver> Metrics evaluate(const Scenario &scenario, const std::vector<Sample> &samples) {
+  host::set_time_us(0);
+  Driver driver;
+  Metrics metrics;
+
+  std::vector<uint32_t> boundaries;
+  uint32_t end = 0;
+  for(const auto &phase : scenario.phases) {
+    boundaries.push_back(end);
+    end += phase.duration_ms;
+  }
+  metrics.hours = end / 3600000.0;
+
+  driver.initialize(samples[0].power, 0);
+  size_t next_sample = 1;
+  float last = samples[0].power;
+
+  bool previous = driver.power_on();
+  size_t phase = 0;
+  //время, когда power_on() последний раз стал равен состоянию участка
+  uint32_t matched_at = 0;
+  bool matched = previous == scenario.phases[0].on;
+
+  auto close_phase = [&](size_t index) {
+    const bool truth = scenario.phases[index].on;
+    const bool changed = index > 0 && scenario.phases[index - 1].on != truth;
+    if(changed == false)
+      return;
+
+    if(matched == false) {
+      metrics.missed++;
+      return;
+    }
+
+    const uint32_t latency = matched_at > boundaries[index] ? matched_at - boundaries[index] : 0;
+    if(truth) {
+      metrics.on_changes++;
+      metrics.on_latency_sum += latency;
+    } else {
+      metrics.off_changes++;
+      metrics.off_latency_sum += latency;
+      metrics.off_latency_max = std::max(metrics.off_latency_max, latency);
+    }
+  };
+
+  for(uint32_t now = 0; now < end; now += LOOP_STEP_MS) {
+    host::set_time_us(static_cast<uint64_t>(now) * 1000);
+
+    while(phase + 1 < scenario.phases.size() && now >= boundaries[phase + 1]) {
+      close_phase(phase);
+      phase++;
+      matched = driver.power_on() == scenario.phases[phase].on;
+      matched_at = boundaries[phase];
+    }
+
+    while(next_sample < samples.size() && samples[next_sample].time <= now) {
+      last = samples[next_sample].power;
+      driver.sample(last, now);
+      next_sample++;
+    }
+
+    driver.loop(last, now);
+
+    const bool power_on = driver.power_on();
+    if(power_on != previous) {
+      const bool truth = scenario.phases[phase].on;
+      if(power_on != truth)
+        metrics.false_toggles++;
+      matched = power_on == truth;
+      matched_at = now;
+      previous = power_on;
+    }
+  }
+
+  close_phase(phase);
+  return metrics;
+}
+
+void print(const char *scenario, const char *sensor, const char *version, const Metrics &metrics) {
+  printf("%-18s %-10s %-9s %6.1f %6.1f %6.1f %6u %6u\n", scenario, sensor, version,
+         metrics.on_changes ? metrics.on_latency_sum / metrics.on_changes / 1000 : 0.0,
+         metrics.off_changes ? metrics.off_latency_sum / metrics.off_changes / 1000 : 0.0,
+         metrics.off_latency_max / 1000.0, metrics.missed, metrics.false_toggles);
+}
+
+}  // namespace
+
+int main() {
+  Metrics current_total, cusum_v1_total, counters_total;
+
+  printf("%-18s %-10s %-9s %6s %6s %6s %6s %6s\n", "trace", "sensor", "tracker", "on,s", "off,s", "offmax", "missed",
+         "false");
+
+  uint32_t seed = 1;
+  for(const auto &scenario : scenarios()) {
+    for(const auto &sensor : SENSORS) {
+      const auto samples = sensor_samples(scenario, sensor, seed++);
+
+      auto current = evaluate<CurrentDriver>(scenario, samples);
+      auto cusum_v1 = evaluate<CusumV1Driver>(scenario, samples);
+      auto counters = evaluate<CountersDriver>(scenario, samples);
+
+      print(scenario.name, sensor.name, "current", current);
+      print(scenario.name, sensor.name, "cusum_v1", cusum_v1);
+      print(scenario.name, sensor.name, "counters", counters);
+
+      current_total.add(current);
+      cusum_v1_total.add(cusum_v1);
+      counters_total.add(counters);
+    }
+  }
+
+  printf("\n%-9s %8s %8s %8s %8s %12s\n", "tracker", "on,s", "off,s", "offmax,s", "missed", "false/hour");
+  const std::pair<const char *, Metrics *> totals[] = {
+      {"current", &current_total}, {"cusum_v1", &cusum_v1_total}, {"counters", &counters_total}};
+  for(const auto &total : totals) {
+    const Metrics &m = *total.second;
+    printf("%-9s %8.1f %8.1f %8.1f %8u %12.2f\n", total.first, m.on_changes ? m.on_latency_sum / m.on_changes / 1000 : 0.0,
+           m.off_changes ? m.off_latency_sum / m.off_changes / 1000 : 0.0, m.off_latency_max / 1000.0, m.missed,
+           m.false_toggles / m.hours);
+  }
+
+  return current_total.missed == 0 && current_total.false_toggles == 0 ? 0 : 1;
+}
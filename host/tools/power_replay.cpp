@@ -0,0 +1,89 @@
+//Прогон выгрузки PWR1 с устройства (<name>/pwr/d) через PowerTracker так, как это делает компонент:
+//отсчеты в set_power со временем с устройства, update из главного цикла каждые 16 мс.
+//  mosquitto_sub -h <broker> -t daikin/pwr/d -C 1 > power.bin & mosquitto_pub -h <broker> -t daikin/pwr/c -m dump
+//  power_replay power.bin [-v]
+//Печатает подтвержденные уровни и переключения питания, -v - еще каждый отсчет и периодические проверки уровня.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "esphome.h"
+#include "shared_libs/PowerTracker.h"
+#include "dump_reader.h"
+
+namespace {
+
+const uint32_t LOOP_STEP_MS = 16;
+//после последнего отсчета: дождаться подтверждения по времени и таймаута стабильного уровня
+const uint32_t TAIL_MS = 25000;
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    fprintf(stderr, "usage: %s <power.bin> [-v]\n", argv[0]);
+    return 2;
+  }
+  const bool verbose = argc > 2 && std::string(argv[2]) == "-v";
+
+  std::ifstream file(argv[1], std::ios::binary);
+  const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  std::vector<dump_reader::PowerSample> samples;
+  if(file.fail() && data.empty()) {
+    fprintf(stderr, "%s: cannot read\n", argv[1]);
+    return 1;
+  }
+  if(dump_reader::read_pwr1(data, samples) == false) {
+    fprintf(stderr, "%s: not a PWR1 dump or truncated\n", argv[1]);
+    return 1;
+  }
+  if(samples.empty()) {
+    printf("no samples\n");
+    return 0;
+  }
+
+  //те же параметры, что у компонента
+  PowerTracker tracker(20, 10, 20);
+  uint32_t now = samples[0].time;
+  uint32_t levels = 0, toggles = 0;
+  bool power_on = false;
+
+  float level = samples[0].power;
+  tracker.add_on_power_callback([&](float power) {
+    levels++;
+    //периодическая проверка того же уровня - только с -v
+    if(verbose || power != level)
+      printf("%10.3f  level %.1f W%s\n", now / 1000.0, power, power != level ? "" : " (recheck)");
+    level = power;
+    if(tracker.power_on() != power_on) {
+      toggles++;
+      power_on = tracker.power_on();
+      printf("%10.3f  power %s\n", now / 1000.0, power_on ? "on" : "off");
+    }
+  });
+
+  tracker.initialize(samples[0].power, now);
+  power_on = tracker.power_on();
+  printf("%10.3f  initialize %.1f W, power %s\n", now / 1000.0, samples[0].power, power_on ? "on" : "off");
+
+  auto run_until = [&](uint32_t until) {
+    for(; static_cast<int32_t>(until - now) > 0; now += LOOP_STEP_MS)
+      tracker.update(now);
+    now = until;
+  };
+
+  for(size_t i = 1; i < samples.size(); i++) {
+    run_until(samples[i].time);
+    if(verbose)
+      printf("%10.3f  sample %.1f W\n", now / 1000.0, samples[i].power);
+    tracker.set_power(samples[i].power, now);
+  }
+  run_until(now + TAIL_MS);
+
+  printf("%zu samples over %.1f s, %u level callbacks, %u power toggles\n", samples.size(),
+         (samples.back().time - samples[0].time) / 1000.0, levels, toggles);
+  return 0;
+}
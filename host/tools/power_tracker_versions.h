@@ -0,0 +1,349 @@
+#pragma once
+
+//Прежние версии PowerTracker для сравнения в power_eval, код без изменений кроме имен классов:
+//  PowerTrackerCounters - счетчики роста и падения, до перехода на CUSUM
+//  PowerTrackerCusumV1 - первая версия CUSUM: повторы отсчетов не считались, по таймауту бралось сглаженное значение
+
+#include "esphome.h"
+
+class PowerTrackerCounters {
+ private:
+  enum PowerState : uint8_t {
+    UNKNOWN = 0,
+    DOWN = 1,
+    UP = 2,
+    STABLE =3,
+  };
+
+  float power_;
+  unsigned long power_time_;
+  unsigned long power_stable_time_;
+  unsigned long stable_power_timeout_;
+  bool initialized_{false};
+  uint16_t max_power_in_off_state_;
+  PowerState power_state_;
+  CallbackManager<void(float)> power_callback_{};
+
+  unsigned long increase_count_{0};
+  float increase_value_{0.0};
+
+  unsigned long decrease_count_{0};
+  float decrease_value_{0.0};
+  float stable_power_{0.0};
+
+ public:
+  PowerTrackerCounters(uint16_t power_stable_time_seconds, uint16_t stable_power_timeout_seconds, uint16_t max_power_in_off_state) {
+    power_time_ = millis();
+    //время через которое питание считается стабильным
+    power_stable_time_ = power_stable_time_seconds * 1000;
+    //текущее состояние питания
+    power_state_ = PowerState::UNKNOWN;
+    max_power_in_off_state_ = max_power_in_off_state;
+    stable_power_timeout_ = stable_power_timeout_seconds * 1000;
+  }
+
+  void add_on_power_callback(std::function<void(float)> &&callback) {
+    this->power_callback_.add(std::move(callback));
+  }
+
+  bool is_initialized() { return this->initialized_; }
+
+  void reset() { this->initialized_ = false; }
+
+  void initialize(float power) {
+    this->initialized_ = true;
+    set_stable_power_(power);
+  }
+
+  bool is_power_unknown() {
+    return this->power_state_ == PowerState::UNKNOWN;
+  }
+
+  bool is_power_stable() {
+    return this->power_state_ == PowerState::STABLE;
+  }
+
+  bool power_on() {
+    if(this->power_ > this->max_power_in_off_state_)
+      return true;
+
+    return false;
+  }
+
+  void set_power(float power) {
+
+    if(initialized_ == false)
+      return;
+
+    if (isnan(power))
+      return;
+
+    //если значения не равны, то ставим новое значение
+    if(power_ != power) {
+
+      if(power > this->power_) {
+        power_state_ = PowerState::UP;
+        increase_count_ += 1;
+        increase_value_ += power - power_;
+      }
+      else {
+        power_state_ = PowerState::DOWN;
+        decrease_count_ += 1;
+        decrease_value_ += power_ - power;
+      }
+
+      //если суммарно питание увеличилось на 100
+      if (power - stable_power_ > 100) {
+        set_stable_power_(power);
+        ESP_LOGD("power_tracker", "Питание увеличилось на: %.2fW, считаем его стабильным", (power - stable_power_ ));
+        power_callback_.call(power);
+        return;
+      }
+
+      float total_power_change = abs(increase_count_ * increase_value_ - decrease_count_ * decrease_value_);
+      auto changes_count = increase_count_ + decrease_count_;
+
+      if(changes_count > 4 && (total_power_change == 0 || total_power_change == abs(stable_power_ - power))) {
+        ESP_LOGD("power_tracker", "питание нестабильно, но стабильно изменяется");
+        set_stable_power_(power);
+        power_callback_.call(power);
+        return;
+      }
+
+      //если питание все возрастает
+      if(increase_count_ > 6) {
+        ESP_LOGD("power_tracker", "слишком много изменений");
+        set_stable_power_(power);
+        power_callback_.call(power);
+        return;
+      }
+
+      power_ = power;
+      power_time_ = millis();
+
+      ESP_LOGD("power_tracker","Отслеживаем питание: %.2f", this->power_);
+
+      return;
+    }
+
+    auto change_time = millis() - this->power_time_;
+
+    if(power_state_ == PowerState::STABLE) {
+
+      if(change_time >= this->stable_power_timeout_) {
+        ESP_LOGD("power_tracker","Питание %.2fW стабильное, проверка состояния", this->power_);
+        power_time_ = millis();
+        power_callback_.call(power);
+      }
+      return;
+    }
+
+    //т.е. состояние конечное, не было изменений в течении power_stable_time_ секунд
+    if(change_time >= power_stable_time_) {
+      ESP_LOGD("power_tracker", "Питание %.2fW стабильное", this->power_);
+      set_stable_power_(power);
+      power_callback_.call(power);
+    }
+  }
+
+ private:
+  void set_stable_power_(float power) {
+
+    ESP_LOGD("power_tracker", "stable_power: %.2f, increase_count: %ld, increase_value: %.2f, decrease_count: %ld, decrease_value: %.2f, new stable power: %.2f",
+             stable_power_,
+             increase_count_,
+             increase_value_,
+             decrease_count_,
+             decrease_value_,
+             power);
+
+    this->power_state_ = PowerState::STABLE;
+    this->power_time_ = millis();
+    this->stable_power_ = power;
+    this->power_ = power;
+
+    this->increase_count_ = 0;
+    this->increase_value_ = 0.0;
+    this->decrease_count_ = 0;
+    this->decrease_value_ = 0.0;
+  }
+};
+
+class PowerTrackerCusumV1 {
+ private:
+  enum PowerState : uint8_t {
+    UNKNOWN = 0,
+    DOWN = 1,
+    UP = 2,
+    STABLE =3,
+  };
+
+  float power_;
+  unsigned long power_time_;
+  unsigned long power_stable_time_;
+  unsigned long stable_power_timeout_;
+  bool initialized_{false};
+  uint16_t max_power_in_off_state_;
+  PowerState power_state_;
+  CallbackManager<void(float)> power_callback_{};
+
+  float stable_power_{0.0};
+  //экспоненциальное сглаживание отсчетов, используется если уровень не подтвердился по CUSUM
+  float smoothed_power_{0.0};
+  float smoothing_{0.3};
+
+  float cusum_up_{0.0};
+  float cusum_down_{0.0};
+  //отклонение от стабильного уровня, которое считаем шумом, W
+  float drift_{25.0};
+  //накопленное отклонение, после которого уровень считается изменившимся, W
+  float threshold_{100.0};
+  //сколько отсчетов подряд отклоняются в одну сторону
+  uint8_t run_length_{0};
+
+ public:
+  PowerTrackerCusumV1(uint16_t power_stable_time_seconds, uint16_t stable_power_timeout_seconds, uint16_t max_power_in_off_state) {
+    power_time_ = millis();
+    //время через которое питание считается стабильным
+    power_stable_time_ = power_stable_time_seconds * 1000;
+    //текущее состояние питания
+    power_state_ = PowerState::UNKNOWN;
+    max_power_in_off_state_ = max_power_in_off_state;
+    stable_power_timeout_ = stable_power_timeout_seconds * 1000;
+  }
+
+  void add_on_power_callback(std::function<void(float)> &&callback) {
+    this->power_callback_.add(std::move(callback));
+  }
+
+  void set_change_detection(float drift, float threshold) {
+    this->drift_ = drift;
+    this->threshold_ = threshold;
+  }
+
+  bool is_initialized() { return this->initialized_; }
+
+  void reset() { this->initialized_ = false; }
+
+  void initialize(float power) {
+    this->initialized_ = true;
+    set_stable_power_(power);
+  }
+
+  bool is_power_unknown() {
+    return this->power_state_ == PowerState::UNKNOWN;
+  }
+
+  bool is_power_stable() {
+    return this->power_state_ == PowerState::STABLE;
+  }
+
+  //решение принимается по подтвержденному уровню, а не по последнему отсчету
+  bool power_on() {
+    if(this->stable_power_ > this->max_power_in_off_state_)
+      return true;
+
+    return false;
+  }
+
+  void set_power(float power) {
+
+    if(initialized_ == false)
+      return;
+
+    if (isnan(power))
+      return;
+
+    //новый отсчет
+    if(power_ != power) {
+      add_sample_(power);
+      return;
+    }
+
+    auto change_time = millis() - this->power_time_;
+
+    if(power_state_ == PowerState::STABLE) {
+
+      if(change_time >= this->stable_power_timeout_) {
+        ESP_LOGD("power_tracker","Питание %.2fW стабильное, проверка состояния", this->stable_power_);
+        power_time_ = millis();
+        power_callback_.call(power);
+      }
+      return;
+    }
+
+    //уровень не подтвердился, но и не вернулся к стабильному в течении power_stable_time_ секунд
+    if(change_time >= power_stable_time_) {
+      ESP_LOGD("power_tracker", "Питание %.2fW стабильное", this->smoothed_power_);
+      set_stable_power_(this->smoothed_power_);
+      power_callback_.call(power);
+    }
+  }
+
+ private:
+  void add_sample_(float power) {
+    this->power_ = power;
+    this->smoothed_power_ += this->smoothing_ * (power - this->smoothed_power_);
+
+    const float deviation = power - this->stable_power_;
+    this->cusum_up_ = std::max(0.0f, this->cusum_up_ + deviation - this->drift_);
+    this->cusum_down_ = std::max(0.0f, this->cusum_down_ - deviation - this->drift_);
+
+    PowerState direction = PowerState::STABLE;
+    if(deviation > this->drift_)
+      direction = PowerState::UP;
+    else if(deviation < -this->drift_)
+      direction = PowerState::DOWN;
+
+    if(direction == PowerState::STABLE) {
+      //вернулись в полосу шума
+      this->run_length_ = 0;
+      if(this->power_state_ != PowerState::STABLE) {
+        this->power_state_ = PowerState::STABLE;
+        this->power_time_ = millis();
+      }
+      ESP_LOGD("power_tracker","Отслеживаем питание: %.2f, в пределах шума", power);
+      return;
+    }
+
+    if(direction != this->power_state_) {
+      this->power_state_ = direction;
+      this->power_time_ = millis();
+      this->run_length_ = 0;
+    }
+
+    if(this->run_length_ < UINT8_MAX)
+      this->run_length_++;
+
+    const bool level_up = this->cusum_up_ > this->threshold_;
+    const bool level_down = this->cusum_down_ > this->threshold_ && this->run_length_ >= 2;
+
+    if(level_up || level_down) {
+      ESP_LOGD("power_tracker", "Смена уровня питания: %.2fW -> %.2fW", this->stable_power_, power);
+      set_stable_power_(power);
+      power_callback_.call(power);
+      return;
+    }
+
+    ESP_LOGD("power_tracker","Отслеживаем питание: %.2f, cusum up: %.2f, down: %.2f", power, this->cusum_up_, this->cusum_down_);
+  }
+
+  void set_stable_power_(float power) {
+
+    ESP_LOGD("power_tracker", "stable_power: %.2f, cusum up: %.2f, cusum down: %.2f, new stable power: %.2f",
+             stable_power_,
+             cusum_up_,
+             cusum_down_,
+             power);
+
+    this->power_state_ = PowerState::STABLE;
+    this->power_time_ = millis();
+    this->stable_power_ = power;
+    this->smoothed_power_ = power;
+    this->power_ = power;
+
+    this->cusum_up_ = 0.0;
+    this->cusum_down_ = 0.0;
+    this->run_length_ = 0;
+  }
+};
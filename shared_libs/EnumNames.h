@@ -0,0 +1,139 @@
+#pragma once
+
+#include "esphome.h"
+
+namespace ir_climate {
+
+//значение, которое возвращается если строку распознать не удалось
+static const uint8_t ENUM_UNDEFINED = 0xFF;
+
+//ключ строки: первая буква без учета регистра и длина,
+//в каждой таблице ключи уникальны (проверяется static_assert рядом с таблицей)
+constexpr uint8_t enum_name_length_(const char *str) { return *str ? 1 + enum_name_length_(str + 1) : 0; }
+
+constexpr uint16_t enum_name_key_(const char first, const uint8_t length) {
+  return static_cast<uint16_t>(static_cast<uint8_t>(first | 0x20) << 8) | length;
+}
+
+//таблицы лежат во flash (PROGMEM), поля читаются через pgm_read_*,
+//сами строки - обычные литералы в ram: их указатели уходят в json и логи
+struct EnumName {
+  const char *name;
+  uint16_t key;
+  uint8_t value;
+
+  constexpr EnumName(const char *name, const uint8_t value)
+      : name(name), key(enum_name_key_(name[0], enum_name_length_(name))), value(value) {}
+};
+
+template<size_t N> constexpr bool enum_key_unique_(const EnumName (&names)[N], const size_t i, const size_t j) {
+  return j >= N ? true : names[i].key != names[j].key && enum_key_unique_(names, i, j + 1);
+}
+
+//все ключи таблицы разные - иначе парсер не сможет различить строки
+template<size_t N> constexpr bool enum_keys_unique(const EnumName (&names)[N], const size_t i = 0) {
+  return i >= N ? true : enum_key_unique_(names, i, i + 1) && enum_keys_unique(names, i + 1);
+}
+
+//идеальный хэш: ключ -> одна из ENUM_SLOTS ячеек, seed подбирается при компиляции так,
+//чтобы ключи таблицы не попадали в одну ячейку. Разбор строки - одна ячейка и одно сравнение.
+static const uint8_t ENUM_SLOTS = 16;
+static const uint8_t ENUM_NO_ENTRY = 0xFF;
+
+//мультипликативный хэш: старшие 4 бита произведения ключа на нечетный множитель,
+//множитель - константа Кнута, умноженная на нечетное число из seed
+constexpr uint8_t enum_slot_(const uint16_t key, const uint8_t seed) {
+  return static_cast<uint8_t>((static_cast<uint32_t>(key) * (0x9E3779B1u * (2u * seed + 1u))) >> 28);
+}
+
+template<size_t N>
+constexpr bool enum_slot_unique_(const EnumName (&names)[N], const uint8_t seed, const size_t i, const size_t j) {
+  return j >= N ? true
+                : enum_slot_(names[i].key, seed) != enum_slot_(names[j].key, seed) &&
+                      enum_slot_unique_(names, seed, i, j + 1);
+}
+
+template<size_t N> constexpr bool enum_slots_unique_(const EnumName (&names)[N], const uint8_t seed, const size_t i = 0) {
+  return i >= N ? true : enum_slot_unique_(names, seed, i, i + 1) && enum_slots_unique_(names, seed, i + 1);
+}
+
+//0 - подходящего seed нет
+template<size_t N> constexpr uint8_t enum_seed_(const EnumName (&names)[N], const uint16_t seed = 1) {
+  return seed > UINT8_MAX ? 0
+                          : enum_slots_unique_(names, static_cast<uint8_t>(seed)) ? static_cast<uint8_t>(seed)
+                                                                                  : enum_seed_(names, seed + 1);
+}
+
+template<size_t N>
+constexpr uint8_t enum_slot_entry_(const EnumName (&names)[N], const uint8_t seed, const uint8_t slot, const size_t i = 0) {
+  return i >= N ? ENUM_NO_ENTRY
+                : enum_slot_(names[i].key, seed) == slot ? static_cast<uint8_t>(i)
+                                                        : enum_slot_entry_(names, seed, slot, i + 1);
+}
+
+struct EnumIndex {
+  uint8_t seed;
+  //номер строки таблицы для ячейки или ENUM_NO_ENTRY
+  uint8_t slots[ENUM_SLOTS];
+};
+
+template<size_t... I> struct EnumSlotSequence {};
+
+template<size_t N, size_t... I> struct MakeEnumSlotSequence : MakeEnumSlotSequence<N - 1, N - 1, I...> {};
+
+template<size_t... I> struct MakeEnumSlotSequence<0, I...> {
+  typedef EnumSlotSequence<I...> type;
+};
+
+template<size_t N, size_t... I>
+constexpr EnumIndex enum_index_(const EnumName (&names)[N], const uint8_t seed, EnumSlotSequence<I...>) {
+  return EnumIndex{seed, {enum_slot_entry_(names, seed, static_cast<uint8_t>(I))...}};
+}
+
+//индекс строится при компиляции: static constexpr EnumIndex X_INDEX PROGMEM = enum_index(X_NAMES);
+template<size_t N> constexpr EnumIndex enum_index(const EnumName (&names)[N]) {
+  static_assert(N < ENUM_SLOTS, "enum table is larger than ENUM_SLOTS");
+  return enum_index_(names, enum_seed_(names), typename MakeEnumSlotSequence<ENUM_SLOTS>::type());
+}
+
+template<size_t N>
+inline const char *enum_to_str(const EnumName (&names)[N], const uint8_t value, const char *fallback) {
+  for (const auto &entry : names) {
+    if (pgm_read_byte(&entry.value) == value)
+      return static_cast<const char *>(pgm_read_ptr(&entry.name));
+  }
+
+  return fallback;
+}
+
+template<size_t N>
+inline uint8_t str_to_enum(const EnumName (&names)[N], const EnumIndex &index, const std::string &str,
+                           const uint8_t fallback) {
+  if (str.empty() || str.size() > UINT8_MAX)
+    return fallback;
+
+  const auto key = enum_name_key_(str[0], static_cast<uint8_t>(str.size()));
+  const auto entry = pgm_read_byte(&index.slots[enum_slot_(key, pgm_read_byte(&index.seed))]);
+
+  if (entry == ENUM_NO_ENTRY || pgm_read_word(&names[entry].key) != key)
+    return fallback;
+
+  const auto name = static_cast<const char *>(pgm_read_ptr(&names[entry].name));
+  return strncasecmp(name, str.c_str(), str.size()) == 0 ? pgm_read_byte(&names[entry].value) : fallback;
+}
+
+static constexpr EnumName ON_OFF_NAMES[] PROGMEM = {
+    {"on", 1},
+    {"off", 0},
+    {"true", 1},
+    {"false", 0}};
+static_assert(enum_keys_unique(ON_OFF_NAMES), "ON_OFF_NAMES: first letter and length must be unique");
+static constexpr EnumIndex ON_OFF_INDEX PROGMEM = enum_index(ON_OFF_NAMES);
+static_assert(ON_OFF_INDEX.seed != 0, "ON_OFF_NAMES: no perfect hash seed");
+
+//"on"/"true" -> 1, "off"/"false" -> 0, иначе ENUM_UNDEFINED
+inline uint8_t parse_on_off(const std::string &str) {
+  return str_to_enum(ON_OFF_NAMES, ON_OFF_INDEX, str, ENUM_UNDEFINED);
+}
+
+}  // namespace ir_climate
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "esphome.h"
+
+namespace ir_climate {
+
+//Кэш последних принятых и отправленных кадров.
+//Одинаковый кадр в течении окна (удержание кнопки, повтор кадра, отражение нашей же отправки)
+//не применяется повторно. Каждое совпадение продлевает окно, пока кадры идут подряд.
+class FrameDedup {
+ private:
+  static const uint8_t SIZE = 4;
+
+  struct Entry {
+    uint32_t hash;
+    uint32_t time;
+    bool used;
+  };
+
+  Entry entries_[SIZE]{};
+  uint8_t next_{0};
+  uint32_t window_;
+  uint32_t dropped_{0};
+
+ public:
+  explicit FrameDedup(uint32_t window_ms = 500) : window_(window_ms) {}
+
+  //FNV-1a
+  static uint32_t hash(const uint8_t *data, uint16_t length) {
+    uint32_t hash = 2166136261UL;
+    for(uint16_t i = 0; i < length; i++) {
+      hash ^= data[i];
+      hash *= 16777619UL;
+    }
+    return hash;
+  }
+
+  //true - такой кадр уже был в течении окна, кадр нужно пропустить
+  bool is_duplicate(uint32_t hash, uint32_t now) {
+    for(auto &entry : this->entries_) {
+      if(entry.used && entry.hash == hash && (now - entry.time) < this->window_) {
+        entry.time = now;
+        this->dropped_++;
+        return true;
+      }
+    }
+
+    remember(hash, now);
+    return false;
+  }
+
+  //отправленный кадр, его отражение не должно считаться командой с пульта
+  void remember(uint32_t hash, uint32_t now) {
+    for(auto &entry : this->entries_) {
+      if(entry.used && entry.hash == hash) {
+        entry.time = now;
+        return;
+      }
+    }
+
+    this->entries_[this->next_] = Entry{hash, now, true};
+    this->next_ = (this->next_ + 1) % SIZE;
+  }
+
+  void set_window(uint32_t window_ms) { this->window_ = window_ms; }
+
+  uint32_t get_dropped() const { return this->dropped_; }
+};
+
+}  // namespace ir_climate
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "esphome.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_heap_caps.h>
+#endif
+
+namespace heap_diagnostics {
+
+//Диагностика памяти: свободная куча, самый большой свободный блок, фрагментация, остаток стека
+//и статистика по горячим местам (publish_json, обработчики subscribe_json, кодирование и запуск ir кадра).
+//Модуль необязательный: пока экземпляр не создан, замеры HeapProbe ничего не делают.
+//
+//Подключение в yaml:
+//  sensor:
+//  - platform: custom
+//    lambda: |-
+//      auto diagnostics = new heap_diagnostics::HeapDiagnostics("${device_name}", 60000);
+//      App.register_component(diagnostics);
+//      return {diagnostics->free_heap_sensor, diagnostics->max_free_block_sensor, diagnostics->fragmentation_sensor};
+//
+//Раз в интервал публикуется json в <name>/diag:
+//  heap, block, frag, stack - текущие значения, min_heap/max_frag/min_stack - худшие с момента загрузки
+//  pj, sj, ir - замеры (sj - разбор json вместе с обработчиком): n - вызовов, ret - максимум памяти, оставшейся занятой после вызова,
+//               min_heap - минимум свободной кучи после вызова, max_frag - максимальная фрагментация после вызова
+enum Probe : uint8_t {
+  PROBE_PUBLISH_JSON = 0,
+  PROBE_SUBSCRIBE_JSON = 1,
+  PROBE_IR_SEND = 2,
+  PROBE_COUNT = 3,
+};
+
+static const char *const PROBE_NAMES[PROBE_COUNT] = {"pj", "sj", "ir"};
+
+struct ProbeStats {
+  uint32_t calls{0};
+  uint32_t max_retained{0};
+  uint32_t min_free_heap{UINT32_MAX};
+  uint8_t max_fragmentation{0};
+};
+
+inline uint32_t free_heap() { return ESP.getFreeHeap(); }
+
+inline uint32_t max_free_block() {
+#ifdef ARDUINO_ARCH_ESP8266
+  return ESP.getMaxFreeBlockSize();
+#elif defined(ARDUINO_ARCH_ESP32)
+  return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+#else
+  return 0;
+#endif
+}
+
+//0 - вся свободная память одним блоком, 100 - сильно раздроблена
+inline uint8_t fragmentation() {
+#ifdef ARDUINO_ARCH_ESP8266
+  return ESP.getHeapFragmentation();
+#else
+  uint32_t heap = free_heap();
+  if(heap == 0)
+    return 0;
+  return 100 - (max_free_block() * 100) / heap;
+#endif
+}
+
+//минимум свободного стека за все время работы
+inline uint32_t free_stack() {
+#ifdef ARDUINO_ARCH_ESP8266
+  return ESP.getFreeContStack();
+#elif defined(ARDUINO_ARCH_ESP32)
+  return uxTaskGetStackHighWaterMark(nullptr);
+#else
+  return 0;
+#endif
+}
+
+class HeapDiagnostics;
+
+//созданный экземпляр, nullptr если диагностика не подключена.
+//Статическая переменная функции, чтобы во всех единицах трансляции был один экземпляр
+inline HeapDiagnostics *&global_heap_diagnostics() {
+  static HeapDiagnostics *instance = nullptr;
+  return instance;
+}
+
+class HeapDiagnostics : public PollingComponent {
+ private:
+  std::string topic_;
+  ProbeStats probes_[PROBE_COUNT];
+  uint32_t min_free_heap_{UINT32_MAX};
+  uint8_t max_fragmentation_{0};
+  uint32_t min_free_stack_{UINT32_MAX};
+
+ public:
+  sensor::Sensor *free_heap_sensor = new sensor::Sensor();
+  sensor::Sensor *max_free_block_sensor = new sensor::Sensor();
+  sensor::Sensor *fragmentation_sensor = new sensor::Sensor();
+
+  HeapDiagnostics(const std::string &name, uint32_t update_interval) : PollingComponent(update_interval) {
+    this->topic_ = sanitize_string_whitelist(name, HOSTNAME_CHARACTER_WHITELIST) + "/diag";
+    global_heap_diagnostics() = this;
+  }
+
+  void record(Probe probe, uint32_t heap_before) {
+    ProbeStats &stats = this->probes_[probe];
+    uint32_t heap_after = free_heap();
+    uint8_t frag = fragmentation();
+
+    stats.calls++;
+
+    if(heap_before > heap_after && heap_before - heap_after > stats.max_retained)
+      stats.max_retained = heap_before - heap_after;
+
+    if(heap_after < stats.min_free_heap)
+      stats.min_free_heap = heap_after;
+
+    if(frag > stats.max_fragmentation)
+      stats.max_fragmentation = frag;
+
+    sample_();
+  }
+
+  void update() override {
+    sample_();
+
+    uint32_t heap = free_heap();
+    uint32_t block = max_free_block();
+    uint8_t frag = fragmentation();
+
+    this->free_heap_sensor->publish_state(heap);
+    this->max_free_block_sensor->publish_state(block);
+    this->fragmentation_sensor->publish_state(frag);
+
+    if(global_mqtt_client == nullptr || global_mqtt_client->is_connected() == false)
+      return;
+
+    global_mqtt_client->publish_json(this->topic_, [this, heap, block, frag](JsonObject &root) {
+      root["heap"] = heap;
+      root["block"] = block;
+      root["frag"] = frag;
+      root["stack"] = free_stack();
+      root["min_heap"] = this->min_free_heap_;
+      root["max_frag"] = this->max_fragmentation_;
+      root["min_stack"] = this->min_free_stack_;
+
+      for(uint8_t i = 0; i < PROBE_COUNT; i++) {
+        const ProbeStats &stats = this->probes_[i];
+        if(stats.calls == 0)
+          continue;
+
+        JsonObject &probe = root.createNestedObject(PROBE_NAMES[i]);
+        probe["n"] = stats.calls;
+        probe["ret"] = stats.max_retained;
+        probe["min_heap"] = stats.min_free_heap;
+        probe["max_frag"] = stats.max_fragmentation;
+      }
+    });
+  }
+
+  float get_setup_priority() const override { return setup_priority::AFTER_CONNECTION; }
+
+ private:
+  void sample_() {
+    uint32_t heap = free_heap();
+    uint8_t frag = fragmentation();
+    uint32_t stack = free_stack();
+
+    if(heap < this->min_free_heap_)
+      this->min_free_heap_ = heap;
+
+    if(frag > this->max_fragmentation_)
+      this->max_fragmentation_ = frag;
+
+    if(stack < this->min_free_stack_)
+      this->min_free_stack_ = stack;
+  }
+};
+
+//Замер вокруг участка кода: свободная куча до, после выхода из области видимости - запись в статистику
+class HeapProbe {
+ private:
+  Probe probe_;
+  uint32_t heap_before_{0};
+
+ public:
+  explicit HeapProbe(Probe probe) : probe_(probe) {
+    if(global_heap_diagnostics() != nullptr)
+      this->heap_before_ = free_heap();
+  }
+
+  ~HeapProbe() {
+    if(global_heap_diagnostics() != nullptr)
+      global_heap_diagnostics()->record(this->probe_, this->heap_before_);
+  }
+};
+
+}  // namespace heap_diagnostics
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "esphome.h"
+#include <IRrecv.h>
+
+namespace ir_climate {
+
+//Запись сырых таймингов принятых кадров, и разобранных, и тех, что разобрать не удалось.
+//Записи лежат подряд в буфере фиксированного размера, при нехватке места удаляются самые старые.
+//
+//Формат выгрузки (little-endian):
+//  char[4]  magic "IRC1"
+//  uint16   количество записей N
+//  N раз:
+//    uint32 время приема, ms (millis())
+//    int16  decode_type_t, -1 (UNKNOWN) - кадр не разобран
+//    uint16 количество бит разобранного кадра, 0 если не разобран
+//    uint16 количество таймингов M
+//    M раз:
+//      uint16 длительность, us: mark, space, mark, ... (первый интервал до кадра не пишется)
+class IRRawCapture {
+ private:
+  static const uint8_t RECORD_HEADER_SIZE = 10;
+
+  std::vector<uint8_t> buffer_;
+  size_t used_{0};
+  uint16_t records_{0};
+
+ public:
+  explicit IRRawCapture(uint16_t capacity_bytes) { buffer_.resize(capacity_bytes); }
+
+  void add(const decode_results *results, bool decoded) {
+    //rawbuf[0] - пауза перед кадром
+    uint16_t timings = results->rawlen > 1 ? results->rawlen - 1 : 0;
+    size_t record_size = RECORD_HEADER_SIZE + timings * 2;
+
+    if(record_size > this->buffer_.size()) {
+      ESP_LOGW("ir.capture", "кадр из %u таймингов не помещается в буфер", timings);
+      return;
+    }
+
+    while(this->used_ + record_size > this->buffer_.size())
+      drop_oldest_();
+
+    uint8_t *record = this->buffer_.data() + this->used_;
+    put_u32_(record, millis());
+    put_u16_(record + 4, static_cast<uint16_t>(static_cast<int16_t>(decoded ? results->decode_type : decode_type_t::UNKNOWN)));
+    put_u16_(record + 6, decoded ? results->bits : 0);
+    put_u16_(record + 8, timings);
+
+    for(uint16_t i = 0; i < timings; i++) {
+      uint32_t us = results->rawbuf[i + 1] * kRawTick;
+      put_u16_(record + RECORD_HEADER_SIZE + i * 2, us > UINT16_MAX ? UINT16_MAX : us);
+    }
+
+    this->used_ += record_size;
+    this->records_++;
+  }
+
+  void clear() {
+    this->used_ = 0;
+    this->records_ = 0;
+  }
+
+  uint16_t size() const { return this->records_; }
+
+  std::string dump() const {
+    std::string payload;
+    payload.reserve(6 + this->used_);
+    payload.append("IRC1", 4);
+    payload.push_back(static_cast<char>(this->records_ & 0xFF));
+    payload.push_back(static_cast<char>(this->records_ >> 8));
+    payload.append(reinterpret_cast<const char *>(this->buffer_.data()), this->used_);
+    return payload;
+  }
+
+ private:
+  void drop_oldest_() {
+    const uint8_t *record = this->buffer_.data();
+    size_t record_size = RECORD_HEADER_SIZE + (record[8] | (record[9] << 8)) * 2;
+
+    memmove(this->buffer_.data(), this->buffer_.data() + record_size, this->used_ - record_size);
+    this->used_ -= record_size;
+    this->records_--;
+  }
+
+  static void put_u16_(uint8_t *dest, uint16_t value) {
+    dest[0] = value & 0xFF;
+    dest[1] = value >> 8;
+  }
+
+  static void put_u32_(uint8_t *dest, uint32_t value) {
+    put_u16_(dest, value & 0xFFFF);
+    put_u16_(dest + 2, value >> 16);
+  }
+};
+
+}  // namespace ir_climate
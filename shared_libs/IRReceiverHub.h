@@ -0,0 +1,99 @@
+#pragma once
+
+#include "esphome.h"
+#include <IRrecv.h>
+
+#include "FrameDedup.h"
+#include "IRRawCapture.h"
+
+namespace ir_climate {
+
+//Общий ИК приемник: один IRrecv и один буфер decode_results на узел, кадры раздаются всем
+//подписанным драйверам. Так несколько кондиционеров работают от одного приемника,
+//у каждого остается свой пин передатчика.
+//Кадры одного протокола получают все драйверы этого протокола - у них общий пульт.
+class IRReceiverHub {
+ private:
+  IRrecv* ir_receiver_;
+  decode_results* decode_results_;
+  CallbackManager<void(const decode_results *)> frame_callback_{};
+  //повторы кадров с пульта и отражения отправок всех драйверов
+  FrameDedup frame_dedup_{};
+  bool enabled_{false};
+  //необязательная запись сырых таймингов
+  IRRawCapture* capture_{nullptr};
+  uint32_t undecoded_frames_{0};
+
+ public:
+  IRReceiverHub(uint16_t receiver_pin, uint16_t buffer_size, uint8_t timeout, uint8_t tolerance) {
+    ir_receiver_ = new IRrecv(receiver_pin, buffer_size, timeout, true);
+    ir_receiver_->setTolerance(tolerance);
+    decode_results_ = new decode_results();
+  }
+
+  void add_on_frame_callback(std::function<void(const decode_results *)> &&callback) {
+    this->frame_callback_.add(std::move(callback));
+  }
+
+  //драйверы вызывают setup и loop каждый из своего, приемник включается один раз
+  void setup() {
+    if(this->enabled_)
+      return;
+
+    this->enabled_ = true;
+    ir_receiver_->enableIRIn();
+  }
+
+  void loop() {
+    //decode не трогает decode_results без принятого кадра, по rawlen отличаем неразобранный кадр от его отсутствия
+    decode_results_->rawlen = 0;
+
+    //с DECODE_HASH (по умолчанию в библиотеке) шум и чужие пульты разбираются как UNKNOWN с хешем таймингов,
+    //для драйверов это тоже неразобранный кадр
+    if (ir_receiver_->decode(decode_results_) == false || decode_results_->decode_type == decode_type_t::UNKNOWN) {
+      if(decode_results_->rawlen == 0)
+        return;
+
+      this->undecoded_frames_++;
+      ESP_LOGD("ir.receiver", "кадр не разобран, таймингов: %u, всего не разобрано: %u", decode_results_->rawlen, this->undecoded_frames_);
+
+      if(this->capture_ != nullptr)
+        this->capture_->add(decode_results_, false);
+      return;
+    }
+
+    if(this->capture_ != nullptr)
+      this->capture_->add(decode_results_, true);
+
+    if(this->frame_dedup_.is_duplicate(frame_hash(decode_results_), millis())) {
+      ESP_LOGD("ir.receiver", "повтор кадра пропущен, всего пропущено: %u", this->frame_dedup_.get_dropped());
+      return;
+    }
+
+    frame_callback_.call(decode_results_);
+  }
+
+  //приемник выключается на время отправки любым драйвером
+  void pause() { ir_receiver_->disableIRIn(); }
+
+  void resume() { ir_receiver_->enableIRIn(); }
+
+  //отправленный кадр, его отражение не применяем
+  void remember_sent(uint32_t hash) { this->frame_dedup_.remember(hash, millis()); }
+
+  void set_capture(IRRawCapture* capture) { this->capture_ = capture; }
+
+  uint32_t get_undecoded_frames() const { return this->undecoded_frames_; }
+
+  uint32_t get_duplicate_frames() const { return this->frame_dedup_.get_dropped(); }
+
+  //кадры до 64 бит лежат в value, длиннее - побайтно в state
+  static uint32_t frame_hash(const decode_results *results) {
+    if(results->bits > 64)
+      return FrameDedup::hash(results->state, std::min<uint16_t>(results->bits / 8, sizeof(results->state)));
+
+    return FrameDedup::hash(reinterpret_cast<const uint8_t *>(&results->value), sizeof(results->value));
+  }
+};
+
+}  // namespace ir_climate
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "esphome.h"
+
+namespace ir_climate {
+
+//Отправка ИК кадра по прерываниям аппаратного timer1, главный цикл не ждет конца кадра.
+//Драйвер кодирует кадр в тайминги (mark, space, mark, ...) через mark/space/data, вызывает start()
+//и в loop() проверяет is_busy(). Прерывание на mark переключает несущую каждые полпериода,
+//на space - одно прерывание в конце паузы. После последнего mark передатчик остается занятым
+//на trailing_gap - паузу между кадрами протокола.
+//
+//timer1 на узле один, поэтому в эфире одновременно только один кадр: start() другого передатчика
+//возвращает false, пока первый не закончит, драйвер повторяет попытку из следующего loop().
+//timer1 не должен использоваться ничем еще: на ESP8266 его занимают analogWrite, tone и Servo.
+class IRTransmitter {
+ public:
+  //TCL112AC: заголовок 2 + 112 бит по 2 + footer 1, DAIKIN64: leader 4 + заголовок 2 + 64 бита по 2 + footer 1 + gap + mark
+  static const uint16_t MAX_TIMINGS = 232;
+
+ private:
+  //80 МГц / 16: 5 тиков на мкс
+  static const uint8_t TICKS_PER_US = 5;
+
+  uint8_t pin_;
+  uint16_t carrier_on_ticks_;
+  uint16_t carrier_off_ticks_;
+
+  uint16_t timings_[MAX_TIMINGS];
+  uint16_t count_{0};
+  uint32_t trailing_gap_us_{0};
+  bool overflow_{false};
+
+  //состояние, которое меняет прерывание
+  volatile uint16_t index_{0};
+  volatile uint32_t half_periods_left_{0};
+  volatile bool busy_{false};
+
+ public:
+  //duty - процент периода несущей, когда светодиод включен
+  explicit IRTransmitter(uint8_t pin, uint32_t carrier_hz = 38000, uint8_t duty = 50) : pin_(pin) {
+    const uint32_t period_ticks = 1000000UL * TICKS_PER_US / carrier_hz;
+    carrier_on_ticks_ = period_ticks * duty / 100;
+    carrier_off_ticks_ = period_ticks - carrier_on_ticks_;
+  }
+
+  void begin() {
+    pinMode(this->pin_, OUTPUT);
+    digitalWrite(this->pin_, LOW);
+    timer1_isr_init();
+  }
+
+  //кодирование кадра, пока передатчик занят буфер не трогаем
+  bool clear() {
+    if(this->busy_)
+      return false;
+
+    this->count_ = 0;
+    this->trailing_gap_us_ = 0;
+    this->overflow_ = false;
+    return true;
+  }
+
+  void mark(uint16_t us) {
+    //длинная пауза бывает только в конце кадра
+    if(this->trailing_gap_us_ != 0)
+      this->overflow_ = true;
+
+    //два mark подряд - один импульс
+    if(this->count_ % 2 == 1)
+      this->timings_[this->count_ - 1] += us;
+    else
+      push_(us);
+  }
+
+  //пауза после последнего mark не хранится в буфере, а становится паузой между кадрами
+  void space(uint32_t us) {
+    if(this->count_ == 0)
+      return;
+
+    if(this->count_ % 2 == 0) {
+      this->timings_[this->count_ - 1] += us;
+      return;
+    }
+
+    if(us > UINT16_MAX) {
+      this->trailing_gap_us_ = us;
+      return;
+    }
+
+    push_(us);
+  }
+
+  void data(uint64_t value, uint16_t nbits, uint16_t one_mark, uint32_t one_space, uint16_t zero_mark,
+            uint32_t zero_space, bool msb_first) {
+    for(uint16_t i = 0; i < nbits; i++) {
+      const uint16_t bit = msb_first ? nbits - 1 - i : i;
+      const bool one = (value >> bit) & 1;
+      mark(one ? one_mark : zero_mark);
+      space(one ? one_space : zero_space);
+    }
+  }
+
+  //true - кадр пошел в эфир
+  bool start() {
+    if(this->count_ == 0 || this->overflow_ || active_() != nullptr)
+      return false;
+
+    //пауза в конце буфера тоже становится паузой между кадрами
+    if(this->count_ % 2 == 0)
+      this->trailing_gap_us_ += this->timings_[--this->count_];
+
+    this->index_ = 0;
+    this->busy_ = true;
+    active_() = this;
+
+    timer1_attachInterrupt(&IRTransmitter::on_timer_);
+    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+    begin_timing_();
+    return true;
+  }
+
+  //кадр в эфире или еще идет пауза после него
+  bool is_busy() const { return this->busy_; }
+
+  bool is_overflow() const { return this->overflow_; }
+
+  uint16_t size() const { return this->count_; }
+
+  static bool is_any_busy() { return active_() != nullptr; }
+
+ private:
+  //передатчик, чей кадр сейчас в эфире, его ведет прерывание
+  static IRTransmitter *volatile &ICACHE_RAM_ATTR active_() {
+    static IRTransmitter *volatile active = nullptr;
+    return active;
+  }
+
+  void push_(uint16_t us) {
+    if(this->count_ >= MAX_TIMINGS) {
+      this->overflow_ = true;
+      return;
+    }
+
+    this->timings_[this->count_++] = us;
+  }
+
+  static void ICACHE_RAM_ATTR on_timer_() {
+    IRTransmitter *transmitter = active_();
+    if(transmitter != nullptr)
+      transmitter->on_timer_edge_();
+  }
+
+  void ICACHE_RAM_ATTR on_timer_edge_() {
+    if(this->half_periods_left_ > 0) {
+      carrier_half_period_();
+      return;
+    }
+
+    this->index_++;
+    begin_timing_();
+  }
+
+  //четные тайминги - mark, нечетные - space, за последним - пауза между кадрами
+  void ICACHE_RAM_ATTR begin_timing_() {
+    if(this->index_ > this->count_) {
+      timer1_disable();
+      timer1_detachInterrupt();
+      active_() = nullptr;
+      this->busy_ = false;
+      return;
+    }
+
+    if(this->index_ == this->count_) {
+      digitalWrite(this->pin_, LOW);
+      write_us_(this->trailing_gap_us_);
+      return;
+    }
+
+    const uint32_t us = this->timings_[this->index_];
+
+    if(this->index_ % 2 == 1) {
+      digitalWrite(this->pin_, LOW);
+      write_us_(us);
+      return;
+    }
+
+    //целое число периодов несущей
+    const uint32_t period_ticks = this->carrier_on_ticks_ + this->carrier_off_ticks_;
+    this->half_periods_left_ = 2 * ((us * TICKS_PER_US + period_ticks / 2) / period_ticks);
+    if(this->half_periods_left_ == 0)
+      this->half_periods_left_ = 2;
+    carrier_half_period_();
+  }
+
+  void ICACHE_RAM_ATTR carrier_half_period_() {
+    const bool on = this->half_periods_left_ % 2 == 0;
+    this->half_periods_left_--;
+    digitalWrite(this->pin_, on ? HIGH : LOW);
+    timer1_write(on ? this->carrier_on_ticks_ : this->carrier_off_ticks_);
+  }
+
+  static void ICACHE_RAM_ATTR write_us_(uint32_t us) { timer1_write(us > 0 ? us * TICKS_PER_US : 1); }
+};
+
+}  // namespace ir_climate
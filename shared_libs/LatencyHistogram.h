@@ -0,0 +1,142 @@
+#pragma once
+
+#include "esphome.h"
+
+namespace latency_histogram {
+
+//Гистограммы времени выполнения по фазам главного цикла.
+//Время меряется счетчиком тактов, бакеты log2 по микросекундам: бакет i - [2^i, 2^(i+1)) us,
+//нулевой бакет - меньше 2us, последний - все что дольше 2^(LATENCY_BUCKETS-1) us.
+//Модуль необязательный: пока экземпляр не создан, замеры LatencyProbe ничего не делают.
+//
+//Подключение в yaml:
+//  custom_component:
+//  - lambda: |-
+//      auto latency = new latency_histogram::LatencyTracker("${device_name}", 60000);
+//      App.register_component(latency);
+//      return {latency};
+//
+//Раз в интервал публикуется json в <name>/lat и гистограммы обнуляются:
+//  {"<фаза>":[n0,n1,...],"<фаза>_max":us}, хвост из нулевых бакетов не публикуется
+//  cl - call_loop, l - loop, ir - разбор кадра с пульта, ps - publish_state_, pt - PowerTracker::set_power и update
+enum Phase : uint8_t {
+  PHASE_CALL_LOOP = 0,
+  PHASE_LOOP = 1,
+  PHASE_IR_DECODE = 2,
+  PHASE_PUBLISH_STATE = 3,
+  PHASE_POWER_TRACKER = 4,
+  PHASE_COUNT = 5,
+};
+
+static const char *const PHASE_NAMES[PHASE_COUNT] = {"cl", "l", "ir", "ps", "pt"};
+static const char *const PHASE_MAX_NAMES[PHASE_COUNT] = {"cl_max", "l_max", "ir_max", "ps_max", "pt_max"};
+
+static const uint8_t LATENCY_BUCKETS = 16;
+
+class LatencyHistogram {
+ private:
+  uint16_t buckets_[LATENCY_BUCKETS];
+  uint32_t max_us_{0};
+
+ public:
+  LatencyHistogram() { reset(); }
+
+  void add(uint32_t us) {
+    uint8_t bucket = 0;
+    while(bucket < LATENCY_BUCKETS - 1 && (us >> (bucket + 1)) != 0)
+      bucket++;
+
+    if(this->buckets_[bucket] < UINT16_MAX)
+      this->buckets_[bucket]++;
+
+    if(us > this->max_us_)
+      this->max_us_ = us;
+  }
+
+  void reset() {
+    memset(this->buckets_, 0, sizeof(this->buckets_));
+    this->max_us_ = 0;
+  }
+
+  uint16_t get_bucket(uint8_t bucket) const { return this->buckets_[bucket]; }
+
+  uint32_t get_max() const { return this->max_us_; }
+
+  //количество бакетов без хвоста из нулей
+  uint8_t used_buckets() const {
+    uint8_t used = LATENCY_BUCKETS;
+    while(used > 0 && this->buckets_[used - 1] == 0)
+      used--;
+    return used;
+  }
+};
+
+class LatencyTracker;
+
+//созданный экземпляр, nullptr если замеры не подключены.
+//Статическая переменная функции, чтобы во всех единицах трансляции был один экземпляр
+inline LatencyTracker *&global_latency_tracker() {
+  static LatencyTracker *instance = nullptr;
+  return instance;
+}
+
+class LatencyTracker : public PollingComponent {
+ private:
+  std::string topic_;
+  LatencyHistogram histograms_[PHASE_COUNT];
+  uint32_t cycles_per_us_;
+
+ public:
+  LatencyTracker(const std::string &name, uint32_t update_interval) : PollingComponent(update_interval) {
+    this->topic_ = sanitize_string_whitelist(name, HOSTNAME_CHARACTER_WHITELIST) + "/lat";
+    this->cycles_per_us_ = ESP.getCpuFreqMHz();
+    global_latency_tracker() = this;
+  }
+
+  void record(Phase phase, uint32_t cycles) { this->histograms_[phase].add(cycles / this->cycles_per_us_); }
+
+  void update() override {
+    if(global_mqtt_client == nullptr || global_mqtt_client->is_connected() == false)
+      return;
+
+    global_mqtt_client->publish_json(this->topic_, [this](JsonObject &root) {
+      for(uint8_t i = 0; i < PHASE_COUNT; i++) {
+        const LatencyHistogram &histogram = this->histograms_[i];
+        uint8_t used = histogram.used_buckets();
+        if(used == 0)
+          continue;
+
+        JsonArray &buckets = root.createNestedArray(PHASE_NAMES[i]);
+        for(uint8_t bucket = 0; bucket < used; bucket++)
+          buckets.add(histogram.get_bucket(bucket));
+
+        root[PHASE_MAX_NAMES[i]] = histogram.get_max();
+      }
+    });
+
+    for(auto &histogram : this->histograms_)
+      histogram.reset();
+  }
+
+  float get_setup_priority() const override { return setup_priority::AFTER_CONNECTION; }
+};
+
+//Замер участка кода от создания до выхода из области видимости
+class LatencyProbe {
+ private:
+  Phase phase_;
+  uint32_t started_at_{0};
+
+ public:
+  explicit LatencyProbe(Phase phase) : phase_(phase) {
+    if(global_latency_tracker() != nullptr)
+      this->started_at_ = ESP.getCycleCount();
+  }
+
+  ~LatencyProbe() {
+    if(global_latency_tracker() != nullptr)
+      global_latency_tracker()->record(this->phase_, ESP.getCycleCount() - this->started_at_);
+  }
+};
+
+}  // namespace latency_histogram
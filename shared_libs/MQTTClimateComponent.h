@@ -0,0 +1,1102 @@
+#pragma once
+
+#include "esphome.h"
+
+#include "EnumNames.h"
+#include "HeapDiagnostics.h"
+#include "IRRawCapture.h"
+#include "IRReceiverHub.h"
+#include "LatencyHistogram.h"
+#include "PowerSampleRecorder.h"
+#include "PowerTracker.h"
+#include "Thermostat.h"
+#include "TopicArena.h"
+
+namespace mqtt_climate {
+
+static const char *TAG = "mqtt.climate";
+
+//версия формата компактного состояния, при изменении CompactState старые сообщения отбрасываются по размеру или версии
+static const uint8_t COMPACT_STATE_VERSION = 1;
+
+//индексы строк в TopicArena компонента, за TOPIC_FEATURES идут топики дополнительных кнопок
+enum TopicIndex : uint8_t {
+  TOPIC_MODE_COMMAND = 0,           //управление режимом
+  TOPIC_INFO = 1,                   //получение всех данных
+  TOPIC_TEMPERATURE_COMMAND = 2,    //управление температурой
+  TOPIC_FAN_MODE_COMMAND = 3,       //режим вентилятора
+  TOPIC_SWING_MODE_COMMAND = 4,     //режим шторок
+  TOPIC_JSON_COMMAND = 5,           //изменение нескольких полей одним сообщением
+  TOPIC_COMPACT_STATE = 6,
+  TOPIC_POWER_RECORDER_COMMAND = 7,
+  TOPIC_POWER_RECORDER_DATA = 8,
+  TOPIC_DISCOVERY = 9,
+  TOPIC_CURRENT_TEMPERATURE = 10,
+  FIELD_CURRENT_TEMPERATURE = 11,
+  TOPIC_IR_CAPTURE_COMMAND = 12,
+  TOPIC_IR_CAPTURE_DATA = 13,
+  TOPIC_THERMOSTAT_STATE = 14,      //состояние регулятора по температуре в комнате
+  TOPIC_FEATURES = 15,
+};
+
+//Дополнительная кнопка кондиционера (sleep, turbo, ...)
+//команда: <name>/<feature>/set, атрибуты в info топике: <feature> и <feature>_al, ключ <feature> в json команде
+template<typename Driver> struct ClimateFeature {
+  const char *name;
+  const char *allowed_name;
+  bool (*set)(Driver *ac, bool on);
+  bool (*get)(const Driver *ac);
+  bool (*allowed)(const Driver *ac);
+};
+
+//Общая часть mqtt компонента кондиционера, протокол задается через Traits:
+//  typedef ... Driver;                                        ir драйвер (IRDaikin, IRDahatsu)
+//  static const ClimateFeature<Driver> *features();           дополнительные кнопки, порядок = порядок применения
+//  static uint8_t feature_count();
+//  static void restore_state(Driver *ac, JsonObject &root);    восстановление из retain сообщения info топика
+//  static void add_state_attributes(const Driver *ac, JsonObject &root, JsonObject &attributes);
+//  static void set_power(Driver *ac, bool on);                 синхронизация питания по датчику нагрузки
+template<typename Traits> class MQTTClimateComponent : public MQTTComponent {
+ private:
+  typedef typename Traits::Driver Driver;
+  typedef decltype(std::declval<const Driver &>().get_temp()) temperature_type;
+  typedef decltype(std::declval<const Driver &>().get_hvac_mode()) mode_type;
+
+  //все топики в одном буфере, собираются в call_setup, индексы - TopicIndex
+  TopicArena topics_;
+
+  Driver* ir_climate_;
+  //до сборки topics_ в call_setup
+  std::string current_temperature_topic_;
+  std::string current_temperature_field_;
+
+  float power_{NAN};
+  bool prev_resend_state_{false};
+  bool discovery_topic_sended_{false};
+  bool init_state_from_retain_message_{true};
+  bool initialized_{false};
+  bool setup_initialized_{false};
+  unsigned long initialize_started_at_{0};
+  //начальное состояние отправляется через initial_state_delay_ ms после discovery, loop при этом не блокируется
+  unsigned long discovery_sended_at_{0};
+  uint32_t initial_state_delay_{500};
+  //самая длинная итерация главного цикла за время инициализации, us
+  uint32_t last_call_loop_at_{0};
+  uint32_t init_max_loop_time_{0};
+  std::string name_;
+  PowerTracker* power_tracker_{nullptr};
+  sensor::Sensor* power_sensor_{nullptr};
+  //запись отсчетов питания, выгрузка по команде в <name>/pwr/c
+  PowerSampleRecorder* power_recorder_{nullptr};
+  //запись сырых ir кадров, выгрузка по команде в <name>/ir/c
+  ir_climate::IRRawCapture* ir_capture_{nullptr};
+
+  //окно, в течении которого команды из mqtt собираются в одну отправку ir
+  uint32_t command_coalesce_window_{50};
+  unsigned long pending_since_{0};
+  bool send_pending_{false};
+  bool publish_pending_{false};
+  //сколько ir кадров не было отправлено благодаря объединению команд
+  uint32_t ir_frames_saved_{0};
+  uint32_t ir_frames_sent_{0};
+
+  //отпечаток последнего опубликованного состояния, повторно то же самое не публикуем
+  uint64_t published_fingerprint_{0};
+  bool state_published_{false};
+  uint32_t suppressed_publishes_{0};
+
+  //последнее состояние во flash, восстанавливается при загрузке еще до подключения к mqtt
+  ESPPreferenceObject state_preference_;
+  typename Driver::CompactState saved_state_{};
+  bool state_restored_{false};
+  bool state_save_pending_{false};
+  unsigned long state_changed_at_{0};
+  //запись во flash только после state_save_delay_ ms без изменений
+  uint32_t state_save_delay_{10000};
+
+  //необязательный топик с состоянием в hex: версия, размер, Driver::CompactState
+  //при восстановлении из retain используется вместо json info топика
+  bool compact_state_enabled_{false};
+
+  //собранное один раз discovery сообщение. Строка живет в куче все время работы компонента (~780 байт),
+  //зато при переподключениях нет пика на сборку json документа
+  std::string discovery_payload_;
+  uint32_t discovery_renders_{0};
+
+  //необязательный регулятор уставки по датчику температуры в комнате
+  Thermostat* thermostat_{nullptr};
+  //цель - уставка, выставленная пультом или командой, setpoint - уставка, выставленная регулятором
+  float thermostat_target_{NAN};
+  float thermostat_setpoint_{NAN};
+  bool thermostat_state_pending_{false};
+
+ public:
+  MQTTClimateComponent(uint16_t receiver_pin, uint16_t transmitter_pin, const std::string &name)
+      : MQTTClimateComponent(new Driver(receiver_pin, transmitter_pin), name) {}
+
+  //несколько кондиционеров на одном узле: общий приемник, у каждого свой передатчик
+  MQTTClimateComponent(ir_climate::IRReceiverHub *receiver_hub, uint16_t transmitter_pin, const std::string &name)
+      : MQTTClimateComponent(new Driver(receiver_hub, transmitter_pin), name) {}
+
+  MQTTClimateComponent(Driver *ir_climate, const std::string &name) {
+    ir_climate_ = ir_climate;
+    name_ = name;
+    power_tracker_ = new PowerTracker(20, 10, 20);
+
+    //доавляем callback, который будет вызван если значение питания не меняется в течении заданного отрезка времения
+    power_tracker_->add_on_power_callback([this](float state) { power_stable_callback_(state); });
+
+    //доавляем callback, вызывается при считывании данных с пульта
+    //состояние с пульта важнее: команды, ждущие окна объединения, устарели вместе с неотправленным кадром драйвера
+    ir_climate_->add_on_state_callback([this]() {
+      this->send_pending_ = false;
+      this->publish_pending_ = false;
+      this->power_tracker_->reset();
+      //пульт смещения регулятора не знает, уставка в его кадре - цель
+      this->set_thermostat_target_();
+      this->publish_state_();
+    });
+
+    //кадр отправляется драйвером из loop(), здесь только подтверждение отправки
+    ir_climate_->add_on_send_callback([this]() { this->ir_frames_sent_++; });
+  }
+
+  void send_discovery(JsonObject &, SendDiscoveryConfig &) override {}
+
+  bool send_initial_state() override { return this->publish_state_(true); }
+
+  bool is_internal() override { return false; }
+
+  std::string component_type() const override { return "climate"; }
+
+  void set_power_sensor(sensor::Sensor *sensor) { this->power_sensor_ = sensor; }
+
+  //хранить последние capacity отсчетов датчика питания
+  //"dump" в <name>/pwr/c публикует их в <name>/pwr/d (формат в PowerSampleRecorder.h), "clear" очищает буфер
+  void set_power_recorder(uint16_t capacity) { this->power_recorder_ = new PowerSampleRecorder(capacity); }
+
+  //записывать тайминги принятых кадров в буфер на capacity_bytes
+  //"dump" в <name>/ir/c публикует их в <name>/ir/d (формат в IRRawCapture.h), "clear" очищает буфер
+  //при общем приемнике запись одна на всех, включать ее достаточно у одного компонента
+  void set_ir_capture(uint16_t capacity_bytes) {
+    this->ir_capture_ = new ir_climate::IRRawCapture(capacity_bytes);
+    this->ir_climate_->get_receiver_hub()->set_capture(this->ir_capture_);
+  }
+
+  //включает публикацию состояния в <name>/r
+  void enable_compact_state_topic() { this->compact_state_enabled_ = true; }
+
+  //регулировать уставку по датчику из set_current_temperature_sensor, только в режимах cool и heat
+  //уставка с пульта или из HA - цель для температуры в комнате, состояние регулятора публикуется в <name>/ctl
+  //в <name>/i, <name>/r и во flash - цель, смещение регулятора есть только в кадре кондиционера
+  void enable_thermostat(float hysteresis, float max_offset, uint32_t interval_seconds = 300, uint32_t timeout_seconds = 900) {
+    this->thermostat_ = new Thermostat(hysteresis, max_offset, interval_seconds, timeout_seconds);
+  }
+
+  void set_state_save_delay(uint32_t delay_ms) { this->state_save_delay_ = delay_ms; }
+
+  void set_command_coalesce_window(uint32_t window_ms) { this->command_coalesce_window_ = window_ms; }
+
+  uint32_t get_ir_frames_saved() const { return this->ir_frames_saved_; }
+
+  uint32_t get_ir_frames_sent() const { return this->ir_frames_sent_; }
+
+  uint32_t get_ir_duplicate_frames() const { return this->ir_climate_->get_duplicate_frames(); }
+
+  uint32_t get_suppressed_publishes() const { return this->suppressed_publishes_; }
+
+  uint32_t get_discovery_renders() const { return this->discovery_renders_; }
+
+  const TopicArena &get_topics() const { return this->topics_; }
+
+  void set_current_temperature_sensor(std::string topic, std::string field) {
+    this->current_temperature_topic_ = topic;
+    this->current_temperature_field_ = field;
+  }
+
+  void setup() override {
+    ir_climate_->setup();
+
+    for (uint8_t i = 0; i < Traits::feature_count(); i++) {
+      const ClimateFeature<Driver> *feature = &Traits::features()[i];
+
+      this->subscribe(this->topics_.get(TOPIC_FEATURES + i), [this, feature](const std::string &, const std::string &payload) {
+        ESP_LOGD(TAG, "%s_command_topic: %s", feature->name, payload.c_str());
+        auto on = ir_climate::parse_on_off(payload);
+
+        if(on == ir_climate::ENUM_UNDEFINED) {
+          ESP_LOGW(TAG, "Unrecognized %s mode %s", feature->name, payload.c_str());
+          return;
+        }
+
+        if(feature->set(ir_climate_, on == 1))
+          this->schedule_send_();
+
+        this->schedule_publish_();
+      });
+    }
+
+    this->subscribe(this->topics_.get(TOPIC_MODE_COMMAND), [this](const std::string &, const std::string &payload) {
+      ESP_LOGD(TAG, "mode_command_topic: %s", payload.c_str());
+      this->power_tracker_->reset();
+      ir_climate_->set_hvac_mode(payload);
+      this->schedule_send_();
+      this->schedule_publish_();
+    });
+
+    this->subscribe(this->topics_.get(TOPIC_TEMPERATURE_COMMAND), [this](const std::string &, const std::string &payload) {
+      ESP_LOGD(TAG, "temperature_command_topic: %s", payload.c_str());
+      auto val = parse_float(payload);
+
+      if (!val.has_value()) {
+        ESP_LOGW(TAG, "Can't convert '%s' to number!", payload.c_str());
+        return;
+      }
+
+      if(ir_climate_->set_temp(static_cast<temperature_type>(*val)) == true)
+        this->schedule_send_();
+
+      this->set_thermostat_target_();
+      this->schedule_publish_();
+    });
+
+    this->subscribe(this->topics_.get(TOPIC_FAN_MODE_COMMAND), [this](const std::string &, const std::string &payload) {
+      ESP_LOGD(TAG, "fan_mode_command_topic: %s", payload.c_str());
+      if(ir_climate_->set_fan(payload) == true)
+        this->schedule_send_();
+
+      this->schedule_publish_();
+    });
+
+    this->subscribe(this->topics_.get(TOPIC_SWING_MODE_COMMAND), [this](const std::string &, const std::string &payload) {
+      ESP_LOGD(TAG, "swing_mode_command_topic: %s", payload.c_str());
+      ir_climate_->set_swing_mode(payload);
+      this->schedule_send_();
+      this->schedule_publish_();
+    });
+
+    //атомарное изменение состояния: {"hvac":"cool","t":24,"fm":"auto","sm":"off", <feature>: true|false}
+    //все поля необязательные
+    this->subscribe_json_probed_(this->topics_.get(TOPIC_JSON_COMMAND), [this](const std::string &, JsonObject &root) {
+      if(root.success() == false) {
+        ESP_LOGW(TAG, "json_command_topic: parsing error");
+        return;
+      }
+
+      bool changed = false;
+
+      //режим применяем первым, от него зависят ограничения остальных полей
+      const char* hvac_mode_str = root["hvac"];
+      if(hvac_mode_str != nullptr) {
+        this->power_tracker_->reset();
+        ir_climate_->set_hvac_mode(hvac_mode_str);
+        changed = true;
+      }
+
+      if(root.containsKey("t")) {
+        changed |= ir_climate_->set_temp(static_cast<temperature_type>(root["t"].as<float>()));
+        this->set_thermostat_target_();
+      }
+
+      const char* fan_mode_str = root["fm"];
+      if(fan_mode_str != nullptr)
+        changed |= ir_climate_->set_fan(fan_mode_str);
+
+      const char* swing_mode_str = root["sm"];
+      if(swing_mode_str != nullptr) {
+        ir_climate_->set_swing_mode(swing_mode_str);
+        changed = true;
+      }
+
+      //кнопки после температуры и вентилятора: например turbo при включении сам их переопределяет
+      for (uint8_t i = 0; i < Traits::feature_count(); i++) {
+        const ClimateFeature<Driver> &feature = Traits::features()[i];
+
+        if(root.containsKey(feature.name))
+          changed |= feature.set(ir_climate_, root[feature.name].template as<bool>());
+      }
+
+      ESP_LOGD(TAG, "json_command_topic: changed: %s", changed ? "true" : "false");
+
+      if(changed)
+        this->schedule_send_();
+
+      this->schedule_publish_();
+    });
+
+    //компактное состояние подписываем первым, его retain сообщение приходит раньше json
+    if(this->topics_.has(TOPIC_COMPACT_STATE)) {
+      this->subscribe(this->topics_.get(TOPIC_COMPACT_STATE), [this](const std::string &, const std::string &payload) {
+        if(this->init_state_from_retain_message_ == false)
+          return;
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+        uint32_t started_at = micros();
+#endif
+        typename Driver::CompactState state;
+
+        if(decode_compact_state(payload, state) == false) {
+          ESP_LOGW(TAG, "Compact state is invalid, waiting for json state");
+          return;
+        }
+
+        if(this->ir_climate_->restore_compact_state(state) == false) {
+          ESP_LOGW(TAG, "Compact state is not recognized, waiting for json state");
+          return;
+        }
+
+        ESP_LOGD(TAG, "Compact state restored: %u bytes, %uus", static_cast<unsigned>(payload.size()),
+                 static_cast<unsigned>(micros() - started_at));
+        retain_state_restored_();
+      });
+    }
+
+    //инициализация начального состояния из последнего отправленного сообщения
+    this->subscribe_json_probed_(this->topics_.get(TOPIC_INFO), [this](const std::string &, JsonObject &root) {
+      if(this->init_state_from_retain_message_ == false)
+        return;
+
+      if(root.success() == false) {
+        this->init_state_from_retain_message_ = false;
+        ESP_LOGW(TAG, "Parsing error, skipping initialization from retain state message");
+        return;
+      }
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+      uint32_t started_at = micros();
+#endif
+
+      Traits::restore_state(this->ir_climate_, root);
+
+      ESP_LOGD(TAG, "Json state restored: %u bytes, %uus", static_cast<unsigned>(root.measureLength()),
+               static_cast<unsigned>(micros() - started_at));
+      retain_state_restored_();
+    });
+
+    if(this->power_sensor_ != nullptr)
+      this->power_sensor_->add_on_raw_state_callback([this](float power) { update_power_(power); });
+
+    if(this->thermostat_ != nullptr && this->topics_.has(TOPIC_CURRENT_TEMPERATURE)) {
+      this->subscribe_json(this->topics_.get(TOPIC_CURRENT_TEMPERATURE), [this](const std::string &, JsonObject &root) {
+        const char *field = this->topics_.get(FIELD_CURRENT_TEMPERATURE);
+
+        if(root.containsKey(field) == false)
+          return;
+
+        float temperature = root[field] | NAN;
+        if(isnan(temperature))
+          return;
+
+        this->thermostat_->set_room_temperature(temperature, millis());
+        ESP_LOGV(TAG, "[thermostat] room temperature: %.1f", temperature);
+      });
+    }
+
+    if(this->power_recorder_ != nullptr) {
+      this->subscribe(this->topics_.get(TOPIC_POWER_RECORDER_COMMAND), [this](const std::string &, const std::string &payload) {
+        if(payload == "clear") {
+          this->power_recorder_->clear();
+          ESP_LOGI(TAG, "[power_recorder] cleared");
+          return;
+        }
+
+        if(payload != "dump") {
+          ESP_LOGW(TAG, "Unrecognized power recorder command %s", payload.c_str());
+          return;
+        }
+
+        ESP_LOGI(TAG, "[power_recorder] dump %u samples", this->power_recorder_->size());
+        //без retain: выгрузка нужна один раз тому, кто ее запросил, брокер не должен хранить и рассылать килобайты
+        global_mqtt_client->publish(this->topics_.get(TOPIC_POWER_RECORDER_DATA), this->power_recorder_->dump(), 0, false);
+      });
+    }
+
+    if(this->ir_capture_ != nullptr) {
+      this->subscribe(this->topics_.get(TOPIC_IR_CAPTURE_COMMAND), [this](const std::string &, const std::string &payload) {
+        if(payload == "clear") {
+          this->ir_capture_->clear();
+          ESP_LOGI(TAG, "[ir_capture] cleared");
+          return;
+        }
+
+        if(payload != "dump") {
+          ESP_LOGW(TAG, "Unrecognized ir capture command %s", payload.c_str());
+          return;
+        }
+
+        ESP_LOGI(TAG, "[ir_capture] dump %u frames", this->ir_capture_->size());
+        //без retain, как и выгрузка отсчетов питания
+        global_mqtt_client->publish(this->topics_.get(TOPIC_IR_CAPTURE_DATA), this->ir_capture_->dump(), 0, false);
+      });
+    }
+  }
+
+  void call_setup() override {
+
+    if (this->is_internal())
+      return;
+
+    build_topics_();
+    restore_saved_state_();
+
+    global_mqtt_client->register_mqtt_component(this);
+
+    setup_initialized_ = false;
+    this->schedule_resend_state();
+  }
+
+  void call_loop() override {
+
+    if (this->is_internal())
+      return;
+
+    latency_histogram::LatencyProbe latency(latency_histogram::PHASE_CALL_LOOP);
+
+    //При дисконнекте от mqtt он при новом подключении дергает метод this->schedule_resend_state()
+    //нужно пониять когда это произошло и переинициализировать плаги, для этого добавил prev_resend_state_
+    if(this->is_connected_() == false)
+      return;
+
+    //время между вызовами call_loop - итерация главного цикла esphome
+    uint32_t call_loop_at = micros();
+    if(this->resend_state_ && this->last_call_loop_at_ != 0)
+      this->init_max_loop_time_ = std::max(this->init_max_loop_time_, call_loop_at - this->last_call_loop_at_);
+    this->last_call_loop_at_ = call_loop_at;
+
+    if(this->prev_resend_state_ == false && this->resend_state_ == true) {
+      //Если была запрошене переинициализация, например отвалился mqtt
+      this->initialize_started_at_ = millis();
+      this->init_max_loop_time_ = 0;
+      //состояние из flash уже применено, retain сообщение не ждем
+      this->init_state_from_retain_message_ = this->state_restored_ == false;
+      this->discovery_topic_sended_ = false;
+      this->power_tracker_->reset();
+
+      if(setup_initialized_ == false) {
+        this->setup();
+        setup_initialized_ = true;
+      }
+
+      ESP_LOGI(TAG, "Сбрасываем состояние");
+    }
+
+    this->loop();
+
+    if (this->resend_state_ == false)
+      return;
+
+    this->prev_resend_state_ = this->resend_state_;
+
+    if(this->init_state_from_retain_message_) {
+      auto state_initialization_time = (millis() - this->initialize_started_at_);
+      if(state_initialization_time > 5000) {
+        float time = (float)state_initialization_time * 0.001;
+        ESP_LOGW(TAG, "Time out, passed: %.2fs, initialize state from the default ac settings", time);
+        this->init_state_from_retain_message_ = false;
+      }
+
+      return;
+    }
+
+    //задержка отправки discovery, без сохраненного состояния даем время прийти retain сообщению
+    if(this->state_restored_ == false && (millis() - initialize_started_at_) < 5000)
+      return;
+
+    if (this->is_discovery_enabled() && this->discovery_topic_sended_ == false) {
+      this->discovery_topic_sended_ = this->send_auto_discovery_();
+      if (this->discovery_topic_sended_ == false) {
+        //resend_state_ остается выставленным, повторяем на следующей итерации
+        ESP_LOGW(TAG, "sending auto discovery topic failed");
+        return;
+      }
+
+      //даем HA обработать discovery, начальное состояние отправим на одной из следующих итераций
+      this->discovery_sended_at_ = millis();
+      return;
+    }
+
+    if(this->discovery_topic_sended_ && (millis() - this->discovery_sended_at_) < this->initial_state_delay_)
+      return;
+
+    this->resend_state_ = false;
+
+    if(this->send_initial_state() == false) {
+      ESP_LOGW(TAG,"sending initial state data failed");
+      this->schedule_resend_state();
+    }
+
+    if(this->resend_state_ == false && (this->discovery_topic_sended_ == true || this->is_discovery_enabled() == false)) {
+      this->initialized_ = true;
+      this->prev_resend_state_ = this->resend_state_;
+      ESP_LOGI(TAG, "Initial state initialized, auto discovery topic sended, uptime: %.2fs, max loop time during initialization: %.1fms",
+               millis() * 0.001f, this->init_max_loop_time_ * 0.001f);
+    }
+  }
+
+  void loop() override {
+    latency_histogram::LatencyProbe latency(latency_histogram::PHASE_LOOP);
+
+    //отправляем накопленные за окно команды одним кадром
+    flush_pending_commands_();
+
+    save_state_();
+
+    //ждем полной инициализации плагина, отправку автодискавери и начального состояния
+    if(this->initialized_ == false)
+      return;
+
+    //прием кадров с пульта и запуск отправки кадра из очереди драйвера
+    ir_climate_->loop();
+
+    //инициализация отслеживания питания
+    if(this->power_tracker_->is_initialized() == false && isnan(this->power_) == false) {
+      this->power_tracker_->initialize(this->power_);
+      ESP_LOGD(TAG, "[power_tracker] initialize with power: %.2f", this->power_);
+    }
+
+    //подтверждение уровня по времени и периодическая проверка питания
+    update_power_tracker_();
+
+    update_thermostat_();
+
+    yield();
+  }
+
+  //компактное состояние в hex: версия, размер, Driver::CompactState
+  static std::string encode_compact_state(const typename Driver::CompactState &state) {
+    static const char HEX_CHARS[] = "0123456789abcdef";
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&state);
+
+    std::string payload;
+    payload.reserve((2 + sizeof(state)) * 2);
+
+    const uint8_t header[2] = {COMPACT_STATE_VERSION, sizeof(state)};
+    for(uint8_t byte : header) {
+      payload.push_back(HEX_CHARS[byte >> 4]);
+      payload.push_back(HEX_CHARS[byte & 0x0F]);
+    }
+
+    for(size_t i = 0; i < sizeof(state); i++) {
+      payload.push_back(HEX_CHARS[bytes[i] >> 4]);
+      payload.push_back(HEX_CHARS[bytes[i] & 0x0F]);
+    }
+
+    return payload;
+  }
+
+  //false если версия, размер или содержимое не совпадают с текущей прошивкой
+  static bool decode_compact_state(const std::string &payload, typename Driver::CompactState &state) {
+    if(payload.size() != (2 + sizeof(state)) * 2)
+      return false;
+
+    uint8_t bytes[2 + sizeof(state)];
+
+    for(size_t i = 0; i < sizeof(bytes); i++) {
+      auto high = hex_value_(payload[i * 2]);
+      auto low = hex_value_(payload[i * 2 + 1]);
+      if(high < 0 || low < 0)
+        return false;
+      bytes[i] = (high << 4) | low;
+    }
+
+    if(bytes[0] != COMPACT_STATE_VERSION || bytes[1] != sizeof(state))
+      return false;
+
+    memcpy(&state, bytes + 2, sizeof(state));
+    return true;
+  }
+
+ protected:
+  std::string friendly_name() const override { return this->name_; }
+ private:
+  std::string get_sanitized_name_() { return sanitize_string_whitelist(this->name_, HOSTNAME_CHARACTER_WHITELIST); }
+
+  static int8_t hex_value_(char c) {
+    if(c >= '0' && c <= '9')
+      return c - '0';
+    if(c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  //subscribe_json, но замер памяти охватывает и разбор json, а не только обработчик
+  void subscribe_json_probed_(const std::string &topic, std::function<void(const std::string &, JsonObject &)> callback) {
+    this->subscribe(topic, [callback](const std::string &topic, const std::string &payload) {
+      heap_diagnostics::HeapProbe probe(heap_diagnostics::PROBE_SUBSCRIBE_JSON);
+      json::parse_json(payload, [&topic, &callback](JsonObject &root) { callback(topic, root); });
+    });
+  }
+
+  bool send_auto_discovery_() {
+
+    auto const &discovery_info = global_mqtt_client->get_discovery_info();
+
+    if (discovery_info.clean) {
+      ESP_LOGV(TAG, "'%s': Cleaning discovery...", this->friendly_name().c_str());
+      return global_mqtt_client->publish(this->topics_.get(TOPIC_DISCOVERY), "", 0, 0, true);
+    }
+
+    //содержимое discovery не меняется, собираем его один раз, при переподключениях публикуем готовую строку
+    if(this->discovery_payload_.empty())
+      render_discovery_payload_();
+
+    return this->publish(this->topics_.get(TOPIC_DISCOVERY), this->discovery_payload_);
+  }
+
+  void render_discovery_payload_() {
+    heap_diagnostics::HeapProbe probe(heap_diagnostics::PROBE_PUBLISH_JSON);
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+    uint32_t free_heap_before = ESP.getFreeHeap();
+#endif
+    size_t length = 0;
+
+    const char *payload = json::build_json([this](JsonObject &root) {
+
+      SendDiscoveryConfig config;
+      config.state_topic = false;
+      config.command_topic = false;
+
+      std::string name = this->friendly_name();
+      const std::string &node_name = App.get_name();
+      std::string unique_id = this->unique_id();
+
+      JsonObject &device_info = root.createNestedObject("device");
+
+      JsonArray &fan_modes = root.createNestedArray("fan_modes");
+      for (const char* fan_mode_str : this->ir_climate_->fan_modes_str)
+        fan_modes.add(fan_mode_str);
+
+      const char *info_topic = this->topics_.get(TOPIC_INFO);
+
+      if(this->topics_.has(TOPIC_CURRENT_TEMPERATURE)) {
+        root["curr_temp_t"] = this->topics_.get(TOPIC_CURRENT_TEMPERATURE);
+        root["curr_temp_tpl"]= std::string("{{value_json.") + this->topics_.get(FIELD_CURRENT_TEMPERATURE) + "}}";
+      }
+
+      root["mode_cmd_t"] = this->topics_.get(TOPIC_MODE_COMMAND);
+      root["mode_stat_t"] = info_topic;
+      root["mode_stat_tpl"] = "{{value_json.hvac}}";
+
+      JsonArray &modes = root.createNestedArray("modes");
+
+      for (auto mode_str : this->ir_climate_->modes_str)
+        modes.add(mode_str);
+
+      JsonArray &swing_modes = root.createNestedArray("swing_modes");
+      for (auto swing_mode_str : this->ir_climate_->swing_modes_str)
+        swing_modes.add(swing_mode_str);
+
+      root["temp_cmd_t"] = this->topics_.get(TOPIC_TEMPERATURE_COMMAND);
+      root["temp_stat_t"] = info_topic;
+      root["temp_stat_tpl"] = "{{value_json.t}}";
+
+      root["min_temp"] = ir_climate_->temp_min;
+      root["max_temp"] = ir_climate_->temp_max;
+      root["temp_step"] = ir_climate_->temp_step;
+      root["fan_mode_cmd_t"] = this->topics_.get(TOPIC_FAN_MODE_COMMAND);
+      root["fan_mode_stat_t"] = info_topic;
+      root["fan_mode_stat_tpl"] = "{{value_json.fm}}";
+      root["swing_mode_cmd_t"] = this->topics_.get(TOPIC_SWING_MODE_COMMAND);
+      root["swing_mode_stat_t"] = info_topic;
+      root["swing_mode_stat_tpl"] = "{{value_json.sm}}";
+      root["json_attr_t"] = info_topic;
+      root["json_attr_tpl"] = "{{value_json.attrs|tojson}}";
+      root["name"] = name;
+
+      device_info["ids"] = get_mac_address();
+      device_info["name"] = node_name;
+      device_info["sw"] = ESPHOME_VERSION;
+      device_info["mf"] = "espressif";
+
+      if (unique_id.empty() == false) {
+        root["uniq_id"] = unique_id;
+      } else {
+        root["uniq_id"] = "ESP_" + this->get_default_object_id_();
+      }
+
+      if (this->availability_ == nullptr) {
+        if (!global_mqtt_client->get_availability().topic.empty()) {
+          root["avty_t"] = global_mqtt_client->get_availability().topic;
+          if (global_mqtt_client->get_availability().payload_available != "online")
+            root["pl_avail"] = global_mqtt_client->get_availability().payload_available;
+          if (global_mqtt_client->get_availability().payload_not_available != "offline")
+            root["pl_not_avail"] = global_mqtt_client->get_availability().payload_not_available;
+        }
+      } else if (!this->availability_->topic.empty()) {
+        root["avty_t"] = this->availability_->topic;
+        if (this->availability_->payload_available != "online")
+          root["pl_avail"] = this->availability_->payload_available;
+        if (this->availability_->payload_not_available != "offline")
+          root["pl_not_avail"] = this->availability_->payload_not_available;
+      }
+    }, &length);
+
+    this->discovery_payload_.assign(payload, length);
+    this->discovery_renders_++;
+
+    ESP_LOGD(TAG, "discovery payload cached: %u bytes, free heap before: %u, after: %u",
+             static_cast<unsigned>(length), free_heap_before, ESP.getFreeHeap());
+  }
+
+  void power_stable_callback_(float power) {
+    auto hvac_mode = this->ir_climate_->get_hvac_mode();
+    //Определеяем по потребеления кондиционера включен ли он
+    auto sensor_power_on = this->power_tracker_->power_on();
+
+    //Текущее состояние кондиционера
+    auto current_power_on = hvac_mode != mode_type::MODE_OFF;
+
+    //Если состояния синхранизиованы, то выходим
+    if(sensor_power_on == current_power_on)
+      return;
+
+    //если по нагрузке кондиционер выключен, а по состоянию выключен
+    if(sensor_power_on == false && current_power_on == true) {
+      ESP_LOGW(TAG, "[power_tracker] sending off state; [current power is %.2f]", power);
+      Traits::set_power(this->ir_climate_, false);
+      this->publish_state_();
+      return;
+    }
+
+    //если по нагрузке включен, а по состоянию выключен, то восстанавливаем состояние
+    if(sensor_power_on == true  && current_power_on == false) {
+      ESP_LOGW(TAG, "[power_tracker] current power state is on, restore state; [current power is %.2fW]", power);
+      Traits::set_power(this->ir_climate_, true);
+      this->publish_state_();
+      return;
+    }
+  }
+
+  void update_power_(float power) {
+    if(isnan(power))
+      return;
+
+    this->power_ = power;
+
+    ESP_LOGD("update_power_","power is %.2f", power);
+
+    if(this->power_recorder_ != nullptr)
+      this->power_recorder_->add(millis(), power);
+
+    latency_histogram::LatencyProbe latency(latency_histogram::PHASE_POWER_TRACKER);
+    this->power_tracker_->set_power(power);
+  }
+
+  void update_power_tracker_() {
+    latency_histogram::LatencyProbe latency(latency_histogram::PHASE_POWER_TRACKER);
+    this->power_tracker_->update();
+  }
+
+  void update_thermostat_() {
+    if(this->thermostat_ == nullptr)
+      return;
+
+    const auto now = millis();
+    const float setpoint = ir_climate_->get_temp();
+
+    //уставку поменяли в обход команд: turbo, ограничения режима - это новая цель
+    if(setpoint != this->thermostat_setpoint_)
+      set_thermostat_target_();
+
+    if(this->thermostat_state_pending_) {
+      this->thermostat_state_pending_ = false;
+      publish_thermostat_state_();
+    }
+
+    const auto hvac_mode = ir_climate_->get_hvac_mode();
+    const bool regulated = hvac_mode == mode_type::MODE_COOL || hvac_mode == mode_type::MODE_HEAT;
+
+    bool changed;
+    if(regulated == false && this->thermostat_->get_offset() != 0) {
+      //режим ушел из cool/heat: смещение снимаем сразу, в кадре снова цель
+      this->thermostat_->reset(now);
+      changed = true;
+    } else {
+      //без свежих показаний уставка возвращается к цели
+      changed = this->thermostat_->expire(now);
+      if(changed == false && regulated)
+        changed = this->thermostat_->update(this->thermostat_target_, ir_climate_->temp_step, now);
+    }
+
+    if(changed == false)
+      return;
+
+    float new_setpoint = this->thermostat_target_ + this->thermostat_->get_offset();
+    new_setpoint = std::max<float>(ir_climate_->temp_min, std::min<float>(ir_climate_->temp_max, new_setpoint));
+
+    //в /i цель не меняется, публикует состояние только отправка кадра
+    if(new_setpoint != setpoint) {
+      if(ir_climate_->set_temp(static_cast<temperature_type>(new_setpoint)))
+        this->schedule_send_();
+      this->thermostat_setpoint_ = ir_climate_->get_temp();
+    }
+
+    ESP_LOGD(TAG, "[thermostat] room: %.1f, target: %.1f, offset: %.1f, setpoint: %.1f",
+             this->thermostat_->get_room_temperature(), this->thermostat_target_,
+             this->thermostat_->get_offset(), this->thermostat_setpoint_);
+    publish_thermostat_state_();
+  }
+
+  //уставка с пульта, из команды или восстановленная - новая цель, смещение с нуля
+  void set_thermostat_target_() {
+    if(this->thermostat_ == nullptr)
+      return;
+
+    const float setpoint = ir_climate_->get_temp();
+    this->thermostat_target_ = setpoint;
+    this->thermostat_setpoint_ = setpoint;
+    this->thermostat_->reset(millis());
+    this->thermostat_state_pending_ = true;
+    ESP_LOGD(TAG, "[thermostat] new target: %.1f", setpoint);
+  }
+
+  //уставка для HA и flash: пока в кадре уставка регулятора - его цель
+  temperature_type get_target_temp_() const {
+    const auto setpoint = ir_climate_->get_temp();
+    if(this->thermostat_ == nullptr || this->thermostat_->get_offset() == 0 || setpoint != this->thermostat_setpoint_)
+      return setpoint;
+
+    return static_cast<temperature_type>(this->thermostat_target_);
+  }
+
+  //состояние для flash и <name>/r без смещения регулятора
+  typename Driver::CompactState get_compact_state_() const {
+    auto state = ir_climate_->get_compact_state();
+    const auto temp = get_target_temp_();
+    if(temp != ir_climate_->get_temp())
+      Driver::set_compact_state_temp(state, temp);
+    return state;
+  }
+
+  //{"room":23.4,"target":24,"offset":-1,"sp":23}, room - пока нет показаний датчика не публикуется
+  void publish_thermostat_state_() {
+    this->publish_json(this->topics_.get(TOPIC_THERMOSTAT_STATE), [this](JsonObject &root) {
+      if(isnan(this->thermostat_->get_room_temperature()) == false)
+        root["room"] = this->thermostat_->get_room_temperature();
+      root["target"] = this->thermostat_target_;
+      root["offset"] = this->thermostat_->get_offset();
+      root["sp"] = this->thermostat_setpoint_;
+    });
+  }
+
+  void schedule_send_() {
+    //кадр уже ждет отправки, изменение уйдет вместе с ним
+    if(this->send_pending_) {
+      this->ir_frames_saved_++;
+      ESP_LOGD(TAG, "command merged into pending ir frame, frames saved: %u", this->ir_frames_saved_);
+    }
+
+    start_pending_window_();
+    this->send_pending_ = true;
+  }
+
+  void schedule_publish_() {
+    start_pending_window_();
+    this->publish_pending_ = true;
+  }
+
+  void start_pending_window_() {
+    if(this->send_pending_ == false && this->publish_pending_ == false)
+      this->pending_since_ = millis();
+  }
+
+  void build_topics_() {
+    auto sanitized_name = get_sanitized_name_();
+    auto const &discovery_info = global_mqtt_client->get_discovery_info();
+
+    std::vector<std::string> topics(TOPIC_FEATURES + Traits::feature_count());
+    topics[TOPIC_MODE_COMMAND] = sanitized_name + "/m/c";
+    topics[TOPIC_INFO] = sanitized_name + "/i";
+    topics[TOPIC_TEMPERATURE_COMMAND] = sanitized_name + "/t/c";
+    topics[TOPIC_FAN_MODE_COMMAND] = sanitized_name + "/f/c";
+    topics[TOPIC_SWING_MODE_COMMAND] = sanitized_name + "/s/c";
+    topics[TOPIC_JSON_COMMAND] = sanitized_name + "/j/c";
+
+    if(this->compact_state_enabled_)
+      topics[TOPIC_COMPACT_STATE] = sanitized_name + "/r";
+
+    if(this->power_recorder_ != nullptr) {
+      topics[TOPIC_POWER_RECORDER_COMMAND] = sanitized_name + "/pwr/c";
+      topics[TOPIC_POWER_RECORDER_DATA] = sanitized_name + "/pwr/d";
+    }
+
+    if(this->thermostat_ != nullptr)
+      topics[TOPIC_THERMOSTAT_STATE] = sanitized_name + "/ctl";
+
+    if(this->ir_capture_ != nullptr) {
+      topics[TOPIC_IR_CAPTURE_COMMAND] = sanitized_name + "/ir/c";
+      topics[TOPIC_IR_CAPTURE_DATA] = sanitized_name + "/ir/d";
+    }
+
+    topics[TOPIC_DISCOVERY] = discovery_info.prefix + "/" + this->component_type() + "/" + sanitized_name + "/config";
+    topics[TOPIC_CURRENT_TEMPERATURE] = this->current_temperature_topic_;
+    topics[FIELD_CURRENT_TEMPERATURE] = this->current_temperature_field_;
+
+    for (uint8_t i = 0; i < Traits::feature_count(); i++)
+      topics[TOPIC_FEATURES + i] = sanitized_name + "/" + Traits::features()[i].name + "/set";
+
+    //сколько бы заняли отдельные строки: объект std::string и его буфер
+    size_t strings_usage = 0;
+    for (const auto &topic : topics)
+      strings_usage += sizeof(std::string) + topic.capacity() + 1;
+
+    if(this->topics_.build(topics) == false)
+      ESP_LOGE(TAG, "'%s': topics do not fit into the topic arena, mqtt is disabled", this->name_.c_str());
+
+    //строки датчика температуры больше не нужны
+    std::string().swap(this->current_temperature_topic_);
+    std::string().swap(this->current_temperature_field_);
+
+    ESP_LOGD(TAG, "'%s': %u topics in %u bytes, as separate strings: %u bytes", this->name_.c_str(),
+             this->topics_.count(), static_cast<unsigned>(this->topics_.memory_usage()), static_cast<unsigned>(strings_usage));
+  }
+
+  void retain_state_restored_() {
+    if(this->power_tracker_->is_initialized()) {
+      power_stable_callback_(power_);
+      this->power_tracker_->reset();
+    }
+
+    this->init_state_from_retain_message_ = false;
+    set_thermostat_target_();
+
+    ESP_LOGD(TAG, "Last state successfully restored: %s", this->ir_climate_->to_string());
+  }
+
+  void restore_saved_state_() {
+    this->state_preference_ = global_preferences.make_preference<typename Driver::CompactState>(
+        fnv1_hash("climate_state_" + get_sanitized_name_()), true);
+
+    if(this->state_preference_.load(&this->saved_state_) == false) {
+      ESP_LOGD(TAG, "No saved state, waiting for retain message");
+      return;
+    }
+
+    if(this->ir_climate_->restore_compact_state(this->saved_state_) == false) {
+      ESP_LOGW(TAG, "Saved state is not recognized, waiting for retain message");
+      return;
+    }
+
+    this->state_restored_ = true;
+    set_thermostat_target_();
+
+    ESP_LOGI(TAG, "State restored from flash");
+  }
+
+  void schedule_state_save_() {
+    this->state_save_pending_ = true;
+    this->state_changed_at_ = millis();
+  }
+
+  void save_state_() {
+    if(this->state_save_pending_ == false)
+      return;
+
+    if((millis() - this->state_changed_at_) < this->state_save_delay_)
+      return;
+
+    this->state_save_pending_ = false;
+
+    auto state = get_compact_state_();
+
+    //во flash пишем только если состояние отличается от сохраненного
+    if(memcmp(&state, &this->saved_state_, sizeof(state)) == 0)
+      return;
+
+    if(this->state_preference_.save(&state) == false) {
+      ESP_LOGW(TAG, "Saving state to flash failed");
+      return;
+    }
+
+    this->saved_state_ = state;
+    ESP_LOGD(TAG, "State saved to flash");
+  }
+
+  void flush_pending_commands_() {
+    if(this->send_pending_ == false && this->publish_pending_ == false)
+      return;
+
+    if((millis() - this->pending_since_) < this->command_coalesce_window_)
+      return;
+
+    if(this->send_pending_)
+      ir_climate_->send();
+
+    this->send_pending_ = false;
+    this->publish_pending_ = false;
+
+    this->publish_state_();
+  }
+
+  bool publish_state_(bool force = false) {
+    latency_histogram::LatencyProbe latency(latency_histogram::PHASE_PUBLISH_STATE);
+
+    //в /i и во flash уходит цель регулятора, а не уставка в кадре: она тоже часть отпечатка, шаг 0.5 - удвоенное значение
+    const auto target_temp = get_target_temp_();
+    auto fingerprint = ir_climate_->get_state_fingerprint();
+    fingerprint |= (uint64_t) (uint8_t) (target_temp * 2) << 56;
+
+    if(force == false && this->state_published_ && fingerprint == this->published_fingerprint_) {
+      this->suppressed_publishes_++;
+      ESP_LOGV(TAG, "state not changed, publish skipped, suppressed: %u", this->suppressed_publishes_);
+      //flash мог отстать от /i, save_state_() сам сравнит с сохраненным; ждущую запись не откладываем
+      if(this->state_save_pending_ == false)
+        schedule_state_save_();
+      return true;
+    }
+
+    schedule_state_save_();
+
+    heap_diagnostics::HeapProbe probe(heap_diagnostics::PROBE_PUBLISH_JSON);
+
+    auto success = this->publish_json(this->topics_.get(TOPIC_INFO), [this, target_temp](JsonObject &root) {
+
+      root["hvac"] = ir_climate_->get_hvac_mode_str();
+      root["fm"] = ir_climate_->get_fan_str();
+      root["t"] = target_temp;
+      root["sm"] = ir_climate_->get_swing_mode_str();
+
+      JsonObject &attributes = root.createNestedObject("attrs");
+      JsonArray &fan_modes_al = attributes.createNestedArray("fan_modes_al");
+
+      for (uint8_t i = 0; i < Traits::feature_count(); i++) {
+        const ClimateFeature<Driver> &feature = Traits::features()[i];
+        attributes[feature.name] = feature.get(ir_climate_);
+        attributes[feature.allowed_name] = feature.allowed(ir_climate_);
+      }
+
+      //возможность менять температуру
+      attributes["set_temp_al"] = ir_climate_->set_temp_allowed();
+      attributes["mode"] = ir_climate_->get_mode_str();
+
+      Traits::add_state_attributes(ir_climate_, root, attributes);
+
+      //маска режима, порядок как в fan_modes, fan_bit находится по типу fan_mode в пространстве имен драйвера
+      const auto fan_modes_mask = ir_climate_->get_fan_modes_mask();
+      for (auto fan_mode : ir_climate_->fan_modes) {
+        if(fan_modes_mask & fan_bit(fan_mode))
+          fan_modes_al.add(Driver::fan_mode_to_str(fan_mode));
+      }
+
+    });
+
+    ESP_LOGD(TAG, "%s publish state: [%s]", success ? "success" : "failed", ir_climate_->to_string());
+
+    if(success && this->topics_.has(TOPIC_COMPACT_STATE)) {
+      auto compact_state = encode_compact_state(get_compact_state_());
+      success = this->publish(this->topics_.get(TOPIC_COMPACT_STATE), compact_state);
+      ESP_LOGV(TAG, "compact state published: %u bytes", static_cast<unsigned>(compact_state.size()));
+    }
+
+    if(success) {
+      this->published_fingerprint_ = fingerprint;
+      this->state_published_ = true;
+    }
+
+    return success;
+  }
+};
+
+}  // namespace mqtt_climate
@@ -6,15 +6,41 @@ namespace mqtt_subscribe_json {
 
 static const char *TAG =  "mqtt_json_subscribe.sensor";
 
+//Одна подписка на топик, одно разбираемое сообщение, значения раздаются нескольким сенсорам.
+//Поле задается путем через точку ("power", "update.state"), путь разбивается один раз при добавлении.
 class MQTTSubscribeJsonSensor : public sensor::Sensor, public Component {
  private:
+  struct Field {
+    std::string path;
+    std::vector<std::string> keys;
+    sensor::Sensor *sensor;
+  };
+
   std::string sensor_value_filed_;
   std::string topic_;
+  std::vector<Field> fields_;
  public:
-  void set_topic(const std::string &topic, const std::string &filed) { topic_ = topic; sensor_value_filed_ = filed; }
+  //основное поле - значение самого сенсора, всегда первое в fields_: повторный вызов заменяет его,
+  //add_field() до set_topic() его не сдвигает
+  void set_topic(const std::string &topic, const std::string &filed) {
+    topic_ = topic;
+    sensor_value_filed_ = filed;
+
+    if (this->fields_.empty() == false && this->fields_.front().sensor == this)
+      this->fields_.front() = make_field_(filed, this);
+    else
+      this->fields_.insert(this->fields_.begin(), make_field_(filed, this));
+  }
+
+  //дополнительное поле того же сообщения, возвращает сенсор для него
+  sensor::Sensor *add_field(const std::string &path) {
+    auto sensor = new sensor::Sensor();
+    this->fields_.push_back(make_field_(path, sensor));
+    return sensor;
+  }
 
   void setup() override {
-    mqtt::global_mqtt_client->subscribe_json(this->topic_, [this](const std::string &topic, JsonObject &payload) { update_sensor_value_(payload); }, this->qos_);
+    mqtt::global_mqtt_client->subscribe_json(this->topic_, [this](const std::string &, JsonObject &payload) { update_sensor_value_(payload); }, this->qos_);
   }
 
   void set_parent(mqtt::MQTTClientComponent *parent) { parent_ = parent; }
@@ -24,20 +50,56 @@ class MQTTSubscribeJsonSensor : public sensor::Sensor, public Component {
   void dump_config() {
     LOG_SENSOR("", "MQTT Subscribe", this);
     ESP_LOGCONFIG(TAG, "  Topic: %s, Field: %s", this->topic_.c_str(), this->sensor_value_filed_.c_str());
+    for (const auto &field : this->fields_) {
+      if (field.sensor != this) {
+        ESP_LOGCONFIG(TAG, "  Field: %s", field.path.c_str());
+      }
+    }
   }
 
   float get_setup_priority() const { return setup_priority::AFTER_CONNECTION; }
 
  private:
+  static Field make_field_(const std::string &path, sensor::Sensor *sensor) {
+    Field field;
+    field.path = path;
+    field.sensor = sensor;
+
+    size_t start = 0;
+    while (true) {
+      auto dot = path.find('.', start);
+      field.keys.push_back(path.substr(start, dot - start));
+      if (dot == std::string::npos)
+        break;
+      start = dot + 1;
+    }
+
+    return field;
+  }
+
   void update_sensor_value_(JsonObject &root) {
-    //Можно сделать разбивку по точкам, вытягивать разный уроверь вложенности данных, но тут это не требуется
-    if(root.containsKey(this->sensor_value_filed_) == false)
-      return;
+    for (auto &field : this->fields_) {
+      float value = read_field_(root, field.keys);
+
+      if(isnan(value) == false)
+        field.sensor->publish_state(value);
+    }
+  }
+
+  static float read_field_(JsonObject &root, const std::vector<std::string> &keys) {
+    JsonObject *object = &root;
+
+    for (size_t i = 0; i + 1 < keys.size(); i++) {
+      JsonObject &child = (*object)[keys[i]];
+      if (child.success() == false)
+        return NAN;
+      object = &child;
+    }
 
-    float value = root[this->sensor_value_filed_] | NAN;
+    if(object->containsKey(keys.back()) == false)
+      return NAN;
 
-    if(isnan(value) == false)
-      this->publish_state(value);
+    return (*object)[keys.back()] | NAN;
   }
 
  protected:
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "esphome.h"
+
+//Кольцевой буфер отсчетов датчика питания в том виде, в котором они приходят в PowerTracker.
+//Нужен чтобы снять реальный поток отсчетов с устройства и прогнать его через PowerTracker::set_power(power, now).
+//
+//Формат выгрузки (little-endian):
+//  char[4]  magic "PWR1"
+//  uint32   количество отсчетов N
+//  N раз:
+//    uint32 время отсчета, ms (millis())
+//    float  значение, W
+//Отсчеты идут от старого к новому.
+class PowerSampleRecorder {
+ private:
+  struct Sample {
+    uint32_t time;
+    float power;
+  };
+
+  std::vector<Sample> samples_;
+  //позиция для следующей записи
+  uint16_t head_{0};
+  uint16_t count_{0};
+
+ public:
+  explicit PowerSampleRecorder(uint16_t capacity) { samples_.resize(capacity); }
+
+  void add(uint32_t time, float power) {
+    if(this->samples_.empty())
+      return;
+
+    this->samples_[this->head_] = Sample{time, power};
+    this->head_ = (this->head_ + 1) % this->samples_.size();
+
+    if(this->count_ < this->samples_.size())
+      this->count_++;
+  }
+
+  void clear() {
+    this->head_ = 0;
+    this->count_ = 0;
+  }
+
+  uint16_t size() const { return this->count_; }
+
+  uint16_t capacity() const { return this->samples_.size(); }
+
+  std::string dump() const {
+    std::string payload;
+    payload.reserve(8 + this->count_ * 8);
+    payload.append("PWR1", 4);
+    append_u32_(payload, this->count_);
+
+    if(this->count_ == 0)
+      return payload;
+
+    //самый старый отсчет
+    uint16_t index = (this->head_ + this->samples_.size() - this->count_) % this->samples_.size();
+
+    for(uint16_t i = 0; i < this->count_; i++) {
+      const Sample &sample = this->samples_[index];
+      append_u32_(payload, sample.time);
+
+      uint32_t power_bits;
+      memcpy(&power_bits, &sample.power, sizeof(power_bits));
+      append_u32_(payload, power_bits);
+
+      index = (index + 1) % this->samples_.size();
+    }
+
+    return payload;
+  }
+
+ private:
+  static void append_u32_(std::string &payload, uint32_t value) {
+    for(uint8_t i = 0; i < 4; i++)
+      payload.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+  }
+};
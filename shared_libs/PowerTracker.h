@@ -1,3 +1,16 @@
+#pragma once
+
+#include "esphome.h"
+
+//Отслеживание уровня потребления кондиционера.
+//Смена уровня определяется двусторонним CUSUM относительно последнего стабильного значения:
+//отклонения в пределах drift считаются шумом, накопленное отклонение больше threshold - новым уровнем.
+//Переход через max_power_in_off_state_ считается сменой уровня, даже если он меньше threshold.
+//Рост подтверждается сразу, падение - drop_confirm_samples_ отсчетами подряд (повторы того же значения тоже
+//считаются) или, если датчик шлет отсчеты только при изменении, тем, что падение держится drop_confirm_time_ ms.
+//Так провал на один отсчет при работе компрессора не выглядит как выключение.
+//Если новый уровень так и не подтвердился, через power_stable_time_ берется последний отсчет.
+//set_power - каждый отсчет датчика, update - из loop(), таймеры подтверждения и периодической проверки.
 class PowerTracker {
  private:
   enum PowerState : uint8_t {
@@ -16,12 +29,18 @@ class PowerTracker {
   PowerState power_state_;
   CallbackManager<void(float)> power_callback_{};
 
-  unsigned long increase_count_{0};
-  float increase_value_{0.0};
-
-  unsigned long decrease_count_{0};
-  float decrease_value_{0.0};
   float stable_power_{0.0};
+  float cusum_up_{0.0};
+  float cusum_down_{0.0};
+  //отклонение от стабильного уровня, которое считаем шумом, W
+  float drift_{25.0};
+  //накопленное отклонение, после которого уровень считается изменившимся, W
+  float threshold_{100.0};
+  //сколько отсчетов подряд отклоняются в одну сторону
+  uint8_t run_length_{0};
+  //подтверждение падения: отсчетов подряд или время с начала падения, ms
+  uint8_t drop_confirm_samples_{2};
+  uint32_t drop_confirm_time_{5000};
 
  public:
   PowerTracker(uint16_t power_stable_time_seconds, uint16_t stable_power_timeout_seconds, uint16_t max_power_in_off_state) {
@@ -38,13 +57,26 @@ class PowerTracker {
     this->power_callback_.add(std::move(callback));
   }
 
+  void set_change_detection(float drift, float threshold) {
+    this->drift_ = drift;
+    this->threshold_ = threshold;
+  }
+
+  void set_drop_confirmation(uint8_t samples, uint32_t time_ms) {
+    this->drop_confirm_samples_ = samples;
+    this->drop_confirm_time_ = time_ms;
+  }
+
   bool is_initialized() { return this->initialized_; }
 
   void reset() { this->initialized_ = false; }
 
-  void initialize(float power) {
+  void initialize(float power) { initialize(power, millis()); }
+
+  //now - время отсчета в ms, позволяет прогонять записанные отсчеты в ускоренном времени
+  void initialize(float power, unsigned long now) {
     this->initialized_ = true;
-    set_stable_power_(power);
+    set_stable_power_(power, now);
   }
 
   bool is_power_unknown() {
@@ -55,14 +87,18 @@ class PowerTracker {
     return this->power_state_ == PowerState::STABLE;
   }
 
+  //решение принимается по подтвержденному уровню, а не по последнему отсчету
   bool power_on() {
-    if(this->power_ > this->max_power_in_off_state_)
+    if(this->stable_power_ > this->max_power_in_off_state_)
       return true;
 
     return false;
   }
 
-  void set_power(float power) {
+  void set_power(float power) { set_power(power, millis()); }
+
+  //отсчет датчика, повтор прежнего значения - тоже отсчет
+  void set_power(float power, unsigned long now) {
 
     if(initialized_ == false)
       return;
@@ -70,93 +106,122 @@ class PowerTracker {
     if (isnan(power))
       return;
 
-    //если значения не равны, то ставим новое значение
-    if(power_ != power) {
-
-      if(power > this->power_) {
-        power_state_ = PowerState::UP;
-        increase_count_ += 1;
-        increase_value_ += power - power_;
-      }
-      else {
-        power_state_ = PowerState::DOWN;
-        decrease_count_ += 1;
-        decrease_value_ += power_ - power;
-      }
-
-      //если суммарно питание увеличилось на 100
-      if (power - stable_power_ > 100) {
-        set_stable_power_(power);
-        ESP_LOGD("power_tracker", "Питание увеличилось на: %.2fW, считаем его стабильным", (power - stable_power_ ));
-        power_callback_.call(power);
-        return;
-      }
-
-      float total_power_change = abs(increase_count_ * increase_value_ - decrease_count_ * decrease_value_);
-      auto changes_count = increase_count_ + decrease_count_;
-
-      if(changes_count > 4 && (total_power_change == 0 || total_power_change == abs(stable_power_ - power))) {
-        ESP_LOGD("power_tracker", "питание нестабильно, но стабильно изменяется");
-        set_stable_power_(power);
-        power_callback_.call(power);
-        return;
-      }
-
-      //если питание все возрастает
-      if(increase_count_ > 6) {
-        ESP_LOGD("power_tracker", "слишком много изменений");
-        set_stable_power_(power);
-        power_callback_.call(power);
-        return;
-      }
+    add_sample_(power, now);
+  }
 
-      power_ = power;
-      power_time_ = millis();
+  void update() { update(millis()); }
 
-      ESP_LOGD("power_tracker","Отслеживаем питание: %.2f", this->power_);
+  void update(unsigned long now) {
 
+    if(initialized_ == false)
       return;
-    }
 
-    auto change_time = millis() - this->power_time_;
+    auto change_time = now - this->power_time_;
 
     if(power_state_ == PowerState::STABLE) {
 
       if(change_time >= this->stable_power_timeout_) {
-        ESP_LOGD("power_tracker","Питание %.2fW стабильное, проверка состояния", this->power_);
-        power_time_ = millis();
-        power_callback_.call(power);
+        ESP_LOGD("power_tracker","Питание %.2fW стабильное, проверка состояния", this->stable_power_);
+        power_time_ = now;
+        power_callback_.call(this->stable_power_);
       }
       return;
     }
 
-    //т.е. состояние конечное, не было изменений в течении power_stable_time_ секунд
+    //датчик молчит после падения, новых отсчетов для подтверждения не будет
+    if(level_down_confirmed_(now)) {
+      confirm_level_(this->power_, now);
+      return;
+    }
+
+    //уровень не подтвердился, но и не вернулся к стабильному в течении power_stable_time_ секунд
     if(change_time >= power_stable_time_) {
       ESP_LOGD("power_tracker", "Питание %.2fW стабильное", this->power_);
-      set_stable_power_(power);
-      power_callback_.call(power);
+      set_stable_power_(this->power_, now);
+      power_callback_.call(this->power_);
     }
   }
 
  private:
-  void set_stable_power_(float power) {
+  void add_sample_(float power, unsigned long now) {
+    this->power_ = power;
+
+    const float deviation = power - this->stable_power_;
+    this->cusum_up_ = std::max(0.0f, this->cusum_up_ + deviation - this->drift_);
+    this->cusum_down_ = std::max(0.0f, this->cusum_down_ - deviation - this->drift_);
+
+    PowerState direction = PowerState::STABLE;
+    if(deviation > this->drift_)
+      direction = PowerState::UP;
+    else if(deviation < -this->drift_)
+      direction = PowerState::DOWN;
+
+    if(direction == PowerState::STABLE) {
+      //вернулись в полосу шума
+      this->run_length_ = 0;
+      if(this->power_state_ != PowerState::STABLE) {
+        this->power_state_ = PowerState::STABLE;
+        this->power_time_ = now;
+      }
+      ESP_LOGD("power_tracker","Отслеживаем питание: %.2f, в пределах шума", power);
+      return;
+    }
+
+    if(direction != this->power_state_) {
+      this->power_state_ = direction;
+      this->power_time_ = now;
+      this->run_length_ = 0;
+    }
+
+    if(this->run_length_ < UINT8_MAX)
+      this->run_length_++;
+
+    const bool level_up = direction == PowerState::UP && (this->cusum_up_ > this->threshold_ || crosses_off_level_(power));
+
+    if(level_up || level_down_confirmed_(now)) {
+      confirm_level_(power, now);
+      return;
+    }
+
+    ESP_LOGD("power_tracker","Отслеживаем питание: %.2f, cusum up: %.2f, down: %.2f", power, this->cusum_up_, this->cusum_down_);
+  }
+
+  //отсчет по другую сторону границы выключенного состояния, чем подтвержденный уровень
+  bool crosses_off_level_(float power) const {
+    return (power > this->max_power_in_off_state_) != (this->stable_power_ > this->max_power_in_off_state_);
+  }
+
+  bool level_down_confirmed_(unsigned long now) const {
+    if(this->power_state_ != PowerState::DOWN)
+      return false;
+
+    if(this->cusum_down_ <= this->threshold_ && crosses_off_level_(this->power_) == false)
+      return false;
+
+    return this->run_length_ >= this->drop_confirm_samples_ || (now - this->power_time_) >= this->drop_confirm_time_;
+  }
+
+  void confirm_level_(float power, unsigned long now) {
+    ESP_LOGD("power_tracker", "Смена уровня питания: %.2fW -> %.2fW", this->stable_power_, power);
+    set_stable_power_(power, now);
+    power_callback_.call(power);
+  }
+
+  void set_stable_power_(float power, unsigned long now) {
 
-    ESP_LOGD("power_tracker", "stable_power: %.2f, increase_count: %ld, increase_value: %.2f, decrease_count: %ld, decrease_value: %.2f, new stable power: %.2f",
+    ESP_LOGD("power_tracker", "stable_power: %.2f, cusum up: %.2f, cusum down: %.2f, new stable power: %.2f",
              stable_power_,
-             increase_count_,
-             increase_value_,
-             decrease_count_,
-             decrease_value_,
+             cusum_up_,
+             cusum_down_,
              power);
 
     this->power_state_ = PowerState::STABLE;
-    this->power_time_ = millis();
+    this->power_time_ = now;
     this->stable_power_ = power;
     this->power_ = power;
 
-    this->increase_count_ = 0;
-    this->increase_value_ = 0.0;
-    this->decrease_count_ = 0;
-    this->decrease_value_ = 0.0;
+    this->cusum_up_ = 0.0;
+    this->cusum_down_ = 0.0;
+    this->run_length_ = 0;
   }
-};
\ No newline at end of file
+};
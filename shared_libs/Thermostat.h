@@ -0,0 +1,90 @@
+#pragma once
+
+#include "esphome.h"
+
+//Регулятор уставки кондиционера по температуре в комнате.
+//Кондиционер держит температуру по своему датчику, в комнате она отличается на пару градусов.
+//Регулятор смещает уставку относительно цели: в комнате теплее цели больше чем на hysteresis - уставка
+//ниже на шаг, холоднее - выше на шаг. Направление одинаковое для охлаждения и нагрева.
+//Смещение меняется не чаще раза в interval и не больше max_offset в обе стороны,
+//без свежих показаний (старше timeout) смещение сбрасывается и уставка возвращается к цели.
+class Thermostat {
+ private:
+  float hysteresis_;
+  float max_offset_;
+  uint32_t interval_;
+  uint32_t timeout_;
+
+  float room_temperature_{NAN};
+  uint32_t room_temperature_at_{0};
+  float offset_{0};
+  uint32_t last_step_at_{0};
+  bool stepped_{false};
+
+ public:
+  Thermostat(float hysteresis, float max_offset, uint32_t interval_seconds, uint32_t timeout_seconds) {
+    hysteresis_ = hysteresis;
+    max_offset_ = max_offset;
+    interval_ = interval_seconds * 1000;
+    timeout_ = timeout_seconds * 1000;
+  }
+
+  void set_room_temperature(float temperature, uint32_t now) {
+    this->room_temperature_ = temperature;
+    this->room_temperature_at_ = now;
+  }
+
+  float get_room_temperature() const { return this->room_temperature_; }
+
+  //есть показания не старше timeout
+  bool has_room_temperature(uint32_t now) const {
+    return isnan(this->room_temperature_) == false && (now - this->room_temperature_at_) < this->timeout_;
+  }
+
+  float get_offset() const { return this->offset_; }
+
+  //новая цель, смещение начинаем с нуля, первый шаг не раньше чем через interval
+  void reset(uint32_t now) {
+    this->offset_ = 0;
+    this->last_step_at_ = now;
+    this->stepped_ = true;
+  }
+
+  //показания устарели: смещение к нулю, true - смещение было
+  bool expire(uint32_t now) {
+    if(this->offset_ == 0 || has_room_temperature(now))
+      return false;
+
+    this->offset_ = 0;
+    this->last_step_at_ = now;
+    this->stepped_ = true;
+    return true;
+  }
+
+  //true - смещение изменилось, step - шаг уставки кондиционера
+  bool update(float target, float step, uint32_t now) {
+    if(has_room_temperature(now) == false)
+      return false;
+
+    if(this->stepped_ && (now - this->last_step_at_) < this->interval_)
+      return false;
+
+    const float error = this->room_temperature_ - target;
+    float offset = this->offset_;
+
+    if(error > this->hysteresis_)
+      offset -= step;
+    else if(error < -this->hysteresis_)
+      offset += step;
+    else
+      return false;
+
+    if(offset > this->max_offset_ || offset < -this->max_offset_)
+      return false;
+
+    this->offset_ = offset;
+    this->last_step_at_ = now;
+    this->stepped_ = true;
+    return true;
+  }
+};
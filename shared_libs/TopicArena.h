@@ -0,0 +1,60 @@
+#pragma once
+
+#include "esphome.h"
+
+//Строки топиков компонента в одном буфере точного размера.
+//Собирается один раз из временного списка, дальше get(index) возвращает строку из буфера.
+//Пустая строка в списке - топик не используется, get вернет "".
+//Смещения 16 бит: все строки вместе с нулями не больше 65535 байт, иначе build() откажется.
+class TopicArena {
+ private:
+  char *buffer_{nullptr};
+  uint16_t *offsets_{nullptr};
+  uint8_t count_{0};
+  uint16_t size_{0};
+
+ public:
+  //false - строки не помещаются в uint16 смещения или топиков больше 255, буфер остается пустым
+  bool build(const std::vector<std::string> &topics) {
+    delete[] this->buffer_;
+    delete[] this->offsets_;
+    this->buffer_ = nullptr;
+    this->offsets_ = nullptr;
+    this->count_ = 0;
+    this->size_ = 0;
+
+    size_t size = 0;
+    for (const auto &topic : topics)
+      size += topic.size() + 1;
+
+    if (size > UINT16_MAX || topics.size() > UINT8_MAX)
+      return false;
+
+    this->count_ = topics.size();
+    this->size_ = size;
+    this->buffer_ = new char[this->size_];
+    this->offsets_ = new uint16_t[this->count_];
+
+    uint16_t offset = 0;
+    for (uint8_t i = 0; i < this->count_; i++) {
+      this->offsets_[i] = offset;
+      memcpy(this->buffer_ + offset, topics[i].c_str(), topics[i].size() + 1);
+      offset += topics[i].size() + 1;
+    }
+    return true;
+  }
+
+  //индекс за пределами таблицы - неиспользуемый топик
+  const char *get(uint8_t index) const { return index < this->count_ ? this->buffer_ + this->offsets_[index] : ""; }
+
+  bool has(uint8_t index) const { return index < this->count_ && this->buffer_[this->offsets_[index]] != '\0'; }
+
+  uint16_t offset(uint8_t index) const { return this->offsets_[index]; }
+
+  uint16_t size() const { return this->size_; }
+
+  uint8_t count() const { return this->count_; }
+
+  //буфер и таблица смещений
+  size_t memory_usage() const { return this->size_ + this->count_ * sizeof(uint16_t); }
+};